@@ -22,8 +22,15 @@
 #include <nnapi/SharedMemory.h>
 #include <nnapi/TypeUtils.h>
 
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
 #include <limits>
 #include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -44,6 +51,7 @@
 #ifdef NN_INCLUDE_CPU_IMPLEMENTATION
 #include "BidirectionalSequenceLSTM.h"
 #include "Cast.h"
+#include "CpuOperationUtils.h"
 #include "EmbeddingLookup.h"
 #include "ExpandDims.h"
 #include "HashtableLookup.h"
@@ -56,6 +64,12 @@
 #include "RNN.h"
 #include "SVDF.h"
 #include "Tile.h"
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wsign-compare"
+#include <public/gemmlowp.h>
+#include <ruy/context.h>
+#pragma clang diagnostic pop
 #endif  // NN_INCLUDE_CPU_IMPLEMENTATION
 
 namespace android {
@@ -66,8 +80,9 @@ class OperationExecutionContext : public IOperationExecutionContext {
     DISALLOW_IMPLICIT_CONSTRUCTORS(OperationExecutionContext);
 
    public:
-    OperationExecutionContext(const Operation* operation, RunTimeOperandInfo* operands)
-        : operation(operation), operands(operands) {}
+    OperationExecutionContext(const Operation* operation, RunTimeOperandInfo* operands,
+                              const CpuFloat16ConstantCache* float16ConstantCache = nullptr)
+        : operation(operation), operands(operands), float16ConstantCache(float16ConstantCache) {}
 
     uint32_t getNumInputs() const override;
     OperandType getInputType(uint32_t index) const override;
@@ -88,6 +103,12 @@ class OperationExecutionContext : public IOperationExecutionContext {
     bool isOmittedInput(uint32_t index) const override;
     bool isOmittedOutput(uint32_t index) const override;
 
+    void* getScratchBuffer(size_t size) override;
+    void* getFloat16ConversionBuffer(size_t size) override;
+    gemmlowp::GemmContext* getGemmContext() override;
+    ruy::Context* getRuyContext() override;
+    const float* getFloat32ConstantInput(uint32_t index) const override;
+
     // Return false if any of inputs or outputs is omitted, i.e. has lifetime of NO_VALUE.
     bool checkNoOmittedOperand() const;
     // Return false if any of inputs has dimension 0.
@@ -100,6 +121,7 @@ class OperationExecutionContext : public IOperationExecutionContext {
 
     const Operation* operation;
     RunTimeOperandInfo* operands;
+    const CpuFloat16ConstantCache* float16ConstantCache;
 
     int result = ANEURALNETWORKS_NO_ERROR;
 };
@@ -221,13 +243,18 @@ bool setInfoAndAllocateIfNeeded(RunTimeOperandInfo* info, const Shape& shape, in
             return false;
         }
         uint32_t length = nonExtensionOperandSizeOfData(info->type, info->dimensions);
-        if (length > 0) {
+        if (length > 0 && info->growableBuffer != nullptr) {
+            info->buffer = info->growableBuffer->reserve(length);
+            info->length = length;
+            info->isPlanned = true;
+        } else if (length > 0) {
             info->buffer = new uint8_t[length];
             if (info->buffer == nullptr) {
                 *result = ANEURALNETWORKS_OUT_OF_MEMORY;
                 return false;
             }
             info->length = length;
+            info->isPlanned = false;
         }
     }
     if (!info->isSufficient()) {
@@ -253,6 +280,216 @@ bool OperationExecutionContext::isOmittedOutput(uint32_t index) const {
     return getOutputInfo(index)->lifetime == Operand::LifeTime::NO_VALUE;
 }
 
+// Scratch resources used by one operation at a time. An operation acquires a set the first time
+// it asks for one of the resources and keeps it until it returns, so the operations it runs
+// itself, such as those of an IF branch, share it.
+struct OperationScratch {
+    // Requests above this size are left to the operation to allocate, to bound the memory held
+    // by every set.
+    static constexpr size_t kMaxBufferSize = 1605632;
+
+    // Returns a buffer of at least size bytes, reallocating *buffer if it is smaller, or
+    // nullptr if the allocation fails.
+    static void* reserve(std::unique_ptr<uint8_t[]>* buffer, size_t* bufferSize, size_t size) {
+        if (*bufferSize < size) {
+            buffer->reset(new (std::nothrow) uint8_t[size]);
+            *bufferSize = *buffer != nullptr ? size : 0;
+        }
+        return buffer->get();
+    }
+
+    std::unique_ptr<uint8_t[]> buffer;
+    size_t bufferSize = 0;
+    std::unique_ptr<uint8_t[]> float16ConversionBuffer;
+    size_t float16ConversionBufferSize = 0;
+#ifdef NN_INCLUDE_CPU_IMPLEMENTATION
+    // The maximum number of threads the GEMMs of this set may use. Each context has its own
+    // worker threads.
+    int maxNumGemmThreads = 1;
+    std::unique_ptr<gemmlowp::GemmContext> gemmContext;
+    std::unique_ptr<ruy::Context> ruyContext;
+#endif  // NN_INCLUDE_CPU_IMPLEMENTATION
+};
+
+// The process-wide sets of scratch resources, one per core. When every set is in use, an
+// operation waits for one to be released, which cannot deadlock as an operation holds at most
+// one set and never waits for another operation while holding it.
+//
+// Set k is only acquired while sets 0 to k-1 are in use, so its GEMMs use at most 1/(k+1) of
+// the cores. An operation running alone gets set 0 and all the cores, and the GEMM worker threads
+// of all the sets number O(cores log cores) rather than O(cores²).
+class OperationScratchPool {
+   public:
+    static OperationScratchPool* get() {
+        // Intentionally never destroyed, as operations may still run during process exit.
+        static OperationScratchPool* const pool = new OperationScratchPool();
+        return pool;
+    }
+
+    OperationScratch* acquire() {
+        std::unique_lock<std::mutex> lock(mMutex);
+        auto notInUse = mInUse.end();
+        mCondition.wait(lock, [this, &notInUse] {
+            notInUse = std::find(mInUse.begin(), mInUse.end(), false);
+            return notInUse != mInUse.end();
+        });
+        *notInUse = true;
+        const size_t index = notInUse - mInUse.begin();
+        std::unique_ptr<OperationScratch>& scratch = mScratches[index];
+        if (scratch == nullptr) {
+            scratch = std::make_unique<OperationScratch>();
+#ifdef NN_INCLUDE_CPU_IMPLEMENTATION
+            scratch->maxNumGemmThreads =
+                    static_cast<int>(std::max(mScratches.size() / (index + 1), size_t{1}));
+#endif  // NN_INCLUDE_CPU_IMPLEMENTATION
+        }
+        return scratch.get();
+    }
+
+    void release(const OperationScratch* scratch) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            const auto it = std::find_if(mScratches.begin(), mScratches.end(),
+                                         [scratch](const auto& s) { return s.get() == scratch; });
+            CHECK(it != mScratches.end());
+            mInUse[it - mScratches.begin()] = false;
+        }
+        mCondition.notify_one();
+    }
+
+   private:
+    OperationScratchPool()
+        : mScratches(std::max(std::thread::hardware_concurrency(), 1u)),
+          mInUse(mScratches.size(), false) {}
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    // Made on first use.
+    std::vector<std::unique_ptr<OperationScratch>> mScratches;
+    std::vector<bool> mInUse;
+};
+
+// The state of the operations running on the current thread.
+struct ThreadOperationState {
+    // The set of scratch resources of the outermost operation, if it has acquired one.
+    OperationScratch* scratch = nullptr;
+    // The number of executeOperation() calls in progress.
+    uint32_t depth = 0;
+    // The number of operations, including the one on this thread, that the executor may run
+    // concurrently. Their GEMMs share the cores rather than each using all of them.
+    uint32_t concurrentOperationCount = 1;
+};
+
+ThreadOperationState* getThreadOperationState() {
+    thread_local ThreadOperationState state;
+    return &state;
+}
+
+// Returns the scratch resources of the operation running on the current thread, acquiring them if
+// needed. Only to be called while an executeOperation() is in progress.
+OperationScratch* getOperationScratch() {
+    ThreadOperationState* state = getThreadOperationState();
+    CHECK_GT(state->depth, 0u);
+    if (state->scratch == nullptr) {
+        state->scratch = OperationScratchPool::get()->acquire();
+    }
+    return state->scratch;
+}
+
+// Marks an executeOperation() call in progress, and releases the scratch resources once the
+// outermost one returns.
+class ScopedOperation {
+   public:
+    ScopedOperation() { ++getThreadOperationState()->depth; }
+    ~ScopedOperation() {
+        ThreadOperationState* state = getThreadOperationState();
+        if (--state->depth == 0 && state->scratch != nullptr) {
+            OperationScratchPool::get()->release(state->scratch);
+            state->scratch = nullptr;
+        }
+    }
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(ScopedOperation);
+};
+
+void* OperationExecutionContext::getScratchBuffer(size_t size) {
+    if (size > OperationScratch::kMaxBufferSize) {
+        return nullptr;
+    }
+    OperationScratch* scratch = getOperationScratch();
+    return OperationScratch::reserve(&scratch->buffer, &scratch->bufferSize, size);
+}
+
+void* OperationExecutionContext::getFloat16ConversionBuffer(size_t size) {
+    if (size > OperationScratch::kMaxBufferSize) {
+        return nullptr;
+    }
+    OperationScratch* scratch = getOperationScratch();
+    return OperationScratch::reserve(&scratch->float16ConversionBuffer,
+                                     &scratch->float16ConversionBufferSize, size);
+}
+
+#ifdef NN_INCLUDE_CPU_IMPLEMENTATION
+// Returns the maximum number of threads a GEMM of the current operation may use. gemmlowp and ruy
+// use fewer than this for small problems.
+int getMaxNumGemmThreads(const OperationScratch& scratch) {
+    const uint32_t concurrentOperationCount =
+            getThreadOperationState()->concurrentOperationCount;
+    return std::min(scratch.maxNumGemmThreads,
+                    static_cast<int>(std::max(
+                            std::thread::hardware_concurrency() / concurrentOperationCount, 1u)));
+}
+
+// getThreadGemmContext() and getThreadRuyContext() are also used by the operations still
+// implemented in CpuExecutor::executeOperation, which have no OperationExecutionContext.
+gemmlowp::GemmContext* getThreadGemmContext() {
+    OperationScratch* scratch = getOperationScratch();
+    if (scratch->gemmContext == nullptr) {
+        scratch->gemmContext = std::make_unique<gemmlowp::GemmContext>();
+    }
+    scratch->gemmContext->set_max_num_threads(getMaxNumGemmThreads(*scratch));
+    return scratch->gemmContext.get();
+}
+
+ruy::Context* getThreadRuyContext() {
+    OperationScratch* scratch = getOperationScratch();
+    if (scratch->ruyContext == nullptr) {
+        scratch->ruyContext = std::make_unique<ruy::Context>();
+    }
+    scratch->ruyContext->set_max_num_threads(getMaxNumGemmThreads(*scratch));
+    return scratch->ruyContext.get();
+}
+#endif  // NN_INCLUDE_CPU_IMPLEMENTATION
+
+gemmlowp::GemmContext* OperationExecutionContext::getGemmContext() {
+#ifdef NN_INCLUDE_CPU_IMPLEMENTATION
+    return getThreadGemmContext();
+#else   // NN_INCLUDE_CPU_IMPLEMENTATION
+    return nullptr;
+#endif  // NN_INCLUDE_CPU_IMPLEMENTATION
+}
+
+const float* OperationExecutionContext::getFloat32ConstantInput(uint32_t index) const {
+    const RunTimeOperandInfo* info = getInputInfo(index);
+    // Only constants are looked up, as a request memory may alias a constant pool.
+    if (float16ConstantCache == nullptr || info->type != OperandType::TENSOR_FLOAT16 ||
+        (info->lifetime != Operand::LifeTime::CONSTANT_COPY &&
+         info->lifetime != Operand::LifeTime::CONSTANT_REFERENCE &&
+         info->lifetime != Operand::LifeTime::POINTER)) {
+        return nullptr;
+    }
+    return float16ConstantCache->getFloat32Value(info->buffer);
+}
+
+ruy::Context* OperationExecutionContext::getRuyContext() {
+#ifdef NN_INCLUDE_CPU_IMPLEMENTATION
+    return getThreadRuyContext();
+#else   // NN_INCLUDE_CPU_IMPLEMENTATION
+    return nullptr;
+#endif  // NN_INCLUDE_CPU_IMPLEMENTATION
+}
+
 bool OperationExecutionContext::checkNoOmittedOperand() const {
     for (uint32_t i = 0; i < operation->inputs.size(); i++) {
         NN_RET_CHECK(!isOmittedInput(i))
@@ -402,6 +639,293 @@ bool setRunTimePoolInfosFromMemoryPools(std::vector<RunTimePoolInfo>* poolInfos,
     return true;
 }
 
+#ifdef NN_INCLUDE_CPU_IMPLEMENTATION
+static bool isFusableQuant8Type(OperandType type) {
+    return type == OperandType::TENSOR_QUANT8_ASYMM ||
+           type == OperandType::TENSOR_QUANT8_ASYMM_SIGNED;
+}
+
+// Returns whether the operation can be a float32 step of a fused group.
+static bool isFusableFloatOperation(const Model::Subgraph& subgraph, const Operation& operation) {
+    const auto isFloat32 = [&subgraph](uint32_t operandIndex) {
+        return subgraph.operands[operandIndex].type == OperandType::TENSOR_FLOAT32;
+    };
+    if (operation.outputs.size() != 1 || !isFloat32(operation.outputs[0])) {
+        return false;
+    }
+    switch (operation.type) {
+        case OperationType::ADD:
+        case OperationType::SUB:
+        case OperationType::MUL:
+        case OperationType::DIV:
+            return operation.inputs.size() == 3 && isFloat32(operation.inputs[0]) &&
+                   isFloat32(operation.inputs[1]);
+        case OperationType::RELU:
+        case OperationType::RELU1:
+        case OperationType::RELU6:
+        case OperationType::LOGISTIC:
+        case OperationType::TANH:
+            return operation.inputs.size() == 1 && isFloat32(operation.inputs[0]);
+        default:
+            return false;
+    }
+}
+
+static bool isFusableConversion(const Model::Subgraph& subgraph, const Operation& operation,
+                                OperationType type) {
+    if (operation.type != type || operation.inputs.size() != 1 || operation.outputs.size() != 1) {
+        return false;
+    }
+    const OperandType inputType = subgraph.operands[operation.inputs[0]].type;
+    const OperandType outputType = subgraph.operands[operation.outputs[0]].type;
+    return type == OperationType::DEQUANTIZE
+                   ? isFusableQuant8Type(inputType) && outputType == OperandType::TENSOR_FLOAT32
+                   : inputType == OperandType::TENSOR_FLOAT32 && isFusableQuant8Type(outputType);
+}
+
+// Returns the step of a fusable float32 operation, whose input value is the
+// value computed so far.
+static CpuFusionPlan::Step makeFusedStep(const Operation& operation, uint32_t value) {
+    CpuFusionPlan::Step step = {.type = operation.type};
+    if (operation.inputs.size() == 3) {
+        step.isBinary = true;
+        step.sideIsFirst = operation.inputs[1] == value;
+        step.sideOperand = operation.inputs[step.sideIsFirst ? 0 : 1];
+        step.activationOperand = operation.inputs[2];
+    }
+    return step;
+}
+#endif  // NN_INCLUDE_CPU_IMPLEMENTATION
+
+CpuFusionPlan CpuFusionPlan::create([[maybe_unused]] const Model::Subgraph& subgraph) {
+    NNTRACE_CPU(NNTRACE_PHASE_PREPARATION, "CpuFusionPlan::create");
+    CpuFusionPlan plan;
+#ifdef NN_INCLUDE_CPU_IMPLEMENTATION
+    const std::vector<Operation>& operations = subgraph.operations;
+    const uint32_t operationCount = operations.size();
+    constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+    // The number of reads of each operand, and the operation reading it if
+    // there is exactly one.
+    std::vector<uint32_t> numberOfReads(subgraph.operands.size(), 0);
+    std::vector<uint32_t> reader(subgraph.operands.size(), kNone);
+    for (uint32_t i = 0; i < operationCount; ++i) {
+        for (uint32_t operandIndex : operations[i].inputs) {
+            numberOfReads[operandIndex]++;
+            reader[operandIndex] = i;
+        }
+    }
+
+    plan.mGroupIndexes.assign(operationCount, kNoGroup);
+    for (uint32_t first = 0; first < operationCount; ++first) {
+        const Operation& head = operations[first];
+        if (plan.mGroupIndexes[first] != kNoGroup) {
+            continue;
+        }
+        const bool dequantizes = isFusableConversion(subgraph, head, OperationType::DEQUANTIZE);
+        if (!dequantizes && !isFusableFloatOperation(subgraph, head)) {
+            continue;
+        }
+        Group group = {.operations = {first},
+                       .inputOperand = head.inputs[0],
+                       .dequantizesInput = dequantizes};
+        if (!dequantizes) {
+            group.steps.push_back(makeFusedStep(head, head.inputs[0]));
+        }
+
+        // Extend the chain while its value is a temporary read by only one
+        // operation, which is not part of another group.
+        uint32_t value = head.outputs[0];
+        while (subgraph.operands[value].lifetime == Operand::LifeTime::TEMPORARY_VARIABLE &&
+               numberOfReads[value] == 1 && plan.mGroupIndexes[reader[value]] == kNoGroup) {
+            const uint32_t next = reader[value];
+            const Operation& operation = operations[next];
+            if (isFusableFloatOperation(subgraph, operation)) {
+                group.steps.push_back(makeFusedStep(operation, value));
+            } else if (isFusableConversion(subgraph, operation, OperationType::QUANTIZE)) {
+                group.quantizesOutput = true;
+            } else {
+                break;
+            }
+            group.operations.push_back(next);
+            value = operation.outputs[0];
+            if (group.quantizesOutput) {
+                break;
+            }
+        }
+        if (group.operations.size() < 2) {
+            continue;
+        }
+        group.outputOperand = value;
+        for (uint32_t operationIndex : group.operations) {
+            plan.mGroupIndexes[operationIndex] = plan.mGroups.size();
+        }
+        plan.mGroups.push_back(std::move(group));
+    }
+    VLOG(CPUEXE) << "CpuFusionPlan::create: fused " << plan.mGroups.size() << " groups";
+#endif  // NN_INCLUDE_CPU_IMPLEMENTATION
+    return plan;
+}
+
+const CpuFusionPlan::Group* CpuFusionPlan::getGroup(uint32_t operationIndex) const {
+    if (operationIndex >= mGroupIndexes.size() || mGroupIndexes[operationIndex] == kNoGroup) {
+        return nullptr;
+    }
+    return &mGroups[mGroupIndexes[operationIndex]];
+}
+
+uint32_t CpuFusionPlan::getExecutionPosition(uint32_t operationIndex) const {
+    const Group* group = getGroup(operationIndex);
+    return group != nullptr ? group->operations.back() : operationIndex;
+}
+
+CpuMemoryPlan CpuMemoryPlan::create(const Model::Subgraph& subgraph,
+                                    const CpuFusionPlan* fusionPlan) {
+    NNTRACE_CPU(NNTRACE_PHASE_PREPARATION, "CpuMemoryPlan::create");
+    const size_t operandCount = subgraph.operands.size();
+    constexpr uint32_t kNotWritten = std::numeric_limits<uint32_t>::max();
+
+    // Compute the live range [firstUse, lastUse] of every operand in terms of
+    // the indexes of the operations in the serialized execution order. Fused
+    // operations all run in the position of the last one of their group.
+    std::vector<uint32_t> firstUse(operandCount, kNotWritten);
+    std::vector<uint32_t> lastUse(operandCount, 0);
+    for (uint32_t i = 0; i < subgraph.operations.size(); ++i) {
+        const Operation& operation = subgraph.operations[i];
+        const uint32_t position =
+                fusionPlan != nullptr ? fusionPlan->getExecutionPosition(i) : i;
+        for (uint32_t operandIndex : operation.outputs) {
+            firstUse[operandIndex] = std::min(firstUse[operandIndex], position);
+            lastUse[operandIndex] = std::max(lastUse[operandIndex], position);
+        }
+        for (uint32_t operandIndex : operation.inputs) {
+            lastUse[operandIndex] = std::max(lastUse[operandIndex], position);
+        }
+    }
+
+    CpuMemoryPlan plan;
+    for (uint32_t i = 0; i < operandCount; ++i) {
+        const Operand& operand = subgraph.operands[i];
+        if (operand.lifetime != Operand::LifeTime::TEMPORARY_VARIABLE ||
+            firstUse[i] == kNotWritten || isExtension(operand.type) ||
+            nonExtensionOperandSizeOfDataOverflowsUInt32(operand.type, operand.dimensions)) {
+            continue;
+        }
+        // A size of 0 means that the operand has unknown dimensions.
+        const uint32_t length = nonExtensionOperandSizeOfData(operand);
+        if (length > 0) {
+            plan.mPlannedOperands.push_back({.operandIndex = i, .offset = 0, .length = length});
+        }
+    }
+
+    // Greedy by size: place the largest operands first, each one at the lowest
+    // aligned offset that does not overlap any already placed operand with an
+    // intersecting live range.
+    std::stable_sort(plan.mPlannedOperands.begin(), plan.mPlannedOperands.end(),
+                     [](const PlannedOperand& a, const PlannedOperand& b) {
+                         return a.length > b.length;
+                     });
+    std::vector<std::pair<size_t, size_t>> conflicts;
+    for (size_t i = 0; i < plan.mPlannedOperands.size(); ++i) {
+        PlannedOperand& current = plan.mPlannedOperands[i];
+        conflicts.clear();
+        for (size_t j = 0; j < i; ++j) {
+            const PlannedOperand& placed = plan.mPlannedOperands[j];
+            if (firstUse[current.operandIndex] <= lastUse[placed.operandIndex] &&
+                firstUse[placed.operandIndex] <= lastUse[current.operandIndex]) {
+                conflicts.emplace_back(placed.offset, placed.offset + placed.length);
+            }
+        }
+        std::sort(conflicts.begin(), conflicts.end());
+        size_t offset = 0;
+        for (const auto& [begin, end] : conflicts) {
+            if (offset + current.length <= begin) {
+                break;
+            }
+            offset = std::max(offset, roundUp(end, kAlignment));
+        }
+        current.offset = offset;
+        plan.mArenaSize = std::max(plan.mArenaSize, offset + current.length);
+    }
+
+    VLOG(CPUEXE) << "CpuMemoryPlan::create: planned " << plan.mPlannedOperands.size()
+                 << " temporaries in an arena of " << plan.mArenaSize << " bytes";
+    return plan;
+}
+
+void CpuMemoryPlan::setBuffers(uint8_t* arena, std::vector<RunTimeOperandInfo>* operands) const {
+    CHECK(operands != nullptr);
+    for (const PlannedOperand& planned : mPlannedOperands) {
+        CHECK_LT(planned.operandIndex, operands->size());
+        RunTimeOperandInfo& info = (*operands)[planned.operandIndex];
+        CHECK(info.lifetime == Operand::LifeTime::TEMPORARY_VARIABLE);
+        info.buffer = arena + planned.offset;
+        info.length = planned.length;
+        info.isPlanned = true;
+    }
+}
+
+CpuFloat16ConstantCache CpuFloat16ConstantCache::create(
+        const Model& model, const std::vector<RunTimePoolInfo>& modelPoolInfos) {
+    NNTRACE_CPU(NNTRACE_PHASE_PREPARATION, "CpuFloat16ConstantCache::create");
+    CpuFloat16ConstantCache cache;
+    auto addSubgraph = [&model, &modelPoolInfos, &cache](const Model::Subgraph& subgraph) {
+        for (const Operation& operation : subgraph.operations) {
+            switch (operation.type) {
+                case OperationType::CONV_2D:
+                case OperationType::DEPTHWISE_CONV_2D:
+                case OperationType::TRANSPOSE_CONV_2D:
+                case OperationType::GROUPED_CONV_2D:
+                case OperationType::FULLY_CONNECTED:
+                    break;
+                default:
+                    continue;
+            }
+            // The weights and the bias are the second and third inputs of all of them.
+            for (size_t i = 1; i <= 2 && i < operation.inputs.size(); ++i) {
+                const Operand& operand = subgraph.operands[operation.inputs[i]];
+                if (operand.type != OperandType::TENSOR_FLOAT16) {
+                    continue;
+                }
+                const void* value = nullptr;
+                switch (operand.lifetime) {
+                    case Operand::LifeTime::CONSTANT_COPY:
+                        value = model.operandValues.data() + operand.location.offset;
+                        break;
+                    case Operand::LifeTime::CONSTANT_REFERENCE:
+                        CHECK_LT(operand.location.poolIndex, modelPoolInfos.size());
+                        value = modelPoolInfos[operand.location.poolIndex].getBuffer() +
+                                operand.location.offset;
+                        break;
+                    case Operand::LifeTime::POINTER:
+                        value = std::get<const void*>(operand.location.pointer);
+                        break;
+                    default:
+                        continue;
+                }
+                std::vector<float>& converted = cache.mValues[value];
+                if (converted.empty()) {
+                    const _Float16* float16Value = static_cast<const _Float16*>(value);
+                    const size_t size = nonExtensionOperandSizeOfData(operand) / sizeof(_Float16);
+                    converted.assign(float16Value, float16Value + size);
+                }
+            }
+        }
+    };
+    addSubgraph(model.main);
+    for (const Model::Subgraph& subgraph : model.referenced) {
+        addSubgraph(subgraph);
+    }
+    VLOG(CPUEXE) << "CpuFloat16ConstantCache::create: converted " << cache.mValues.size()
+                 << " constants";
+    return cache;
+}
+
+const float* CpuFloat16ConstantCache::getFloat32Value(const void* float16Value) const {
+    const auto it = mValues.find(float16Value);
+    return it != mValues.end() ? it->second.data() : nullptr;
+}
+
 #ifdef NN_INCLUDE_CPU_IMPLEMENTATION
 template <typename T>
 inline bool convertToNhwcImpl(T* to, const T* from, const std::vector<uint32_t>& fromDim) {
@@ -523,7 +1047,8 @@ static bool convertFromNhwc(RunTimeOperandInfo& to, const RunTimeOperandInfo& fr
 #endif  // NN_INCLUDE_CPU_IMPLEMENTATION
 
 // Decrements the usage count for the operands listed.  Frees the memory
-// allocated for any temporary variable with a count of zero.
+// allocated for any temporary variable with a count of zero, unless it lives
+// in the arena of a CpuMemoryPlan.
 static void consumeOperationInputs(const std::vector<uint32_t>& inputs,
                                    RunTimeOperandInfo* operands) {
     for (uint32_t i : inputs) {
@@ -533,7 +1058,7 @@ static void consumeOperationInputs(const std::vector<uint32_t>& inputs,
             continue;
         }
         info.numberOfUsesLeft--;
-        if (info.numberOfUsesLeft == 0 && info.buffer != nullptr) {
+        if (info.numberOfUsesLeft == 0 && info.buffer != nullptr && !info.isPlanned) {
             delete[] info.buffer;
             info.buffer = nullptr;
         }
@@ -546,7 +1071,71 @@ static void consumeOperationInputs(const std::vector<uint32_t>& inputs,
 static void freeUnusedSubgraphOperands(std::vector<RunTimeOperandInfo>* operands) {
     for (auto& info : *operands) {
         if (info.lifetime == Operand::LifeTime::TEMPORARY_VARIABLE && info.numberOfUsesLeft == 0 &&
-            info.buffer != nullptr) {
+            info.buffer != nullptr && !info.isPlanned) {
+            delete[] info.buffer;
+            info.buffer = nullptr;
+        }
+    }
+}
+
+void CpuExecutor::setModel(const Model& model,
+                           const std::vector<RunTimePoolInfo>& modelPoolInfos) {
+    mModelOperandValues = model.operandValues.data();
+    mModelPoolInfos = &modelPoolInfos;
+    mReferencedSubgraphs = &model.referenced;
+}
+
+// Points the temporaries planned by memoryPlan at a newly allocated arena and
+// returns its storage.
+static std::unique_ptr<uint8_t[]> allocateArena(const CpuMemoryPlan& memoryPlan,
+                                                std::vector<RunTimeOperandInfo>* operands) {
+    // One allocation backs all of the planned temporaries. The storage is
+    // over-allocated so that the arena itself can be aligned.
+    constexpr size_t kAlignment = CpuMemoryPlan::kAlignment;
+    std::unique_ptr<uint8_t[]> arenaStorage(
+            new uint8_t[memoryPlan.getArenaSize() + kAlignment - 1]);
+    auto* arena = reinterpret_cast<uint8_t*>(
+            roundUp(reinterpret_cast<uintptr_t>(arenaStorage.get()), kAlignment));
+    memoryPlan.setBuffers(arena, operands);
+    return arenaStorage;
+}
+
+std::unique_ptr<uint8_t[]> CpuExecutor::allocatePlannedTemporaries(
+        std::vector<RunTimeOperandInfo>* operands) const {
+    // The plan assumes the serialized execution order, so it cannot be used
+    // when operations may run out of order.
+    if (mMemoryPlan == nullptr || mMemoryPlan->getArenaSize() == 0 || runsInParallel()) {
+        return nullptr;
+    }
+    return allocateArena(*mMemoryPlan, operands);
+}
+
+// Returns the indexes of the operands that executing the subgraph modifies.
+static std::vector<uint32_t> getMutableOperandIndexes(const Model::Subgraph& subgraph) {
+    std::vector<uint32_t> indexes;
+    for (uint32_t i = 0; i < subgraph.operands.size(); ++i) {
+        const Operand::LifeTime lifetime = subgraph.operands[i].lifetime;
+        if (lifetime == Operand::LifeTime::TEMPORARY_VARIABLE ||
+            lifetime == Operand::LifeTime::SUBGRAPH_OUTPUT) {
+            indexes.push_back(i);
+        }
+    }
+    return indexes;
+}
+
+static void resetOperandTable(RunTimeOperandTable* table) {
+    for (uint32_t i : table->mutableOperandIndexes) {
+        table->operands[i] = table->initialOperands[i];
+    }
+}
+
+// Frees the temporaries of the table that still hold a buffer, e.g. after a
+// failure. They are dead as the next run resets them.
+static void freeOperandTableTemporaries(RunTimeOperandTable* table) {
+    for (uint32_t i : table->mutableOperandIndexes) {
+        RunTimeOperandInfo& info = table->operands[i];
+        if (info.lifetime == Operand::LifeTime::TEMPORARY_VARIABLE && info.buffer != nullptr &&
+            !info.isPlanned) {
             delete[] info.buffer;
             info.buffer = nullptr;
         }
@@ -560,21 +1149,91 @@ int CpuExecutor::run(const Model& model, const Request& request,
                      const std::vector<RunTimePoolInfo>& requestPoolInfos) {
     NNTRACE_CPU(NNTRACE_PHASE_EXECUTION, "run");
     VLOG(CPUEXE) << "CpuExecutor::run() with request(" << SHOW_IF_DEBUG(request) << ")";
-    mModelOperandValues = model.operandValues.data();
-    mModelPoolInfos = &modelPoolInfos;
-    mReferencedSubgraphs = &model.referenced;
+    setModel(model, modelPoolInfos);
 
+    std::vector<RunTimeOperandInfo> operands = initializeRunTimeInfo(model.main);
+    const std::unique_ptr<uint8_t[]> arenaStorage = allocatePlannedTemporaries(&operands);
+    updateForArguments(model.main.inputIndexes, request.inputs, requestPoolInfos, operands.data());
+    updateForArguments(model.main.outputIndexes, request.outputs, requestPoolInfos,
+                       operands.data());
+    return executeMainSubgraph(model.main, &operands, requestPoolInfos);
+}
+
+RunTimeOperandTable CpuExecutor::prepareOperandTable(
+        const Model& model, const Request& request,
+        const std::vector<RunTimePoolInfo>& modelPoolInfos,
+        const std::vector<RunTimePoolInfo>& requestPoolInfos) {
+    NNTRACE_CPU(NNTRACE_PHASE_EXECUTION, "prepareOperandTable");
+    VLOG(CPUEXE) << "CpuExecutor::prepareOperandTable() with request(" << SHOW_IF_DEBUG(request)
+                 << ")";
+    setModel(model, modelPoolInfos);
+
+    RunTimeOperandTable table;
+    table.initialOperands = initializeRunTimeInfo(model.main);
+    table.arenaStorage = allocatePlannedTemporaries(&table.initialOperands);
+    updateForArguments(model.main.inputIndexes, request.inputs, requestPoolInfos,
+                       table.initialOperands.data());
+    updateForArguments(model.main.outputIndexes, request.outputs, requestPoolInfos,
+                       table.initialOperands.data());
+    table.mutableOperandIndexes = getMutableOperandIndexes(model.main);
+    table.operands = table.initialOperands;
+
+    mModelOperandValues = nullptr;
+    mModelPoolInfos = nullptr;
+    mReferencedSubgraphs = nullptr;
+    return table;
+}
+
+int CpuExecutor::run(const Model& model, RunTimeOperandTable* table,
+                     const std::vector<RunTimePoolInfo>& modelPoolInfos,
+                     const std::vector<RunTimePoolInfo>& requestPoolInfos) {
+    NNTRACE_CPU(NNTRACE_PHASE_EXECUTION, "run");
+    VLOG(CPUEXE) << "CpuExecutor::run() with a prepared operand table";
+    CHECK(table != nullptr);
+    CHECK(table->arenaStorage == nullptr || !runsInParallel())
+            << "A memory planned operand table cannot be run in parallel";
+    setModel(model, modelPoolInfos);
+
+    resetOperandTable(table);
+    const int result = executeMainSubgraph(model.main, &table->operands, requestPoolInfos);
+    freeOperandTableTemporaries(table);
+    return result;
+}
+
+RunTimeOperandTable CpuExecutor::prepareLoopOperandTable(const Model::Subgraph& subgraph) {
+    RunTimeOperandTable table;
+    table.initialOperands = initializeRunTimeInfo(subgraph);
+    // The subgraphs of a loop always run serially, so their temporaries can be
+    // planned regardless of the parallelism of the main subgraph. The plan is
+    // only created here if none was made when the model was prepared.
+    CpuMemoryPlan unpreparedPlan;
+    const CpuMemoryPlan* memoryPlan = &unpreparedPlan;
+    if (mReferencedMemoryPlans != nullptr) {
+        const size_t subgraphIndex = &subgraph - mReferencedSubgraphs->data();
+        CHECK_LT(subgraphIndex, mReferencedMemoryPlans->size());
+        memoryPlan = &(*mReferencedMemoryPlans)[subgraphIndex];
+    } else {
+        unpreparedPlan = CpuMemoryPlan::create(subgraph);
+    }
+    if (memoryPlan->getArenaSize() > 0) {
+        table.arenaStorage = allocateArena(*memoryPlan, &table.initialOperands);
+    }
+    table.mutableOperandIndexes = getMutableOperandIndexes(subgraph);
+    table.operands = table.initialOperands;
+    return table;
+}
+
+int CpuExecutor::executeMainSubgraph(const Model::Subgraph& subgraph,
+                                     std::vector<RunTimeOperandInfo>* operands,
+                                     const std::vector<RunTimePoolInfo>& requestPoolInfos) {
     // b/109953668, disable OpenMP
 #ifdef NNAPI_OPENMP
     ScopedOpenmpSettings openMpSettings;
 #endif  // NNAPI_OPENMP
 
-    std::vector<RunTimeOperandInfo> operands = initializeRunTimeInfo(model.main);
-    updateForArguments(model.main.inputIndexes, request.inputs, requestPoolInfos, operands.data());
-    updateForArguments(model.main.outputIndexes, request.outputs, requestPoolInfos,
-                       operands.data());
-    int result = executeSubgraph(model.main, operands.data());
-    freeUnusedSubgraphOperands(&operands);
+    int result = runsInParallel() ? executeSubgraphInParallel(subgraph, operands->data())
+                                  : executeSubgraph(subgraph, operands->data(), mFusionPlan);
+    freeUnusedSubgraphOperands(operands);
 
     if (result == ANEURALNETWORKS_NO_ERROR) {
         VLOG(CPUEXE) << "Completed run normally";
@@ -585,7 +1244,7 @@ int CpuExecutor::run(const Model& model, const Request& request,
 
     // Only report the output shapes when the result code is NO_ERROR or OUTPUT_INSUFFICIENT_SIZE.
     if (result == ANEURALNETWORKS_NO_ERROR || result == ANEURALNETWORKS_OUTPUT_INSUFFICIENT_SIZE) {
-        setOutputShapes(model.main.outputIndexes, operands);
+        setOutputShapes(subgraph.outputIndexes, *operands);
     } else {
         mOutputShapes.clear();
     }
@@ -597,15 +1256,329 @@ int CpuExecutor::run(const Model& model, const Request& request,
     return result;
 }
 
-int CpuExecutor::executeSubgraph(const Model::Subgraph& subgraph, RunTimeOperandInfo* operands) {
+int CpuExecutor::executeSubgraph(const Model::Subgraph& subgraph, RunTimeOperandInfo* operands,
+                                 const CpuFusionPlan* fusionPlan) {
     VLOG(CPUEXE) << "CpuExecutor::executeSubgraph " << subgraph;
     // The graph has serialized the operation in execution order.
-    for (const auto& operation : subgraph.operations) {
-        NN_RETURN_IF_ERROR(executeOperation(operation, operands));
+    for (uint32_t i = 0; i < subgraph.operations.size(); ++i) {
+        const Operation& operation = subgraph.operations[i];
+        if (const CpuFusionPlan::Group* group =
+                    fusionPlan != nullptr ? fusionPlan->getGroup(i) : nullptr) {
+            // The whole group runs in the position of its last operation.
+            if (i == group->operations.back()) {
+                NN_RETURN_IF_ERROR(executeFusedGroup(subgraph.operations, *group, operands));
+            }
+            continue;
+        }
+        const int result = executeOperation(operation, operands);
+        consumeOperationInputs(operation.inputs, operands);
+        NN_RETURN_IF_ERROR(result);
+    }
+    return ANEURALNETWORKS_NO_ERROR;
+}
+
+#ifdef NN_INCLUDE_CPU_IMPLEMENTATION
+// The number of values of a fused group that are computed at a time, small
+// enough for the intermediate values to stay in the L1 cache.
+constexpr uint32_t kFusedBlockSize = 1024;
+
+// Returns whether the operands of the group have shapes that the fused kernel
+// supports. Otherwise, e.g. for broadcasts or zero-sized tensors, the
+// operations run unfused and report any error themselves.
+static bool canRunFused(const CpuFusionPlan::Group& group, const RunTimeOperandInfo* operands) {
+    const RunTimeOperandInfo& input = operands[group.inputOperand];
+    if (input.buffer == nullptr || input.dimensions.size() > 4 ||
+        getNumberOfElements(input.shape()) == 0) {
+        return false;
+    }
+    for (const CpuFusionPlan::Step& step : group.steps) {
+        if (!step.isBinary) {
+            continue;
+        }
+        const RunTimeOperandInfo& side = operands[step.sideOperand];
+        const RunTimeOperandInfo& activation = operands[step.activationOperand];
+        if (side.buffer == nullptr || activation.buffer == nullptr) {
+            return false;
+        }
+        // A scalar broadcasts to the shape of the input only if it does not
+        // have more dimensions.
+        if (side.dimensions != input.dimensions &&
+            (getNumberOfElements(side.shape()) != 1 ||
+             side.dimensions.size() > input.dimensions.size())) {
+            return false;
+        }
+        const int32_t activationValue = *reinterpret_cast<const int32_t*>(activation.buffer);
+        if (activationValue < static_cast<int32_t>(FusedActivationFunc::NONE) ||
+            activationValue > static_cast<int32_t>(FusedActivationFunc::RELU6)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+static void dequantizeBlock(const T* input, float scale, int32_t zeroPoint, uint32_t size,
+                            float* block) {
+    for (uint32_t i = 0; i < size; ++i) {
+        // This dequantization formula also appears in Dequantize.cpp.
+        block[i] = scale * (static_cast<int32_t>(input[i]) - zeroPoint);
+    }
+}
+
+template <typename T>
+static void quantizeBlock(const float* block, uint32_t size, float scale, int32_t zeroPoint,
+                          T* output) {
+    constexpr float kMin = std::numeric_limits<T>::min();
+    constexpr float kMax = std::numeric_limits<T>::max();
+    for (uint32_t i = 0; i < size; ++i) {
+        // This quantization formula also appears in Quantize.cpp.
+        output[i] = static_cast<T>(std::max<float>(
+                kMin, std::min<float>(kMax, zeroPoint + std::round(block[i] / scale))));
+    }
+}
+
+// Applies a binary operation and its fused activation function to a block,
+// with the same formulas as the unfused float32 kernels.
+template <typename Op>
+static void applyBinaryStep(const float* side, bool sideIsScalar, bool sideIsFirst, float min,
+                            float max, uint32_t size, float* block, Op op) {
+    const auto apply = [min, max, op](float a, float b) {
+        return std::min(std::max(op(a, b), min), max);
+    };
+    if (sideIsScalar) {
+        const float scalar = side[0];
+        for (uint32_t i = 0; i < size; ++i) {
+            block[i] = sideIsFirst ? apply(scalar, block[i]) : apply(block[i], scalar);
+        }
+    } else if (sideIsFirst) {
+        for (uint32_t i = 0; i < size; ++i) {
+            block[i] = apply(side[i], block[i]);
+        }
+    } else {
+        for (uint32_t i = 0; i < size; ++i) {
+            block[i] = apply(block[i], side[i]);
+        }
+    }
+}
+
+static void applyFusedStep(const CpuFusionPlan::Step& step, const RunTimeOperandInfo* operands,
+                           uint32_t begin, uint32_t size, float* block) {
+    const auto applyRelu = [size, block](float reluMin, float reluMax) {
+        for (uint32_t i = 0; i < size; ++i) {
+            block[i] = std::min(std::max(reluMin, block[i]), reluMax);
+        }
+    };
+    switch (step.type) {
+        case OperationType::RELU:
+            return applyRelu(0.f, std::numeric_limits<float>::max());
+        case OperationType::RELU1:
+            return applyRelu(-1.f, 1.f);
+        case OperationType::RELU6:
+            return applyRelu(0.f, 6.f);
+        case OperationType::LOGISTIC:
+            for (uint32_t i = 0; i < size; ++i) {
+                block[i] = 1.f / (1.f + std::exp(-block[i]));
+            }
+            return;
+        case OperationType::TANH:
+            for (uint32_t i = 0; i < size; ++i) {
+                block[i] = std::tanh(block[i]);
+            }
+            return;
+        default:
+            break;
+    }
+
+    const RunTimeOperandInfo& side = operands[step.sideOperand];
+    const bool sideIsScalar = getNumberOfElements(side.shape()) == 1;
+    const float* sideData =
+            reinterpret_cast<const float*>(side.buffer) + (sideIsScalar ? 0 : begin);
+    const int32_t activation =
+            *reinterpret_cast<const int32_t*>(operands[step.activationOperand].buffer);
+    float min, max;
+    CalculateActivationRangeFloat(activation, &min, &max);
+    switch (step.type) {
+        case OperationType::ADD:
+            return applyBinaryStep(sideData, sideIsScalar, step.sideIsFirst, min, max, size, block,
+                                   std::plus<float>());
+        case OperationType::SUB:
+            return applyBinaryStep(sideData, sideIsScalar, step.sideIsFirst, min, max, size, block,
+                                   std::minus<float>());
+        case OperationType::MUL:
+            return applyBinaryStep(sideData, sideIsScalar, step.sideIsFirst, min, max, size, block,
+                                   std::multiplies<float>());
+        case OperationType::DIV:
+            return applyBinaryStep(sideData, sideIsScalar, step.sideIsFirst, min, max, size, block,
+                                   std::divides<float>());
+        default:
+            LOG(FATAL) << "Unexpected fused operation " << step.type;
+    }
+}
+
+// Runs a group whose operands satisfy canRunFused(), one block of values at a
+// time, without writing the intermediate values of the chain to memory.
+static int runFusedGroup(const CpuFusionPlan::Group& group, RunTimeOperandInfo* operands) {
+    NNTRACE_COMP("runFusedGroup");
+    const RunTimeOperandInfo& input = operands[group.inputOperand];
+    RunTimeOperandInfo& output = operands[group.outputOperand];
+    Shape outputShape = output.shape();
+    outputShape.dimensions = input.dimensions;
+    if (int result; !setInfoAndAllocateIfNeeded(&output, outputShape, &result)) {
+        return result;
+    }
+
+    const uint32_t size = getNumberOfElements(input.shape());
+    float block[kFusedBlockSize];
+    for (uint32_t begin = 0; begin < size; begin += kFusedBlockSize) {
+        const uint32_t blockSize = std::min(kFusedBlockSize, size - begin);
+        if (!group.dequantizesInput) {
+            std::copy_n(reinterpret_cast<const float*>(input.buffer) + begin, blockSize, block);
+        } else if (input.type == OperandType::TENSOR_QUANT8_ASYMM) {
+            dequantizeBlock(input.buffer + begin, input.scale, input.zeroPoint, blockSize, block);
+        } else {
+            dequantizeBlock(reinterpret_cast<const int8_t*>(input.buffer) + begin, input.scale,
+                            input.zeroPoint, blockSize, block);
+        }
+        for (const CpuFusionPlan::Step& step : group.steps) {
+            applyFusedStep(step, operands, begin, blockSize, block);
+        }
+        if (!group.quantizesOutput) {
+            std::copy_n(block, blockSize, reinterpret_cast<float*>(output.buffer) + begin);
+        } else if (output.type == OperandType::TENSOR_QUANT8_ASYMM) {
+            quantizeBlock(block, blockSize, output.scale, output.zeroPoint, output.buffer + begin);
+        } else {
+            quantizeBlock(block, blockSize, output.scale, output.zeroPoint,
+                          reinterpret_cast<int8_t*>(output.buffer) + begin);
+        }
+    }
+    return ANEURALNETWORKS_NO_ERROR;
+}
+#endif  // NN_INCLUDE_CPU_IMPLEMENTATION
+
+int CpuExecutor::executeFusedGroup(const std::vector<Operation>& operations,
+                                   const CpuFusionPlan::Group& group,
+                                   RunTimeOperandInfo* operands) {
+#ifdef NN_INCLUDE_CPU_IMPLEMENTATION
+    if (canRunFused(group, operands)) {
+        const int result = hasDeadlinePassed(mDeadline) ? ANEURALNETWORKS_MISSED_DEADLINE_TRANSIENT
+                                                        : runFusedGroup(group, operands);
+        for (uint32_t i : group.operations) {
+            consumeOperationInputs(operations[i].inputs, operands);
+        }
+        return result;
+    }
+#endif  // NN_INCLUDE_CPU_IMPLEMENTATION
+    for (uint32_t i : group.operations) {
+        const int result = executeOperation(operations[i], operands);
+        consumeOperationInputs(operations[i].inputs, operands);
+        NN_RETURN_IF_ERROR(result);
     }
     return ANEURALNETWORKS_NO_ERROR;
 }
 
+int CpuExecutor::executeSubgraphInParallel(const Model::Subgraph& subgraph,
+                                           RunTimeOperandInfo* operands) {
+    VLOG(CPUEXE) << "CpuExecutor::executeSubgraphInParallel " << subgraph;
+    CHECK(mThreadPool != nullptr);
+    const std::vector<Operation>& operations = subgraph.operations;
+    const uint32_t operationCount = operations.size();
+    constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+    // An operation depends on the operations writing its inputs.
+    std::vector<uint32_t> producers(subgraph.operands.size(), kNone);
+    for (uint32_t i = 0; i < operationCount; ++i) {
+        for (uint32_t operandIndex : operations[i].outputs) {
+            producers[operandIndex] = i;
+        }
+    }
+    std::vector<uint32_t> numberOfPendingProducers(operationCount, 0);
+    std::vector<std::vector<uint32_t>> dependents(operationCount);
+    for (uint32_t i = 0; i < operationCount; ++i) {
+        for (uint32_t operandIndex : operations[i].inputs) {
+            const uint32_t producer = producers[operandIndex];
+            // An operation may read the same operand more than once.
+            if (producer != kNone &&
+                (dependents[producer].empty() || dependents[producer].back() != i)) {
+                dependents[producer].push_back(i);
+                numberOfPendingProducers[i]++;
+            }
+        }
+    }
+
+    // Ready operations are dispatched in serialized order.
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> ready;
+    for (uint32_t i = 0; i < operationCount; ++i) {
+        if (numberOfPendingProducers[i] == 0) {
+            ready.push(i);
+        }
+    }
+
+    // Operations running concurrently may copy the RunTimeOperandInfo of a
+    // shared input, so the usage counts are tracked separately and only
+    // written back once the last consumer of the operand has finished.
+    std::vector<uint32_t> numberOfUsesLeft(subgraph.operands.size());
+    for (size_t i = 0; i < numberOfUsesLeft.size(); ++i) {
+        numberOfUsesLeft[i] = operands[i].numberOfUsesLeft;
+    }
+    auto consumeInputs = [&numberOfUsesLeft, operands](const Operation& operation) {
+        for (uint32_t i : operation.inputs) {
+            if (numberOfUsesLeft[i] == 0 || --numberOfUsesLeft[i] > 0) {
+                continue;
+            }
+            RunTimeOperandInfo& info = operands[i];
+            info.numberOfUsesLeft = 0;
+            if (info.buffer != nullptr && !info.isPlanned) {
+                delete[] info.buffer;
+                info.buffer = nullptr;
+            }
+        }
+    };
+
+    // The scheduling state, including the ready queue and the counts above,
+    // is only accessed while holding the mutex.
+    std::mutex mutex;
+    std::condition_variable operationFinished;
+    uint32_t numberInFlight = 0;
+    uint32_t failedOperation = kNone;
+    int result = ANEURALNETWORKS_NO_ERROR;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        // Stop dispatching new operations as soon as one of them has failed.
+        while (failedOperation == kNone && !ready.empty() && numberInFlight < mMaxConcurrency) {
+            const uint32_t i = ready.top();
+            ready.pop();
+            ++numberInFlight;
+            mThreadPool->schedule([&, i] {
+                getThreadOperationState()->concurrentOperationCount = mMaxConcurrency;
+                const int n = executeOperation(operations[i], operands);
+                std::lock_guard<std::mutex> guard(mutex);
+                consumeInputs(operations[i]);
+                if (n != ANEURALNETWORKS_NO_ERROR) {
+                    // Report the failure of the earliest operation, as serial execution would.
+                    if (i < failedOperation) {
+                        failedOperation = i;
+                        result = n;
+                    }
+                } else {
+                    for (uint32_t dependent : dependents[i]) {
+                        if (--numberOfPendingProducers[dependent] == 0) {
+                            ready.push(dependent);
+                        }
+                    }
+                }
+                --numberInFlight;
+                operationFinished.notify_one();
+            });
+        }
+        if (numberInFlight == 0 && (failedOperation != kNone || ready.empty())) {
+            break;
+        }
+        operationFinished.wait(lock);
+    }
+    return result;
+}
+
 std::vector<RunTimeOperandInfo> CpuExecutor::initializeRunTimeInfo(
         const Model::Subgraph& subgraph) {
     VLOG(CPUEXE) << "CpuExecutor::initializeRunTimeInfo";
@@ -718,6 +1691,7 @@ void CpuExecutor::updateForArguments(const std::vector<uint32_t>& indexes,
 int CpuExecutor::executeOperation([[maybe_unused]] const Operation& operation,
                                   [[maybe_unused]] RunTimeOperandInfo* operands) {
 #ifdef NN_INCLUDE_CPU_IMPLEMENTATION
+    const ScopedOperation scopedOperation;
     if (hasDeadlinePassed(mDeadline)) {
         return ANEURALNETWORKS_MISSED_DEADLINE_TRANSIENT;
     }
@@ -1316,22 +2290,25 @@ int CpuExecutor::executeOperation([[maybe_unused]] const Operation& operation,
                 success = meanFloat16(reinterpret_cast<_Float16*>(input.buffer), input.shape(),
                                       reinterpret_cast<const int32_t*>(axis.buffer), axis.shape(),
                                       keepDims > 0, reinterpret_cast<_Float16*>(output.buffer),
-                                      outShape);
+                                      outShape, getThreadRuyContext());
             } else if (input.type == OperandType::TENSOR_FLOAT32) {
                 success = meanGeneric<float, float>(
                         reinterpret_cast<float*>(input.buffer), input.shape(),
                         reinterpret_cast<const int32_t*>(axis.buffer), axis.shape(), keepDims > 0,
-                        reinterpret_cast<float*>(output.buffer), outShape);
+                        reinterpret_cast<float*>(output.buffer), outShape,
+                        getThreadRuyContext());
             } else if (input.type == OperandType::TENSOR_QUANT8_ASYMM) {
                 success = meanGeneric<uint8_t, int32_t>(
                         reinterpret_cast<uint8_t*>(input.buffer), input.shape(),
                         reinterpret_cast<const int32_t*>(axis.buffer), axis.shape(), keepDims > 0,
-                        reinterpret_cast<uint8_t*>(output.buffer), outShape);
+                        reinterpret_cast<uint8_t*>(output.buffer), outShape,
+                        getThreadRuyContext());
             } else if (input.type == OperandType::TENSOR_QUANT8_ASYMM_SIGNED) {
                 success = meanGeneric<int8_t, int32_t>(
                         reinterpret_cast<int8_t*>(input.buffer), input.shape(),
                         reinterpret_cast<const int32_t*>(axis.buffer), axis.shape(), keepDims > 0,
-                        reinterpret_cast<int8_t*>(output.buffer), outShape);
+                        reinterpret_cast<int8_t*>(output.buffer), outShape,
+                        getThreadRuyContext());
             }
         } break;
         case OperationType::ARGMAX:
@@ -1535,15 +2512,17 @@ int CpuExecutor::executeOperation([[maybe_unused]] const Operation& operation,
                         reinterpret_cast<const float*>(bias.buffer), bias.shape(), padding_left,
                         padding_right, padding_top, padding_bottom, stride_width, stride_height,
                         numGroups, activation, reinterpret_cast<float*>(output_tmp.buffer),
-                        outShape);
+                        outShape, getThreadRuyContext());
             } else if (input_tmp.type == OperandType::TENSOR_FLOAT16) {
+                OperationExecutionContext context(&operation, operands, mFloat16ConstantCache);
+                const Float32Input filterFloat32(&context, 1);
+                const Float32Input biasFloat32(&context, 2);
                 success = groupedConvFloat16(
                         reinterpret_cast<const _Float16*>(input_tmp.buffer), input_tmp.shape(),
-                        reinterpret_cast<const _Float16*>(filter.buffer), filter.shape(),
-                        reinterpret_cast<const _Float16*>(bias.buffer), bias.shape(), padding_left,
-                        padding_right, padding_top, padding_bottom, stride_width, stride_height,
-                        numGroups, activation, reinterpret_cast<_Float16*>(output_tmp.buffer),
-                        outShape);
+                        filterFloat32.get(), filter.shape(), biasFloat32.get(), bias.shape(),
+                        padding_left, padding_right, padding_top, padding_bottom, stride_width,
+                        stride_height, numGroups, activation,
+                        reinterpret_cast<_Float16*>(output_tmp.buffer), outShape, &context);
             } else if (input_tmp.type == OperandType::TENSOR_QUANT8_ASYMM) {
                 if (filter.type == OperandType::TENSOR_QUANT8_SYMM_PER_CHANNEL) {
                     success = groupedConvQuant8PerChannel(
@@ -1554,7 +2533,8 @@ int CpuExecutor::executeOperation([[maybe_unused]] const Operation& operation,
                             reinterpret_cast<const int32_t*>(bias.buffer), bias.shape(),
                             padding_left, padding_right, padding_top, padding_bottom, stride_width,
                             stride_height, numGroups, activation,
-                            reinterpret_cast<uint8_t*>(output_tmp.buffer), outShape);
+                            reinterpret_cast<uint8_t*>(output_tmp.buffer), outShape,
+                            getThreadRuyContext(), getThreadGemmContext());
                 } else if (filter.type == OperandType::TENSOR_QUANT8_ASYMM) {
                     success = groupedConvQuant8(
                             reinterpret_cast<const uint8_t*>(input_tmp.buffer), input_tmp.shape(),
@@ -1562,7 +2542,8 @@ int CpuExecutor::executeOperation([[maybe_unused]] const Operation& operation,
                             reinterpret_cast<const int32_t*>(bias.buffer), bias.shape(),
                             padding_left, padding_right, padding_top, padding_bottom, stride_width,
                             stride_height, numGroups, activation,
-                            reinterpret_cast<uint8_t*>(output_tmp.buffer), outShape);
+                            reinterpret_cast<uint8_t*>(output_tmp.buffer), outShape,
+                            getThreadRuyContext(), getThreadGemmContext());
                 }
             } else if (input_tmp.type == OperandType::TENSOR_QUANT8_ASYMM_SIGNED) {
                 if (filter.type == OperandType::TENSOR_QUANT8_SYMM_PER_CHANNEL) {
@@ -1574,7 +2555,8 @@ int CpuExecutor::executeOperation([[maybe_unused]] const Operation& operation,
                             reinterpret_cast<const int32_t*>(bias.buffer), bias.shape(),
                             padding_left, padding_right, padding_top, padding_bottom, stride_width,
                             stride_height, numGroups, activation,
-                            reinterpret_cast<int8_t*>(output_tmp.buffer), outShape);
+                            reinterpret_cast<int8_t*>(output_tmp.buffer), outShape,
+                            getThreadRuyContext(), getThreadGemmContext());
                 } else if (filter.type == OperandType::TENSOR_QUANT8_ASYMM_SIGNED) {
                     success = groupedConvQuant8(
                             reinterpret_cast<const int8_t*>(input_tmp.buffer), input_tmp.shape(),
@@ -1582,7 +2564,8 @@ int CpuExecutor::executeOperation([[maybe_unused]] const Operation& operation,
                             reinterpret_cast<const int32_t*>(bias.buffer), bias.shape(),
                             padding_left, padding_right, padding_top, padding_bottom, stride_width,
                             stride_height, numGroups, activation,
-                            reinterpret_cast<int8_t*>(output_tmp.buffer), outShape);
+                            reinterpret_cast<int8_t*>(output_tmp.buffer), outShape,
+                            getThreadRuyContext(), getThreadGemmContext());
                 }
             }
 
@@ -1654,7 +2637,7 @@ int CpuExecutor::executeOperation([[maybe_unused]] const Operation& operation,
                        operationRegistration->execute == nullptr) {
                 LOG(ERROR) << "Incomplete operation registration: " << operation.type;
             } else {
-                OperationExecutionContext context(&operation, operands);
+                OperationExecutionContext context(&operation, operands, mFloat16ConstantCache);
                 success = operationRegistration->flags.allowOmittedOperand ||
                           context.checkNoOmittedOperand();
                 success = success && (operationRegistration->flags.allowZeroSizedInput ||
@@ -1671,8 +2654,6 @@ int CpuExecutor::executeOperation([[maybe_unused]] const Operation& operation,
     if (result != ANEURALNETWORKS_NO_ERROR) {
         LOG(ERROR) << operation.type << " failed.";
     }
-
-    consumeOperationInputs(ins, operands);
     return result;
 #else
     LOG(ERROR) << "Built without CPU execution support";
@@ -1724,8 +2705,6 @@ int CpuExecutor::executeIfOperation(const Operation& operation, RunTimeOperandIn
         setInfoExceptLifetime(&operands[operation.outputs[i]],
                               branchOperands[branchSubgraph.outputIndexes[i]]);
     }
-
-    consumeOperationInputs(operation.inputs, operands);
     return ANEURALNETWORKS_NO_ERROR;
 }
 
@@ -1737,71 +2716,67 @@ int CpuExecutor::executeWhileOperation(const Operation& operation, RunTimeOperan
             *reinterpret_cast<const Model::Subgraph*>(condModelOperand.buffer);
     const Model::Subgraph& bodySubgraph =
             *reinterpret_cast<const Model::Subgraph*>(bodyModelOperand.buffer);
-    std::vector<RunTimeOperandInfo> condOperands = initializeRunTimeInfo(condSubgraph);
-    std::vector<RunTimeOperandInfo> bodyOperands = initializeRunTimeInfo(bodySubgraph);
-
-    // The code below implements the following sequence of subgraph input and output buffer
-    // assignments:
-    // iteration = 0   cond inputs = body inputs = outer inputs   body outputs = tmp1
-    // iteration = 1   cond inputs = body inputs = tmp1           body outputs = tmp2
-    // iteration = 2   cond inputs = body inputs = tmp2           body outputs = tmp1
-    // iteration = 3   cond inputs = body inputs = ...            body outputs = ...
 
-    // For body output double buffering.
-    std::vector<uint8_t*> tmp1(bodySubgraph.outputIndexes.size());
-    std::vector<uint8_t*> tmp2(bodySubgraph.outputIndexes.size());
+    // The operand tables and the arenas of their temporaries are set up once
+    // for the whole loop, and reset before each iteration.
+    RunTimeOperandTable condTable = prepareLoopOperandTable(condSubgraph);
+    RunTimeOperandTable bodyTable = prepareLoopOperandTable(bodySubgraph);
+    std::vector<RunTimeOperandInfo>& condOperands = condTable.operands;
+    std::vector<RunTimeOperandInfo>& bodyOperands = bodyTable.operands;
 
     // Ensure objects are freed
-    auto cleanupGuard = base::make_scope_guard(
-            [&tmp1, &tmp2, &condOperands, &bodyOperands, &operation, &operands] {
-                auto freeLoopOutputs = [](const std::vector<uint8_t*>& tmp) {
-                    for (auto buffer : tmp) {
-                        if (buffer != nullptr) {
-                            delete[] buffer;
-                        }
-                    }
-                };
-
-                freeLoopOutputs(tmp1);
-                freeLoopOutputs(tmp2);
-                freeUnusedSubgraphOperands(&condOperands);
-                freeUnusedSubgraphOperands(&bodyOperands);
-                consumeOperationInputs(operation.inputs, operands);
-            });
+    auto cleanupGuard = base::make_scope_guard([&condTable, &bodyTable] {
+        freeOperandTableTemporaries(&condTable);
+        freeOperandTableTemporaries(&bodyTable);
+    });
 
-    // For body outputs with unknown shape, we skip double buffering and
-    // allocate on each iteration instead. This allows growing output tensors
-    // inside a WHILE loop.
-    std::vector<bool> bodyOutputHasUnknownShape(bodySubgraph.outputIndexes.size());
-    for (uint32_t i = 0, n = bodySubgraph.outputIndexes.size(); i < n; ++i) {
+    // The code below implements the following sequence of subgraph input and output buffer
+    // assignments:
+    // iteration = 0   cond inputs = body inputs = outer inputs   body outputs = outer outputs
+    // iteration = 1   cond inputs = body inputs = outer outputs  body outputs = tmp
+    // iteration = 2   cond inputs = body inputs = tmp            body outputs = outer outputs
+    // iteration = 3   cond inputs = body inputs = ...            body outputs = ...
+    //
+    // An outer output is only used if it already has a buffer that is large enough for the body
+    // output, which then has to have a known shape. Otherwise, and for the odd iterations, the
+    // body outputs are written to buffers that grow as needed and are kept across iterations.
+    // The body outputs past the outer outputs are input-output operands of the loop, which have
+    // no outer output.
+    const uint32_t outputCount = bodySubgraph.outputIndexes.size();
+    std::vector<uint8_t*> outerBuffers(outputCount, nullptr);
+    for (uint32_t i = 0, n = operation.outputs.size(); i < n; ++i) {
+        const RunTimeOperandInfo& outerOperand = operands[operation.outputs[i]];
         const Operand& operand = bodySubgraph.operands[bodySubgraph.outputIndexes[i]];
-        bodyOutputHasUnknownShape[i] = nonExtensionOperandSizeOfData(operand) == 0;
-    }
-
-    // Initialize condition inputs from outer operands.
-    for (uint32_t i = 0, n = condSubgraph.inputIndexes.size(); i < n; ++i) {
-        setInfoExceptLifetime(&condOperands[condSubgraph.inputIndexes[i]],
-                              operands[operation.inputs[op::kFirstInput + i]]);
+        const uint32_t length = nonExtensionOperandSizeOfData(operand);
+        if (length > 0 && outerOperand.buffer != nullptr && outerOperand.length >= length) {
+            outerBuffers[i] = outerOperand.buffer;
+        }
     }
+    std::vector<GrowableBuffer> evenBuffers(outputCount);
+    std::vector<GrowableBuffer> oddBuffers(outputCount);
 
     // Store condition output on the stack.
-    RunTimeOperandInfo& condOutput = condOperands[condSubgraph.outputIndexes[0]];
     bool8 condValue = {/* initialized memory */};
-    condOutput.buffer = &condValue;
-    condOutput.length = sizeof(condValue);
 
     std::chrono::nanoseconds timeoutDuration(mLoopTimeoutDuration);
     const auto startTime = Clock::now();
     for (uint32_t iteration = 0;; ++iteration) {
         VLOG(CPUEXE) << "CpuExecutor::executeWhileOperation: iteration " << iteration;
-        if (iteration != 0) {
-            // Set condition inputs from previous iteration outputs.
-            for (uint32_t i = 0, n = bodySubgraph.outputIndexes.size(); i < n; ++i) {
-                setInfoExceptLifetime(&condOperands[condSubgraph.inputIndexes[i]],
-                                      bodyOperands[bodySubgraph.outputIndexes[i]]);
-            }
+        // Set condition inputs from previous iteration outputs, or from outer operands for the
+        // first iteration and for the input-only operands, which keep their values.
+        resetOperandTable(&condTable);
+        for (uint32_t i = 0, n = condSubgraph.inputIndexes.size(); i < n; ++i) {
+            setInfoExceptLifetime(&condOperands[condSubgraph.inputIndexes[i]],
+                                  iteration != 0 && i < outputCount
+                                          ? bodyOperands[bodySubgraph.outputIndexes[i]]
+                                          : operands[operation.inputs[op::kFirstInput + i]]);
         }
+        RunTimeOperandInfo& condOutput = condOperands[condSubgraph.outputIndexes[0]];
+        condOutput.buffer = &condValue;
+        condOutput.length = sizeof(condValue);
+
         NN_RETURN_IF_ERROR(executeSubgraph(condSubgraph, condOperands.data()));
+        freeUnusedSubgraphOperands(&condOperands);
         VLOG(CPUEXE) << "CpuExecutor::executeWhileOperation: condition value: "
                      << static_cast<int>(condValue);
         if (!condValue) {
@@ -1817,42 +2792,40 @@ int CpuExecutor::executeWhileOperation(const Operation& operation, RunTimeOperan
         }
 
         // Set body inputs from condition inputs.
+        resetOperandTable(&bodyTable);
         for (uint32_t i = 0, n = bodySubgraph.inputIndexes.size(); i < n; ++i) {
             bodyOperands[bodySubgraph.inputIndexes[i]] = condOperands[condSubgraph.inputIndexes[i]];
         }
         // Set body outputs.
-        auto& outputBuffer = iteration % 2 == 0 ? tmp1 : tmp2;
-        for (uint32_t i = 0, n = bodySubgraph.outputIndexes.size(); i < n; ++i) {
+        const bool isEven = iteration % 2 == 0;
+        for (uint32_t i = 0; i < outputCount; ++i) {
             RunTimeOperandInfo& info = bodyOperands[bodySubgraph.outputIndexes[i]];
-            if (bodyOutputHasUnknownShape[i]) {
-                // Reset dimensions and buffer.
-                info.dimensions = bodySubgraph.operands[bodySubgraph.outputIndexes[i]].dimensions;
-                if (outputBuffer[i] != nullptr) {
-                    delete[] outputBuffer[i];
-                    outputBuffer[i] = nullptr;
-                }
+            if (isEven && outerBuffers[i] != nullptr) {
+                info.buffer = outerBuffers[i];
+                info.length = operands[operation.outputs[i]].length;
+                info.isPlanned = true;
+            } else {
+                info.growableBuffer = isEven ? &evenBuffers[i] : &oddBuffers[i];
             }
-            info.buffer = outputBuffer[i];
         }
 
         NN_RETURN_IF_ERROR(executeSubgraph(bodySubgraph, bodyOperands.data()));
-
-        // Update output buffer information in case we have allocated new buffers.
-        for (uint32_t i = 0, n = bodySubgraph.outputIndexes.size(); i < n; ++i) {
-            outputBuffer[i] = bodyOperands[bodySubgraph.outputIndexes[i]].buffer;
-        }
+        freeUnusedSubgraphOperands(&bodyOperands);
     }
 
-    // Copy body outputs to outer outputs.
+    // Copy body outputs to outer outputs, unless they are already there.
     for (uint32_t i = 0, n = operation.outputs.size(); i < n; ++i) {
         RunTimeOperandInfo& outerOperand = operands[operation.outputs[i]];
-        RunTimeOperandInfo& innerOperand = condOperands[condSubgraph.inputIndexes[i]];
+        const RunTimeOperandInfo& innerOperand = condOperands[condSubgraph.inputIndexes[i]];
+        const bool isInPlace =
+                outerBuffers[i] != nullptr && innerOperand.buffer == outerOperand.buffer;
         if (int error; !setInfoAndAllocateIfNeeded(&outerOperand, innerOperand.shape(), &error)) {
             return error;
         }
-        CHECK_EQ(outerOperand.length, innerOperand.length);
-        // TODO: Use the outer buffer as tmp1 to avoid copies.
-        std::memcpy(outerOperand.buffer, innerOperand.buffer, innerOperand.length);
+        if (!isInPlace) {
+            CHECK_EQ(outerOperand.length, innerOperand.length);
+            std::memcpy(outerOperand.buffer, innerOperand.buffer, innerOperand.length);
+        }
     }
 
     return ANEURALNETWORKS_NO_ERROR;
@@ -18,6 +18,7 @@
 
 #include "IndexedShapeWrapper.h"
 
+#include <utility>
 #include <vector>
 
 #include "LegacyUtils.h"
@@ -102,5 +103,59 @@ bool IndexedShapeWrapper::isValid(const std::vector<uint32_t>& index) const {
     return true;
 }
 
+bool collapseBinaryBroadcast(const Shape& aShape, const Shape& bShape, const Shape& outputShape,
+                             BinaryBroadcast* broadcast) {
+    const size_t rank = outputShape.dimensions.size();
+    const size_t aRank = aShape.dimensions.size();
+    const size_t bRank = bShape.dimensions.size();
+    NN_RET_CHECK_LE(aRank, rank);
+    NN_RET_CHECK_LE(bRank, rank);
+
+    *broadcast = BinaryBroadcast();
+    std::vector<uint32_t> sizes;
+    std::vector<bool> aSpans, bSpans;
+    for (size_t i = 0; i < rank; ++i) {
+        const uint32_t size = outputShape.dimensions[i];
+        const uint32_t aSize = i + aRank >= rank ? aShape.dimensions[i + aRank - rank] : 1;
+        const uint32_t bSize = i + bRank >= rank ? bShape.dimensions[i + bRank - rank] : 1;
+        NN_RET_CHECK(aSize == size || aSize == 1);
+        NN_RET_CHECK(bSize == size || bSize == 1);
+        if (size == 0) {
+            broadcast->innerSize = 0;
+            return true;
+        }
+        if (size == 1) continue;
+        // Otherwise outputShape is larger than the broadcast of the inputs.
+        NN_RET_CHECK(aSize != 1 || bSize != 1);
+        if (!sizes.empty() && aSpans.back() == (aSize != 1) && bSpans.back() == (bSize != 1)) {
+            sizes.back() *= size;
+        } else {
+            sizes.push_back(size);
+            aSpans.push_back(aSize != 1);
+            bSpans.push_back(bSize != 1);
+        }
+    }
+    if (sizes.empty()) return true;
+
+    std::vector<uint32_t> aStrides(sizes.size()), bStrides(sizes.size());
+    uint32_t aStride = 1, bStride = 1;
+    for (size_t i = sizes.size(); i-- > 0;) {
+        aStrides[i] = aSpans[i] ? aStride : 0;
+        bStrides[i] = bSpans[i] ? bStride : 0;
+        aStride *= aSpans[i] ? sizes[i] : 1;
+        bStride *= bSpans[i] ? sizes[i] : 1;
+    }
+    broadcast->innerSize = sizes.back();
+    broadcast->aInnerStride = aStrides.back();
+    broadcast->bInnerStride = bStrides.back();
+    sizes.pop_back();
+    aStrides.pop_back();
+    bStrides.pop_back();
+    broadcast->outerSizes = std::move(sizes);
+    broadcast->aOuterStrides = std::move(aStrides);
+    broadcast->bOuterStrides = std::move(bStrides);
+    return true;
+}
+
 }  // namespace nn
 }  // namespace android
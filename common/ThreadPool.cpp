@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ThreadPool"
+
+#include "ThreadPool.h"
+
+#include <android-base/logging.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif  // __linux__
+
+#include <utility>
+
+namespace android {
+namespace nn {
+namespace {
+
+// The pool whose worker loop is running on the current thread, if any.
+thread_local const ThreadPool* tCurrentThreadPool = nullptr;
+
+void applyCpuAffinityHint([[maybe_unused]] uint64_t cpuAffinityMask) {
+#ifdef __linux__
+    if (cpuAffinityMask == 0) {
+        return;
+    }
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (uint32_t cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; ++cpu) {
+        if (cpuAffinityMask & (uint64_t{1} << cpu)) {
+            CPU_SET(cpu, &cpuSet);
+        }
+    }
+    if (sched_setaffinity(/*pid=*/0, sizeof(cpuSet), &cpuSet) != 0) {
+        PLOG(WARNING) << "Failed to apply CPU affinity mask 0x" << std::hex << cpuAffinityMask;
+    }
+#endif  // __linux__
+}
+
+}  // namespace
+
+ThreadPool::ThreadPool(uint32_t numThreads, uint64_t cpuAffinityMask)
+    : kCpuAffinityMask(cpuAffinityMask) {
+    CHECK_GT(numThreads, 0u);
+    mWorkers.reserve(numThreads);
+    for (uint32_t i = 0; i < numThreads; ++i) {
+        mWorkers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mShuttingDown = true;
+    }
+    mCondition.notify_all();
+    for (auto& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::schedule(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        CHECK(!mShuttingDown) << "ThreadPool::schedule called on a pool being destroyed";
+        mTasks.push(std::move(task));
+    }
+    mCondition.notify_one();
+}
+
+void ThreadPool::runAndWait(const std::function<void()>& task) {
+    // Waiting for another worker from a worker thread could deadlock the pool.
+    if (isWorkerThread()) {
+        task();
+        return;
+    }
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool done = false;
+    schedule([&task, &mutex, &condition, &done] {
+        task();
+        std::lock_guard<std::mutex> guard(mutex);
+        done = true;
+        condition.notify_one();
+    });
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&done] { return done; });
+}
+
+bool ThreadPool::isWorkerThread() const {
+    return tCurrentThreadPool == this;
+}
+
+bool ThreadPool::isAnyWorkerThread() {
+    return tCurrentThreadPool != nullptr;
+}
+
+void ThreadPool::workerLoop() {
+    tCurrentThreadPool = this;
+    applyCpuAffinityHint(kCpuAffinityMask);
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this] { return mShuttingDown || !mTasks.empty(); });
+            // Drain the remaining tasks before exiting.
+            if (mTasks.empty()) {
+                return;
+            }
+            task = std::move(mTasks.front());
+            mTasks.pop();
+        }
+        task();
+    }
+}
+
+}  // namespace nn
+}  // namespace android
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ThreadPool.h"
+
+namespace android {
+namespace nn {
+namespace {
+
+using ::testing::ElementsAreArray;
+
+TEST(ThreadPoolTest, RunsTasksOfSingleThreadInFifoOrder) {
+    constexpr int kCount = 100;
+    std::vector<int> order;
+    {
+        ThreadPool pool(1);
+        for (int i = 0; i < kCount; ++i) {
+            // Only the worker thread appends, so no lock is needed.
+            pool.schedule([&order, i] { order.push_back(i); });
+        }
+    }
+    std::vector<int> expected(kCount);
+    for (int i = 0; i < kCount; ++i) {
+        expected[i] = i;
+    }
+    EXPECT_THAT(order, ElementsAreArray(expected));
+}
+
+TEST(ThreadPoolTest, DestructorDrainsScheduledTasks) {
+    constexpr int kCount = 50;
+    std::atomic<int> done = 0;
+    {
+        ThreadPool pool(2);
+        for (int i = 0; i < kCount; ++i) {
+            pool.schedule([&done] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                ++done;
+            });
+        }
+    }
+    EXPECT_EQ(done, kCount);
+}
+
+TEST(ThreadPoolTest, RunAndWaitRunsOnWorker) {
+    ThreadPool pool(2);
+    const auto caller = std::this_thread::get_id();
+    std::thread::id runner;
+    bool onWorker = false;
+    pool.runAndWait([&] {
+        runner = std::this_thread::get_id();
+        onWorker = pool.isWorkerThread();
+    });
+    EXPECT_NE(runner, caller);
+    EXPECT_TRUE(onWorker);
+    EXPECT_FALSE(pool.isWorkerThread());
+}
+
+TEST(ThreadPoolTest, RunAndWaitFromWorkerRunsInline) {
+    // With a single worker, waiting for another worker would never return.
+    ThreadPool pool(1);
+    std::thread::id outer;
+    std::thread::id inner;
+    pool.runAndWait([&] {
+        outer = std::this_thread::get_id();
+        pool.runAndWait([&] { inner = std::this_thread::get_id(); });
+    });
+    EXPECT_EQ(outer, inner);
+}
+
+TEST(ThreadPoolTest, RunAndWaitFromWorkerOfAnotherPool) {
+    ThreadPool pool(1);
+    ThreadPool other(1);
+    bool onOther = false;
+    bool onPool = true;
+    pool.runAndWait([&] {
+        other.runAndWait([&] {
+            onOther = other.isWorkerThread();
+            onPool = pool.isWorkerThread();
+        });
+    });
+    EXPECT_TRUE(onOther);
+    EXPECT_FALSE(onPool);
+}
+
+TEST(ThreadPoolTest, IsAnyWorkerThread) {
+    EXPECT_FALSE(ThreadPool::isAnyWorkerThread());
+    ThreadPool pool(1);
+    bool isAnyWorkerThread = false;
+    pool.runAndWait([&isAnyWorkerThread] {
+        isAnyWorkerThread = ThreadPool::isAnyWorkerThread();
+    });
+    EXPECT_TRUE(isAnyWorkerThread);
+    EXPECT_FALSE(ThreadPool::isAnyWorkerThread());
+}
+
+TEST(ThreadPoolTest, RunsTasksConcurrently) {
+    // Each task waits for the other, so this only finishes if both workers
+    // run at the same time.
+    std::mutex mutex;
+    std::condition_variable condition;
+    int arrived = 0;
+    ThreadPool pool(2);
+    const auto task = [&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        ++arrived;
+        condition.notify_all();
+        condition.wait(lock, [&arrived] { return arrived == 2; });
+    };
+    pool.schedule(task);
+    pool.runAndWait(task);
+    EXPECT_EQ(pool.getNumThreads(), 2u);
+}
+
+}  // namespace
+}  // namespace nn
+}  // namespace android
@@ -21,10 +21,12 @@
 #include <utility>
 #include <vector>
 
+#include "CpuExecutor.h"
 #include "HalInterfaces.h"
 #include "MemoryUtils.h"
 #include "OperationsExecutionUtils.h"
 #include "QuantUtils.h"
+#include "ThreadPool.h"
 #include "Utils.h"
 #include "ValidateHal.h"
 #include "nnapi/TypeUtils.h"
@@ -250,6 +252,338 @@ TEST_F(CombineDimensionsTest, Dimensions) {
     testIncompatible({1, 2, 3, 4}, {1, 2, 3, 3});
 }
 
+class CpuMemoryPlanTest : public ::testing::Test {
+   protected:
+    static Operand makeOperand(Operand::LifeTime lifetime, std::vector<uint32_t> dimensions) {
+        return {.type = OperandType::TENSOR_FLOAT32,
+                .dimensions = std::move(dimensions),
+                .lifetime = lifetime};
+    }
+
+    static Operation makeOperation(uint32_t input, uint32_t output) {
+        return {.type = OperationType::RELU, .inputs = {input}, .outputs = {output}};
+    }
+
+    // Returns the buffer offset of each operand within the arena, or -1 if the
+    // operand is not planned.
+    static std::vector<int64_t> getOffsets(const Model::Subgraph& subgraph,
+                                           const CpuMemoryPlan& plan) {
+        std::vector<RunTimeOperandInfo> operands(subgraph.operands.size());
+        for (size_t i = 0; i < operands.size(); ++i) {
+            operands[i].lifetime = subgraph.operands[i].lifetime;
+            operands[i].buffer = nullptr;
+        }
+        std::vector<uint8_t> arena(plan.getArenaSize());
+        plan.setBuffers(arena.data(), &operands);
+        std::vector<int64_t> offsets;
+        for (const auto& operand : operands) {
+            offsets.push_back(operand.isPlanned ? operand.buffer - arena.data() : -1);
+        }
+        return offsets;
+    }
+};
+
+TEST_F(CpuMemoryPlanTest, ReusesMemoryOfDeadTemporaries) {
+    // in -> t0 -> t1 -> t2 -> out, where t0 and t2 have disjoint live ranges.
+    const Model::Subgraph subgraph = {
+            .operands = {makeOperand(Operand::LifeTime::SUBGRAPH_INPUT, {4}),
+                         makeOperand(Operand::LifeTime::TEMPORARY_VARIABLE, {4}),
+                         makeOperand(Operand::LifeTime::TEMPORARY_VARIABLE, {4}),
+                         makeOperand(Operand::LifeTime::TEMPORARY_VARIABLE, {4}),
+                         makeOperand(Operand::LifeTime::SUBGRAPH_OUTPUT, {4})},
+            .operations = {makeOperation(0, 1), makeOperation(1, 2), makeOperation(2, 3),
+                           makeOperation(3, 4)},
+            .inputIndexes = {0},
+            .outputIndexes = {4},
+    };
+    const CpuMemoryPlan plan = CpuMemoryPlan::create(subgraph);
+    EXPECT_EQ(plan.getArenaSize(), CpuMemoryPlan::kAlignment + 4 * sizeof(float));
+    EXPECT_THAT(getOffsets(subgraph, plan),
+                ElementsAreArray<int64_t>({-1, 0, CpuMemoryPlan::kAlignment, 0, -1}));
+}
+
+TEST_F(CpuMemoryPlanTest, SkipsTemporariesOfUnknownSize) {
+    const Model::Subgraph subgraph = {
+            .operands = {makeOperand(Operand::LifeTime::SUBGRAPH_INPUT, {4}),
+                         makeOperand(Operand::LifeTime::TEMPORARY_VARIABLE, {0}),
+                         makeOperand(Operand::LifeTime::TEMPORARY_VARIABLE, {4}),
+                         makeOperand(Operand::LifeTime::SUBGRAPH_OUTPUT, {4})},
+            .operations = {makeOperation(0, 1), makeOperation(1, 2), makeOperation(2, 3)},
+            .inputIndexes = {0},
+            .outputIndexes = {3},
+    };
+    const CpuMemoryPlan plan = CpuMemoryPlan::create(subgraph);
+    EXPECT_EQ(plan.getArenaSize(), 4 * sizeof(float));
+    EXPECT_THAT(getOffsets(subgraph, plan), ElementsAreArray<int64_t>({-1, -1, 0, -1}));
+}
+
+TEST(CpuFloat16ConstantCacheTest, ConvertsConstantWeightsOfFullyConnected) {
+    const std::vector<_Float16> weights = {1.0f, -2.0f, 0.5f, 4.0f};
+    const std::vector<_Float16> bias = {0.25f, -0.75f};
+    Model model;
+    const DataLocation weightsLocation = model.operandValues.append(
+            reinterpret_cast<const uint8_t*>(weights.data()), weights.size() * sizeof(_Float16));
+    const DataLocation biasLocation = {.pointer = static_cast<const void*>(bias.data()),
+                                       .length = static_cast<uint32_t>(bias.size() *
+                                                                       sizeof(_Float16))};
+    model.main = {
+            .operands = {{.type = OperandType::TENSOR_FLOAT16,
+                          .dimensions = {1, 2},
+                          .lifetime = Operand::LifeTime::SUBGRAPH_INPUT},
+                         {.type = OperandType::TENSOR_FLOAT16,
+                          .dimensions = {2, 2},
+                          .lifetime = Operand::LifeTime::CONSTANT_COPY,
+                          .location = weightsLocation},
+                         {.type = OperandType::TENSOR_FLOAT16,
+                          .dimensions = {2},
+                          .lifetime = Operand::LifeTime::POINTER,
+                          .location = biasLocation},
+                         {.type = OperandType::INT32, .lifetime = Operand::LifeTime::NO_VALUE},
+                         {.type = OperandType::TENSOR_FLOAT16,
+                          .dimensions = {1, 2},
+                          .lifetime = Operand::LifeTime::SUBGRAPH_OUTPUT}},
+            .operations = {{.type = OperationType::FULLY_CONNECTED,
+                            .inputs = {0, 1, 2, 3},
+                            .outputs = {4}}},
+            .inputIndexes = {0},
+            .outputIndexes = {4},
+    };
+
+    const CpuFloat16ConstantCache cache = CpuFloat16ConstantCache::create(model, {});
+    const float* weightsFloat32 =
+            cache.getFloat32Value(model.operandValues.data() + weightsLocation.offset);
+    ASSERT_NE(weightsFloat32, nullptr);
+    EXPECT_THAT(std::vector<float>(weightsFloat32, weightsFloat32 + weights.size()),
+                ElementsAreArray({1.0f, -2.0f, 0.5f, 4.0f}));
+    const float* biasFloat32 = cache.getFloat32Value(bias.data());
+    ASSERT_NE(biasFloat32, nullptr);
+    EXPECT_THAT(std::vector<float>(biasFloat32, biasFloat32 + bias.size()),
+                ElementsAreArray({0.25f, -0.75f}));
+    EXPECT_EQ(CpuFloat16ConstantCache().getFloat32Value(bias.data()), nullptr);
+}
+
+class CpuFusionPlanTest : public ::testing::Test {
+   protected:
+    static Operand makeOperand(OperandType type, Operand::LifeTime lifetime) {
+        const bool isTensor = type != OperandType::INT32;
+        return {.type = type,
+                .dimensions = isTensor ? std::vector<uint32_t>{4} : std::vector<uint32_t>{},
+                .scale = isTensor && type != OperandType::TENSOR_FLOAT32 ? 0.5f : 0.0f,
+                .lifetime = lifetime};
+    }
+
+    static Operation makeOperation(OperationType type, std::vector<uint32_t> inputs,
+                                   uint32_t output) {
+        return {.type = type, .inputs = std::move(inputs), .outputs = {output}};
+    }
+};
+
+TEST_F(CpuFusionPlanTest, FusesDequantizeAddReluQuantize) {
+    // in -> DEQUANTIZE -> t0 -> ADD(t0, side) -> t1 -> RELU -> t2 -> QUANTIZE -> out
+    const Model::Subgraph subgraph = {
+            .operands = {makeOperand(OperandType::TENSOR_QUANT8_ASYMM,
+                                     Operand::LifeTime::SUBGRAPH_INPUT),
+                         makeOperand(OperandType::TENSOR_FLOAT32,
+                                     Operand::LifeTime::SUBGRAPH_INPUT),
+                         makeOperand(OperandType::INT32, Operand::LifeTime::CONSTANT_COPY),
+                         makeOperand(OperandType::TENSOR_FLOAT32,
+                                     Operand::LifeTime::TEMPORARY_VARIABLE),
+                         makeOperand(OperandType::TENSOR_FLOAT32,
+                                     Operand::LifeTime::TEMPORARY_VARIABLE),
+                         makeOperand(OperandType::TENSOR_FLOAT32,
+                                     Operand::LifeTime::TEMPORARY_VARIABLE),
+                         makeOperand(OperandType::TENSOR_QUANT8_ASYMM,
+                                     Operand::LifeTime::SUBGRAPH_OUTPUT)},
+            .operations = {makeOperation(OperationType::DEQUANTIZE, {0}, 3),
+                           makeOperation(OperationType::ADD, {1, 3, 2}, 4),
+                           makeOperation(OperationType::RELU, {4}, 5),
+                           makeOperation(OperationType::QUANTIZE, {5}, 6)},
+            .inputIndexes = {0, 1},
+            .outputIndexes = {6},
+    };
+    const CpuFusionPlan plan = CpuFusionPlan::create(subgraph);
+    ASSERT_EQ(plan.getGroupCount(), 1u);
+    const CpuFusionPlan::Group* group = plan.getGroup(0);
+    ASSERT_NE(group, nullptr);
+    EXPECT_EQ(plan.getGroup(3), group);
+    EXPECT_THAT(group->operations, ElementsAreArray<uint32_t>({0, 1, 2, 3}));
+    EXPECT_EQ(group->inputOperand, 0u);
+    EXPECT_EQ(group->outputOperand, 6u);
+    EXPECT_TRUE(group->dequantizesInput);
+    EXPECT_TRUE(group->quantizesOutput);
+    ASSERT_EQ(group->steps.size(), 2u);
+    EXPECT_EQ(group->steps[0].type, OperationType::ADD);
+    EXPECT_EQ(group->steps[0].sideOperand, 1u);
+    EXPECT_TRUE(group->steps[0].sideIsFirst);
+    EXPECT_EQ(group->steps[0].activationOperand, 2u);
+    EXPECT_EQ(group->steps[1].type, OperationType::RELU);
+    EXPECT_EQ(plan.getExecutionPosition(0), 3u);
+}
+
+TEST_F(CpuFusionPlanTest, StopsAtTemporaryWithSeveralReaders) {
+    // in -> RELU -> t0 -> TANH -> t1 -> LOGISTIC -> out0, and t1 -> RELU6 -> out1.
+    const Model::Subgraph subgraph = {
+            .operands = {makeOperand(OperandType::TENSOR_FLOAT32,
+                                     Operand::LifeTime::SUBGRAPH_INPUT),
+                         makeOperand(OperandType::TENSOR_FLOAT32,
+                                     Operand::LifeTime::TEMPORARY_VARIABLE),
+                         makeOperand(OperandType::TENSOR_FLOAT32,
+                                     Operand::LifeTime::TEMPORARY_VARIABLE),
+                         makeOperand(OperandType::TENSOR_FLOAT32,
+                                     Operand::LifeTime::SUBGRAPH_OUTPUT),
+                         makeOperand(OperandType::TENSOR_FLOAT32,
+                                     Operand::LifeTime::SUBGRAPH_OUTPUT)},
+            .operations = {makeOperation(OperationType::RELU, {0}, 1),
+                           makeOperation(OperationType::TANH, {1}, 2),
+                           makeOperation(OperationType::LOGISTIC, {2}, 3),
+                           makeOperation(OperationType::RELU6, {2}, 4)},
+            .inputIndexes = {0},
+            .outputIndexes = {3, 4},
+    };
+    const CpuFusionPlan plan = CpuFusionPlan::create(subgraph);
+    ASSERT_EQ(plan.getGroupCount(), 1u);
+    ASSERT_NE(plan.getGroup(0), nullptr);
+    EXPECT_THAT(plan.getGroup(0)->operations, ElementsAreArray<uint32_t>({0, 1}));
+    EXPECT_EQ(plan.getGroup(0)->outputOperand, 2u);
+    EXPECT_EQ(plan.getGroup(2), nullptr);
+    EXPECT_EQ(plan.getGroup(3), nullptr);
+    EXPECT_EQ(plan.getExecutionPosition(2), 2u);
+}
+
+class CpuExecutorParallelTest : public ::testing::Test {
+   protected:
+    static constexpr uint32_t kSize = 4;
+    static constexpr uint32_t kMaxConcurrency = 4;
+
+    struct Result {
+        int n;
+        std::vector<std::vector<float>> outputs;
+    };
+
+    static Operand makeTensor(Operand::LifeTime lifetime,
+                              std::vector<uint32_t> dimensions = {kSize}) {
+        return {.type = OperandType::TENSOR_FLOAT32,
+                .dimensions = std::move(dimensions),
+                .lifetime = lifetime};
+    }
+
+    static Operand makeConstant(Model* model, OperandType type, const std::vector<int32_t>& values,
+                                std::vector<uint32_t> dimensions = {}) {
+        return {.type = type,
+                .dimensions = std::move(dimensions),
+                .lifetime = Operand::LifeTime::CONSTANT_COPY,
+                .location = model->operandValues.append(
+                        reinterpret_cast<const uint8_t*>(values.data()),
+                        values.size() * sizeof(int32_t))};
+    }
+
+    static Request::Argument makeArgument(const float* buffer, uint32_t count) {
+        return {.lifetime = Request::Argument::LifeTime::POINTER,
+                .location = {.pointer = static_cast<const void*>(buffer),
+                             .length = static_cast<uint32_t>(count * sizeof(float))}};
+    }
+
+    // Runs the model with maxConcurrency operations in flight. outputSizes is
+    // the number of elements of the buffer passed for each output.
+    static Result run(const Model& model, const std::vector<std::vector<float>>& inputs,
+                      const std::vector<uint32_t>& outputSizes, ThreadPool* threadPool,
+                      uint32_t maxConcurrency) {
+        Result result = {.outputs = std::vector<std::vector<float>>(outputSizes.size())};
+        Request request;
+        for (const auto& input : inputs) {
+            request.inputs.push_back(makeArgument(input.data(), input.size()));
+        }
+        for (size_t i = 0; i < outputSizes.size(); ++i) {
+            result.outputs[i].resize(outputSizes[i], -1.0f);
+            request.outputs.push_back(makeArgument(result.outputs[i].data(), outputSizes[i]));
+        }
+        CpuExecutor executor;
+        executor.setInterOperationParallelism(threadPool, maxConcurrency);
+        result.n = executor.run(model, request, {}, {});
+        return result;
+    }
+
+    // Runs the model serially once and in parallel several times, as the order
+    // in which concurrent operations finish varies between runs.
+    static void checkParallelMatchesSerial(const Model& model,
+                                           const std::vector<std::vector<float>>& inputs,
+                                           const std::vector<uint32_t>& outputSizes,
+                                           int expectedN) {
+        const Result serial = run(model, inputs, outputSizes, nullptr, 1);
+        ASSERT_EQ(serial.n, expectedN);
+        ThreadPool threadPool(kMaxConcurrency);
+        for (int i = 0; i < 20; ++i) {
+            SCOPED_TRACE(i);
+            const Result parallel = run(model, inputs, outputSizes, &threadPool, kMaxConcurrency);
+            EXPECT_EQ(parallel.n, serial.n);
+            if (expectedN == ANEURALNETWORKS_NO_ERROR) {
+                EXPECT_EQ(parallel.outputs, serial.outputs);
+            }
+        }
+    }
+};
+
+TEST_F(CpuExecutorParallelTest, MatchesSerialExecution) {
+    // t0 = in0 + in0, t1 = in0 * in1 and t2 = in1 - in0 read the shared input
+    // in0 concurrently, then out0 = t0 + t1 and out1 = t2 * t1 both read t1,
+    // while out2 = RELU(in0) runs alongside any of them.
+    Model model;
+    const Operand activation = makeConstant(&model, OperandType::INT32, {0});
+    model.main = {
+            .operands = {makeTensor(Operand::LifeTime::SUBGRAPH_INPUT),
+                         makeTensor(Operand::LifeTime::SUBGRAPH_INPUT), activation,
+                         makeTensor(Operand::LifeTime::TEMPORARY_VARIABLE),
+                         makeTensor(Operand::LifeTime::TEMPORARY_VARIABLE),
+                         makeTensor(Operand::LifeTime::TEMPORARY_VARIABLE),
+                         makeTensor(Operand::LifeTime::SUBGRAPH_OUTPUT),
+                         makeTensor(Operand::LifeTime::SUBGRAPH_OUTPUT),
+                         makeTensor(Operand::LifeTime::SUBGRAPH_OUTPUT)},
+            .operations = {{.type = OperationType::ADD, .inputs = {0, 0, 2}, .outputs = {3}},
+                           {.type = OperationType::MUL, .inputs = {0, 1, 2}, .outputs = {4}},
+                           {.type = OperationType::SUB, .inputs = {1, 0, 2}, .outputs = {5}},
+                           {.type = OperationType::ADD, .inputs = {3, 4, 2}, .outputs = {6}},
+                           {.type = OperationType::MUL, .inputs = {5, 4, 2}, .outputs = {7}},
+                           {.type = OperationType::RELU, .inputs = {0}, .outputs = {8}}},
+            .inputIndexes = {0, 1},
+            .outputIndexes = {6, 7, 8},
+    };
+    const std::vector<std::vector<float>> inputs = {{-1.0f, 0.5f, 2.0f, 3.0f},
+                                                    {4.0f, -2.0f, 0.25f, 1.0f}};
+    checkParallelMatchesSerial(model, inputs, {kSize, kSize, kSize}, ANEURALNETWORKS_NO_ERROR);
+
+    const Result serial = run(model, inputs, {kSize, kSize, kSize}, nullptr, 1);
+    EXPECT_THAT(serial.outputs[0], ElementsAreArray({-6.0f, 0.0f, 4.5f, 9.0f}));
+    EXPECT_THAT(serial.outputs[1], ElementsAreArray({-20.0f, 2.5f, -0.875f, -6.0f}));
+    EXPECT_THAT(serial.outputs[2], ElementsAreArray({0.0f, 0.5f, 2.0f, 3.0f}));
+}
+
+TEST_F(CpuExecutorParallelTest, ReportsEarliestFailure) {
+    // RESHAPE fails as its target shape does not match the size of in0, and
+    // the independent ADD after it fails as its output buffer is too small.
+    // Serial execution stops at RESHAPE, so that is the failure to report,
+    // whichever of the two concurrent operations fails first.
+    Model model;
+    const Operand activation = makeConstant(&model, OperandType::INT32, {0});
+    const Operand targetShape = makeConstant(&model, OperandType::TENSOR_INT32, {kSize - 1}, {1});
+    model.main = {
+            .operands = {makeTensor(Operand::LifeTime::SUBGRAPH_INPUT), activation, targetShape,
+                         makeTensor(Operand::LifeTime::SUBGRAPH_OUTPUT, {0}),
+                         makeTensor(Operand::LifeTime::SUBGRAPH_OUTPUT)},
+            .operations = {{.type = OperationType::RESHAPE, .inputs = {0, 2}, .outputs = {3}},
+                           {.type = OperationType::ADD, .inputs = {0, 0, 1}, .outputs = {4}}},
+            .inputIndexes = {0},
+            .outputIndexes = {3, 4},
+    };
+    const std::vector<std::vector<float>> inputs = {{1.0f, 2.0f, 3.0f, 4.0f}};
+    checkParallelMatchesSerial(model, inputs, {kSize, kSize / 2}, ANEURALNETWORKS_OP_FAILED);
+
+    // Without the failing RESHAPE, the ADD failure is reported.
+    model.main.operations[0].inputs = {0, 0, 1};
+    model.main.operations[0].type = OperationType::MUL;
+    checkParallelMatchesSerial(model, inputs, {kSize, kSize / 2},
+                               ANEURALNETWORKS_OUTPUT_INSUFFICIENT_SIZE);
+}
+
 TEST(QuantizationUtilsTest, QuantizeMultiplierSmallerThanOneExp) {
     auto checkInvalidQuantization = [](double value) {
         int32_t q;
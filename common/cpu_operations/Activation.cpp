@@ -544,15 +544,14 @@ bool executeHardSwish(IOperationExecutionContext* context) {
     if (getNumberOfElements(context->getOutputShape(kOutputTensor)) == 0) return true;
     switch (context->getInputType(kInputTensor)) {
         case OperandType::TENSOR_FLOAT16: {
-            const Shape& inputShape = context->getInputShape(kInputTensor);
-            const Shape& outputShape = context->getOutputShape(kOutputTensor);
-            std::vector<float> inputFloat(getNumberOfElements(inputShape));
-            std::vector<float> outputFloat(getNumberOfElements(outputShape));
-            convertFloat16ToFloat32(context->getInputBuffer<_Float16>(kInputTensor), &inputFloat);
-            tflite::reference_ops::HardSwish(convertShapeToTflshape(inputShape), inputFloat.data(),
-                                             convertShapeToTflshape(outputShape),
-                                             outputFloat.data());
-            convertFloat32ToFloat16(outputFloat, context->getOutputBuffer<_Float16>(kOutputTensor));
+            // Same as tflite::reference_ops::HardSwish, computed in float32 per element.
+            const _Float16* inputData = context->getInputBuffer<_Float16>(kInputTensor);
+            _Float16* outputData = context->getOutputBuffer<_Float16>(kOutputTensor);
+            const uint32_t size = getNumberOfElements(context->getInputShape(kInputTensor));
+            for (uint32_t i = 0; i < size; ++i) {
+                const float in = inputData[i];
+                outputData[i] = in * std::min(6.0f, std::max(0.0f, in + 3.0f)) / 6.0f;
+            }
             return true;
         }
         case OperandType::TENSOR_FLOAT32: {
@@ -21,10 +21,12 @@
 #pragma clang diagnostic ignored "-Wunused-parameter"
 #pragma clang diagnostic ignored "-Wsign-compare"
 #pragma clang diagnostic ignored "-Winvalid-partial-specialization"
+#include <ruy/ruy.h>
 #include <tensorflow/lite/kernels/internal/reference/reference_ops.h>
 #include <tensorflow/lite/kernels/internal/runtime_shape.h>
 #pragma clang diagnostic pop
 
+#include <algorithm>
 #include <limits>
 #include <memory>
 #include <vector>
@@ -103,6 +105,84 @@ std::unique_ptr<T[]> getTempData(uint32_t numElems) {
     return std::unique_ptr<T[]>(new (std::nothrow) T[numElems]);
 }
 
+// Performs batch matmul with one ruy GEMM per matrix of the output, which ruy blocks for the
+// caches and parallelizes over the threads of ruyContext.
+// LHS <..., A, B>  X  RHS<..., B, C>
+// An adjoint operand stores the transpose of its matrix row-major, which is the matrix itself
+// column-major, so the adjoint flags only change the order of the ruy layouts and no operand is
+// transposed in memory. Batch dimensions of size 1 in RHS are broadcast.
+template <typename T, typename MulParamsType>
+bool batchMatMulRuy(const T* inputLHSData, const Shape& inputLHSShape, const T* inputRHSData,
+                    const Shape& inputRHSShape, const bool adjX, const bool adjY,
+                    const MulParamsType& mulParams, T* outputData, const Shape& outputShape,
+                    ruy::Context* ruyContext) {
+    const uint32_t numDims = getNumberOfDimensions(outputShape);
+    const uint32_t outputRows = getSizeOfDimension(outputShape, numDims - 2);
+    const uint32_t outputCols = getSizeOfDimension(outputShape, numDims - 1);
+    const uint32_t depth = getSizeOfDimension(inputLHSShape, adjX ? numDims - 2 : numDims - 1);
+
+    ruy::Matrix<T> lhs;
+    ruy::MakeSimpleLayout(outputRows, depth, adjX ? ruy::Order::kColMajor : ruy::Order::kRowMajor,
+                          lhs.mutable_layout());
+    lhs.set_zero_point(static_cast<T>(inputLHSShape.offset));
+    ruy::Matrix<T> rhs;
+    ruy::MakeSimpleLayout(depth, outputCols, adjY ? ruy::Order::kColMajor : ruy::Order::kRowMajor,
+                          rhs.mutable_layout());
+    rhs.set_zero_point(static_cast<T>(inputRHSShape.offset));
+    ruy::Matrix<T> dst;
+    ruy::MakeSimpleLayout(outputRows, outputCols, ruy::Order::kRowMajor, dst.mutable_layout());
+    dst.set_zero_point(static_cast<T>(outputShape.offset));
+
+    uint32_t numBatches = 1;
+    for (uint32_t d = 0; d + 2 < numDims; ++d) {
+        const uint32_t rhsDim = getSizeOfDimension(inputRHSShape, d);
+        NN_RET_CHECK(rhsDim == 1 || rhsDim == getSizeOfDimension(outputShape, d))
+                << "Batch dimensions of RHS can not be broadcast to the output.";
+        numBatches *= getSizeOfDimension(outputShape, d);
+    }
+    const uint32_t lhsMatrixSize = outputRows * depth;
+    const uint32_t rhsMatrixSize = depth * outputCols;
+    const uint32_t outputMatrixSize = outputRows * outputCols;
+    for (uint32_t b = 0; b < numBatches; ++b) {
+        // The output batch index is also the LHS one, whose batch dimensions the output has.
+        uint32_t rhsBatch = 0;
+        uint32_t rhsBatchStride = 1;
+        uint32_t remaining = b;
+        for (uint32_t d = numDims - 2; d-- > 0;) {
+            const uint32_t outputDim = getSizeOfDimension(outputShape, d);
+            const uint32_t rhsDim = getSizeOfDimension(inputRHSShape, d);
+            if (rhsDim != 1) {
+                rhsBatch += (remaining % outputDim) * rhsBatchStride;
+            }
+            remaining /= outputDim;
+            rhsBatchStride *= rhsDim;
+        }
+        lhs.set_data(inputLHSData + b * lhsMatrixSize);
+        rhs.set_data(inputRHSData + rhsBatch * rhsMatrixSize);
+        dst.set_data(outputData + b * outputMatrixSize);
+        ruy::Mul(lhs, rhs, mulParams, ruyContext, &dst);
+    }
+    return true;
+}
+
+bool batchMatMulFloat32(const float* inputLHSData, const Shape& inputLHSShape,
+                        const float* inputRHSData, const Shape& inputRHSShape, const bool adjX,
+                        const bool adjY, float* outputData, const Shape& outputShape,
+                        IOperationExecutionContext* context) {
+    NNTRACE_TRANS("batchMatMulFloat32");
+    NNTRACE_COMP_SWITCH("ruy::Mul");
+    return batchMatMulRuy(inputLHSData, inputLHSShape, inputRHSData, inputRHSShape, adjX, adjY,
+                          ruy::MulParams<float, float>(), outputData, outputShape,
+                          context->getRuyContext());
+}
+
+// Returns whether an int8 operand and its zero point avoid -128.
+bool avoidsInt8Min(const int8_t* data, const Shape& shape) {
+    const int8_t* end = data + getNumberOfElements(shape);
+    return shape.offset != std::numeric_limits<int8_t>::min() &&
+           std::find(data, end, std::numeric_limits<int8_t>::min()) == end;
+}
+
 // Performs batch matmul.
 // LHS <..., A, B>  X  RHS<..., B, C>
 // We assume that LHS and RHS are both row oriented (adjacent values in memory
@@ -151,8 +231,27 @@ bool batchMatMulGeneric(const T* inputLHSData, const Shape& inputLHSShape, const
 template <typename T>
 bool batchMatMulQuantized(const T* inputLHSData, const Shape& inputLHSShape, const T* inputRHSData,
                           const Shape& inputRHSShape, const bool adjX, const bool adjY,
-                          T* outputData, const Shape& outputShape) {
+                          T* outputData, const Shape& outputShape,
+                          IOperationExecutionContext* context) {
     NNTRACE_TRANS("batchMatMulQuantized");
+    // The pre-dotprod ruy kernels accumulate pairs of int8 products in int16, which overflows
+    // only if both operands hold -128, and ruy rejects two zero points of -128.
+    if (avoidsInt8Min(inputLHSData, inputLHSShape) ||
+        avoidsInt8Min(inputRHSData, inputRHSShape)) {
+        double realMultiplier = 0.0;
+        int32_t outputMultiplier = 0;
+        int32_t outputShift = 0;
+        NN_RET_CHECK(GetQuantizedConvolutionMultiplier(inputLHSShape, inputRHSShape, outputShape,
+                                                       &realMultiplier));
+        NN_RET_CHECK(QuantizeMultiplier(realMultiplier, &outputMultiplier, &outputShift));
+        ruy::MulParams<int32_t, T> mulParams;
+        mulParams.set_multiplier_fixedpoint(outputMultiplier);
+        mulParams.set_multiplier_exponent(outputShift);
+        NNTRACE_COMP_SWITCH("ruy::Mul");
+        return batchMatMulRuy(inputLHSData, inputLHSShape, inputRHSData, inputRHSShape, adjX,
+                              adjY, mulParams, outputData, outputShape, context->getRuyContext());
+    }
+
     NNTRACE_COMP_SWITCH("reference_ops::Transpose");
     const T* realInputLHSData = inputLHSData;
     const T* realInputRHSData = inputRHSData;
@@ -229,14 +328,14 @@ bool prepare(IOperationExecutionContext* context) {
 bool execute(IOperationExecutionContext* context) {
     switch (context->getInputType(kInputLHSTensor)) {
         case OperandType::TENSOR_FLOAT32:
-            return batchMatMulGeneric(context->getInputBuffer<float>(kInputLHSTensor),
+            return batchMatMulFloat32(context->getInputBuffer<float>(kInputLHSTensor),
                                       context->getInputShape(kInputLHSTensor),
                                       context->getInputBuffer<float>(kInputRHSTensor),
                                       context->getInputShape(kInputRHSTensor),
                                       context->getInputValue<bool>(kInputLHSAdj),
                                       context->getInputValue<bool>(kInputRHSAdj),
                                       context->getOutputBuffer<float>(kOutputTensor),
-                                      context->getOutputShape(kOutputTensor));
+                                      context->getOutputShape(kOutputTensor), context);
         case OperandType::TENSOR_FLOAT16:
             return batchMatMulGeneric(context->getInputBuffer<_Float16>(kInputLHSTensor),
                                       context->getInputShape(kInputLHSTensor),
@@ -263,7 +362,7 @@ bool execute(IOperationExecutionContext* context) {
                                         context->getInputValue<bool>(kInputLHSAdj),
                                         context->getInputValue<bool>(kInputRHSAdj),
                                         context->getOutputBuffer<int8_t>(kOutputTensor),
-                                        context->getOutputShape(kOutputTensor));
+                                        context->getOutputShape(kOutputTensor), context);
         default:
             NN_RET_CHECK_FAIL() << "Unsupported tensor type for operation " << kOperationName;
     }
@@ -21,7 +21,8 @@
 #include "Broadcast.h"
 
 #include <algorithm>
-#include <vector>
+#include <array>
+#include <functional>
 
 #include "IndexedShapeWrapper.h"
 #include "OperationResolver.h"
@@ -72,23 +73,64 @@ namespace {
             return false;                                               \
     }
 
-using binaryFunctionFloat32 = std::function<bool(
-        const float* in1, const Shape& shape1, const float* in2, const Shape& shape2,
-        int32_t activation, float* out, const Shape& shapeOut)>;
+// Returns the strides of |shape| in a 4-D iteration over the broadcasted output shape, with 0
+// for the dimensions that are broadcast.
+std::array<uint32_t, 4> getBroadcastStrides(const Shape& shape) {
+    std::array<uint32_t, 4> strides = {0, 0, 0, 0};
+    const uint32_t numDims = getNumberOfDimensions(shape);
+    uint32_t stride = 1;
+    for (uint32_t i = 0; i < numDims; ++i) {
+        const uint32_t dim = getSizeOfDimension(shape, numDims - 1 - i);
+        strides[3 - i] = dim == 1 ? 0 : stride;
+        stride *= dim;
+    }
+    return strides;
+}
 
+// Evaluates |op| in float32 one element at a time, so that no float32 copies of the operands
+// are needed. The results are identical to running the float32 kernel on converted operands.
+template <typename BinaryOp>
 bool binaryOperationFloat16(const _Float16* in1, const Shape& shape1, const _Float16* in2,
                             const Shape& shape2, int32_t activation, _Float16* out,
-                            const Shape& shapeOut, binaryFunctionFloat32 operationFloat32) {
-    std::vector<float> in1_float32(getNumberOfElements(shape1));
-    convertFloat16ToFloat32(in1, &in1_float32);
-    std::vector<float> in2_float32(getNumberOfElements(shape2));
-    convertFloat16ToFloat32(in2, &in2_float32);
-    std::vector<float> out_float32(getNumberOfElements(shapeOut));
-
-    operationFloat32(in1_float32.data(), shape1, in2_float32.data(), shape2, activation,
-                     out_float32.data(), shapeOut);
-    convertFloat32ToFloat16(out_float32, out);
+                            const Shape& shapeOut, BinaryOp op) {
+    NN_RET_CHECK_LE(static_cast<uint32_t>(activation),
+                    static_cast<uint32_t>(FusedActivationFunc::RELU6))
+            << "Unsupported fused activation function type";
+    float outputActivationMin, outputActivationMax;
+    CalculateActivationRangeFloat(activation, &outputActivationMin, &outputActivationMax);
+    const auto compute = [&op, outputActivationMin, outputActivationMax](_Float16 a, _Float16 b) {
+        const float result = op(static_cast<float>(a), static_cast<float>(b));
+        return static_cast<_Float16>(
+                std::min(std::max(result, outputActivationMin), outputActivationMax));
+    };
+
+    if (SameShape(shape1, shape2)) {
+        const uint32_t size = getNumberOfElements(shapeOut);
+        for (uint32_t i = 0; i < size; ++i) {
+            out[i] = compute(in1[i], in2[i]);
+        }
+        return true;
+    }
 
+    const uint32_t numOutputDims = getNumberOfDimensions(shapeOut);
+    NN_RET_CHECK_LE(numOutputDims, 4u);
+    std::array<uint32_t, 4> outputDims = {1, 1, 1, 1};
+    for (uint32_t i = 0; i < numOutputDims; ++i) {
+        outputDims[4 - numOutputDims + i] = getSizeOfDimension(shapeOut, i);
+    }
+    const std::array<uint32_t, 4> strides1 = getBroadcastStrides(shape1);
+    const std::array<uint32_t, 4> strides2 = getBroadcastStrides(shape2);
+    for (uint32_t i0 = 0; i0 < outputDims[0]; ++i0) {
+        for (uint32_t i1 = 0; i1 < outputDims[1]; ++i1) {
+            for (uint32_t i2 = 0; i2 < outputDims[2]; ++i2) {
+                const _Float16* row1 = in1 + i0 * strides1[0] + i1 * strides1[1] + i2 * strides1[2];
+                const _Float16* row2 = in2 + i0 * strides2[0] + i1 * strides2[1] + i2 * strides2[2];
+                for (uint32_t i3 = 0; i3 < outputDims[3]; ++i3) {
+                    *out++ = compute(row1[i3 * strides1[3]], row2[i3 * strides2[3]]);
+                }
+            }
+        }
+    }
     return true;
 }
 
@@ -122,7 +164,8 @@ bool addFloat32(const float* in1, const Shape& shape1, const float* in2, const S
 bool addFloat16(const _Float16* in1, const Shape& shape1, const _Float16* in2, const Shape& shape2,
                 int32_t activation, _Float16* out, const Shape& shapeOut) {
     NNTRACE_TRANS("addFloat16");
-    return binaryOperationFloat16(in1, shape1, in2, shape2, activation, out, shapeOut, &addFloat32);
+    return binaryOperationFloat16(in1, shape1, in2, shape2, activation, out, shapeOut,
+                                  std::plus<float>());
 }
 
 template <typename T>
@@ -211,24 +254,7 @@ bool executeInt32(const int32_t* aData, const Shape& aShape, const int32_t* bDat
                   const Shape& bShape, int32_t activation, int32_t* outputData,
                   const Shape& outputShape, int32_t func(int32_t, int32_t)) {
     NN_RET_CHECK_EQ(static_cast<FusedActivationFunc>(activation), FusedActivationFunc::NONE);
-    IndexedShapeWrapper aShapeIndexed(aShape);
-    IndexedShapeWrapper bShapeIndexed(bShape);
-    IndexedShapeWrapper outputShapeIndexed(outputShape);
-    std::vector<uint32_t> curIndex(outputShape.dimensions.size(), 0);
-    bool lastIndex = false;
-    do {
-        uint32_t outputFlatIndex;
-        NN_RET_CHECK(outputShapeIndexed.indexToFlatIndex(curIndex, &outputFlatIndex));
-        uint32_t aFlatIndex;
-        NN_RET_CHECK(aShapeIndexed.broadcastedIndexToFlatIndex(curIndex, &aFlatIndex));
-        uint32_t bFlatIndex;
-        NN_RET_CHECK(bShapeIndexed.broadcastedIndexToFlatIndex(curIndex, &bFlatIndex));
-
-        outputData[outputFlatIndex] = func(aData[aFlatIndex], bData[bFlatIndex]);
-
-        NN_RET_CHECK(outputShapeIndexed.nextIndexInplace(&curIndex, &lastIndex));
-    } while (!lastIndex);
-    return true;
+    return broadcastBinaryOp(aData, aShape, bData, bShape, outputData, outputShape, func);
 }
 
 bool mulFloat32(const float* in1, const Shape& shape1, const float* in2, const Shape& shape2,
@@ -261,7 +287,8 @@ bool mulFloat32(const float* in1, const Shape& shape1, const float* in2, const S
 bool mulFloat16(const _Float16* in1, const Shape& shape1, const _Float16* in2, const Shape& shape2,
                 int32_t activation, _Float16* out, const Shape& shapeOut) {
     NNTRACE_TRANS("mulFloat16");
-    return binaryOperationFloat16(in1, shape1, in2, shape2, activation, out, shapeOut, &mulFloat32);
+    return binaryOperationFloat16(in1, shape1, in2, shape2, activation, out, shapeOut,
+                                  std::multiplies<float>());
 }
 
 template <typename T>
@@ -332,7 +359,8 @@ bool subFloat32(const float* in1, const Shape& shape1, const float* in2, const S
 bool subFloat16(const _Float16* in1, const Shape& shape1, const _Float16* in2, const Shape& shape2,
                 int32_t activation, _Float16* out, const Shape& shapeOut) {
     NNTRACE_TRANS("subFloat16");
-    return binaryOperationFloat16(in1, shape1, in2, shape2, activation, out, shapeOut, &subFloat32);
+    return binaryOperationFloat16(in1, shape1, in2, shape2, activation, out, shapeOut,
+                                  std::minus<float>());
 }
 
 template <typename T>
@@ -432,7 +460,8 @@ bool divFloat32(const float* in1, const Shape& shape1, const float* in2, const S
 bool divFloat16(const _Float16* in1, const Shape& shape1, const _Float16* in2, const Shape& shape2,
                 int32_t activation, _Float16* out, const Shape& shapeOut) {
     NNTRACE_TRANS("divFloat16");
-    return binaryOperationFloat16(in1, shape1, in2, shape2, activation, out, shapeOut, &divFloat32);
+    return binaryOperationFloat16(in1, shape1, in2, shape2, activation, out, shapeOut,
+                                  std::divides<float>());
 }
 
 }  // namespace
@@ -19,7 +19,7 @@
 #include "Comparisons.h"
 
 #include <functional>
-#include <vector>
+#include <type_traits>
 
 #include "IndexedShapeWrapper.h"
 #include "OperationResolver.h"
@@ -30,35 +30,23 @@ namespace nn {
 namespace comparisons {
 namespace {
 
-template <typename DataType, typename ComparisonType>
-bool compute(const std::function<bool(ComparisonType, ComparisonType)>& func, const DataType* aData,
-             const Shape& aShape, const DataType* bData, const Shape& bShape, bool8* outputData,
-             const Shape& outputShape) {
-    IndexedShapeWrapper aShapeIndexed(aShape);
-    IndexedShapeWrapper bShapeIndexed(bShape);
-    IndexedShapeWrapper outputShapeIndexed(outputShape);
-    std::vector<uint32_t> curIndex(outputShape.dimensions.size(), 0);
-    bool lastIndex = false;
-    do {
-        uint32_t outputFlatIndex;
-        NN_RET_CHECK(outputShapeIndexed.indexToFlatIndex(curIndex, &outputFlatIndex));
-        uint32_t aFlatIndex;
-        NN_RET_CHECK(aShapeIndexed.broadcastedIndexToFlatIndex(curIndex, &aFlatIndex));
-        uint32_t bFlatIndex;
-        NN_RET_CHECK(bShapeIndexed.broadcastedIndexToFlatIndex(curIndex, &bFlatIndex));
-
-        if (aShape.type == OperandType::TENSOR_QUANT8_ASYMM ||
-            aShape.type == OperandType::TENSOR_QUANT8_ASYMM_SIGNED) {
-            const float realA = (aData[aFlatIndex] - aShape.offset) * aShape.scale;
-            const float realB = (bData[bFlatIndex] - bShape.offset) * bShape.scale;
-            outputData[outputFlatIndex] = func(realA, realB);
-        } else {
-            outputData[outputFlatIndex] = func(aData[aFlatIndex], bData[bFlatIndex]);
-        }
-
-        NN_RET_CHECK(outputShapeIndexed.nextIndexInplace(&curIndex, &lastIndex));
-    } while (!lastIndex);
-    return true;
+template <typename DataType, typename ComparisonType, typename Compare>
+bool compute(Compare func, const DataType* aData, const Shape& aShape, const DataType* bData,
+             const Shape& bShape, bool8* outputData, const Shape& outputShape) {
+    // Quantized values are compared after dequantization.
+    if constexpr (!std::is_same_v<DataType, ComparisonType>) {
+        const int32_t aOffset = aShape.offset, bOffset = bShape.offset;
+        const float aScale = aShape.scale, bScale = bShape.scale;
+        return broadcastBinaryOp(aData, aShape, bData, bShape, outputData, outputShape,
+                                 [=](DataType a, DataType b) -> bool8 {
+                                     const float realA = (a - aOffset) * aScale;
+                                     const float realB = (b - bOffset) * bScale;
+                                     return func(realA, realB);
+                                 });
+    } else {
+        return broadcastBinaryOp(aData, aShape, bData, bShape, outputData, outputShape,
+                                 [=](DataType a, DataType b) -> bool8 { return func(a, b); });
+    }
 }
 
 template <typename DataType, typename ComparisonType>
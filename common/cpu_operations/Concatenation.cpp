@@ -19,6 +19,7 @@
 #include "Concatenation.h"
 
 #include <algorithm>
+#include <cmath>
 #include <iterator>
 #include <vector>
 
@@ -94,6 +95,47 @@ bool concatenation<uint8_t>(const std::vector<const uint8_t*>& inputDataPtrs,
     return true;
 }
 
+template <>
+bool concatenation<int8_t>(const std::vector<const int8_t*>& inputDataPtrs,
+                           const std::vector<Shape>& inputShapes, int32_t axis, int8_t* outputData,
+                           const Shape& outputShape) {
+    NNTRACE_TRANS("concatenationQuant8Signed");
+    uint32_t outerSize = 1;
+    for (int32_t i = 0; i < axis; ++i) {
+        outerSize *= getSizeOfDimension(outputShape, i);
+    }
+    uint32_t innerSize = 1;
+    for (uint32_t i = axis + 1; i < getNumberOfDimensions(outputShape); ++i) {
+        innerSize *= getSizeOfDimension(outputShape, i);
+    }
+
+    NNTRACE_COMP_SWITCH("concatenationQuant8Signed");
+    const float inverseOutputScale = 1.f / outputShape.scale;
+    int8_t* outputPtr = outputData;
+    for (uint32_t k = 0; k < outerSize; ++k) {
+        for (size_t i = 0; i < inputShapes.size(); ++i) {
+            const Shape& inputShape = inputShapes[i];
+            const uint32_t copySize = getSizeOfDimension(inputShape, axis) * innerSize;
+            const int8_t* inputPtr = inputDataPtrs[i] + k * copySize;
+            if (inputShape.offset == outputShape.offset && inputShape.scale == outputShape.scale) {
+                std::copy(inputPtr, inputPtr + copySize, outputPtr);
+            } else {
+                // Requantizes the same way as the uint8 reference implementation.
+                const float scale = inputShape.scale * inverseOutputScale;
+                const float bias = -inputShape.offset * scale;
+                for (uint32_t j = 0; j < copySize; ++j) {
+                    const int32_t value =
+                            static_cast<int32_t>(std::round(inputPtr[j] * scale + bias)) +
+                            outputShape.offset;
+                    outputPtr[j] = static_cast<int8_t>(std::clamp(value, -128, 127));
+                }
+            }
+            outputPtr += copySize;
+        }
+    }
+    return true;
+}
+
 template <typename T>
 inline bool concatenation(IOperationExecutionContext* context) {
     uint32_t inputCount = context->getNumInputs() - 1;
@@ -110,36 +152,6 @@ inline bool concatenation(IOperationExecutionContext* context) {
                          context->getOutputShape(kOutputTensor));
 }
 
-template <>
-inline bool concatenation<int8_t>(IOperationExecutionContext* context) {
-    uint32_t inputCount = context->getNumInputs() - 1;
-    std::vector<std::vector<uint8_t>> inputs_uint8(inputCount);
-    for (uint32_t i = 0; i < inputCount; ++i) {
-        const auto currentSize = getNumberOfElements(context->getInputShape(i));
-        inputs_uint8[i].resize(currentSize);
-        if (currentSize != 0) {
-            convertInt8ToUInt8(context->getInputBuffer<int8_t>(i), &inputs_uint8[i]);
-        }
-    }
-    std::vector<const uint8_t*> inputDatas;
-    std::vector<Shape> inputShapes;
-    for (uint32_t i = 0; i < inputCount; ++i) {
-        inputDatas.push_back(inputs_uint8[i].data());
-        inputShapes.push_back(context->getInputShape(i));
-        inputShapes[i].offset += 128;
-    }
-
-    std::vector<uint8_t> output_uint8(getNumberOfElements(context->getOutputShape(kOutputTensor)));
-    Shape outputShape(context->getOutputShape(kOutputTensor));
-    outputShape.offset += 128;
-    NN_RET_CHECK(concatenation(inputDatas, inputShapes, context->getInputValue<int32_t>(inputCount),
-                               output_uint8.data(), outputShape));
-
-    convertUInt8ToInt8(output_uint8, context->getOutputBuffer<int8_t>(kOutputTensor));
-
-    return true;
-}
-
 }  // namespace
 
 bool prepare(IOperationExecutionContext* context) {
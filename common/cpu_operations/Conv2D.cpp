@@ -20,7 +20,9 @@
 
 #include <algorithm>
 #include <iterator>
+#include <limits>
 #include <memory>
+#include <tuple>
 #include <vector>
 
 #include "LegacyUtils.h"
@@ -34,8 +36,9 @@
 #pragma clang diagnostic ignored "-Wunused-parameter"
 #pragma clang diagnostic ignored "-Wsign-compare"
 #pragma clang diagnostic ignored "-Winvalid-partial-specialization"
+#include <public/gemmlowp.h>
+#include <ruy/ruy.h>
 #include <tensorflow/lite/kernels/internal/optimized/legacy_optimized_ops.h>
-#include <tensorflow/lite/kernels/internal/reference/integer_ops/conv.h>
 #include <tensorflow/lite/kernels/internal/types.h>
 #pragma clang diagnostic pop
 
@@ -49,15 +52,6 @@ namespace conv_2d {
 #ifdef NN_INCLUDE_CPU_IMPLEMENTATION
 namespace {
 
-// If possible we will use this static buffer for the tensor.
-constexpr size_t kStaticBufferSize = 1605632;
-[[maybe_unused]] char static_scratch_buffer[kStaticBufferSize];
-
-// executionMutex is used to protect concurrent access of the static_scratch_buffer
-// and other non-threadsafe resources like gemmlowp::GemmContext.
-// std::mutex is safe for pthreads on Android.
-std::mutex executionMutex;
-
 struct Conv2dParam {
     int32_t padding_left, padding_right;
     int32_t padding_top, padding_bottom;
@@ -161,9 +155,8 @@ struct Conv2dParam {
         LOG(ERROR) << "Conv size is too large, not enough memory";                \
         return false;                                                             \
     }                                                                             \
-    if (im2colByteSize <= kStaticBufferSize) {                                    \
-        im2colData = reinterpret_cast<Type*>(static_scratch_buffer);              \
-    } else {                                                                      \
+    im2colData = static_cast<Type*>(context->getScratchBuffer(im2colByteSize));   \
+    if (im2colData == nullptr) {                                                  \
         im2colData = new (std::nothrow) Type[im2colByteSize / sizeof(Type)];      \
         if (im2colData == nullptr) {                                              \
             LOG(ERROR) << "Conv size is too large, not enough memory";            \
@@ -193,7 +186,7 @@ bool convNhwc(const float* inputData, const Shape& inputShape, const float* filt
               int32_t padding_left, int32_t /*padding_right*/, int32_t padding_top,
               int32_t /*padding_bottom*/, int32_t stride_width, int32_t stride_height,
               int32_t dilation_width_factor, int32_t dilation_height_factor, int32_t activation,
-              float* outputData, const Shape& outputShape) {
+              float* outputData, const Shape& outputShape, IOperationExecutionContext* context) {
     NNTRACE_TRANS("convFloat32");
 
     ANDROID_NN_CONV_PARAMETERS(float)
@@ -201,8 +194,6 @@ bool convNhwc(const float* inputData, const Shape& inputShape, const float* filt
     float output_activation_min, output_activation_max;
     CalculateActivationRangeFloat(activation, &output_activation_min, &output_activation_max);
 
-    // Prevent concurrent executions that may access the scratch buffer.
-    std::unique_lock<std::mutex> lock(executionMutex);
     NNTRACE_COMP_SWITCH("optimized_ops::Conv");
 
     const bool need_im2colData = needim2colData(filterShape, stride_width, stride_height,
@@ -222,7 +213,7 @@ bool convNhwc(const uint8_t* inputData, const Shape& inputShape, const uint8_t*
               int32_t padding_left, int32_t /*padding_right*/, int32_t padding_top,
               int32_t /*padding_bottom*/, int32_t stride_width, int32_t stride_height,
               int32_t dilation_width_factor, int32_t dilation_height_factor, int32_t activation,
-              uint8_t* outputData, const Shape& outputShape) {
+              uint8_t* outputData, const Shape& outputShape, IOperationExecutionContext* context) {
     NNTRACE_TRANS("convQuant8");
 
     ANDROID_NN_CONV_PARAMETERS(uint8_t)
@@ -245,14 +236,6 @@ bool convNhwc(const uint8_t* inputData, const Shape& inputShape, const uint8_t*
     CalculateActivationRangeUint8(activation, outputShape, &output_activation_min,
                                   &output_activation_max);
 
-    static gemmlowp::GemmContext gemm_context;
-
-    // Prevent concurrent executions that may access the scratch buffer and
-    // gemm_context.
-    std::unique_lock<std::mutex> lock(executionMutex);
-    // Alow gemmlowp automatically decide how many threads to use.
-    gemm_context.set_max_num_threads(0);
-
     NNTRACE_COMP_SWITCH("optimized_ops::Conv");
 
     const bool need_im2colData = needim2colData(filterShape, stride_width, stride_height,
@@ -265,65 +248,196 @@ bool convNhwc(const uint8_t* inputData, const Shape& inputShape, const uint8_t*
                                 paddingHeight, outputOffset, output_multiplier, output_shift,
                                 output_activation_min, output_activation_max, outputData,
                                 convertShapeToDims(outputShape),
-                                need_im2colData ? im2colData : nullptr, im2colDim, &gemm_context);
+                                need_im2colData ? im2colData : nullptr, im2colDim,
+                                context->getGemmContext());
     return true;
 }
 
-// Passing input, filter and output shapes by value, so that we can change the
-// offsets without modifying the actual shapes.
-bool convNhwc(const int8_t* inputData, Shape inputShape, const int8_t* filterData,
-              Shape filterShape, const int32_t* biasData, const Shape& biasShape,
-              int32_t padding_left, int32_t padding_right, int32_t padding_top,
-              int32_t padding_bottom, int32_t stride_width, int32_t stride_height,
-              int32_t dilation_width_factor, int32_t dilation_height_factor, int32_t activation,
-              int8_t* outputData, Shape outputShape) {
-    NNTRACE_TRANS("convQuant8");
-
-    std::vector<uint8_t> unsignedInput(getNumberOfElements(inputShape));
-    convertInt8ToUInt8(inputData, &unsignedInput);
-    inputShape.offset += 128;
-
-    std::vector<uint8_t> unsignedFilter(getNumberOfElements(filterShape));
-    convertInt8ToUInt8(filterData, &unsignedFilter);
-    filterShape.offset += 128;
-
-    std::vector<uint8_t> unsignedOutput(getNumberOfElements(outputShape));
-    outputShape.offset += 128;
+// Computes a signed quantized convolution directly on int8 data, as a GEMM of the filter with
+// the im2col matrix of the input. outputMultiplier and outputShift hold the requantization
+// parameters of every output channel, with positive shifts meaning left shifts.
+bool convQuant8SignedNhwc(const int8_t* inputData, const Shape& inputShape,
+                          const int8_t* filterData, const Shape& filterShape,
+                          const int32_t* biasData, int32_t paddingLeft, int32_t paddingTop,
+                          int32_t strideWidth, int32_t strideHeight, int32_t dilationWidthFactor,
+                          int32_t dilationHeightFactor,
+                          const std::vector<int32_t>& outputMultiplier,
+                          const std::vector<int32_t>& outputShift, int32_t activation,
+                          int8_t* outputData, const Shape& outputShape,
+                          IOperationExecutionContext* context) {
+    NNTRACE_TRANS("convQuant8Signed");
+    const uint32_t numBatches = getSizeOfDimension(inputShape, 0);
+    const uint32_t inputHeight = getSizeOfDimension(inputShape, 1);
+    const uint32_t inputWidth = getSizeOfDimension(inputShape, 2);
+    const uint32_t inputDepth = getSizeOfDimension(inputShape, 3);
+    const uint32_t filterHeight = getSizeOfDimension(filterShape, 1);
+    const uint32_t filterWidth = getSizeOfDimension(filterShape, 2);
+    const uint32_t outputHeight = getSizeOfDimension(outputShape, 1);
+    const uint32_t outputWidth = getSizeOfDimension(outputShape, 2);
+    const uint32_t outputDepth = getSizeOfDimension(outputShape, 3);
+    const uint32_t numPixels = numBatches * outputHeight * outputWidth;
+    const uint32_t gemmDepth = filterHeight * filterWidth * inputDepth;
+
+    int32_t outputActivationMin = 0, outputActivationMax = 0;
+    CalculateActivationRangeInt8(activation, outputShape, &outputActivationMin,
+                                 &outputActivationMax);
+
+    // The input is already the im2col matrix for an unpadded 1x1 convolution with unit strides.
+    const int8_t* im2colData = inputData;
+    std::unique_ptr<int8_t[]> im2colGuard;
+    if (needim2colData(filterShape, strideWidth, strideHeight, dilationWidthFactor,
+                       dilationHeightFactor) ||
+        outputHeight != inputHeight || outputWidth != inputWidth) {
+        const uint64_t im2colByteSize = static_cast<uint64_t>(numPixels) * gemmDepth;
+        NN_RET_CHECK_LT(im2colByteSize, 0x7fffffffu) << "Conv size is too large";
+        int8_t* im2colBuffer = static_cast<int8_t*>(context->getScratchBuffer(im2colByteSize));
+        if (im2colBuffer == nullptr) {
+            im2colBuffer = new (std::nothrow) int8_t[im2colByteSize];
+            NN_RET_CHECK(im2colBuffer != nullptr) << "Conv size is too large, not enough memory";
+            im2colGuard.reset(im2colBuffer);
+        }
 
-    NN_RET_CHECK(convNhwc(unsignedInput.data(), inputShape, unsignedFilter.data(), filterShape,
-                          biasData, biasShape, padding_left, padding_right, padding_top,
-                          padding_bottom, stride_width, stride_height, dilation_width_factor,
-                          dilation_height_factor, activation, unsignedOutput.data(), outputShape));
+        // Padded elements hold the input zero point, so that they do not contribute to the sums.
+        const int8_t inputZeroPoint = static_cast<int8_t>(inputShape.offset);
+        int8_t* im2colPtr = im2colBuffer;
+        for (uint32_t b = 0; b < numBatches; b++) {
+            for (uint32_t h = 0; h < outputHeight; h++) {
+                for (uint32_t w = 0; w < outputWidth; w++) {
+                    const int32_t hInputOrigin =
+                            static_cast<int32_t>(h) * strideHeight - paddingTop;
+                    const int32_t wInputOrigin =
+                            static_cast<int32_t>(w) * strideWidth - paddingLeft;
+                    for (uint32_t i = 0; i < filterHeight; i++) {
+                        const int32_t hInput =
+                                hInputOrigin + dilationHeightFactor * static_cast<int32_t>(i);
+                        for (uint32_t j = 0; j < filterWidth; j++) {
+                            const int32_t wInput =
+                                    wInputOrigin + dilationWidthFactor * static_cast<int32_t>(j);
+                            if (hInput >= 0 && hInput < static_cast<int32_t>(inputHeight) &&
+                                wInput >= 0 && wInput < static_cast<int32_t>(inputWidth)) {
+                                const int8_t* inputPtr =
+                                        inputData +
+                                        ((b * inputHeight + hInput) * inputWidth + wInput) *
+                                                inputDepth;
+                                std::copy(inputPtr, inputPtr + inputDepth, im2colPtr);
+                            } else {
+                                std::fill(im2colPtr, im2colPtr + inputDepth, inputZeroPoint);
+                            }
+                            im2colPtr += inputDepth;
+                        }
+                    }
+                }
+            }
+        }
+        im2colData = im2colBuffer;
+    }
 
-    convertUInt8ToInt8(unsignedOutput, outputData);
+    // The pre-dotprod ruy kernels accumulate pairs of int8 products in int16, which overflows
+    // for -128 * -128 + -128 * -128, and ruy does not take a filter zero point of -128.
+    // TFLite-style filters in [-127, 127] never hit this. Other filters are shifted to uint8 for
+    // gemmlowp, which accumulates uint8 products without overflow, and the int32 sums are then
+    // requantized per channel.
+    const int8_t* filterEnd = filterData + outputDepth * gemmDepth;
+    if (filterShape.offset == std::numeric_limits<int8_t>::min() ||
+        std::find(filterData, filterEnd, std::numeric_limits<int8_t>::min()) != filterEnd) {
+        auto toUint8 = [](int8_t value) { return static_cast<uint8_t>(value ^ 0x80); };
+        std::vector<uint8_t> unsignedFilter(outputDepth * gemmDepth);
+        std::transform(filterData, filterEnd, unsignedFilter.begin(), toUint8);
+        std::vector<uint8_t> unsignedIm2col(numPixels * gemmDepth);
+        std::transform(im2colData, im2colData + unsignedIm2col.size(), unsignedIm2col.begin(),
+                       toUint8);
+        std::vector<int32_t> accumulators(numPixels * outputDepth);
+
+        gemmlowp::MatrixMap<const uint8_t, gemmlowp::MapOrder::RowMajor> lhs(
+                unsignedFilter.data(), outputDepth, gemmDepth);
+        gemmlowp::MatrixMap<const uint8_t, gemmlowp::MapOrder::ColMajor> rhs(
+                unsignedIm2col.data(), gemmDepth, numPixels);
+        gemmlowp::MatrixMap<int32_t, gemmlowp::MapOrder::ColMajor> result(
+                accumulators.data(), outputDepth, numPixels);
+        NNTRACE_COMP_SWITCH("gemmlowp::GemmWithOutputPipeline");
+        gemmlowp::GemmWithOutputPipeline<uint8_t, int32_t, gemmlowp::DefaultL8R8BitDepthParams>(
+                context->getGemmContext(), lhs, rhs, &result, -(filterShape.offset + 128),
+                -(inputShape.offset + 128), std::make_tuple());
+
+        for (uint32_t p = 0; p < numPixels; p++) {
+            for (uint32_t d = 0; d < outputDepth; d++) {
+                int32_t sum = accumulators[p * outputDepth + d] + biasData[d];
+                sum = tflite::MultiplyByQuantizedMultiplier(sum, outputMultiplier[d],
+                                                            outputShift[d]);
+                sum += outputShape.offset;
+                sum = std::max(std::min(sum, outputActivationMax), outputActivationMin);
+                outputData[p * outputDepth + d] = static_cast<int8_t>(sum);
+            }
+        }
+        return true;
+    }
 
+    // The filter is a row-major [outputDepth, gemmDepth] matrix and the im2col matrix a
+    // column-major [gemmDepth, numPixels] one, so the column-major product is the NHWC output.
+    ruy::Matrix<int8_t> lhs;
+    ruy::MakeSimpleLayout(outputDepth, gemmDepth, ruy::Order::kRowMajor, lhs.mutable_layout());
+    lhs.set_data(filterData);
+    lhs.set_zero_point(static_cast<int8_t>(filterShape.offset));
+    ruy::Matrix<int8_t> rhs;
+    ruy::MakeSimpleLayout(gemmDepth, numPixels, ruy::Order::kColMajor, rhs.mutable_layout());
+    rhs.set_data(im2colData);
+    rhs.set_zero_point(static_cast<int8_t>(inputShape.offset));
+    ruy::Matrix<int8_t> dst;
+    ruy::MakeSimpleLayout(outputDepth, numPixels, ruy::Order::kColMajor, dst.mutable_layout());
+    dst.set_data(outputData);
+    dst.set_zero_point(static_cast<int8_t>(outputShape.offset));
+
+    ruy::MulParams<int32_t, int8_t> mulParams;
+    mulParams.set_bias(biasData);
+    mulParams.set_multiplier_fixedpoint_perchannel(outputMultiplier.data());
+    mulParams.set_multiplier_exponent_perchannel(outputShift.data());
+    mulParams.set_clamp_min(static_cast<int8_t>(outputActivationMin));
+    mulParams.set_clamp_max(static_cast<int8_t>(outputActivationMax));
+
+    NNTRACE_COMP_SWITCH("ruy::Mul");
+    ruy::Mul(lhs, rhs, mulParams, context->getRuyContext(), &dst);
     return true;
 }
 
-bool convNhwc(const _Float16* inputData, const Shape& inputShape, const _Float16* filterData,
-              const Shape& filterShape, const _Float16* biasData, const Shape& biasShape,
+bool convNhwc(const int8_t* inputData, const Shape& inputShape, const int8_t* filterData,
+              const Shape& filterShape, const int32_t* biasData, const Shape& biasShape,
+              int32_t padding_left, int32_t /*padding_right*/, int32_t padding_top,
+              int32_t /*padding_bottom*/, int32_t stride_width, int32_t stride_height,
+              int32_t dilation_width_factor, int32_t dilation_height_factor, int32_t activation,
+              int8_t* outputData, const Shape& outputShape, IOperationExecutionContext* context) {
+    double realMultiplier = 0.0;
+    NN_RET_CHECK(GetQuantizedConvolutionMultiplier(inputShape, filterShape, biasShape, outputShape,
+                                                   &realMultiplier));
+    int32_t multiplier = 0;
+    int32_t shift = 0;
+    NN_RET_CHECK(QuantizeMultiplier(realMultiplier, &multiplier, &shift));
+
+    const uint32_t outputDepth = getSizeOfDimension(outputShape, 3);
+    return convQuant8SignedNhwc(inputData, inputShape, filterData, filterShape, biasData,
+                                padding_left, padding_top, stride_width, stride_height,
+                                dilation_width_factor, dilation_height_factor,
+                                std::vector<int32_t>(outputDepth, multiplier),
+                                std::vector<int32_t>(outputDepth, shift), activation, outputData,
+                                outputShape, context);
+}
+
+bool convNhwc(const _Float16* inputData, const Shape& inputShape, const float* filterData,
+              const Shape& filterShape, const float* biasData, const Shape& biasShape,
               int32_t padding_left, int32_t padding_right, int32_t padding_top,
               int32_t padding_bottom, int32_t stride_width, int32_t stride_height,
               int32_t dilation_width_factor, int32_t dilation_height_factor, int32_t activation,
-              _Float16* outputData, const Shape& outputShape) {
+              _Float16* outputData, const Shape& outputShape, IOperationExecutionContext* context) {
     NNTRACE_TRANS("convFloat16");
-
-    std::vector<float> inputData_float32(getNumberOfElements(inputShape));
-    std::vector<float> filterData_float32(getNumberOfElements(filterShape));
-    std::vector<float> biasData_float32(getNumberOfElements(biasShape));
-    std::vector<float> outputData_float32(getNumberOfElements(outputShape));
-
-    convertFloat16ToFloat32(inputData, &inputData_float32);
-    convertFloat16ToFloat32(filterData, &filterData_float32);
-    convertFloat16ToFloat32(biasData, &biasData_float32);
-
-    convNhwc(inputData_float32.data(), inputShape, filterData_float32.data(), filterShape,
-             biasData_float32.data(), biasShape, padding_left, padding_right, padding_top,
-             padding_bottom, stride_width, stride_height, dilation_width_factor,
-             dilation_height_factor, activation, outputData_float32.data(), outputShape);
-    convertFloat32ToFloat16(outputData_float32, outputData);
-
-    return true;
+    return computeFloat16PerBatch(
+            context, inputData, inputShape, outputData, outputShape,
+            [&](const float* inputBatch, const Shape& inputBatchShape, float* outputBatch,
+                const Shape& outputBatchShape) {
+                return convNhwc(inputBatch, inputBatchShape, filterData, filterShape, biasData,
+                                biasShape, padding_left, padding_right, padding_top,
+                                padding_bottom, stride_width, stride_height,
+                                dilation_width_factor, dilation_height_factor, activation,
+                                outputBatch, outputBatchShape, context);
+            });
 }
 
 template <typename T_Input, typename T_Filter, typename T_Bias>
@@ -332,7 +446,7 @@ bool conv(const T_Input* inputData, const Shape& inputShape, const T_Filter* fil
           int32_t padding_left, int32_t padding_right, int32_t padding_top, int32_t padding_bottom,
           int32_t stride_width, int32_t stride_height, int32_t dilation_width_factor,
           int32_t dilation_height_factor, int32_t activation, bool useNchw, T_Input* outputData,
-          const Shape& outputShape) {
+          const Shape& outputShape, IOperationExecutionContext* context) {
     InputWithLayout<T_Input> input(useNchw);
     OutputWithLayout<T_Input> output(useNchw);
     NN_RET_CHECK(input.initialize(inputData, inputShape));
@@ -341,7 +455,7 @@ bool conv(const T_Input* inputData, const Shape& inputShape, const T_Filter* fil
                           biasData, biasShape, padding_left, padding_right, padding_top,
                           padding_bottom, stride_width, stride_height, dilation_width_factor,
                           dilation_height_factor, activation, output.getNhwcBuffer(),
-                          output.getNhwcShape()));
+                          output.getNhwcShape(), context));
     NN_RET_CHECK(output.commit());
     return true;
 }
@@ -353,7 +467,7 @@ bool convQuant8PerChannelNhwc(const uint8_t* inputData, const Shape& inputShape,
                               int32_t paddingTop, int32_t /*paddingBottom*/, int32_t strideWidth,
                               int32_t strideHeight, int32_t dilationWidthFactor,
                               int32_t dilationHeightFactor, int32_t activation, uint8_t* outputData,
-                              const Shape& outputShape) {
+                              const Shape& outputShape, IOperationExecutionContext* /*context*/) {
     NNTRACE_TRANS("convQuant8PerChannel");
 
     uint32_t numBatches = getSizeOfDimension(inputShape, 0);
@@ -446,23 +560,9 @@ bool convQuant8PerChannelNhwc(const int8_t* inputData, const Shape& inputShape,
                               int32_t paddingTop, int32_t /*paddingBottom*/, int32_t strideWidth,
                               int32_t strideHeight, int32_t dilationWidthFactor,
                               int32_t dilationHeightFactor, int32_t activation, int8_t* outputData,
-                              const Shape& outputShape) {
-    NNTRACE_TRANS("convQuant8SignedPerChannel");
-
-    [[maybe_unused]] uint32_t numBatches = getSizeOfDimension(inputShape, 0);
-    [[maybe_unused]] uint32_t inputHeight = getSizeOfDimension(inputShape, 1);
-    [[maybe_unused]] uint32_t inputWidth = getSizeOfDimension(inputShape, 2);
-    [[maybe_unused]] uint32_t inputDepth = getSizeOfDimension(inputShape, 3);
-    [[maybe_unused]] uint32_t filterHeight = getSizeOfDimension(filterShape, 1);
-    [[maybe_unused]] uint32_t filterWidth = getSizeOfDimension(filterShape, 2);
-    [[maybe_unused]] uint32_t filterDepth = getSizeOfDimension(filterShape, 3);
-    [[maybe_unused]] uint32_t outputHeight = getSizeOfDimension(outputShape, 1);
-    [[maybe_unused]] uint32_t outputWidth = getSizeOfDimension(outputShape, 2);
+                              const Shape& outputShape, IOperationExecutionContext* context) {
     uint32_t outputDepth = getSizeOfDimension(outputShape, 3);
 
-    [[maybe_unused]] int32_t inputOffset = -inputShape.offset;
-    [[maybe_unused]] int32_t outputOffset = outputShape.offset;
-
     auto realMultiplier = std::vector<double>(outputDepth, .0f);
     auto outputMultiplier = std::vector<int32_t>(outputDepth, 0);
     auto outputShift = std::vector<int32_t>(outputDepth, .0f);
@@ -477,29 +577,10 @@ bool convQuant8PerChannelNhwc(const int8_t* inputData, const Shape& inputShape,
         NN_RET_CHECK(QuantizeMultiplier(realMultiplier[i], &outputMultiplier[i], &outputShift[i]));
     }
 
-    int32_t output_activation_min = 0, output_activation_max = 0;
-    CalculateActivationRangeInt8(activation, outputShape, &output_activation_min,
-                                 &output_activation_max);
-
-    tflite::ConvParams convParams;
-    convParams.input_offset = -inputShape.offset;
-    convParams.output_offset = outputShape.offset;
-    convParams.stride_height = strideHeight;
-    convParams.stride_width = strideWidth;
-    convParams.dilation_height_factor = dilationHeightFactor;
-    convParams.dilation_width_factor = dilationWidthFactor;
-    convParams.padding_values.height = paddingTop;
-    convParams.padding_values.width = paddingLeft;
-    convParams.quantized_activation_min = output_activation_min;
-    convParams.quantized_activation_max = output_activation_max;
-
-    NNTRACE_COMP_SWITCH("reference_integer_ops::ConvPerChannel");
-    tflite::reference_integer_ops::ConvPerChannel(
-            convParams, outputMultiplier.data(), outputShift.data(),
-            convertShapeToTflshape(inputShape), inputData, convertShapeToTflshape(filterShape),
-            filterData, convertShapeToTflshape(biasShape), biasData,
-            convertShapeToTflshape(outputShape), outputData);
-    return true;
+    return convQuant8SignedNhwc(inputData, inputShape, filterData, filterShape, biasData,
+                                paddingLeft, paddingTop, strideWidth, strideHeight,
+                                dilationWidthFactor, dilationHeightFactor, outputMultiplier,
+                                outputShift, activation, outputData, outputShape, context);
 }
 
 template <typename T>
@@ -509,7 +590,8 @@ bool convQuant8PerChannel(const T* inputData, const Shape& inputShape, const int
                           int32_t paddingRight, int32_t paddingTop, int32_t paddingBottom,
                           int32_t strideWidth, int32_t strideHeight, int32_t dilationWidthFactor,
                           int32_t dilationHeightFactor, int32_t activation, bool useNchw,
-                          T* outputData, const Shape& outputShape) {
+                          T* outputData, const Shape& outputShape,
+                          IOperationExecutionContext* context) {
     InputWithLayout<T> input(useNchw);
     OutputWithLayout<T> output(useNchw);
     NN_RET_CHECK(input.initialize(inputData, inputShape));
@@ -518,7 +600,7 @@ bool convQuant8PerChannel(const T* inputData, const Shape& inputShape, const int
             input.getNhwcBuffer(), input.getNhwcShape(), filterData, filterShape, filterScales,
             biasData, biasShape, paddingLeft, paddingRight, paddingTop, paddingBottom, strideWidth,
             strideHeight, dilationWidthFactor, dilationHeightFactor, activation,
-            output.getNhwcBuffer(), output.getNhwcShape()));
+            output.getNhwcBuffer(), output.getNhwcShape(), context));
     NN_RET_CHECK(output.commit());
     return true;
 }
@@ -607,19 +689,20 @@ bool execute(IOperationExecutionContext* context) {
                         param.stride_width, param.stride_height, param.dilation_width_factor,
                         param.dilation_height_factor, param.activation, param.useNchw,
                         context->getOutputBuffer<float>(kOutputTensor),
-                        context->getOutputShape(kOutputTensor));
-        case OperandType::TENSOR_FLOAT16:
+                        context->getOutputShape(kOutputTensor), context);
+        case OperandType::TENSOR_FLOAT16: {
+            const Float32Input filter(context, kFilterTensor);
+            const Float32Input bias(context, kBiasTensor);
             return conv(context->getInputBuffer<_Float16>(kInputTensor),
-                        context->getInputShape(kInputTensor),
-                        context->getInputBuffer<_Float16>(kFilterTensor),
-                        context->getInputShape(kFilterTensor),
-                        context->getInputBuffer<_Float16>(kBiasTensor),
+                        context->getInputShape(kInputTensor), filter.get(),
+                        context->getInputShape(kFilterTensor), bias.get(),
                         context->getInputShape(kBiasTensor), param.padding_left,
                         param.padding_right, param.padding_top, param.padding_bottom,
                         param.stride_width, param.stride_height, param.dilation_width_factor,
                         param.dilation_height_factor, param.activation, param.useNchw,
                         context->getOutputBuffer<_Float16>(kOutputTensor),
-                        context->getOutputShape(kOutputTensor));
+                        context->getOutputShape(kOutputTensor), context);
+        }
         case OperandType::TENSOR_QUANT8_ASYMM:
             if (context->getInputType(kFilterTensor) ==
                 OperandType::TENSOR_QUANT8_SYMM_PER_CHANNEL) {
@@ -637,7 +720,7 @@ bool execute(IOperationExecutionContext* context) {
                         param.stride_width, param.stride_height, param.dilation_width_factor,
                         param.dilation_height_factor, param.activation, param.useNchw,
                         context->getOutputBuffer<uint8_t>(kOutputTensor),
-                        context->getOutputShape(kOutputTensor));
+                        context->getOutputShape(kOutputTensor), context);
             } else if (context->getInputType(kFilterTensor) == OperandType::TENSOR_QUANT8_ASYMM) {
                 return conv(context->getInputBuffer<uint8_t>(kInputTensor),
                             context->getInputShape(kInputTensor),
@@ -649,7 +732,7 @@ bool execute(IOperationExecutionContext* context) {
                             param.stride_width, param.stride_height, param.dilation_width_factor,
                             param.dilation_height_factor, param.activation, param.useNchw,
                             context->getOutputBuffer<uint8_t>(kOutputTensor),
-                            context->getOutputShape(kOutputTensor));
+                            context->getOutputShape(kOutputTensor), context);
             } else {
                 NN_RET_CHECK_FAIL() << "Unsupported filter type for operation " << kOperationName;
             }
@@ -670,7 +753,7 @@ bool execute(IOperationExecutionContext* context) {
                         param.stride_width, param.stride_height, param.dilation_width_factor,
                         param.dilation_height_factor, param.activation, param.useNchw,
                         context->getOutputBuffer<int8_t>(kOutputTensor),
-                        context->getOutputShape(kOutputTensor));
+                        context->getOutputShape(kOutputTensor), context);
             } else if (context->getInputType(kFilterTensor) ==
                        OperandType::TENSOR_QUANT8_ASYMM_SIGNED) {
                 return conv(context->getInputBuffer<int8_t>(kInputTensor),
@@ -683,7 +766,7 @@ bool execute(IOperationExecutionContext* context) {
                             param.stride_width, param.stride_height, param.dilation_width_factor,
                             param.dilation_height_factor, param.activation, param.useNchw,
                             context->getOutputBuffer<int8_t>(kOutputTensor),
-                            context->getOutputShape(kOutputTensor));
+                            context->getOutputShape(kOutputTensor), context);
             } else {
                 NN_RET_CHECK_FAIL() << "Unsupported filter type for operation " << kOperationName;
             }
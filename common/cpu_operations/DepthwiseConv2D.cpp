@@ -19,6 +19,7 @@
 #include "DepthwiseConv2D.h"
 
 #include <algorithm>
+#include <type_traits>
 #include <vector>
 
 #include "OperationResolver.h"
@@ -29,6 +30,7 @@
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wunused-parameter"
 #include <tensorflow/lite/kernels/internal/optimized/depthwiseconv_uint8.h>
+#include <tensorflow/lite/kernels/internal/optimized/integer_ops/depthwise_conv.h>
 #include <tensorflow/lite/kernels/internal/reference/depthwiseconv_float.h>
 #pragma clang diagnostic pop
 
@@ -160,30 +162,25 @@ bool depthwiseConvNhwc(const float* inputData, const Shape& inputShape, const fl
     return true;
 }
 
-bool depthwiseConvNhwc(const _Float16* inputData, const Shape& inputShape,
-                       const _Float16* filterData, const Shape& filterShape,
-                       const _Float16* biasData, const Shape& biasShape, int32_t paddingLeft,
-                       int32_t paddingRight, int32_t paddingTop, int32_t paddingBottom,
-                       int32_t strideWidth, int32_t strideHeight, int32_t dilationWidthFactor,
-                       int32_t dilationHeightFactor, int32_t depthMultiplier, int32_t activation,
-                       _Float16* outputData, const Shape& outputShape) {
+bool depthwiseConvNhwc(const _Float16* inputData, const Shape& inputShape, const float* filterData,
+                       const Shape& filterShape, const float* biasData, const Shape& biasShape,
+                       int32_t paddingLeft, int32_t paddingRight, int32_t paddingTop,
+                       int32_t paddingBottom, int32_t strideWidth, int32_t strideHeight,
+                       int32_t dilationWidthFactor, int32_t dilationHeightFactor,
+                       int32_t depthMultiplier, int32_t activation, _Float16* outputData,
+                       const Shape& outputShape, IOperationExecutionContext* context) {
     NNTRACE_TRANS("depthwiseConvFloat16");
-    std::vector<float> inputDataFloat32(getNumberOfElements(inputShape));
-    convertFloat16ToFloat32(inputData, &inputDataFloat32);
-    std::vector<float> filterDataFloat32(getNumberOfElements(filterShape));
-    convertFloat16ToFloat32(filterData, &filterDataFloat32);
-    std::vector<float> biasDataFloat32(getNumberOfElements(biasShape));
-    convertFloat16ToFloat32(biasData, &biasDataFloat32);
-
-    std::vector<float> outputDataFloat32(getNumberOfElements(outputShape));
-    depthwiseConvNhwc(inputDataFloat32.data(), inputShape, filterDataFloat32.data(), filterShape,
-                      biasDataFloat32.data(), biasShape, paddingLeft, paddingRight, paddingTop,
-                      paddingBottom, strideWidth, strideHeight, dilationWidthFactor,
-                      dilationHeightFactor, depthMultiplier, activation, outputDataFloat32.data(),
-                      outputShape);
-
-    convertFloat32ToFloat16(outputDataFloat32, outputData);
-    return true;
+    return computeFloat16PerBatch(
+            context, inputData, inputShape, outputData, outputShape,
+            [&](const float* inputBatch, const Shape& inputBatchShape, float* outputBatch,
+                const Shape& outputBatchShape) {
+                return depthwiseConvNhwc(inputBatch, inputBatchShape, filterData, filterShape,
+                                         biasData, biasShape, paddingLeft, paddingRight,
+                                         paddingTop, paddingBottom, strideWidth, strideHeight,
+                                         dilationWidthFactor, dilationHeightFactor,
+                                         depthMultiplier, activation, outputBatch,
+                                         outputBatchShape);
+            });
 }
 
 bool depthwiseConvNhwc(const uint8_t* inputData, const Shape& inputShape, const uint8_t* filterData,
@@ -235,39 +232,6 @@ bool depthwiseConvNhwc(const uint8_t* inputData, const Shape& inputShape, const
     return true;
 }
 
-// Passing input, filter and output shapes by value, so that we can change the
-// offsets without modifying the actual shapes.
-bool depthwiseConvNhwc(const int8_t* inputData, Shape inputShape, const int8_t* filterData,
-                       Shape filterShape, const int32_t* biasData, const Shape& biasShape,
-                       int32_t paddingLeft, int32_t paddingRight, int32_t paddingTop,
-                       int32_t paddingBottom, int32_t strideWidth, int32_t strideHeight,
-                       int32_t dilationWidthFactor, int32_t dilationHeightFactor,
-                       int32_t depthMultiplier, int32_t activation, int8_t* outputData,
-                       Shape outputShape) {
-    NNTRACE_TRANS("depthwiseConvQuant8");
-
-    std::vector<uint8_t> unsignedInput(getNumberOfElements(inputShape));
-    convertInt8ToUInt8(inputData, &unsignedInput);
-    inputShape.offset += 128;
-
-    std::vector<uint8_t> unsignedFilter(getNumberOfElements(filterShape));
-    convertInt8ToUInt8(filterData, &unsignedFilter);
-    filterShape.offset += 128;
-
-    std::vector<uint8_t> unsignedOutput(getNumberOfElements(outputShape));
-    outputShape.offset += 128;
-
-    NN_RET_CHECK(depthwiseConvNhwc(unsignedInput.data(), inputShape, unsignedFilter.data(),
-                                   filterShape, biasData, biasShape, paddingLeft, paddingRight,
-                                   paddingTop, paddingBottom, strideWidth, strideHeight,
-                                   dilationWidthFactor, dilationHeightFactor, depthMultiplier,
-                                   activation, unsignedOutput.data(), outputShape));
-
-    convertUInt8ToInt8(unsignedOutput, outputData);
-
-    return true;
-}
-
 template <typename T>
 bool depthwiseConvQuant8PerChannelNhwc(
         const T* inputData, const Shape& inputShape, const int8_t* filterData,
@@ -294,6 +258,8 @@ bool depthwiseConvQuant8PerChannelNhwc(
     uint32_t outputDepth = getSizeOfDimension(outputShape, 3);
 
     int32_t inputOffset = -inputShape.offset;
+    // Zero for per-channel quantized filters, which are symmetric.
+    int32_t filterOffset = -filterShape.offset;
     int32_t outputOffset = outputShape.offset;
 
     auto realMultiplier = std::vector<double>(outputDepth, .0f);
@@ -316,6 +282,42 @@ bool depthwiseConvQuant8PerChannelNhwc(
     CalculateActivationRange<T>(activation, outputShape, &output_activation_min,
                                 &output_activation_max);
 
+    // The optimized int8 kernel requires a symmetric filter.
+    if constexpr (std::is_same_v<T, int8_t>) {
+        if (filterOffset == 0) {
+            // tflite shifts left by positive shifts.
+            std::vector<int32_t> tfliteOutputShift(outputDepth);
+            std::transform(outputShift.begin(), outputShift.end(), tfliteOutputShift.begin(),
+                           [](int32_t shift) { return -shift; });
+            tflite::DepthwiseParams params{
+                    .padding_values = {static_cast<int16>(paddingWidth),
+                                       static_cast<int16>(paddingHeight), 0 /*width_offset*/,
+                                       0 /*height_offset*/},
+                    .stride_width = static_cast<int16>(strideWidth),
+                    .stride_height = static_cast<int16>(strideHeight),
+                    .dilation_width_factor = static_cast<int16>(dilationWidthFactor),
+                    .dilation_height_factor = static_cast<int16>(dilationHeightFactor),
+                    .depth_multiplier = static_cast<int16>(depthMultiplier),
+                    .input_offset = inputOffset,
+                    .weights_offset = 0,
+                    .output_offset = outputOffset,
+                    .quantized_activation_min = output_activation_min,
+                    .quantized_activation_max = output_activation_max,
+            };
+            // DepthwiseConvPerChannel() needs a tflite CpuBackendContext, which the CPU
+            // executor does not have, to pick the 3x3 kernel and split the rows over threads.
+            NNTRACE_COMP_SWITCH("optimized_integer_ops::DepthwiseConvGeneral");
+            tflite::optimized_integer_ops::depthwise_conv::DepthwiseConvGeneral(
+                    params, outputMultiplier.data(), tfliteOutputShift.data(),
+                    convertShapeToTflshape(inputShape), inputData,
+                    convertShapeToTflshape(filterShape), filterData,
+                    convertShapeToTflshape(biasShape), biasData,
+                    convertShapeToTflshape(outputShape), outputData, /*thread_start=*/0,
+                    /*thread_end=*/outputHeight, /*thread_dim=*/1);
+            return true;
+        }
+    }
+
     const T* inputBase = inputData;
     T* outPtr = outputData;
     for (uint32_t b = 0; b < numBatches; b++) {
@@ -341,7 +343,8 @@ bool depthwiseConvQuant8PerChannelNhwc(
                                             i * filterWidth * filterDepth + j * filterDepth + oc;
                                     uint32_t inputIndex = hInput * inputWidth * inputDepth +
                                                           wInput * inputDepth + ic;
-                                    sum += (static_cast<int32_t>(filterData[filterIndex])) *
+                                    sum += (static_cast<int32_t>(filterData[filterIndex]) +
+                                            filterOffset) *
                                            (static_cast<int32_t>(inputBase[inputIndex]) +
                                             inputOffset);
                                 }
@@ -365,6 +368,24 @@ bool depthwiseConvQuant8PerChannelNhwc(
     return true;
 }
 
+bool depthwiseConvNhwc(const int8_t* inputData, const Shape& inputShape, const int8_t* filterData,
+                       const Shape& filterShape, const int32_t* biasData, const Shape& biasShape,
+                       int32_t paddingLeft, int32_t paddingRight, int32_t paddingTop,
+                       int32_t paddingBottom, int32_t strideWidth, int32_t strideHeight,
+                       int32_t dilationWidthFactor, int32_t dilationHeightFactor,
+                       int32_t depthMultiplier, int32_t activation, int8_t* outputData,
+                       const Shape& outputShape) {
+    NNTRACE_TRANS("depthwiseConvQuant8Signed");
+    // A per-tensor quantized filter is a per-channel quantized one with equal channel scales, so
+    // that symmetric filters run on the optimized per-channel kernel.
+    const std::vector<float> filterScales(getSizeOfDimension(outputShape, 3), filterShape.scale);
+    return depthwiseConvQuant8PerChannelNhwc(
+            inputData, inputShape, filterData, filterShape, filterScales.data(), biasData,
+            biasShape, paddingLeft, paddingRight, paddingTop, paddingBottom, strideWidth,
+            strideHeight, dilationWidthFactor, dilationHeightFactor, depthMultiplier, activation,
+            outputData, outputShape);
+}
+
 template <typename T_Input, typename T_Filter, typename T_Bias>
 bool depthwiseConv(const T_Input* inputData, const Shape& inputShape, const T_Filter* filterData,
                    const Shape& filterShape, const T_Bias* biasData, const Shape& biasShape,
@@ -372,16 +393,25 @@ bool depthwiseConv(const T_Input* inputData, const Shape& inputShape, const T_Fi
                    int32_t paddingBottom, int32_t strideWidth, int32_t strideHeight,
                    int32_t dilationWidthFactor, int32_t dilationHeightFactor,
                    int32_t depthMultiplier, int32_t activation, bool useNchw, T_Input* outputData,
-                   const Shape& outputShape) {
+                   const Shape& outputShape, IOperationExecutionContext* context) {
     InputWithLayout<T_Input> input(useNchw);
     OutputWithLayout<T_Input> output(useNchw);
     NN_RET_CHECK(input.initialize(inputData, inputShape));
     NN_RET_CHECK(output.initialize(outputData, outputShape));
-    NN_RET_CHECK(depthwiseConvNhwc(input.getNhwcBuffer(), input.getNhwcShape(), filterData,
-                                   filterShape, biasData, biasShape, paddingLeft, paddingRight,
-                                   paddingTop, paddingBottom, strideWidth, strideHeight,
-                                   dilationWidthFactor, dilationHeightFactor, depthMultiplier,
-                                   activation, output.getNhwcBuffer(), output.getNhwcShape()));
+    if constexpr (std::is_same_v<T_Input, _Float16>) {
+        NN_RET_CHECK(depthwiseConvNhwc(input.getNhwcBuffer(), input.getNhwcShape(), filterData,
+                                       filterShape, biasData, biasShape, paddingLeft, paddingRight,
+                                       paddingTop, paddingBottom, strideWidth, strideHeight,
+                                       dilationWidthFactor, dilationHeightFactor, depthMultiplier,
+                                       activation, output.getNhwcBuffer(), output.getNhwcShape(),
+                                       context));
+    } else {
+        NN_RET_CHECK(depthwiseConvNhwc(input.getNhwcBuffer(), input.getNhwcShape(), filterData,
+                                       filterShape, biasData, biasShape, paddingLeft, paddingRight,
+                                       paddingTop, paddingBottom, strideWidth, strideHeight,
+                                       dilationWidthFactor, dilationHeightFactor, depthMultiplier,
+                                       activation, output.getNhwcBuffer(), output.getNhwcShape()));
+    }
     NN_RET_CHECK(output.commit());
     return true;
 }
@@ -490,20 +520,21 @@ bool execute(IOperationExecutionContext* context) {
                                  param.dilation_width_factor, param.dilation_height_factor,
                                  param.depth_multiplier, param.activation, param.useNchw,
                                  context->getOutputBuffer<float>(kOutputTensor),
-                                 context->getOutputShape(kOutputTensor));
-        case OperandType::TENSOR_FLOAT16:
+                                 context->getOutputShape(kOutputTensor), context);
+        case OperandType::TENSOR_FLOAT16: {
+            const Float32Input filter(context, kFilterTensor);
+            const Float32Input bias(context, kBiasTensor);
             return depthwiseConv(context->getInputBuffer<_Float16>(kInputTensor),
-                                 context->getInputShape(kInputTensor),
-                                 context->getInputBuffer<_Float16>(kFilterTensor),
-                                 context->getInputShape(kFilterTensor),
-                                 context->getInputBuffer<_Float16>(kBiasTensor),
+                                 context->getInputShape(kInputTensor), filter.get(),
+                                 context->getInputShape(kFilterTensor), bias.get(),
                                  context->getInputShape(kBiasTensor), param.padding_left,
                                  param.padding_right, param.padding_top, param.padding_bottom,
                                  param.stride_width, param.stride_height,
                                  param.dilation_width_factor, param.dilation_height_factor,
                                  param.depth_multiplier, param.activation, param.useNchw,
                                  context->getOutputBuffer<_Float16>(kOutputTensor),
-                                 context->getOutputShape(kOutputTensor));
+                                 context->getOutputShape(kOutputTensor), context);
+        }
         case OperandType::TENSOR_QUANT8_ASYMM:
             if (context->getInputType(kFilterTensor) ==
                 OperandType::TENSOR_QUANT8_SYMM_PER_CHANNEL) {
@@ -534,7 +565,7 @@ bool execute(IOperationExecutionContext* context) {
                                      param.dilation_width_factor, param.dilation_height_factor,
                                      param.depth_multiplier, param.activation, param.useNchw,
                                      context->getOutputBuffer<uint8_t>(kOutputTensor),
-                                     context->getOutputShape(kOutputTensor));
+                                     context->getOutputShape(kOutputTensor), context);
             } else {
                 NN_RET_CHECK_FAIL() << "Unsupported filter type for operation " << kOperationName;
             }
@@ -569,7 +600,7 @@ bool execute(IOperationExecutionContext* context) {
                                      param.dilation_width_factor, param.dilation_height_factor,
                                      param.depth_multiplier, param.activation, param.useNchw,
                                      context->getOutputBuffer<int8_t>(kOutputTensor),
-                                     context->getOutputShape(kOutputTensor));
+                                     context->getOutputShape(kOutputTensor), context);
             } else {
                 NN_RET_CHECK_FAIL() << "Unsupported filter type for operation " << kOperationName;
             }
@@ -19,67 +19,98 @@
 #include "Elementwise.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
-#include <functional>
 #include <limits>
 
+#include "ElementwiseMath.h"
 #include "OperationResolver.h"
 #include "OperationsExecutionUtils.h"
 #include "Tracing.h"
 
+#ifdef NN_INCLUDE_CPU_IMPLEMENTATION
+#include "CpuOperationUtils.h"
+#endif  // NN_INCLUDE_CPU_IMPLEMENTATION
+
 namespace android {
 namespace nn {
 namespace elementwise {
 namespace {
 
-template <typename IntermediateType, typename T>
-inline bool compute(const std::function<IntermediateType(IntermediateType)>& func, const T* input,
-                    const Shape& shape, T* output) {
-    const auto size = getNumberOfElements(shape);
-    for (uint32_t i = 0; i < size; ++i) {
-        output[i] = static_cast<T>(func(static_cast<IntermediateType>(input[i])));
-    }
-    return true;
+// Calls fn(begin, end) over [0, size), on the threads of the ruy context when it is available.
+template <typename Fn>
+void forEachRange([[maybe_unused]] IOperationExecutionContext* context, uint32_t size, Fn fn) {
+#ifdef NN_INCLUDE_CPU_IMPLEMENTATION
+    parallelFor(context->getRuyContext(), size, kMinElementsPerTask, fn);
+#else   // NN_INCLUDE_CPU_IMPLEMENTATION
+    fn(0, size);
+#endif  // NN_INCLUDE_CPU_IMPLEMENTATION
 }
 
-template <typename IntermediateType, typename T>
-inline bool compute(IntermediateType func(IntermediateType), const T* input, const Shape& shape,
-                    T* output) {
-    return compute(std::function<IntermediateType(IntermediateType)>(func), input, shape, output);
+template <typename Kernel, typename T>
+bool compute(IOperationExecutionContext* context) {
+    const T* input = context->getInputBuffer<T>(kInputTensor);
+    T* output = context->getOutputBuffer<T>(kOutputTensor);
+    forEachRange(context, getNumberOfElements(context->getInputShape(kInputTensor)),
+                 [&](uint32_t begin, uint32_t end) {
+                     elementwise_math::apply<Kernel>(input + begin, output + begin, end - begin);
+                 });
+    return true;
 }
 
-template <typename IntermediateType, typename T>
-auto makeQuantized(const std::function<IntermediateType(IntermediateType)>& func, float inScale,
-                   T inZeroPoint, float outScale, T outZeroPoint) {
-    return [func, inScale, inZeroPoint, outScale, outZeroPoint](T val) -> T {
+// A quantized tensor takes at most 256 distinct values, so the function is evaluated once per
+// value into a table, and the tensor is mapped through it.
+template <typename Kernel, typename T>
+bool computeQuantized(IOperationExecutionContext* context) {
+    static_assert(sizeof(T) == 1);
+    using WideT = int32_t;
+    constexpr WideT kMin = std::numeric_limits<T>::min();
+    constexpr WideT kMax = std::numeric_limits<T>::max();
+    const Shape inShape = context->getInputShape(kInputTensor);
+    const Shape outShape = context->getOutputShape(kOutputTensor);
+    std::array<float, kMax - kMin + 1> dequantized;
+    std::array<float, kMax - kMin + 1> results;
+    for (WideT val = kMin; val <= kMax; ++val) {
         // For dequantization formula, see Dequantize.cpp.
-        using WideT = int32_t;
-        static_assert(sizeof(T) < sizeof(WideT));
-        IntermediateType dequantizedVal =
-                (static_cast<WideT>(val) - static_cast<WideT>(inZeroPoint)) * inScale;
-
-        IntermediateType res = func(dequantizedVal);
-
+        dequantized[val - kMin] = (val - inShape.offset) * inShape.scale;
+    }
+    elementwise_math::apply<Kernel>(dequantized.data(), results.data(), results.size());
+    std::array<T, kMax - kMin + 1> table;
+    for (size_t i = 0; i < table.size(); ++i) {
         // For quantization formula, see Quantize.cpp.
-        T quantizedRes = static_cast<T>(std::max<float>(
-                static_cast<IntermediateType>(std::numeric_limits<T>::min()),
-                std::min<float>(static_cast<IntermediateType>(std::numeric_limits<T>::max()),
-                                outZeroPoint + std::round(res / outScale))));
+        const float quantized = outShape.offset + std::round(results[i] / outShape.scale);
+        table[i] = static_cast<T>(std::max<float>(kMin, std::min<float>(kMax, quantized)));
+    }
 
-        return quantizedRes;
-    };
+    const T* input = context->getInputBuffer<T>(kInputTensor);
+    T* output = context->getOutputBuffer<T>(kOutputTensor);
+    forEachRange(context, getNumberOfElements(inShape), [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            output[i] = table[static_cast<WideT>(input[i]) - kMin];
+        }
+    });
+    return true;
 }
 
-bool execute(IOperationExecutionContext* context, float func(float)) {
+bool computeAbsInt32(IOperationExecutionContext* context) {
+    const int32_t* input = context->getInputBuffer<int32_t>(kInputTensor);
+    int32_t* output = context->getOutputBuffer<int32_t>(kOutputTensor);
+    forEachRange(context, getNumberOfElements(context->getInputShape(kInputTensor)),
+                 [&](uint32_t begin, uint32_t end) {
+                     for (uint32_t i = begin; i < end; ++i) {
+                         output[i] = std::abs(input[i]);
+                     }
+                 });
+    return true;
+}
+
+template <typename Kernel>
+bool execute(IOperationExecutionContext* context) {
     switch (context->getInputType(kInputTensor)) {
         case OperandType::TENSOR_FLOAT16:
-            return compute<float, _Float16>(func, context->getInputBuffer<_Float16>(kInputTensor),
-                                            context->getInputShape(kInputTensor),
-                                            context->getOutputBuffer<_Float16>(kOutputTensor));
+            return compute<Kernel, _Float16>(context);
         case OperandType::TENSOR_FLOAT32:
-            return compute<float, float>(func, context->getInputBuffer<float>(kInputTensor),
-                                         context->getInputShape(kInputTensor),
-                                         context->getOutputBuffer<float>(kOutputTensor));
+            return compute<Kernel, float>(context);
         default:
             NN_RET_CHECK_FAIL() << "Unsupported tensor type for elementwise operation";
     }
@@ -90,56 +121,28 @@ bool execute(IOperationExecutionContext* context, float func(float)) {
 bool executeAbs(IOperationExecutionContext* context) {
     switch (context->getInputType(kInputTensor)) {
         case OperandType::TENSOR_FLOAT16:
-            return compute<float, _Float16>(std::abs,
-                                            context->getInputBuffer<_Float16>(kInputTensor),
-                                            context->getInputShape(kInputTensor),
-                                            context->getOutputBuffer<_Float16>(kOutputTensor));
+            return compute<elementwise_math::AbsKernel, _Float16>(context);
         case OperandType::TENSOR_FLOAT32:
-            return compute<float, float>(std::abs, context->getInputBuffer<float>(kInputTensor),
-                                         context->getInputShape(kInputTensor),
-                                         context->getOutputBuffer<float>(kOutputTensor));
+            return compute<elementwise_math::AbsKernel, float>(context);
         case OperandType::TENSOR_INT32:
-            return compute<int32_t, int32_t>(std::abs,
-                                             context->getInputBuffer<int32_t>(kInputTensor),
-                                             context->getInputShape(kInputTensor),
-                                             context->getOutputBuffer<int32_t>(kOutputTensor));
+            return computeAbsInt32(context);
         default:
             NN_RET_CHECK_FAIL() << "Unsupported tensor type for operation ABS";
     }
 }
 
 bool executeRsqrt(IOperationExecutionContext* context) {
-    const std::function<float(float)> frsqrt = [](float x) { return 1.f / std::sqrt(x); };
+    using elementwise_math::RsqrtKernel;
     const auto tensorType = context->getInputType(kInputTensor);
     switch (tensorType) {
         case OperandType::TENSOR_FLOAT16:
-            return compute<float, _Float16>(frsqrt, context->getInputBuffer<_Float16>(kInputTensor),
-                                            context->getInputShape(kInputTensor),
-                                            context->getOutputBuffer<_Float16>(kOutputTensor));
+            return compute<RsqrtKernel, _Float16>(context);
         case OperandType::TENSOR_FLOAT32:
-            return compute<float, float>(frsqrt, context->getInputBuffer<float>(kInputTensor),
-                                         context->getInputShape(kInputTensor),
-                                         context->getOutputBuffer<float>(kOutputTensor));
-        case OperandType::TENSOR_QUANT8_ASYMM: {
-            const Shape inShape = context->getInputShape(kInputTensor);
-            const Shape outShape = context->getOutputShape(kOutputTensor);
-            return compute<uint8_t, uint8_t>(
-                    makeQuantized(frsqrt, inShape.scale, static_cast<uint8_t>(inShape.offset),
-                                  outShape.scale, static_cast<uint8_t>(outShape.offset)),
-                    context->getInputBuffer<uint8_t>(kInputTensor),
-                    context->getInputShape(kInputTensor),
-                    context->getOutputBuffer<uint8_t>(kOutputTensor));
-        }
-        case OperandType::TENSOR_QUANT8_ASYMM_SIGNED: {
-            const Shape inShape = context->getInputShape(kInputTensor);
-            const Shape outShape = context->getOutputShape(kOutputTensor);
-            return compute<int8_t, int8_t>(
-                    makeQuantized(frsqrt, inShape.scale, static_cast<int8_t>(inShape.offset),
-                                  outShape.scale, static_cast<int8_t>(outShape.offset)),
-                    context->getInputBuffer<int8_t>(kInputTensor),
-                    context->getInputShape(kInputTensor),
-                    context->getOutputBuffer<int8_t>(kOutputTensor));
-        }
+            return compute<RsqrtKernel, float>(context);
+        case OperandType::TENSOR_QUANT8_ASYMM:
+            return computeQuantized<RsqrtKernel, uint8_t>(context);
+        case OperandType::TENSOR_QUANT8_ASYMM_SIGNED:
+            return computeQuantized<RsqrtKernel, int8_t>(context);
         default:
             NN_RET_CHECK_FAIL() << "Unsupported tensor type " << tensorType
                                 << " for operation RSQRT";
@@ -162,23 +165,23 @@ bool prepareFloor(IOperationExecutionContext* context) {
 }
 
 bool executeExp(IOperationExecutionContext* context) {
-    return execute(context, std::exp);
+    return execute<elementwise_math::ExpKernel>(context);
 }
 
 bool executeFloor(IOperationExecutionContext* context) {
-    return execute(context, std::floor);
+    return execute<elementwise_math::FloorKernel>(context);
 }
 
 bool executeLog(IOperationExecutionContext* context) {
-    return execute(context, std::log);
+    return execute<elementwise_math::LogKernel>(context);
 }
 
 bool executeSin(IOperationExecutionContext* context) {
-    return execute(context, std::sin);
+    return execute<elementwise_math::SinKernel>(context);
 }
 
 bool executeSqrt(IOperationExecutionContext* context) {
-    return execute(context, std::sqrt);
+    return execute<elementwise_math::SqrtKernel>(context);
 }
 
 }  // namespace elementwise
@@ -44,11 +44,6 @@ namespace fully_connected {
 #ifdef NN_INCLUDE_CPU_IMPLEMENTATION
 namespace {
 
-// executionMutex is used to protect concurrent access of non-threadsafe resources
-// like gemmlowp::GemmContext.
-// std::mutex is safe for pthreads on Android.
-static std::mutex executionMutex;
-
 bool fullyConnectedFloat32(const float* inputData, const Shape& inputShape,
                            const float* weightsData, const Shape& weightsShape,
                            const float* biasData, const Shape& biasShape, int32_t activation,
@@ -80,21 +75,16 @@ bool fullyConnectedFloat32(const float* inputData, const Shape& inputShape,
 }
 
 bool fullyConnectedFloat16(const _Float16* inputData, const Shape& inputShape,
-                           const _Float16* weightsData, const Shape& weightsShape,
-                           const _Float16* biasData, const Shape& biasShape, int32_t activation,
+                           const float* weightsData, const Shape& weightsShape,
+                           const float* biasData, const Shape& biasShape, int32_t activation,
                            _Float16* outputData, const Shape& outputShape) {
     NNTRACE_TRANS("fullyConnectedFloat16");
     std::vector<float> inputDataFloat32(getNumberOfElements(inputShape));
     convertFloat16ToFloat32(inputData, &inputDataFloat32);
-    std::vector<float> weightsDataFloat32(getNumberOfElements(weightsShape));
-    convertFloat16ToFloat32(weightsData, &weightsDataFloat32);
-    std::vector<float> biasDataFloat32(getNumberOfElements(biasShape));
-    convertFloat16ToFloat32(biasData, &biasDataFloat32);
 
     std::vector<float> outputDataFloat32(getNumberOfElements(outputShape));
-    fullyConnectedFloat32(inputDataFloat32.data(), inputShape, weightsDataFloat32.data(),
-                          weightsShape, biasDataFloat32.data(), biasShape, activation,
-                          outputDataFloat32.data(), outputShape);
+    fullyConnectedFloat32(inputDataFloat32.data(), inputShape, weightsData, weightsShape, biasData,
+                          biasShape, activation, outputDataFloat32.data(), outputShape);
     convertFloat32ToFloat16(outputDataFloat32, outputData);
 
     return true;
@@ -103,7 +93,8 @@ bool fullyConnectedFloat16(const _Float16* inputData, const Shape& inputShape,
 bool fullyConnectedQuant8(const uint8_t* inputData, const Shape& inputShape,
                           const uint8_t* weightsData, const Shape& weightsShape,
                           const int32_t* biasData, const Shape& biasShape, int32_t activation,
-                          uint8_t* outputData, const Shape& outputShape) {
+                          uint8_t* outputData, const Shape& outputShape,
+                          gemmlowp::GemmContext* gemmContext) {
     NNTRACE_TRANS("fullyConnectedQuant8");
     int32_t inputOffset = -inputShape.offset;
     int32_t weightsOffset = -weightsShape.offset;
@@ -123,20 +114,13 @@ bool fullyConnectedQuant8(const uint8_t* inputData, const Shape& inputShape,
     CalculateActivationRangeUint8(activation, outputShape, &outputActivationMin,
                                   &outputActivationMax);
 
-    static gemmlowp::GemmContext gemmContext;
-
-    // Prevent concurrent executions that access gemmContext.
-    std::unique_lock<std::mutex> lock(executionMutex);
-    // Alow gemmlowp automatically decide how many threads to use.
-    gemmContext.set_max_num_threads(0);
-
     NNTRACE_COMP_SWITCH("optimized_ops::FullyConnected");
     tflite::optimized_ops::FullyConnected(inputData, convertShapeToDims(inputShape), inputOffset,
                                           weightsData, convertShapeToDims(weightsShape),
                                           weightsOffset, biasData, convertShapeToDims(biasShape),
                                           outputOffset, outputMultiplier, outputShift,
                                           outputActivationMin, outputActivationMax, outputData,
-                                          convertShapeToDims(outputShape), &gemmContext);
+                                          convertShapeToDims(outputShape), gemmContext);
 
     return true;
 }
@@ -202,16 +186,17 @@ bool execute(IOperationExecutionContext* context) {
                                          context->getInputValue<int32_t>(kActivationScalar),
                                          context->getOutputBuffer<float>(kOutputTensor),
                                          context->getOutputShape(kOutputTensor));
-        case OperandType::TENSOR_FLOAT16:
+        case OperandType::TENSOR_FLOAT16: {
+            const Float32Input weights(context, kWeightsTensor);
+            const Float32Input bias(context, kBiasTensor);
             return fullyConnectedFloat16(context->getInputBuffer<_Float16>(kInputTensor),
-                                         context->getInputShape(kInputTensor),
-                                         context->getInputBuffer<_Float16>(kWeightsTensor),
-                                         context->getInputShape(kWeightsTensor),
-                                         context->getInputBuffer<_Float16>(kBiasTensor),
+                                         context->getInputShape(kInputTensor), weights.get(),
+                                         context->getInputShape(kWeightsTensor), bias.get(),
                                          context->getInputShape(kBiasTensor),
                                          context->getInputValue<int32_t>(kActivationScalar),
                                          context->getOutputBuffer<_Float16>(kOutputTensor),
                                          context->getOutputShape(kOutputTensor));
+        }
         case OperandType::TENSOR_QUANT8_ASYMM:
             return fullyConnectedQuant8(context->getInputBuffer<uint8_t>(kInputTensor),
                                         context->getInputShape(kInputTensor),
@@ -221,7 +206,8 @@ bool execute(IOperationExecutionContext* context) {
                                         context->getInputShape(kBiasTensor),
                                         context->getInputValue<int32_t>(kActivationScalar),
                                         context->getOutputBuffer<uint8_t>(kOutputTensor),
-                                        context->getOutputShape(kOutputTensor));
+                                        context->getOutputShape(kOutputTensor),
+                                        context->getGemmContext());
         case OperandType::TENSOR_QUANT8_ASYMM_SIGNED:
             return fullyConnectedQuant8(context->getInputBuffer<int8_t>(kInputTensor),
                                         context->getInputShape(kInputTensor),
@@ -18,12 +18,18 @@
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wunused-parameter"
+#pragma clang diagnostic ignored "-Wsign-compare"
+#include <public/gemmlowp.h>
+#include <ruy/ruy.h>
 #include <tensorflow/lite/kernels/internal/common.h>
 #pragma clang diagnostic pop
 
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <limits>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 #include "CpuOperationUtils.h"
@@ -47,61 +53,280 @@ namespace nn {
     uint32_t outputDepth = getSizeOfDimension(outputShape, 3);  \
     uint32_t outputGroupDepth = outputDepth / numGroups;
 
+namespace {
+
+// Fills the column-major [filterHeight * filterWidth * filterDepth, outputHeight * outputWidth]
+// im2col matrix of group g of one input batch. Padded elements are set to padValue, the input
+// zero point, so that they do not contribute to the sums.
+template <typename T>
+void groupedIm2col(const T* inputBase, const Shape& inputShape, const Shape& filterShape,
+                   const Shape& outputShape, int32_t padding_left, int32_t padding_top,
+                   int32_t stride_width, int32_t stride_height, int32_t g, T padValue,
+                   T* im2colData) {
+    const uint32_t inputHeight = getSizeOfDimension(inputShape, 1);
+    const uint32_t inputWidth = getSizeOfDimension(inputShape, 2);
+    const uint32_t inputDepth = getSizeOfDimension(inputShape, 3);
+    const uint32_t filterHeight = getSizeOfDimension(filterShape, 1);
+    const uint32_t filterWidth = getSizeOfDimension(filterShape, 2);
+    const uint32_t filterDepth = getSizeOfDimension(filterShape, 3);
+    const uint32_t outputHeight = getSizeOfDimension(outputShape, 1);
+    const uint32_t outputWidth = getSizeOfDimension(outputShape, 2);
+
+    T* im2colPtr = im2colData;
+    for (uint32_t h = 0; h < outputHeight; h++) {
+        for (uint32_t w = 0; w < outputWidth; w++) {
+            const int32_t hInputOrigin = static_cast<int32_t>(h) * stride_height - padding_top;
+            const int32_t wInputOrigin = static_cast<int32_t>(w) * stride_width - padding_left;
+            for (uint32_t i = 0; i < filterHeight; i++) {
+                const int32_t hInput = hInputOrigin + static_cast<int32_t>(i);
+                for (uint32_t j = 0; j < filterWidth; j++) {
+                    const int32_t wInput = wInputOrigin + static_cast<int32_t>(j);
+                    if (hInput >= 0 && hInput < static_cast<int32_t>(inputHeight) &&
+                        wInput >= 0 && wInput < static_cast<int32_t>(inputWidth)) {
+                        const T* inputPtr = inputBase +
+                                            (hInput * inputWidth + wInput) * inputDepth +
+                                            g * filterDepth;
+                        std::copy(inputPtr, inputPtr + filterDepth, im2colPtr);
+                    } else {
+                        std::fill(im2colPtr, im2colPtr + filterDepth, padValue);
+                    }
+                    im2colPtr += filterDepth;
+                }
+            }
+        }
+    }
+}
+
+// Computes a grouped convolution as one ruy GEMM per batch and group. The filter of group g is a
+// row-major [outputGroupDepth, gemmDepth] matrix and its im2col matrix a column-major
+// [gemmDepth, numPixels] one, so the column-major product, with a column stride of outputDepth,
+// is written directly into the NHWC output. mulParamsForGroup(g) returns the ruy::MulParams of
+// the output channels of group g. ruy parallelizes every GEMM over the threads of ruyContext.
+template <typename T, typename MulParamsFn>
+bool groupedConvGemm(const T* inputData, const Shape& inputShape, const T* filterData,
+                     const Shape& filterShape, int32_t padding_left, int32_t padding_top,
+                     int32_t stride_width, int32_t stride_height, int32_t numGroups,
+                     MulParamsFn mulParamsForGroup, T* outputData, const Shape& outputShape,
+                     ruy::Context* ruyContext) {
+    ANDROID_NN_GROUPED_CONV_PARAMETERS
+    const uint32_t numPixels = outputHeight * outputWidth;
+    const uint32_t gemmDepth = filterHeight * filterWidth * filterDepth;
+    const T inputZeroPoint = static_cast<T>(inputShape.offset);
+
+    // The input of every group is already its im2col matrix, with a column stride of inputDepth,
+    // for an unpadded 1x1 convolution with unit strides.
+    const bool needIm2col = filterHeight != 1 || filterWidth != 1 || stride_width != 1 ||
+                            stride_height != 1 || outputHeight != inputHeight ||
+                            outputWidth != inputWidth;
+    std::vector<T> im2colData;
+    if (needIm2col) {
+        const uint64_t im2colSize = static_cast<uint64_t>(numPixels) * gemmDepth;
+        NN_RET_CHECK_LT(im2colSize, 0x7fffffffu) << "Grouped conv size is too large";
+        im2colData.resize(im2colSize);
+    }
+
+    ruy::Matrix<T> lhs;
+    ruy::MakeSimpleLayout(outputGroupDepth, gemmDepth, ruy::Order::kRowMajor,
+                          lhs.mutable_layout());
+    lhs.set_zero_point(static_cast<T>(filterShape.offset));
+    ruy::Matrix<T> rhs;
+    ruy::MakeSimpleLayout(gemmDepth, numPixels, ruy::Order::kColMajor, rhs.mutable_layout());
+    if (!needIm2col) {
+        rhs.mutable_layout()->set_stride(inputDepth);
+    }
+    rhs.set_zero_point(inputZeroPoint);
+    ruy::Matrix<T> dst;
+    ruy::MakeSimpleLayout(outputGroupDepth, numPixels, ruy::Order::kColMajor,
+                          dst.mutable_layout());
+    dst.mutable_layout()->set_stride(outputDepth);
+    dst.set_zero_point(static_cast<T>(outputShape.offset));
+
+    for (uint32_t b = 0; b < numBatches; b++) {
+        const T* inputBase = inputData + b * inputHeight * inputWidth * inputDepth;
+        for (int32_t g = 0; g < numGroups; g++) {
+            if (needIm2col) {
+                groupedIm2col(inputBase, inputShape, filterShape, outputShape, padding_left,
+                              padding_top, stride_width, stride_height, g, inputZeroPoint,
+                              im2colData.data());
+                rhs.set_data(im2colData.data());
+            } else {
+                rhs.set_data(inputBase + g * filterDepth);
+            }
+            lhs.set_data(filterData + g * outputGroupDepth * gemmDepth);
+            dst.set_data(outputData + b * numPixels * outputDepth + g * outputGroupDepth);
+            ruy::Mul(lhs, rhs, mulParamsForGroup(g), ruyContext, &dst);
+        }
+    }
+    return true;
+}
+
+// Computes a uint8 grouped convolution like groupedConvGemm(), with one gemmlowp GEMM per batch
+// and group. gemmlowp multiplies uint8 values without the int16 overflow of the ruy int8 kernels,
+// so it takes any filter. Output channel d is requantized with outputMultiplier[d] and
+// outputExponent[d], with positive exponents meaning left shifts.
+bool groupedConvGemmlowp(const uint8_t* inputData, const Shape& inputShape,
+                         const uint8_t* filterData, const Shape& filterShape,
+                         const int32_t* biasData, int32_t padding_left, int32_t padding_top,
+                         int32_t stride_width, int32_t stride_height, int32_t numGroups,
+                         const std::vector<int32_t>& outputMultiplier,
+                         const std::vector<int32_t>& outputExponent, int32_t activation,
+                         uint8_t* outputData, const Shape& outputShape,
+                         gemmlowp::GemmContext* gemmContext) {
+    ANDROID_NN_GROUPED_CONV_PARAMETERS
+    const uint32_t numPixels = outputHeight * outputWidth;
+    const uint32_t gemmDepth = filterHeight * filterWidth * filterDepth;
+    const uint8_t inputZeroPoint = static_cast<uint8_t>(inputShape.offset);
+
+    const bool needIm2col = filterHeight != 1 || filterWidth != 1 || stride_width != 1 ||
+                            stride_height != 1 || outputHeight != inputHeight ||
+                            outputWidth != inputWidth;
+    std::vector<uint8_t> im2colData;
+    if (needIm2col) {
+        const uint64_t im2colSize = static_cast<uint64_t>(numPixels) * gemmDepth;
+        NN_RET_CHECK_LT(im2colSize, 0x7fffffffu) << "Grouped conv size is too large";
+        im2colData.resize(im2colSize);
+    }
+
+    int32_t output_activation_min = 0, output_activation_max = 0;
+    CalculateActivationRange<uint8_t>(activation, outputShape, &output_activation_min,
+                                      &output_activation_max);
+
+    using ChannelVector = gemmlowp::VectorMap<const int32_t, gemmlowp::VectorShape::Col>;
+    const gemmlowp::OutputStageClamp clampStage{output_activation_min, output_activation_max};
+    const gemmlowp::OutputStageSaturatingCastToUint8 castStage{};
+
+    for (uint32_t b = 0; b < numBatches; b++) {
+        const uint8_t* inputBase = inputData + b * inputHeight * inputWidth * inputDepth;
+        for (int32_t g = 0; g < numGroups; g++) {
+            const uint8_t* rhsData = inputBase + g * filterDepth;
+            int rhsStride = inputDepth;
+            if (needIm2col) {
+                groupedIm2col(inputBase, inputShape, filterShape, outputShape, padding_left,
+                              padding_top, stride_width, stride_height, g, inputZeroPoint,
+                              im2colData.data());
+                rhsData = im2colData.data();
+                rhsStride = gemmDepth;
+            }
+            const uint32_t firstChannel = g * outputGroupDepth;
+            gemmlowp::MatrixMap<const uint8_t, gemmlowp::MapOrder::RowMajor> lhs(
+                    filterData + firstChannel * gemmDepth, outputGroupDepth, gemmDepth);
+            gemmlowp::MatrixMap<const uint8_t, gemmlowp::MapOrder::ColMajor> rhs(
+                    rhsData, gemmDepth, numPixels, rhsStride);
+            gemmlowp::MatrixMap<uint8_t, gemmlowp::MapOrder::ColMajor> dst(
+                    outputData + b * numPixels * outputDepth + firstChannel, outputGroupDepth,
+                    numPixels, outputDepth);
+            const gemmlowp::OutputStageBiasAddition<ChannelVector> biasStage{
+                    ChannelVector(biasData + firstChannel, outputGroupDepth)};
+            const gemmlowp::OutputStageScaleInt32ByFixedPointAndExponentPC<
+                    gemmlowp::VectorShape::Col>
+                    scaleStage{ChannelVector(outputMultiplier.data() + firstChannel,
+                                             outputGroupDepth),
+                               ChannelVector(outputExponent.data() + firstChannel,
+                                             outputGroupDepth),
+                               outputShape.offset};
+            gemmlowp::GemmWithOutputPipeline<uint8_t, uint8_t, gemmlowp::DefaultL8R8BitDepthParams>(
+                    gemmContext, lhs, rhs, &dst, -filterShape.offset, -inputShape.offset,
+                    std::make_tuple(biasStage, scaleStage, clampStage, castStage));
+        }
+    }
+    return true;
+}
+
+// Computes a quantized grouped convolution whose output channel d is requantized with
+// outputMultiplier[d] and outputExponent[d], with positive exponents meaning left shifts.
+template <typename T>
+bool groupedConvQuant8Impl(const T* inputData, const Shape& inputShape, const T* filterData,
+                           const Shape& filterShape, const int32_t* biasData, int32_t padding_left,
+                           int32_t padding_top, int32_t stride_width, int32_t stride_height,
+                           int32_t numGroups, const std::vector<int32_t>& outputMultiplier,
+                           const std::vector<int32_t>& outputExponent, int32_t activation,
+                           T* outputData, const Shape& outputShape, ruy::Context* ruyContext,
+                           gemmlowp::GemmContext* gemmContext) {
+    if constexpr (std::is_same_v<T, uint8_t>) {
+        NNTRACE_COMP_SWITCH("gemmlowp::GemmWithOutputPipeline");
+        return groupedConvGemmlowp(inputData, inputShape, filterData, filterShape, biasData,
+                                   padding_left, padding_top, stride_width, stride_height,
+                                   numGroups, outputMultiplier, outputExponent, activation,
+                                   outputData, outputShape, gemmContext);
+    } else {
+        // The pre-dotprod ruy kernels accumulate pairs of int8 products in int16, which
+        // overflows for -128 * -128 + -128 * -128. TFLite-style filters in [-127, 127] never hit
+        // this, and other filters are shifted to uint8 for gemmlowp.
+        const int8_t* filterEnd = filterData + getNumberOfElements(filterShape);
+        if (filterShape.offset != std::numeric_limits<int8_t>::min() &&
+            std::find(filterData, filterEnd, std::numeric_limits<int8_t>::min()) == filterEnd) {
+            const uint32_t outputGroupDepth = getSizeOfDimension(outputShape, 3) / numGroups;
+            int32_t output_activation_min = 0, output_activation_max = 0;
+            CalculateActivationRange<int8_t>(activation, outputShape, &output_activation_min,
+                                             &output_activation_max);
+            NNTRACE_COMP_SWITCH("ruy::Mul");
+            return groupedConvGemm(
+                    inputData, inputShape, filterData, filterShape, padding_left, padding_top,
+                    stride_width, stride_height, numGroups,
+                    [&](int32_t g) {
+                        const uint32_t firstChannel = g * outputGroupDepth;
+                        ruy::MulParams<int32_t, int8_t> mulParams;
+                        mulParams.set_bias(biasData + firstChannel);
+                        mulParams.set_multiplier_fixedpoint_perchannel(outputMultiplier.data() +
+                                                                       firstChannel);
+                        mulParams.set_multiplier_exponent_perchannel(outputExponent.data() +
+                                                                     firstChannel);
+                        mulParams.set_clamp_min(static_cast<int8_t>(output_activation_min));
+                        mulParams.set_clamp_max(static_cast<int8_t>(output_activation_max));
+                        return mulParams;
+                    },
+                    outputData, outputShape, ruyContext);
+        }
+
+        std::vector<uint8_t> unsignedInput(getNumberOfElements(inputShape));
+        convertInt8ToUInt8(inputData, &unsignedInput);
+        Shape unsignedInputShape = inputShape;
+        unsignedInputShape.offset += 128;
+        std::vector<uint8_t> unsignedFilter(getNumberOfElements(filterShape));
+        convertInt8ToUInt8(filterData, &unsignedFilter);
+        Shape unsignedFilterShape = filterShape;
+        unsignedFilterShape.offset += 128;
+        std::vector<uint8_t> unsignedOutput(getNumberOfElements(outputShape));
+        Shape unsignedOutputShape = outputShape;
+        unsignedOutputShape.offset += 128;
+        NNTRACE_COMP_SWITCH("gemmlowp::GemmWithOutputPipeline");
+        NN_RET_CHECK(groupedConvGemmlowp(
+                unsignedInput.data(), unsignedInputShape, unsignedFilter.data(),
+                unsignedFilterShape, biasData, padding_left, padding_top, stride_width,
+                stride_height, numGroups, outputMultiplier, outputExponent, activation,
+                unsignedOutput.data(), unsignedOutputShape, gemmContext));
+        convertUInt8ToInt8(unsignedOutput, outputData);
+        return true;
+    }
+}
+
+}  // namespace
+
 bool groupedConvFloat32(const float* inputData, const Shape& inputShape, const float* filterData,
                         const Shape& filterShape, const float* biasData, const Shape& /*biasShape*/,
                         int32_t padding_left, int32_t /*padding_right*/, int32_t padding_top,
                         int32_t /*padding_bottom*/, int32_t stride_width, int32_t stride_height,
                         int32_t numGroups, int32_t activation, float* outputData,
-                        const Shape& outputShape) {
+                        const Shape& outputShape, ruy::Context* ruyContext) {
     NNTRACE_TRANS("groupConvFloat32");
-    ANDROID_NN_GROUPED_CONV_PARAMETERS
+    const uint32_t outputGroupDepth = getSizeOfDimension(outputShape, 3) / numGroups;
 
     float output_activation_min = 0.0f, output_activation_max = 0.0f;
     CalculateActivationRangeFloat(activation, &output_activation_min, &output_activation_max);
 
-    const float* inputBase = inputData;
-    float* outPtr = outputData;
-    for (uint32_t b = 0; b < numBatches; b++) {
-        for (uint32_t h = 0; h < outputHeight; h++) {
-            for (uint32_t w = 0; w < outputWidth; w++) {
-                const float* filterBase = filterData;
-                for (int32_t g = 0; g < numGroups; g++) {
-                    for (uint32_t d = 0; d < outputGroupDepth; d++) {
-                        int32_t wInputOrigin =
-                                static_cast<int32_t>(w) * stride_width - padding_left;
-                        int32_t hInputOrigin =
-                                static_cast<int32_t>(h) * stride_height - padding_top;
-                        float sum = 0.0f;
-                        for (uint32_t i = 0; i < filterHeight; i++) {
-                            for (uint32_t j = 0; j < filterWidth; j++) {
-                                for (uint32_t k = 0; k < filterDepth; k++) {
-                                    int32_t hInput = hInputOrigin + static_cast<int32_t>(i);
-                                    int32_t wInput = wInputOrigin + static_cast<int32_t>(j);
-                                    uint32_t dInput = filterDepth * g + k;
-                                    if (hInput >= 0 && hInput < static_cast<int32_t>(inputHeight) &&
-                                        wInput >= 0 && wInput < static_cast<int32_t>(inputWidth)) {
-                                        uint32_t filterIndex =
-                                                i * filterWidth * filterDepth + j * filterDepth + k;
-                                        uint32_t inputIndex = hInput * inputWidth * inputDepth +
-                                                              wInput * inputDepth + dInput;
-                                        sum += filterBase[filterIndex] * inputBase[inputIndex];
-                                    }
-                                }
-                            }
-                        }
-                        sum += biasData[g * outputGroupDepth + d];
-                        sum = std::max(std::min(sum, output_activation_max), output_activation_min);
-                        outPtr[d] = sum;
-                        filterBase += filterHeight * filterWidth * filterDepth;
-                    }
-                    outPtr += outputGroupDepth;
-                }
-            }
-        }
-        inputBase += inputHeight * inputWidth * inputDepth;
-    }
-
-    return true;
+    // Float shapes have a zero offset, so padded elements are zeros.
+    NNTRACE_COMP_SWITCH("ruy::Mul");
+    return groupedConvGemm(
+            inputData, inputShape, filterData, filterShape, padding_left, padding_top,
+            stride_width, stride_height, numGroups,
+            [&](int32_t g) {
+                ruy::MulParams<float, float> mulParams;
+                mulParams.set_bias(biasData + g * outputGroupDepth);
+                mulParams.set_clamp_min(output_activation_min);
+                mulParams.set_clamp_max(output_activation_max);
+                return mulParams;
+            },
+            outputData, outputShape, ruyContext);
 }
 
 template <typename T>
@@ -110,76 +335,23 @@ bool groupedConvQuant8(const T* inputData, const Shape& inputShape, const T* fil
                        int32_t padding_left, int32_t /*padding_right*/, int32_t padding_top,
                        int32_t /*padding_bottom*/, int32_t stride_width, int32_t stride_height,
                        int32_t numGroups, int32_t activation, T* outputData,
-                       const Shape& outputShape) {
+                       const Shape& outputShape, ruy::Context* ruyContext,
+                       gemmlowp::GemmContext* gemmContext) {
     NNTRACE_TRANS("groupConvQuant8");
-    ANDROID_NN_GROUPED_CONV_PARAMETERS
-
-    int32_t inputOffset = -inputShape.offset;
-    int32_t filterOffset = -filterShape.offset;
-    int32_t outputOffset = outputShape.offset;
+    const uint32_t outputDepth = getSizeOfDimension(outputShape, 3);
 
     double realMultiplier = 0.0;
     int32_t outputMultiplier = 0;
-    int32_t outputShift = 0;
     NN_RET_CHECK(GetQuantizedConvolutionMultiplier(inputShape, filterShape, biasShape, outputShape,
                                                    &realMultiplier));
     int exponent;
     NN_RET_CHECK(QuantizeMultiplier(realMultiplier, &outputMultiplier, &exponent));
-    outputShift = -exponent;
-
-    int32_t output_activation_min = 0, output_activation_max = 0;
-    CalculateActivationRange<T>(activation, outputShape, &output_activation_min,
-                                &output_activation_max);
 
-    const T* inputBase = inputData;
-    T* outPtr = outputData;
-    for (uint32_t b = 0; b < numBatches; b++) {
-        for (uint32_t h = 0; h < outputHeight; h++) {
-            for (uint32_t w = 0; w < outputWidth; w++) {
-                const T* filterBase = filterData;
-                for (int32_t g = 0; g < numGroups; g++) {
-                    for (uint32_t d = 0; d < outputGroupDepth; d++) {
-                        int32_t wInputOrigin =
-                                static_cast<int32_t>(w) * stride_width - padding_left;
-                        int32_t hInputOrigin =
-                                static_cast<int32_t>(h) * stride_height - padding_top;
-                        int32_t sum = 0.0f;
-                        for (uint32_t i = 0; i < filterHeight; i++) {
-                            for (uint32_t j = 0; j < filterWidth; j++) {
-                                for (uint32_t k = 0; k < filterDepth; k++) {
-                                    int32_t hInput = hInputOrigin + static_cast<int32_t>(i);
-                                    int32_t wInput = wInputOrigin + static_cast<int32_t>(j);
-                                    uint32_t dInput = filterDepth * g + k;
-                                    if (hInput >= 0 && hInput < static_cast<int32_t>(inputHeight) &&
-                                        wInput >= 0 && wInput < static_cast<int32_t>(inputWidth)) {
-                                        uint32_t filterIndex =
-                                                i * filterWidth * filterDepth + j * filterDepth + k;
-                                        uint32_t inputIndex = hInput * inputWidth * inputDepth +
-                                                              wInput * inputDepth + dInput;
-                                        sum += (static_cast<int32_t>(filterBase[filterIndex]) +
-                                                filterOffset) *
-                                               (static_cast<int32_t>(inputBase[inputIndex]) +
-                                                inputOffset);
-                                    }
-                                }
-                            }
-                        }
-                        sum += biasData[g * outputGroupDepth + d];
-                        sum = tflite::MultiplyByQuantizedMultiplier(sum, outputMultiplier,
-                                                                    -outputShift);
-                        sum += outputOffset;
-                        sum = std::max(std::min(sum, output_activation_max), output_activation_min);
-                        outPtr[d] = static_cast<T>(sum);
-                        filterBase += filterHeight * filterWidth * filterDepth;
-                    }
-                    outPtr += outputGroupDepth;
-                }
-            }
-        }
-        inputBase += inputHeight * inputWidth * inputDepth;
-    }
-
-    return true;
+    return groupedConvQuant8Impl(inputData, inputShape, filterData, filterShape, biasData,
+                                 padding_left, padding_top, stride_width, stride_height,
+                                 numGroups, std::vector<int32_t>(outputDepth, outputMultiplier),
+                                 std::vector<int32_t>(outputDepth, exponent), activation,
+                                 outputData, outputShape, ruyContext, gemmContext);
 }
 
 template bool groupedConvQuant8<int8_t>(const int8_t* inputData, const Shape& inputShape,
@@ -189,7 +361,8 @@ template bool groupedConvQuant8<int8_t>(const int8_t* inputData, const Shape& in
                                         int32_t padding_top, int32_t padding_bottom,
                                         int32_t stride_width, int32_t stride_height,
                                         int32_t numGroups, int32_t activation, int8_t* outputData,
-                                        const Shape& outputShape);
+                                        const Shape& outputShape, ruy::Context* ruyContext,
+                                        gemmlowp::GemmContext* gemmContext);
 
 template bool groupedConvQuant8<uint8_t>(const uint8_t* inputData, const Shape& inputShape,
                                          const uint8_t* filterData, const Shape& filterShape,
@@ -198,7 +371,8 @@ template bool groupedConvQuant8<uint8_t>(const uint8_t* inputData, const Shape&
                                          int32_t padding_top, int32_t padding_bottom,
                                          int32_t stride_width, int32_t stride_height,
                                          int32_t numGroups, int32_t activation, uint8_t* outputData,
-                                         const Shape& outputShape);
+                                         const Shape& outputShape, ruy::Context* ruyContext,
+                                         gemmlowp::GemmContext* gemmContext);
 
 template <typename T>
 bool groupedConvQuant8PerChannel(const T* inputData, const Shape& inputShape,
@@ -208,16 +382,14 @@ bool groupedConvQuant8PerChannel(const T* inputData, const Shape& inputShape,
                                  int32_t /*padding_right*/, int32_t padding_top,
                                  int32_t /*padding_bottom*/, int32_t stride_width,
                                  int32_t stride_height, int32_t numGroups, int32_t activation,
-                                 T* outputData, const Shape& outputShape) {
+                                 T* outputData, const Shape& outputShape,
+                                 ruy::Context* ruyContext, gemmlowp::GemmContext* gemmContext) {
     NNTRACE_TRANS("groupConvQuant8");
-    ANDROID_NN_GROUPED_CONV_PARAMETERS
-
-    int32_t inputOffset = -inputShape.offset;
-    int32_t outputOffset = outputShape.offset;
+    const uint32_t outputDepth = getSizeOfDimension(outputShape, 3);
 
     auto realMultiplier = std::vector<double>(outputDepth, .0f);
     auto outputMultiplier = std::vector<int32_t>(outputDepth, 0);
-    auto outputShift = std::vector<int32_t>(outputDepth, 0);
+    auto outputExponent = std::vector<int32_t>(outputDepth, 0);
 
     for (uint32_t i = 0; i < outputDepth; ++i) {
         Shape filterChannelShape = filterShape;
@@ -229,88 +401,47 @@ bool groupedConvQuant8PerChannel(const T* inputData, const Shape& inputShape,
                 inputShape, filterChannelShape, biasChannelShape, outputShape, &realMultiplier[i]));
         int exponent;
         NN_RET_CHECK(QuantizeMultiplier(realMultiplier[i], &outputMultiplier[i], &exponent));
-        outputShift[i] = -exponent;
+        outputExponent[i] = exponent;
     }
 
-    int32_t output_activation_min = 0, output_activation_max = 0;
-    CalculateActivationRange<T>(activation, outputShape, &output_activation_min,
-                                &output_activation_max);
-
-    const T* inputBase = inputData;
-    T* outPtr = outputData;
-    for (uint32_t b = 0; b < numBatches; b++) {
-        for (uint32_t h = 0; h < outputHeight; h++) {
-            for (uint32_t w = 0; w < outputWidth; w++) {
-                const int8_t* filterBase = filterData;
-                for (int32_t g = 0; g < numGroups; g++) {
-                    for (uint32_t d = 0; d < outputGroupDepth; d++) {
-                        int32_t wInputOrigin =
-                                static_cast<int32_t>(w) * stride_width - padding_left;
-                        int32_t hInputOrigin =
-                                static_cast<int32_t>(h) * stride_height - padding_top;
-                        int32_t sum = 0.0f;
-                        for (uint32_t i = 0; i < filterHeight; i++) {
-                            for (uint32_t j = 0; j < filterWidth; j++) {
-                                for (uint32_t k = 0; k < filterDepth; k++) {
-                                    int32_t hInput = hInputOrigin + static_cast<int32_t>(i);
-                                    int32_t wInput = wInputOrigin + static_cast<int32_t>(j);
-                                    uint32_t dInput = filterDepth * g + k;
-                                    if (hInput >= 0 && hInput < static_cast<int32_t>(inputHeight) &&
-                                        wInput >= 0 && wInput < static_cast<int32_t>(inputWidth)) {
-                                        uint32_t filterIndex =
-                                                i * filterWidth * filterDepth + j * filterDepth + k;
-                                        uint32_t inputIndex = hInput * inputWidth * inputDepth +
-                                                              wInput * inputDepth + dInput;
-                                        sum += (static_cast<int32_t>(filterBase[filterIndex])) *
-                                               (static_cast<int32_t>(inputBase[inputIndex]) +
-                                                inputOffset);
-                                    }
-                                }
-                            }
-                        }
-                        int channelIndex = g * outputGroupDepth + d;
-                        sum += biasData[channelIndex];
-                        sum = tflite::MultiplyByQuantizedMultiplier(
-                                sum, outputMultiplier[channelIndex], -outputShift[channelIndex]);
-                        sum += outputOffset;
-                        sum = std::max(std::min(sum, output_activation_max), output_activation_min);
-                        outPtr[d] = static_cast<T>(sum);
-                        filterBase += filterHeight * filterWidth * filterDepth;
-                    }
-                    outPtr += outputGroupDepth;
-                }
-            }
-        }
-        inputBase += inputHeight * inputWidth * inputDepth;
+    if constexpr (std::is_same_v<T, uint8_t>) {
+        // The GEMM needs the filter in the type of the input, and a symmetric int8 filter is
+        // the uint8 one with a zero point of 128.
+        std::vector<uint8_t> filterData_uint8(getNumberOfElements(filterShape));
+        convertInt8ToUInt8(filterData, &filterData_uint8);
+        Shape filterShape_uint8 = filterShape;
+        filterShape_uint8.offset = 128;
+        return groupedConvQuant8Impl(inputData, inputShape, filterData_uint8.data(),
+                                     filterShape_uint8, biasData, padding_left, padding_top,
+                                     stride_width, stride_height, numGroups, outputMultiplier,
+                                     outputExponent, activation, outputData, outputShape,
+                                     ruyContext, gemmContext);
+    } else {
+        return groupedConvQuant8Impl(inputData, inputShape, filterData, filterShape, biasData,
+                                     padding_left, padding_top, stride_width, stride_height,
+                                     numGroups, outputMultiplier, outputExponent, activation,
+                                     outputData, outputShape, ruyContext, gemmContext);
     }
-
-    return true;
 }
 
-bool groupedConvFloat16(const _Float16* inputData, const Shape& inputShape,
-                        const _Float16* filterData, const Shape& filterShape,
-                        const _Float16* biasData, const Shape& biasShape, int32_t padding_left,
-                        int32_t padding_right, int32_t padding_top, int32_t padding_bottom,
-                        int32_t stride_width, int32_t stride_height, int32_t numGroups,
-                        int32_t activation, _Float16* outputData, const Shape& outputShape) {
+bool groupedConvFloat16(const _Float16* inputData, const Shape& inputShape, const float* filterData,
+                        const Shape& filterShape, const float* biasData, const Shape& biasShape,
+                        int32_t padding_left, int32_t padding_right, int32_t padding_top,
+                        int32_t padding_bottom, int32_t stride_width, int32_t stride_height,
+                        int32_t numGroups, int32_t activation, _Float16* outputData,
+                        const Shape& outputShape, IOperationExecutionContext* context) {
     NNTRACE_TRANS("groupConvFloat16");
-
-    std::vector<float> inputData_float32(getNumberOfElements(inputShape));
-    std::vector<float> filterData_float32(getNumberOfElements(filterShape));
-    std::vector<float> biasData_float32(getNumberOfElements(biasShape));
-    std::vector<float> outputData_float32(getNumberOfElements(outputShape));
-
-    convertFloat16ToFloat32(inputData, &inputData_float32);
-    convertFloat16ToFloat32(filterData, &filterData_float32);
-    convertFloat16ToFloat32(biasData, &biasData_float32);
-
-    groupedConvFloat32(inputData_float32.data(), inputShape, filterData_float32.data(), filterShape,
-                       biasData_float32.data(), biasShape, padding_left, padding_right, padding_top,
-                       padding_bottom, stride_width, stride_height, numGroups, activation,
-                       outputData_float32.data(), outputShape);
-    convertFloat32ToFloat16(outputData_float32, outputData);
-
-    return true;
+    ruy::Context* ruyContext = context->getRuyContext();
+    return computeFloat16PerBatch(
+            context, inputData, inputShape, outputData, outputShape,
+            [&](const float* inputBatch, const Shape& inputBatchShape, float* outputBatch,
+                const Shape& outputBatchShape) {
+                return groupedConvFloat32(inputBatch, inputBatchShape, filterData, filterShape,
+                                          biasData, biasShape, padding_left, padding_right,
+                                          padding_top, padding_bottom, stride_width,
+                                          stride_height, numGroups, activation, outputBatch,
+                                          outputBatchShape, ruyContext);
+            });
 }
 
 template bool groupedConvQuant8PerChannel<uint8_t>(
@@ -318,14 +449,16 @@ template bool groupedConvQuant8PerChannel<uint8_t>(
         const Shape& filterShape, const float* filterScales, const int32_t* biasData,
         const Shape& biasShape, int32_t padding_left, int32_t padding_right, int32_t padding_top,
         int32_t padding_bottom, int32_t stride_width, int32_t stride_height, int32_t numGroups,
-        int32_t activation, uint8_t* outputData, const Shape& outputShape);
+        int32_t activation, uint8_t* outputData, const Shape& outputShape,
+        ruy::Context* ruyContext, gemmlowp::GemmContext* gemmContext);
 
 template bool groupedConvQuant8PerChannel<int8_t>(
         const int8_t* inputData, const Shape& inputShape, const int8_t* filterData,
         const Shape& filterShape, const float* filterScales, const int32_t* biasData,
         const Shape& biasShape, int32_t padding_left, int32_t padding_right, int32_t padding_top,
         int32_t padding_bottom, int32_t stride_width, int32_t stride_height, int32_t numGroups,
-        int32_t activation, int8_t* outputData, const Shape& outputShape);
+        int32_t activation, int8_t* outputData, const Shape& outputShape,
+        ruy::Context* ruyContext, gemmlowp::GemmContext* gemmContext);
 
 #undef ANDROID_NN_GROUPED_CONV_PARAMETERS
 }  // namespace nn
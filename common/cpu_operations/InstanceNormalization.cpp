@@ -18,6 +18,7 @@
 
 #include "InstanceNormalization.h"
 
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
@@ -35,58 +36,85 @@ namespace instance_normalization {
 #ifdef NN_INCLUDE_CPU_IMPLEMENTATION
 namespace {
 
+// Number of consecutive channels that are processed together.
+constexpr uint32_t kChannelBlockSize = 64;
+
+// Normalizes numChannels consecutive channels of one batch, over numPixels pixels that are depth
+// values apart. The statistics are gathered in a single read, as sums of the differences to the
+// first pixel, which keeps the variance accurate when the mean is large compared to the spread.
+// The loops over channels are contiguous in NHWC and vectorize.
 template <typename T>
-inline bool instanceNormNhwc(const T* inputData, const Shape& inputShape, T gamma, T beta,
-                             T epsilon, T* outputData, const Shape& /*outputShape*/) {
-    NNTRACE_TRANS("InstanceNormalizationNhwc");
-    uint32_t numBatches = getSizeOfDimension(inputShape, 0);
-    uint32_t height = getSizeOfDimension(inputShape, 1);
-    uint32_t width = getSizeOfDimension(inputShape, 2);
-    uint32_t depth = getSizeOfDimension(inputShape, 3);
-    for (uint32_t b = 0; b < numBatches; b++) {
-        for (uint32_t d = 0; d < depth; d++) {
-            uint32_t indexBase = b * height * width * depth + d;
-            T mean = 0, sigma = 0;
-
-            // Compute the mean of a single layer.
-            for (uint32_t h = 0; h < height; h++) {
-                for (uint32_t w = 0; w < width; w++) {
-                    T val = inputData[indexBase + (h * width + w) * depth];
-                    mean += val;
-                }
-            }
-            mean /= static_cast<T>(height * width);
-
-            // Compute the standard deviation (sigma) of a single layer.
-            for (uint32_t h = 0; h < height; h++) {
-                for (uint32_t w = 0; w < width; w++) {
-                    T val = inputData[indexBase + (h * width + w) * depth] - mean;
-                    sigma += val * val;
-                }
-            }
-            sigma = std::sqrt(static_cast<float>(sigma / static_cast<T>(height * width)) + epsilon);
-
-            // Apply instance normalization.
-            for (uint32_t h = 0; h < height; h++) {
-                for (uint32_t w = 0; w < width; w++) {
-                    uint32_t ind = indexBase + (h * width + w) * depth;
-                    outputData[ind] = (inputData[ind] - mean) * gamma / sigma + beta;
-                }
-            }
+void instanceNormChannelBlock(const T* input, uint32_t numPixels, uint32_t depth,
+                              uint32_t numChannels, float gamma, float beta, float epsilon,
+                              T* output) {
+    float shifts[kChannelBlockSize];
+    float sums[kChannelBlockSize];
+    float sumsOfSquares[kChannelBlockSize];
+    for (uint32_t c = 0; c < numChannels; ++c) {
+        shifts[c] = static_cast<float>(input[c]);
+        sums[c] = 0.0f;
+        sumsOfSquares[c] = 0.0f;
+    }
+    for (uint32_t i = 1; i < numPixels; ++i) {
+        const T* pixel = input + i * depth;
+        for (uint32_t c = 0; c < numChannels; ++c) {
+            const float val = static_cast<float>(pixel[c]) - shifts[c];
+            sums[c] += val;
+            sumsOfSquares[c] += val * val;
         }
     }
+
+    // The normalization and the affine transform, folded into one multiply-add per value.
+    float scales[kChannelBlockSize];
+    float offsets[kChannelBlockSize];
+    const float invNumPixels = 1.0f / static_cast<float>(numPixels);
+    for (uint32_t c = 0; c < numChannels; ++c) {
+        const float shiftedMean = sums[c] * invNumPixels;
+        const float variance =
+                std::max(sumsOfSquares[c] * invNumPixels - shiftedMean * shiftedMean, 0.0f);
+        scales[c] = gamma / std::sqrt(variance + epsilon);
+        offsets[c] = beta - (shifts[c] + shiftedMean) * scales[c];
+    }
+    for (uint32_t i = 0; i < numPixels; ++i) {
+        const T* pixel = input + i * depth;
+        T* outputPixel = output + i * depth;
+        for (uint32_t c = 0; c < numChannels; ++c) {
+            outputPixel[c] = static_cast<T>(static_cast<float>(pixel[c]) * scales[c] + offsets[c]);
+        }
+    }
+}
+
+template <typename T>
+inline bool instanceNormNhwc(const T* inputData, const Shape& inputShape, T gamma, T beta,
+                             T epsilon, T* outputData, const Shape& /*outputShape*/,
+                             ruy::Context* ruyContext) {
+    NNTRACE_TRANS("InstanceNormalizationNhwc");
+    const uint32_t numBatches = getSizeOfDimension(inputShape, 0);
+    const uint32_t height = getSizeOfDimension(inputShape, 1);
+    const uint32_t width = getSizeOfDimension(inputShape, 2);
+    const uint32_t numPixels = height * width;
+    const uint32_t depth = getSizeOfDimension(inputShape, 3);
+    if (numPixels == 0) return true;
+    parallelForAxisBlocks(ruyContext, numBatches, numPixels, depth, kChannelBlockSize,
+                          [&](uint32_t b, uint32_t channelBegin, uint32_t channelEnd) {
+                              const uint32_t offset = b * numPixels * depth + channelBegin;
+                              instanceNormChannelBlock(inputData + offset, numPixels, depth,
+                                                       channelEnd - channelBegin, gamma, beta,
+                                                       epsilon, outputData + offset);
+                          });
     return true;
 }
 
 template <typename T>
 inline bool instanceNorm(const T* inputData, const Shape& inputShape, T gamma, T beta, T epsilon,
-                         bool useNchw, T* outputData, const Shape& outputShape) {
+                         bool useNchw, T* outputData, const Shape& outputShape,
+                         ruy::Context* ruyContext) {
     InputWithLayout<T> input(useNchw);
     OutputWithLayout<T> output(useNchw);
     NN_RET_CHECK(input.initialize(inputData, inputShape));
     NN_RET_CHECK(output.initialize(outputData, outputShape));
     NN_RET_CHECK(instanceNormNhwc(input.getNhwcBuffer(), input.getNhwcShape(), gamma, beta, epsilon,
-                                  output.getNhwcBuffer(), output.getNhwcShape()));
+                                  output.getNhwcBuffer(), output.getNhwcShape(), ruyContext));
     NN_RET_CHECK(output.commit());
     return true;
 }
@@ -109,7 +137,8 @@ bool execute(IOperationExecutionContext* context) {
                                 context->getInputValue<_Float16>(kEpsilonScalar),
                                 context->getInputValue<bool>(kLayoutScalar),
                                 context->getOutputBuffer<_Float16>(kOutputTensor),
-                                context->getOutputShape(kOutputTensor));
+                                context->getOutputShape(kOutputTensor),
+                                context->getRuyContext());
         case OperandType::TENSOR_FLOAT32:
             return instanceNorm(context->getInputBuffer<float>(kInputTensor),
                                 context->getInputShape(kInputTensor),
@@ -118,7 +147,8 @@ bool execute(IOperationExecutionContext* context) {
                                 context->getInputValue<float>(kEpsilonScalar),
                                 context->getInputValue<bool>(kLayoutScalar),
                                 context->getOutputBuffer<float>(kOutputTensor),
-                                context->getOutputShape(kOutputTensor));
+                                context->getOutputShape(kOutputTensor),
+                                context->getRuyContext());
         default:
             NN_RET_CHECK_FAIL() << "Unsupported tensor type for operation " << kOperationName;
     }
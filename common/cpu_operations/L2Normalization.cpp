@@ -19,6 +19,8 @@
 #include "L2Normalization.h"
 
 #include <algorithm>
+#include <limits>
+#include <type_traits>
 #include <vector>
 
 #include "OperationResolver.h"
@@ -43,99 +45,108 @@ namespace l2_norm {
 #ifdef NN_INCLUDE_CPU_IMPLEMENTATION
 namespace {
 
-inline bool l2normFloat32Impl(const float* inputData, const Shape& inputShape, int32_t axis,
-                              float* outputData, const Shape& /*outputShape*/) {
-    NNTRACE_TRANS("l2normFloat32");
+// Number of consecutive inner positions that are processed together when the axis is not the
+// innermost dimension.
+constexpr uint32_t kAxisBlockSize = 64;
+
+// L2 normalization along a non-innermost axis, with a running sum of squares per inner position.
+template <typename T>
+void l2normAxisBlock(const T* input, uint32_t axisSize, uint32_t innerSize, uint32_t numLanes,
+                     T* output) {
     constexpr float kEpsilon = 1e-6f;
-    const uint32_t outerSize = getNumberOfElements(inputShape, 0, axis);
-    const uint32_t axisSize = getSizeOfDimension(inputShape, axis);
-    const uint32_t innerSize =
-            getNumberOfElements(inputShape, axis + 1, getNumberOfDimensions(inputShape));
-    for (uint32_t outer = 0; outer < outerSize; ++outer) {
-        const float* inputBeg = inputData + outer * axisSize * innerSize;
-        const float* inputEnd = inputBeg + axisSize * innerSize;
-        float* outputBeg = outputData + outer * axisSize * innerSize;
-        for (uint32_t inner = 0; inner < innerSize; ++inner, ++inputBeg, ++inputEnd, ++outputBeg) {
-            float sum = 0.0f;
-            for (const float* p = inputBeg; p < inputEnd; p += innerSize) {
-                float val = *p;
-                sum += val * val;
-            }
-            float l2_norm = std::max(std::sqrt(sum), kEpsilon);
-            float* pOut = outputBeg;
-            for (const float* p = inputBeg; p < inputEnd; p += innerSize, pOut += innerSize) {
-                *pOut = *p / l2_norm;
-            }
+    float sums[kAxisBlockSize];
+    std::fill_n(sums, numLanes, 0.0f);
+    for (uint32_t a = 0; a < axisSize; ++a) {
+        const T* row = input + a * innerSize;
+        for (uint32_t j = 0; j < numLanes; ++j) {
+            const float val = static_cast<float>(row[j]);
+            sums[j] += val * val;
+        }
+    }
+    float norms[kAxisBlockSize];
+    for (uint32_t j = 0; j < numLanes; ++j) {
+        norms[j] = std::max(std::sqrt(sums[j]), kEpsilon);
+    }
+    for (uint32_t a = 0; a < axisSize; ++a) {
+        const T* row = input + a * innerSize;
+        T* outputRow = output + a * innerSize;
+        for (uint32_t j = 0; j < numLanes; ++j) {
+            outputRow[j] = static_cast<T>(static_cast<float>(row[j]) / norms[j]);
         }
     }
-    return true;
 }
 
-inline bool l2normQuant8Impl(const uint8_t* inputData, const Shape& inputShape, int32_t axis,
-                             uint8_t* outputData, const Shape& /*outputShape*/) {
-    NNTRACE_TRANS("l2normQuant8");
+template <typename T>
+bool l2normAxis(const T* inputData, const Shape& inputShape, int32_t axis, T* outputData,
+                ruy::Context* ruyContext) {
+    NNTRACE_TRANS("l2normAxis");
     const uint32_t outerSize = getNumberOfElements(inputShape, 0, axis);
     const uint32_t axisSize = getSizeOfDimension(inputShape, axis);
     const uint32_t innerSize =
             getNumberOfElements(inputShape, axis + 1, getNumberOfDimensions(inputShape));
-    for (uint32_t outer = 0; outer < outerSize; ++outer) {
-        const uint8_t* inputBeg = inputData + outer * axisSize * innerSize;
-        const uint8_t* inputEnd = inputBeg + axisSize * innerSize;
-        uint8_t* outputBeg = outputData + outer * axisSize * innerSize;
-        for (uint32_t inner = 0; inner < innerSize; ++inner, ++inputBeg, ++inputEnd, ++outputBeg) {
-            int32_t sum = 0;
-            for (const uint8_t* p = inputBeg; p < inputEnd; p += innerSize) {
-                int32_t val = static_cast<int32_t>(*p) - inputShape.offset;
-                sum += val * val;
-            }
-            int32_t invMultiplier, invShift;
-            tflite::GetInvSqrtQuantizedMultiplierExp(sum, -1, &invMultiplier, &invShift);
-            uint8_t* pOut = outputBeg;
-            for (const uint8_t* p = inputBeg; p < inputEnd; p += innerSize, pOut += innerSize) {
-                int32_t val = static_cast<int32_t>(*p) - inputShape.offset;
-                int32_t scaledVal = tflite::MultiplyByQuantizedMultiplierSmallerThanOneExp(
-                                            val * 128, invMultiplier, invShift) +
-                                    128;
-                *pOut = static_cast<uint8_t>(std::min(std::max(scaledVal, 0), 255));
-            }
+    parallelForAxisBlocks(ruyContext, outerSize, axisSize, innerSize, kAxisBlockSize,
+                          [&](uint32_t outer, uint32_t innerBegin, uint32_t innerEnd) {
+                              const uint32_t offset = outer * axisSize * innerSize + innerBegin;
+                              l2normAxisBlock(inputData + offset, axisSize, innerSize,
+                                              innerEnd - innerBegin, outputData + offset);
+                          });
+    return true;
+}
+
+// The quantized output has a scale of 1/128, and a zero point of 128 for uint8 and 0 for int8.
+template <typename T>
+void l2normQuant8AxisBlock(const T* input, int32_t inputOffset, uint32_t axisSize,
+                           uint32_t innerSize, uint32_t numLanes, T* output) {
+    constexpr int32_t kOutputOffset = std::is_same_v<T, uint8_t> ? 128 : 0;
+    constexpr int32_t kMin = std::numeric_limits<T>::min();
+    constexpr int32_t kMax = std::numeric_limits<T>::max();
+    int32_t sums[kAxisBlockSize];
+    std::fill_n(sums, numLanes, 0);
+    for (uint32_t a = 0; a < axisSize; ++a) {
+        const T* row = input + a * innerSize;
+        for (uint32_t j = 0; j < numLanes; ++j) {
+            const int32_t val = static_cast<int32_t>(row[j]) - inputOffset;
+            sums[j] += val * val;
+        }
+    }
+    int32_t invMultipliers[kAxisBlockSize];
+    int32_t invShifts[kAxisBlockSize];
+    for (uint32_t j = 0; j < numLanes; ++j) {
+        tflite::GetInvSqrtQuantizedMultiplierExp(sums[j], -1, &invMultipliers[j], &invShifts[j]);
+    }
+    for (uint32_t a = 0; a < axisSize; ++a) {
+        const T* row = input + a * innerSize;
+        T* outputRow = output + a * innerSize;
+        for (uint32_t j = 0; j < numLanes; ++j) {
+            const int32_t val = static_cast<int32_t>(row[j]) - inputOffset;
+            const int32_t scaledVal = tflite::MultiplyByQuantizedMultiplierSmallerThanOneExp(
+                                              val * 128, invMultipliers[j], invShifts[j]) +
+                                      kOutputOffset;
+            outputRow[j] = static_cast<T>(std::min(std::max(scaledVal, kMin), kMax));
         }
     }
-    return true;
 }
 
-inline bool l2normQuant8SignedImpl(const int8_t* inputData, const Shape& inputShape, int32_t axis,
-                                   int8_t* outputData, const Shape& /*outputShape*/) {
-    NNTRACE_TRANS("l2normQuant8Signed");
+template <typename T>
+bool l2normQuant8Axis(const T* inputData, const Shape& inputShape, int32_t axis, T* outputData,
+                      ruy::Context* ruyContext) {
+    NNTRACE_TRANS("l2normQuant8Axis");
     const uint32_t outerSize = getNumberOfElements(inputShape, 0, axis);
     const uint32_t axisSize = getSizeOfDimension(inputShape, axis);
     const uint32_t innerSize =
             getNumberOfElements(inputShape, axis + 1, getNumberOfDimensions(inputShape));
-    for (uint32_t outer = 0; outer < outerSize; ++outer) {
-        const int8_t* inputBeg = inputData + outer * axisSize * innerSize;
-        const int8_t* inputEnd = inputBeg + axisSize * innerSize;
-        int8_t* outputBeg = outputData + outer * axisSize * innerSize;
-        for (uint32_t inner = 0; inner < innerSize; ++inner, ++inputBeg, ++inputEnd, ++outputBeg) {
-            int32_t sum = 0;
-            for (const int8_t* p = inputBeg; p < inputEnd; p += innerSize) {
-                int32_t val = static_cast<int32_t>(*p) - inputShape.offset;
-                sum += val * val;
-            }
-            int32_t invMultiplier, invShift;
-            tflite::GetInvSqrtQuantizedMultiplierExp(sum, -1, &invMultiplier, &invShift);
-            int8_t* pOut = outputBeg;
-            for (const int8_t* p = inputBeg; p < inputEnd; p += innerSize, pOut += innerSize) {
-                int32_t val = static_cast<int32_t>(*p) - inputShape.offset;
-                int32_t scaledVal = tflite::MultiplyByQuantizedMultiplierSmallerThanOneExp(
-                        val * 128, invMultiplier, invShift);
-                *pOut = static_cast<int8_t>(std::min(std::max(scaledVal, -128), 127));
-            }
-        }
-    }
+    parallelForAxisBlocks(ruyContext, outerSize, axisSize, innerSize, kAxisBlockSize,
+                          [&](uint32_t outer, uint32_t innerBegin, uint32_t innerEnd) {
+                              const uint32_t offset = outer * axisSize * innerSize + innerBegin;
+                              l2normQuant8AxisBlock(inputData + offset, inputShape.offset,
+                                                    axisSize, innerSize, innerEnd - innerBegin,
+                                                    outputData + offset);
+                          });
     return true;
 }
 
 bool l2normFloat32(const float* inputData, const Shape& inputShape, int32_t axis, float* outputData,
-                   const Shape& outputShape) {
+                   const Shape& outputShape, ruy::Context* ruyContext) {
     int32_t ndim = getNumberOfDimensions(inputShape);
     NN_CHECK(handleNegativeAxis(inputShape, &axis));
     // TFLite optimized implementation only supports computation along the last axis
@@ -146,25 +157,30 @@ bool l2normFloat32(const float* inputData, const Shape& inputShape, int32_t axis
                                                convertShapeToTflshape(outputShape), outputData);
         return true;
     } else {
-        return l2normFloat32Impl(inputData, inputShape, axis, outputData, outputShape);
+        return l2normAxis(inputData, inputShape, axis, outputData, ruyContext);
     }
 }
 
 bool l2normFloat16(const _Float16* inputData, const Shape& inputShape, int32_t axis,
-                   _Float16* outputData, const Shape& outputShape) {
+                   _Float16* outputData, const Shape& outputShape, ruy::Context* ruyContext) {
+    NN_CHECK(handleNegativeAxis(inputShape, &axis));
+    if (axis != static_cast<int32_t>(getNumberOfDimensions(inputShape)) - 1) {
+        return l2normAxis(inputData, inputShape, axis, outputData, ruyContext);
+    }
     NNTRACE_TRANS("l2normFloat16");
     std::vector<float> inputDataFloat32(getNumberOfElements(inputShape));
     convertFloat16ToFloat32(inputData, &inputDataFloat32);
     std::vector<float> outputDataFloat32(getNumberOfElements(outputShape));
 
-    l2normFloat32(inputDataFloat32.data(), inputShape, axis, outputDataFloat32.data(), outputShape);
+    l2normFloat32(inputDataFloat32.data(), inputShape, axis, outputDataFloat32.data(), outputShape,
+                  ruyContext);
     convertFloat32ToFloat16(outputDataFloat32, outputData);
 
     return true;
 }
 
 bool l2normQuant8(const uint8_t* inputData, const Shape& inputShape, int32_t axis,
-                  uint8_t* outputData, const Shape& outputShape) {
+                  uint8_t* outputData, const Shape& outputShape, ruy::Context* ruyContext) {
     int32_t ndim = getNumberOfDimensions(inputShape);
     NN_CHECK(handleNegativeAxis(inputShape, &axis));
     // TFLite optimized implementation only supports computation along the last axis
@@ -175,12 +191,12 @@ bool l2normQuant8(const uint8_t* inputData, const Shape& inputShape, int32_t axi
                                                convertShapeToTflshape(outputShape), outputData);
         return true;
     } else {
-        return l2normQuant8Impl(inputData, inputShape, axis, outputData, outputShape);
+        return l2normQuant8Axis(inputData, inputShape, axis, outputData, ruyContext);
     }
 }
 
 bool l2normQuant8Signed(const int8_t* inputData, const Shape& inputShape, int32_t axis,
-                        int8_t* outputData, const Shape& outputShape) {
+                        int8_t* outputData, const Shape& outputShape, ruy::Context* ruyContext) {
     int32_t ndim = getNumberOfDimensions(inputShape);
     NN_CHECK(handleNegativeAxis(inputShape, &axis));
     // TFLite implementation only supports computation along the last axis
@@ -192,7 +208,7 @@ bool l2normQuant8Signed(const int8_t* inputData, const Shape& inputShape, int32_
                                                        inputData, outputData);
         return true;
     } else {
-        return l2normQuant8SignedImpl(inputData, inputShape, axis, outputData, outputShape);
+        return l2normQuant8Axis(inputData, inputShape, axis, outputData, ruyContext);
     }
 }
 
@@ -233,22 +249,26 @@ bool execute(IOperationExecutionContext* context) {
             return l2normFloat32(context->getInputBuffer<float>(kInputTensor),
                                  context->getInputShape(kInputTensor), axis,
                                  context->getOutputBuffer<float>(kOutputTensor),
-                                 context->getOutputShape(kOutputTensor));
+                                 context->getOutputShape(kOutputTensor),
+                                 context->getRuyContext());
         case OperandType::TENSOR_FLOAT16:
             return l2normFloat16(context->getInputBuffer<_Float16>(kInputTensor),
                                  context->getInputShape(kInputTensor), axis,
                                  context->getOutputBuffer<_Float16>(kOutputTensor),
-                                 context->getOutputShape(kOutputTensor));
+                                 context->getOutputShape(kOutputTensor),
+                                 context->getRuyContext());
         case OperandType::TENSOR_QUANT8_ASYMM:
             return l2normQuant8(context->getInputBuffer<uint8_t>(kInputTensor),
                                 context->getInputShape(kInputTensor), axis,
                                 context->getOutputBuffer<uint8_t>(kOutputTensor),
-                                context->getOutputShape(kOutputTensor));
+                                context->getOutputShape(kOutputTensor),
+                                context->getRuyContext());
         case OperandType::TENSOR_QUANT8_ASYMM_SIGNED:
             return l2normQuant8Signed(context->getInputBuffer<int8_t>(kInputTensor),
                                       context->getInputShape(kInputTensor), axis,
                                       context->getOutputBuffer<int8_t>(kOutputTensor),
-                                      context->getOutputShape(kOutputTensor));
+                                      context->getOutputShape(kOutputTensor),
+                                      context->getRuyContext());
         default:
             NN_RET_CHECK_FAIL() << "Unsupported tensor type for operation " << kOperationName;
     }
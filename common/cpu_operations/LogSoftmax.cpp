@@ -20,45 +20,118 @@
 
 #include <algorithm>
 #include <cmath>
-#include <vector>
+#include <limits>
 
+#include "ElementwiseMath.h"
 #include "OperationResolver.h"
 #include "OperationsExecutionUtils.h"
 #include "Tracing.h"
 
+#ifdef NN_INCLUDE_CPU_IMPLEMENTATION
+#include "CpuOperationUtils.h"
+#endif  // NN_INCLUDE_CPU_IMPLEMENTATION
+
 namespace android {
 namespace nn {
 namespace log_softmax {
 
+namespace {
+
+// Number of consecutive inner positions, or of values along the axis when it is the innermost
+// dimension, that are processed together.
+constexpr uint32_t kBlockSize = 64;
+
+// Log softmax along the innermost dimension, over a contiguous row of values.
+template <typename T>
+void computeRow(const T* input, float beta, uint32_t axisSize, T* output) {
+    // We subtract the maximum value from each element to ensure
+    // numerical stability, taking advantage of the following equality:
+    // exp(x[i])/sum(exp(x[i])) == exp(x[i]+C)/sum(exp(x[i]+C))
+    const float maxValue = static_cast<float>(*std::max_element(input, input + axisSize));
+    float diffs[kBlockSize];
+    float exps[kBlockSize];
+    float sum = 0.0f;
+    for (uint32_t begin = 0; begin < axisSize; begin += kBlockSize) {
+        const uint32_t size = std::min(kBlockSize, axisSize - begin);
+        for (uint32_t i = 0; i < size; ++i) {
+            diffs[i] = (static_cast<float>(input[begin + i]) - maxValue) * beta;
+        }
+        elementwise_math::apply<elementwise_math::ExpKernel>(diffs, exps, size);
+        for (uint32_t i = 0; i < size; ++i) {
+            sum += exps[i];
+        }
+    }
+    const float logSum = std::log(sum);
+    for (uint32_t i = 0; i < axisSize; ++i) {
+        output[i] = static_cast<T>((static_cast<float>(input[i]) - maxValue) * beta - logSum);
+    }
+}
+
+// Log softmax along a non-innermost axis, with a running max and sum per inner position.
+template <typename T>
+void computeAxisBlock(const T* input, float beta, uint32_t axisSize, uint32_t innerSize,
+                      uint32_t numLanes, T* output) {
+    float maxValues[kBlockSize];
+    std::fill_n(maxValues, numLanes, -std::numeric_limits<float>::max());
+    for (uint32_t a = 0; a < axisSize; ++a) {
+        const T* row = input + a * innerSize;
+        for (uint32_t j = 0; j < numLanes; ++j) {
+            maxValues[j] = std::max(maxValues[j], static_cast<float>(row[j]));
+        }
+    }
+    float diffs[kBlockSize];
+    float exps[kBlockSize];
+    float sums[kBlockSize];
+    std::fill_n(sums, numLanes, 0.0f);
+    for (uint32_t a = 0; a < axisSize; ++a) {
+        const T* row = input + a * innerSize;
+        for (uint32_t j = 0; j < numLanes; ++j) {
+            diffs[j] = (static_cast<float>(row[j]) - maxValues[j]) * beta;
+        }
+        elementwise_math::apply<elementwise_math::ExpKernel>(diffs, exps, numLanes);
+        for (uint32_t j = 0; j < numLanes; ++j) {
+            sums[j] += exps[j];
+        }
+    }
+    float logSums[kBlockSize];
+    elementwise_math::apply<elementwise_math::LogKernel>(sums, logSums, numLanes);
+    for (uint32_t a = 0; a < axisSize; ++a) {
+        const T* row = input + a * innerSize;
+        T* outputRow = output + a * innerSize;
+        for (uint32_t j = 0; j < numLanes; ++j) {
+            outputRow[j] = static_cast<T>((static_cast<float>(row[j]) - maxValues[j]) * beta -
+                                          logSums[j]);
+        }
+    }
+}
+
+}  // namespace
+
 template <typename T>
-inline bool compute(const T* input, const Shape& shape, T beta, uint32_t axis, T* output) {
+inline bool compute(const T* input, const Shape& shape, T beta, uint32_t axis, T* output,
+                    [[maybe_unused]] IOperationExecutionContext* context) {
     const uint32_t outerSize = getNumberOfElements(shape, 0, axis);
     const uint32_t axisSize = getSizeOfDimension(shape, axis);
     const uint32_t innerSize = getNumberOfElements(shape, axis + 1, getNumberOfDimensions(shape));
+    const auto computeBlock = [&](uint32_t outer, uint32_t innerBegin, uint32_t innerEnd) {
+        const uint32_t offset = outer * axisSize * innerSize + innerBegin;
+        if (innerSize == 1) {
+            computeRow(input + offset, beta, axisSize, output + offset);
+        } else {
+            computeAxisBlock(input + offset, beta, axisSize, innerSize, innerEnd - innerBegin,
+                             output + offset);
+        }
+    };
+#ifdef NN_INCLUDE_CPU_IMPLEMENTATION
+    parallelForAxisBlocks(context->getRuyContext(), outerSize, axisSize, innerSize, kBlockSize,
+                          computeBlock);
+#else   // NN_INCLUDE_CPU_IMPLEMENTATION
     for (uint32_t outer = 0; outer < outerSize; ++outer) {
-        for (uint32_t inner = 0; inner < innerSize; ++inner) {
-            // We subtract the maximum value from each element to ensure
-            // numerical stability, taking advantage of the following equality:
-            // exp(x[i])/sum(exp(x[i])) == exp(x[i]+C)/sum(exp(x[i]+C))
-            T maxValue = input[outer * axisSize * innerSize + inner];
-            for (uint32_t i = 1; i < axisSize; ++i) {
-                maxValue = std::max(maxValue, input[(outer * axisSize + i) * innerSize + inner]);
-            }
-
-            T sum = 0;
-            for (uint32_t i = 0; i < axisSize; ++i) {
-                sum += std::exp(static_cast<double>(
-                        (input[(outer * axisSize + i) * innerSize + inner] - maxValue) * beta));
-            }
-
-            const T logSum = std::log(static_cast<double>(sum));
-            for (uint32_t i = 0; i < axisSize; ++i) {
-                output[(outer * axisSize + i) * innerSize + inner] =
-                        (input[(outer * axisSize + i) * innerSize + inner] - maxValue) * beta -
-                        logSum;
-            }
+        for (uint32_t inner = 0; inner < innerSize; inner += kBlockSize) {
+            computeBlock(outer, inner, std::min(inner + kBlockSize, innerSize));
         }
     }
+#endif  // NN_INCLUDE_CPU_IMPLEMENTATION
     return true;
 }
 
@@ -74,12 +147,12 @@ bool execute(IOperationExecutionContext* context) {
             return compute(context->getInputBuffer<_Float16>(kInputTensor),
                            context->getInputShape(kInputTensor),
                            context->getInputValue<_Float16>(kInputBeta), axis,
-                           context->getOutputBuffer<_Float16>(kOutputTensor));
+                           context->getOutputBuffer<_Float16>(kOutputTensor), context);
         case OperandType::TENSOR_FLOAT32:
             return compute(context->getInputBuffer<float>(kInputTensor),
                            context->getInputShape(kInputTensor),
                            context->getInputValue<float>(kInputBeta), axis,
-                           context->getOutputBuffer<float>(kOutputTensor));
+                           context->getOutputBuffer<float>(kOutputTensor), context);
         default:
             NN_RET_CHECK_FAIL() << "Unsupported tensor type for operation " << kOperationName;
     }
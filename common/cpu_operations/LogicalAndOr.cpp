@@ -19,7 +19,6 @@
 #include "LogicalAndOr.h"
 
 #include <functional>
-#include <vector>
 
 #include "IndexedShapeWrapper.h"
 #include "OperationResolver.h"
@@ -30,26 +29,11 @@ namespace nn {
 namespace logical {
 namespace {
 
-bool compute(const std::function<bool(bool, bool)>& func, const bool8* aData, const Shape& aShape,
-             const bool8* bData, const Shape& bShape, bool8* outputData, const Shape& outputShape) {
-    IndexedShapeWrapper aShapeIndexed(aShape);
-    IndexedShapeWrapper bShapeIndexed(bShape);
-    IndexedShapeWrapper outputShapeIndexed(outputShape);
-    std::vector<uint32_t> curIndex(outputShape.dimensions.size(), 0);
-    bool lastIndex = false;
-    do {
-        uint32_t outputFlatIndex;
-        NN_RET_CHECK(outputShapeIndexed.indexToFlatIndex(curIndex, &outputFlatIndex));
-        uint32_t aFlatIndex;
-        NN_RET_CHECK(aShapeIndexed.broadcastedIndexToFlatIndex(curIndex, &aFlatIndex));
-        uint32_t bFlatIndex;
-        NN_RET_CHECK(bShapeIndexed.broadcastedIndexToFlatIndex(curIndex, &bFlatIndex));
-
-        outputData[outputFlatIndex] = func(aData[aFlatIndex], bData[bFlatIndex]);
-
-        NN_RET_CHECK(outputShapeIndexed.nextIndexInplace(&curIndex, &lastIndex));
-    } while (!lastIndex);
-    return true;
+template <typename Op>
+bool compute(Op func, const bool8* aData, const Shape& aShape, const bool8* bData,
+             const Shape& bShape, bool8* outputData, const Shape& outputShape) {
+    return broadcastBinaryOp(aData, aShape, bData, bShape, outputData, outputShape,
+                             [=](bool8 a, bool8 b) -> bool8 { return func(a, b); });
 }
 
 }  // namespace
@@ -19,7 +19,7 @@
 #include "MaximumMinimum.h"
 
 #include <algorithm>
-#include <vector>
+#include <limits>
 
 #include "IndexedShapeWrapper.h"
 #include "OperationsExecutionUtils.h"
@@ -34,55 +34,27 @@ namespace {
 template <typename T>
 bool evalGeneric(const T* aData, const Shape& aShape, const T* bData, const Shape& bShape,
                  bool isMinimum, T* outputData, const Shape& outputShape) {
-    IndexedShapeWrapper aShapeIndexed(aShape);
-    IndexedShapeWrapper bShapeIndexed(bShape);
-    IndexedShapeWrapper outputShapeIndexed(outputShape);
-
-    std::vector<uint32_t> curIndex(outputShape.dimensions.size(), 0);
-    bool lastIndex = false;
-    do {
-        uint32_t outputFlatIndex;
-        NN_CHECK(outputShapeIndexed.indexToFlatIndex(curIndex, &outputFlatIndex));
-        uint32_t aFlatIndex;
-        NN_CHECK(aShapeIndexed.broadcastedIndexToFlatIndex(curIndex, &aFlatIndex));
-        uint32_t bFlatIndex;
-        NN_CHECK(bShapeIndexed.broadcastedIndexToFlatIndex(curIndex, &bFlatIndex));
-
-        outputData[outputFlatIndex] = isMinimum ? std::min(aData[aFlatIndex], bData[bFlatIndex])
-                                                : std::max(aData[aFlatIndex], bData[bFlatIndex]);
-
-        NN_CHECK(outputShapeIndexed.nextIndexInplace(&curIndex, &lastIndex));
-    } while (!lastIndex);
-
-    return true;
+    if (isMinimum) {
+        return broadcastBinaryOp(aData, aShape, bData, bShape, outputData, outputShape,
+                                 [](T a, T b) { return std::min(a, b); });
+    }
+    return broadcastBinaryOp(aData, aShape, bData, bShape, outputData, outputShape,
+                             [](T a, T b) { return std::max(a, b); });
 }
 
 template <typename T>
 bool evalQuant8(const T* aData, const Shape& aShape, const T* bData, const Shape& bShape,
                 bool isMinimum, T* outputData, const Shape& outputShape) {
-    IndexedShapeWrapper aShapeIndexed(aShape);
-    IndexedShapeWrapper bShapeIndexed(bShape);
-    IndexedShapeWrapper outputShapeIndexed(outputShape);
-
-    std::vector<uint32_t> curIndex(outputShape.dimensions.size(), 0);
-    bool lastIndex = false;
-    do {
-        uint32_t outputFlatIndex;
-        NN_CHECK(outputShapeIndexed.indexToFlatIndex(curIndex, &outputFlatIndex));
-        uint32_t aFlatIndex;
-        NN_CHECK(aShapeIndexed.broadcastedIndexToFlatIndex(curIndex, &aFlatIndex));
-        uint32_t bFlatIndex;
-        NN_CHECK(bShapeIndexed.broadcastedIndexToFlatIndex(curIndex, &bFlatIndex));
-
-        T aValue = requantize<T>(aData[aFlatIndex], aShape, outputShape);
-        T bValue = requantize<T>(bData[bFlatIndex], bShape, outputShape);
-        outputData[outputFlatIndex] =
-                isMinimum ? std::min(aValue, bValue) : std::max(aValue, bValue);
-
-        NN_CHECK(outputShapeIndexed.nextIndexInplace(&curIndex, &lastIndex));
-    } while (!lastIndex);
-
-    return true;
+    constexpr int32_t kMin = std::numeric_limits<T>::min();
+    const auto aTable = makeRequantizeTable<T>(aShape, outputShape);
+    const auto bTable = makeRequantizeTable<T>(bShape, outputShape);
+    return broadcastBinaryOp(aData, aShape, bData, bShape, outputData, outputShape,
+                             [&](T a, T b) {
+                                 const T aValue = aTable[a - kMin];
+                                 const T bValue = bTable[b - kMin];
+                                 return isMinimum ? std::min(aValue, bValue)
+                                                  : std::max(aValue, bValue);
+                             });
 }
 
 }  // namespace
@@ -19,7 +19,6 @@
 #include "PRelu.h"
 
 #include <algorithm>
-#include <vector>
 
 #include "IndexedShapeWrapper.h"
 #include "OperationResolver.h"
@@ -40,28 +39,10 @@ namespace nn {
 namespace prelu {
 
 #ifdef NN_INCLUDE_CPU_IMPLEMENTATION
-template <typename T>
-inline bool eval(const std::function<T(const T&, const T&)>& func, const T* aData,
-                 const Shape& aShape, const T* bData, const Shape& bShape, T* outputData,
-                 const Shape& outputShape) {
-    IndexedShapeWrapper aShapeIndexed(aShape);
-    IndexedShapeWrapper bShapeIndexed(bShape);
-    IndexedShapeWrapper outputShapeIndexed(outputShape);
-    std::vector<uint32_t> curIndex(outputShape.dimensions.size(), 0);
-    bool lastIndex = false;
-    do {
-        uint32_t outputFlatIndex;
-        NN_RET_CHECK(outputShapeIndexed.indexToFlatIndex(curIndex, &outputFlatIndex));
-        uint32_t aFlatIndex;
-        NN_RET_CHECK(aShapeIndexed.broadcastedIndexToFlatIndex(curIndex, &aFlatIndex));
-        uint32_t bFlatIndex;
-        NN_RET_CHECK(bShapeIndexed.broadcastedIndexToFlatIndex(curIndex, &bFlatIndex));
-
-        outputData[outputFlatIndex] = func(aData[aFlatIndex], bData[bFlatIndex]);
-
-        NN_RET_CHECK(outputShapeIndexed.nextIndexInplace(&curIndex, &lastIndex));
-    } while (!lastIndex);
-    return true;
+template <typename T, typename Func>
+inline bool eval(Func func, const T* aData, const Shape& aShape, const T* bData,
+                 const Shape& bShape, T* outputData, const Shape& outputShape) {
+    return broadcastBinaryOp(aData, aShape, bData, bShape, outputData, outputShape, func);
 }
 
 template <typename T>
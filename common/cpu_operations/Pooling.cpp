@@ -18,6 +18,9 @@
 
 #include "Pooling.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <vector>
 
 #include "OperationResolver.h"
@@ -140,6 +143,60 @@ struct PoolingParam {
     }
 };
 
+// Pools an FP16 tensor directly, accumulating each window in float32, instead of converting the
+// tensors around the float32 kernels. Like tflite's pooling, only the window elements inside the
+// input are pooled. accumulate(float sum, float value) folds a value into the sum of a channel
+// and finish(float sum, uint32_t count) turns it into the output value.
+template <typename AccumulateFn, typename FinishFn>
+bool poolFloat16Nhwc(const _Float16* inputData, const Shape& inputShape, const PoolingParam& param,
+                     _Float16* outputData, const Shape& outputShape, float initialValue,
+                     AccumulateFn accumulate, FinishFn finish) {
+    const int32_t batches = getSizeOfDimension(inputShape, 0);
+    const int32_t inputHeight = getSizeOfDimension(inputShape, 1);
+    const int32_t inputWidth = getSizeOfDimension(inputShape, 2);
+    const int32_t depth = getSizeOfDimension(inputShape, 3);
+    const int32_t outputHeight = getSizeOfDimension(outputShape, 1);
+    const int32_t outputWidth = getSizeOfDimension(outputShape, 2);
+    float activationMin = 0.0f;
+    float activationMax = 0.0f;
+    CalculateActivationRangeFloat(param.activation, &activationMin, &activationMax);
+
+    std::vector<float> sums(depth);
+    for (int32_t b = 0; b < batches; ++b) {
+        for (int32_t outY = 0; outY < outputHeight; ++outY) {
+            const int32_t inYOrigin = outY * param.stride_height - param.padding_top;
+            const int32_t filterYStart = std::max(0, -inYOrigin);
+            const int32_t filterYEnd = std::min(param.filter_height, inputHeight - inYOrigin);
+            for (int32_t outX = 0; outX < outputWidth; ++outX) {
+                const int32_t inXOrigin = outX * param.stride_width - param.padding_left;
+                const int32_t filterXStart = std::max(0, -inXOrigin);
+                const int32_t filterXEnd = std::min(param.filter_width, inputWidth - inXOrigin);
+                std::fill(sums.begin(), sums.end(), initialValue);
+                for (int32_t filterY = filterYStart; filterY < filterYEnd; ++filterY) {
+                    for (int32_t filterX = filterXStart; filterX < filterXEnd; ++filterX) {
+                        const _Float16* in =
+                                inputData + ((b * inputHeight + inYOrigin + filterY) * inputWidth +
+                                             inXOrigin + filterX) *
+                                                    depth;
+                        for (int32_t c = 0; c < depth; ++c) {
+                            sums[c] = accumulate(sums[c], static_cast<float>(in[c]));
+                        }
+                    }
+                }
+                const uint32_t count = std::max(filterYEnd - filterYStart, 0) *
+                                       std::max(filterXEnd - filterXStart, 0);
+                _Float16* out =
+                        outputData + ((b * outputHeight + outY) * outputWidth + outX) * depth;
+                for (int32_t c = 0; c < depth; ++c) {
+                    out[c] = std::min(std::max(finish(sums[c], count), activationMin),
+                                      activationMax);
+                }
+            }
+        }
+    }
+    return true;
+}
+
 bool averagePoolNhwc(const float* inputData, const Shape& inputShape, const PoolingParam& param,
                      float* outputData, const Shape& outputShape) {
     NNTRACE_TRANS("averagePoolFloat32");
@@ -153,14 +210,10 @@ bool averagePoolNhwc(const float* inputData, const Shape& inputShape, const Pool
 bool averagePoolNhwc(const _Float16* inputData, const Shape& inputShape, const PoolingParam& param,
                      _Float16* outputData, const Shape& outputShape) {
     NNTRACE_TRANS("averagePoolFloat16");
-    std::vector<float> inputDataFloat32(getNumberOfElements(inputShape));
-    std::vector<float> outputDataFloat32(getNumberOfElements(outputShape));
-
-    convertFloat16ToFloat32(inputData, &inputDataFloat32);
-    averagePoolNhwc(inputDataFloat32.data(), inputShape, param, outputDataFloat32.data(),
-                    outputShape);
-    convertFloat32ToFloat16(outputDataFloat32, outputData);
-    return true;
+    return poolFloat16Nhwc(
+            inputData, inputShape, param, outputData, outputShape, 0.0f,
+            [](float sum, float value) { return sum + value; },
+            [](float sum, uint32_t count) { return sum / count; });
 }
 
 bool averagePoolNhwc(const uint8_t* inputData, const Shape& inputShape, const PoolingParam& param,
@@ -199,13 +252,10 @@ bool l2PoolNhwc(const float* inputData, const Shape& inputShape, const PoolingPa
 bool l2PoolNhwc(const _Float16* inputData, const Shape& inputShape, const PoolingParam& param,
                 _Float16* outputData, const Shape& outputShape) {
     NNTRACE_TRANS("l2PoolFloat16");
-    std::vector<float> inputDataFloat32(getNumberOfElements(inputShape));
-    std::vector<float> outputDataFloat32(getNumberOfElements(outputShape));
-
-    convertFloat16ToFloat32(inputData, &inputDataFloat32);
-    l2PoolNhwc(inputDataFloat32.data(), inputShape, param, outputDataFloat32.data(), outputShape);
-    convertFloat32ToFloat16(outputDataFloat32, outputData);
-    return true;
+    return poolFloat16Nhwc(
+            inputData, inputShape, param, outputData, outputShape, 0.0f,
+            [](float sum, float value) { return sum + value * value; },
+            [](float sum, uint32_t count) { return std::sqrt(sum / count); });
 }
 
 bool maxPoolNhwc(const float* inputData, const Shape& inputShape, const PoolingParam& param,
@@ -243,14 +293,11 @@ bool maxPoolNhwc(const int8_t* inputData, const Shape& inputShape, const Pooling
 bool maxPoolNhwc(const _Float16* inputData, const Shape& inputShape, const PoolingParam& param,
                  _Float16* outputData, const Shape& outputShape) {
     NNTRACE_TRANS("maxPoolFloat16");
-    std::vector<float> inputData_float32(getNumberOfElements(inputShape));
-    std::vector<float> outputData_float32(getNumberOfElements(outputShape));
-
-    convertFloat16ToFloat32(inputData, &inputData_float32);
-    maxPoolNhwc(inputData_float32.data(), inputShape, param, outputData_float32.data(),
-                outputShape);
-    convertFloat32ToFloat16(outputData_float32, outputData);
-    return true;
+    return poolFloat16Nhwc(
+            inputData, inputShape, param, outputData, outputShape,
+            std::numeric_limits<float>::lowest(),
+            [](float max, float value) { return std::max(max, value); },
+            [](float max, uint32_t /*count*/) { return max; });
 }
 
 template <typename T>
@@ -19,7 +19,6 @@
 #include "Pow.h"
 
 #include <cmath>
-#include <vector>
 
 #include "IndexedShapeWrapper.h"
 #include "OperationsExecutionUtils.h"
@@ -33,27 +32,11 @@ namespace {
 template <typename T>
 bool evalGeneric(const T* baseData, const Shape& baseShape, const T* exponentData,
                  const Shape& exponentShape, T* outputData, const Shape& outputShape) {
-    IndexedShapeWrapper baseShapeIndexed(baseShape);
-    IndexedShapeWrapper exponentShapeIndexed(exponentShape);
-    IndexedShapeWrapper outputShapeIndexed(outputShape);
-
-    std::vector<uint32_t> curIndex(outputShape.dimensions.size(), 0);
-    bool lastIndex = false;
-    do {
-        uint32_t outputFlatIndex;
-        NN_CHECK(outputShapeIndexed.indexToFlatIndex(curIndex, &outputFlatIndex));
-        uint32_t baseFlatIndex;
-        NN_CHECK(baseShapeIndexed.broadcastedIndexToFlatIndex(curIndex, &baseFlatIndex));
-        uint32_t exponentFlatIndex;
-        NN_CHECK(exponentShapeIndexed.broadcastedIndexToFlatIndex(curIndex, &exponentFlatIndex));
-
-        outputData[outputFlatIndex] = std::pow(static_cast<float>(baseData[baseFlatIndex]),
-                                               static_cast<float>(exponentData[exponentFlatIndex]));
-
-        NN_CHECK(outputShapeIndexed.nextIndexInplace(&curIndex, &lastIndex));
-    } while (!lastIndex);
-
-    return true;
+    return broadcastBinaryOp(baseData, baseShape, exponentData, exponentShape, outputData,
+                             outputShape, [](T base, T exponent) -> T {
+                                 return std::pow(static_cast<float>(base),
+                                                 static_cast<float>(exponent));
+                             });
 }
 
 }  // namespace
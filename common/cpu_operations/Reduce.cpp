@@ -27,11 +27,7 @@
 #include "Tracing.h"
 
 #ifdef NN_INCLUDE_CPU_IMPLEMENTATION
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wunused-parameter"
-#pragma clang diagnostic ignored "-Wsign-compare"
-#include <tensorflow/lite/kernels/internal/reference/reference_ops.h>
-#pragma clang diagnostic pop
+#include "ReductionUtils.h"
 #endif  // NN_INCLUDE_CPU_IMPLEMENTATION
 
 namespace android {
@@ -41,23 +37,17 @@ namespace reduce {
 #ifdef NN_INCLUDE_CPU_IMPLEMENTATION
 namespace {
 
-template <typename T>
-inline bool compute(IOperationExecutionContext* context, T init, T func(T, T)) {
+template <typename T, typename ReduceFn>
+inline bool compute(IOperationExecutionContext* context, T init, ReduceFn func) {
+    NNTRACE_COMP("reduceAxes");
     const Shape inputShape = context->getInputShape(kInputTensor);
-    const Shape axesShape = context->getInputShape(kInputAxes);
-    const Shape outputShape = context->getOutputShape(kOutputTensor);
-    const uint32_t inputRank = getNumberOfDimensions(inputShape);
-    const uint32_t numAxes = getNumberOfElements(axesShape);
-    std::vector<int> tempIndex(inputShape.dimensions.size());
-    std::vector<int> tempAxes(numAxes);
-    return tflite::reference_ops::ReduceGeneric<T>(
-            context->getInputBuffer<T>(kInputTensor),
-            reinterpret_cast<const int32_t*>(inputShape.dimensions.data()), inputRank,
-            context->getOutputBuffer<T>(kOutputTensor),
-            reinterpret_cast<const int32_t*>(outputShape.dimensions.data()),
-            outputShape.dimensions.size(), context->getInputBuffer<int32_t>(kInputAxes), numAxes,
-            context->getInputValue<bool8>(kInputKeepDims), tempIndex.data(), tempAxes.data(), init,
-            func);
+    std::vector<bool> shouldReduce;
+    NN_RET_CHECK(getReducedAxes(context->getInputBuffer<int32_t>(kInputAxes),
+                                getNumberOfElements(context->getInputShape(kInputAxes)),
+                                getNumberOfDimensions(inputShape), &shouldReduce));
+    reduceAxes(context->getInputBuffer<T>(kInputTensor), inputShape, shouldReduce, init, func,
+               context->getOutputBuffer<T>(kOutputTensor), context->getRuyContext());
+    return true;
 }
 
 }  // namespace
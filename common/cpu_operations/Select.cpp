@@ -18,7 +18,9 @@
 
 #include "Select.h"
 
-#include "IndexedShapeWrapper.h"
+#include <limits>
+#include <type_traits>
+
 #include "OperationResolver.h"
 #include "OperationsExecutionUtils.h"
 
@@ -33,16 +35,18 @@ bool compute(const bool8* conditionData, const Shape& conditionShape, const T* a
              const Shape& outputShape) {
     // The code assumes that condition has the same shape as all other tensors.
     // This should be checked during preparation stage.
-    uint32_t size = getNumberOfElements(conditionShape);
-    for (uint32_t i = 0; i < size; ++i) {
-        T a = aData[i];
-        T b = bData[i];
-
-        if constexpr (std::is_same_v<T, uint8_t> || std::is_same_v<T, int8_t>) {
-            a = requantize<T>(a, aShape, outputShape);
-            b = requantize<T>(b, bShape, outputShape);
+    const uint32_t size = getNumberOfElements(conditionShape);
+    if constexpr (std::is_same_v<T, uint8_t> || std::is_same_v<T, int8_t>) {
+        constexpr int32_t kMin = std::numeric_limits<T>::min();
+        const auto aTable = makeRequantizeTable<T>(aShape, outputShape);
+        const auto bTable = makeRequantizeTable<T>(bShape, outputShape);
+        for (uint32_t i = 0; i < size; ++i) {
+            outputData[i] = conditionData[i] ? aTable[aData[i] - kMin] : bTable[bData[i] - kMin];
+        }
+    } else {
+        for (uint32_t i = 0; i < size; ++i) {
+            outputData[i] = conditionData[i] ? aData[i] : bData[i];
         }
-        outputData[i] = conditionData[i] ? a : b;
     }
     return true;
 }
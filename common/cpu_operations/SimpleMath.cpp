@@ -30,6 +30,7 @@
 
 #include "CpuOperationUtils.h"
 #include "Operations.h"
+#include "ReductionUtils.h"
 #include "SimpleMath.h"
 #include "Tracing.h"
 
@@ -38,59 +39,55 @@ namespace nn {
 
 bool meanFloat16(_Float16* inputData, const Shape& inputShape, const int32_t* axis,
                  const Shape& axisShape, bool keepDims, _Float16* outputData,
-                 const Shape& outputShape) {
+                 const Shape& outputShape, ruy::Context* ruyContext) {
     NNTRACE_TRANS("meanFloat16");
     std::vector<float> inputDataFloat32(getNumberOfElements(inputShape));
     convertFloat16ToFloat32(inputData, &inputDataFloat32);
 
     std::vector<float> outputDataFloat32(getNumberOfElements(outputShape));
     meanGeneric<float, float>(inputDataFloat32.data(), inputShape, axis, axisShape, keepDims,
-                              outputDataFloat32.data(), outputShape);
+                              outputDataFloat32.data(), outputShape, ruyContext);
     convertFloat32ToFloat16(outputDataFloat32, outputData);
     return true;
 }
 
 template <typename T, typename U>
 bool meanGeneric(T* inputData, const Shape& inputShape, const int32_t* axis, const Shape& axisShape,
-                 bool keepDims, T* outputData, const Shape& outputShape) {
+                 bool /*keepDims*/, T* outputData, const Shape& outputShape,
+                 ruy::Context* ruyContext) {
     NNTRACE_TRANS("meanGeneric");
-    // Creates a temp index to iterate through input data.
-    int32_t* scratchBuffer = new int32_t[getNumberOfDimensions(inputShape)];
-
-    // Creates a temp tensor to store resolved axis given input data.
-    int32_t axisSize = static_cast<int32_t>(getSizeOfDimension(axisShape, 0));
-    int32_t* resolvedAxis = new int32_t[axisSize];
+    std::vector<bool> shouldReduce;
+    NN_RET_CHECK(getReducedAxes(axis, getSizeOfDimension(axisShape, 0),
+                                getNumberOfDimensions(inputShape), &shouldReduce));
+    uint32_t numReduced = 1;
+    for (uint32_t i = 0; i < getNumberOfDimensions(inputShape); ++i) {
+        if (shouldReduce[i]) numReduced *= getSizeOfDimension(inputShape, i);
+    }
 
-    bool result = true;
-    U* tempSumBuffer = new (std::nothrow) U[getNumberOfElements(outputShape)];
-    if (!tempSumBuffer) {
-        LOG(ERROR) << "Failed to allocate tempSumBuffer for MEAN";
-        result = false;
-    } else {
-        NNTRACE_COMP_SWITCH("optimized_ops::Mean");
-        tflite::reference_ops::Mean<T, U>(
-                inputData, reinterpret_cast<const int*>(inputShape.dimensions.data()),
-                getNumberOfDimensions(inputShape), outputData,
-                reinterpret_cast<const int*>(outputShape.dimensions.data()),
-                getNumberOfDimensions(outputShape), axis, axisSize, keepDims, scratchBuffer,
-                resolvedAxis, tempSumBuffer);
-        delete[] tempSumBuffer;
+    const uint32_t numOutputs = getNumberOfElements(outputShape);
+    std::vector<U> sums(numOutputs);
+    NNTRACE_COMP_SWITCH("reduceAxes");
+    reduceAxes(inputData, inputShape, shouldReduce, U(),
+               [](U sum, T value) { return sum + static_cast<U>(value); }, sums.data(),
+               ruyContext);
+    // Matches the truncating division of tflite::reference_ops::Mean for quantized types.
+    for (uint32_t i = 0; i < numOutputs; ++i) {
+        outputData[i] = numReduced > 0 ? static_cast<T>(sums[i] / static_cast<U>(numReduced)) : T();
     }
-    delete[] scratchBuffer;
-    delete[] resolvedAxis;
-    return result;
+    return true;
 }
 template bool meanGeneric<float, float>(float* inputData, const Shape& inputShape,
                                         const int32_t* axis, const Shape& axisShape, bool keepDims,
-                                        float* outputData, const Shape& outputShape);
+                                        float* outputData, const Shape& outputShape,
+                                        ruy::Context* ruyContext);
 template bool meanGeneric<uint8_t, int32_t>(uint8_t* inputData, const Shape& inputShape,
                                             const int32_t* axis, const Shape& axisShape,
                                             bool keepDims, uint8_t* outputData,
-                                            const Shape& outputShape);
+                                            const Shape& outputShape, ruy::Context* ruyContext);
 template bool meanGeneric<int8_t, int32_t>(int8_t* inputData, const Shape& inputShape,
                                            const int32_t* axis, const Shape& axisShape,
                                            bool keepDims, int8_t* outputData,
-                                           const Shape& outputShape);
+                                           const Shape& outputShape, ruy::Context* ruyContext);
 
 }  // namespace nn
 }  // namespace android
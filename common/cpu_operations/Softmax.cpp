@@ -37,6 +37,7 @@
 #pragma clang diagnostic pop
 
 #include "CpuOperationUtils.h"
+#include "ElementwiseMath.h"
 #endif  // NN_INCLUDE_CPU_IMPLEMENTATION
 
 namespace android {
@@ -47,40 +48,70 @@ namespace softmax {
 #ifdef NN_INCLUDE_CPU_IMPLEMENTATION
 namespace {
 
-inline bool softmaxSlowFloat32(const float* inputData, const Shape& inputShape, const float beta,
-                               int32_t axis, float* outputData, const Shape& /*outputShape*/) {
-    NNTRACE_TRANS("softmaxFloatSlow32");
+// Number of consecutive inner positions that are processed together when the axis is not the
+// innermost dimension.
+constexpr uint32_t kAxisBlockSize = 64;
+
+// Softmax along a non-innermost axis, with a running max and sum per inner position. The values
+// are widened to float a row at a time, and the exponentials are computed with the vectorized
+// kernel.
+template <typename T>
+void softmaxAxisBlock(const T* input, float beta, uint32_t axisSize, uint32_t innerSize,
+                      uint32_t numLanes, T* output) {
+    float maxValues[kAxisBlockSize];
+    std::fill_n(maxValues, numLanes, -FLT_MAX);
+    for (uint32_t a = 0; a < axisSize; ++a) {
+        const T* row = input + a * innerSize;
+        for (uint32_t j = 0; j < numLanes; ++j) {
+            maxValues[j] = std::max(maxValues[j], static_cast<float>(row[j]));
+        }
+    }
+    float diffs[kAxisBlockSize];
+    float exps[kAxisBlockSize];
+    float sums[kAxisBlockSize];
+    std::fill_n(sums, numLanes, 0.0f);
+    for (uint32_t a = 0; a < axisSize; ++a) {
+        const T* row = input + a * innerSize;
+        for (uint32_t j = 0; j < numLanes; ++j) {
+            diffs[j] = (static_cast<float>(row[j]) - maxValues[j]) * beta;
+        }
+        elementwise_math::apply<elementwise_math::ExpKernel>(diffs, exps, numLanes);
+        for (uint32_t j = 0; j < numLanes; ++j) {
+            sums[j] += exps[j];
+        }
+    }
+    for (uint32_t a = 0; a < axisSize; ++a) {
+        const T* row = input + a * innerSize;
+        T* outputRow = output + a * innerSize;
+        for (uint32_t j = 0; j < numLanes; ++j) {
+            diffs[j] = (static_cast<float>(row[j]) - maxValues[j]) * beta;
+        }
+        elementwise_math::apply<elementwise_math::ExpKernel>(diffs, exps, numLanes);
+        for (uint32_t j = 0; j < numLanes; ++j) {
+            outputRow[j] = static_cast<T>(exps[j] / sums[j]);
+        }
+    }
+}
+
+template <typename T>
+bool softmaxAxis(const T* inputData, const Shape& inputShape, const float beta, int32_t axis,
+                 T* outputData, ruy::Context* ruyContext) {
+    NNTRACE_TRANS("softmaxAxis");
     const uint32_t outerSize = getNumberOfElements(inputShape, 0, axis);
     const uint32_t axisSize = getSizeOfDimension(inputShape, axis);
     const uint32_t innerSize =
             getNumberOfElements(inputShape, axis + 1, getNumberOfDimensions(inputShape));
-    for (uint32_t outer = 0; outer < outerSize; ++outer) {
-        const float* inputBeg = inputData + outer * axisSize * innerSize;
-        const float* inputEnd = inputBeg + axisSize * innerSize;
-        float* outputBeg = outputData + outer * axisSize * innerSize;
-        for (uint32_t inner = 0; inner < innerSize; ++inner, ++inputBeg, ++inputEnd, ++outputBeg) {
-            // Find max
-            float maxValue = -FLT_MAX;
-            for (const float* p = inputBeg; p < inputEnd; p += innerSize) {
-                maxValue = std::max(maxValue, *p);
-            }
-            // Compute sum
-            float sum = 0.0f;
-            for (const float* p = inputBeg; p < inputEnd; p += innerSize) {
-                sum += std::exp((*p - maxValue) * beta);
-            }
-            // Compute result
-            float* pOut = outputBeg;
-            for (const float* p = inputBeg; p < inputEnd; p += innerSize, pOut += innerSize) {
-                *pOut = std::exp((*p - maxValue) * beta) / sum;
-            }
-        }
-    }
+    parallelForAxisBlocks(ruyContext, outerSize, axisSize, innerSize, kAxisBlockSize,
+                          [&](uint32_t outer, uint32_t innerBegin, uint32_t innerEnd) {
+                              const uint32_t offset = outer * axisSize * innerSize + innerBegin;
+                              softmaxAxisBlock(inputData + offset, beta, axisSize, innerSize,
+                                               innerEnd - innerBegin, outputData + offset);
+                          });
     return true;
 }
 
 bool softmaxFloat32(const float* inputData, const Shape& inputShape, const float beta, int32_t axis,
-                    float* outputData, const Shape& outputShape) {
+                    float* outputData, const Shape& outputShape, ruy::Context* ruyContext) {
     int32_t ndim = getNumberOfDimensions(inputShape);
     NN_CHECK(handleNegativeAxis(inputShape, &axis));
     // TFLite optimized implementation only supports computation along the last axis
@@ -91,29 +122,33 @@ bool softmaxFloat32(const float* inputData, const Shape& inputShape, const float
                                        convertShapeToTflshape(outputShape), outputData);
         return true;
     } else {
-        return softmaxSlowFloat32(inputData, inputShape, beta, axis, outputData, outputShape);
+        return softmaxAxis(inputData, inputShape, beta, axis, outputData, ruyContext);
     }
 }
 
 bool softmaxFloat16(const _Float16* inputData, const Shape& inputShape, const float beta,
-                    int32_t axis, _Float16* outputData, const Shape& outputShape) {
+                    int32_t axis, _Float16* outputData, const Shape& outputShape,
+                    ruy::Context* ruyContext) {
+    NN_CHECK(handleNegativeAxis(inputShape, &axis));
+    if (axis != static_cast<int32_t>(getNumberOfDimensions(inputShape)) - 1) {
+        return softmaxAxis(inputData, inputShape, beta, axis, outputData, ruyContext);
+    }
     NNTRACE_TRANS("softmaxFloat16");
     std::vector<float> inputData_float32(getNumberOfElements(inputShape));
     convertFloat16ToFloat32(inputData, &inputData_float32);
     std::vector<float> outputData_float32(getNumberOfElements(outputShape));
 
     softmaxFloat32(inputData_float32.data(), inputShape, beta, axis, outputData_float32.data(),
-                   outputShape);
+                   outputShape, ruyContext);
     convertFloat32ToFloat16(outputData_float32, outputData);
 
     return true;
 }
 
 template <typename T>
-bool softmaxQuant8Impl(const T* inputData, const Shape& inputShape, const float /*beta*/,
-                       int32_t axis, int32_t inputMultiplier, int32_t inputLeftShift, float diffMin,
-                       T* outputData, const Shape& /*outputShape*/) {
-    NNTRACE_TRANS("softmaxQuant8");
+void softmaxQuant8Block(const T* input, uint32_t axisSize, uint32_t innerSize, uint32_t numLanes,
+                        int32_t inputMultiplier, int32_t inputLeftShift, float diffMin,
+                        T* output) {
     // The representation chosen for the input to the exp() function is Q5.26.
     // We need to leave extra space since values that we skip might be as large as
     // -32 before multiplying by input_beta_multiplier, and therefore as large as
@@ -124,81 +159,102 @@ bool softmaxQuant8Impl(const T* inputData, const Shape& inputShape, const float
     using FixedPointScaledDiff = gemmlowp::FixedPoint<int32_t, kScaledDiffIntegerBits>;
     using FixedPointAccum = gemmlowp::FixedPoint<int32_t, kAccumulationIntegerBits>;
     using FixedPoint0 = gemmlowp::FixedPoint<int32_t, 0>;
+    constexpr int32_t q_min = std::numeric_limits<T>::min();
+    constexpr int32_t q_max = std::numeric_limits<T>::max();
+
+    // Find max
+    T maxValues[kAxisBlockSize];
+    std::fill_n(maxValues, numLanes, std::numeric_limits<T>::min());
+    for (uint32_t a = 0; a < axisSize; ++a) {
+        const T* row = input + a * innerSize;
+        for (uint32_t j = 0; j < numLanes; ++j) {
+            maxValues[j] = std::max(maxValues[j], row[j]);
+        }
+    }
 
-    const uint32_t outerSize = getNumberOfElements(inputShape, 0, axis);
-    const uint32_t axisSize = getSizeOfDimension(inputShape, axis);
-    const uint32_t innerSize =
-            getNumberOfElements(inputShape, axis + 1, getNumberOfDimensions(inputShape));
-    for (uint32_t outer = 0; outer < outerSize; ++outer) {
-        const T* inputBeg = inputData + outer * axisSize * innerSize;
-        const T* inputEnd = inputBeg + axisSize * innerSize;
-        T* outputBeg = outputData + outer * axisSize * innerSize;
-        for (uint32_t inner = 0; inner < innerSize; ++inner, ++inputBeg, ++inputEnd, ++outputBeg) {
-            // Find max
-            T maxValue = std::is_same_v<T, int8_t> ? -128 : 0;
-            for (const T* p = inputBeg; p < inputEnd; p += innerSize) {
-                maxValue = std::max(maxValue, *p);
-            }
-
-            // Compute sum
-            FixedPointAccum sum_of_exps = FixedPointAccum::Zero();
-            for (const T* p = inputBeg; p < inputEnd; p += innerSize) {
-                int32_t input_diff = static_cast<int32_t>(*p) - maxValue;
-                if (input_diff >= diffMin) {
-                    const int32_t input_diff_rescaled =
-                            tflite::MultiplyByQuantizedMultiplierGreaterThanOne(
-                                    input_diff, inputMultiplier, inputLeftShift);
-                    const auto scaled_diff_f8 = FixedPointScaledDiff::FromRaw(input_diff_rescaled);
-                    sum_of_exps = sum_of_exps + gemmlowp::Rescale<kAccumulationIntegerBits>(
+    // Compute sum
+    FixedPointAccum sumsOfExps[kAxisBlockSize];
+    std::fill_n(sumsOfExps, numLanes, FixedPointAccum::Zero());
+    for (uint32_t a = 0; a < axisSize; ++a) {
+        const T* row = input + a * innerSize;
+        for (uint32_t j = 0; j < numLanes; ++j) {
+            int32_t input_diff = static_cast<int32_t>(row[j]) - maxValues[j];
+            if (input_diff >= diffMin) {
+                const int32_t input_diff_rescaled =
+                        tflite::MultiplyByQuantizedMultiplierGreaterThanOne(
+                                input_diff, inputMultiplier, inputLeftShift);
+                const auto scaled_diff_f8 = FixedPointScaledDiff::FromRaw(input_diff_rescaled);
+                sumsOfExps[j] = sumsOfExps[j] + gemmlowp::Rescale<kAccumulationIntegerBits>(
                                                         exp_on_negative_values(scaled_diff_f8));
-                }
             }
+        }
+    }
+
+    FixedPoint0 shiftedScales[kAxisBlockSize];
+    int32_t numBitsOverUnit[kAxisBlockSize];
+    for (uint32_t j = 0; j < numLanes; ++j) {
+        uint32_t fixed_sum_of_exps = static_cast<uint32_t>(sumsOfExps[j].raw());
+        int32_t headroom_plus_one = tflite::CountLeadingZeros(fixed_sum_of_exps);
+        // This is the number of bits to the left of the binary point above 1.0.
+        // Consider fixed_sum_of_exps=1.25.  In that case shifted_scale=0.8 and
+        // no later adjustment will be needed.
+        numBitsOverUnit[j] = kAccumulationIntegerBits - headroom_plus_one;
+        int32_t shifted_sum_minus_one = static_cast<int32_t>(
+                (fixed_sum_of_exps << headroom_plus_one) - (static_cast<uint32_t>(1) << 31));
+        shiftedScales[j] = gemmlowp::one_over_one_plus_x_for_x_in_0_1(
+                FixedPoint0::FromRaw(shifted_sum_minus_one));
+    }
 
-            uint32_t fixed_sum_of_exps = static_cast<uint32_t>(sum_of_exps.raw());
-            int32_t headroom_plus_one = tflite::CountLeadingZeros(fixed_sum_of_exps);
-            // This is the number of bits to the left of the binary point above 1.0.
-            // Consider fixed_sum_of_exps=1.25.  In that case shifted_scale=0.8 and
-            // no later adjustment will be needed.
-            int32_t num_bits_over_unit = kAccumulationIntegerBits - headroom_plus_one;
-            int32_t shifted_sum_minus_one = static_cast<int32_t>(
-                    (fixed_sum_of_exps << headroom_plus_one) - (static_cast<uint32_t>(1) << 31));
-
-            FixedPoint0 shifted_scale = gemmlowp::one_over_one_plus_x_for_x_in_0_1(
-                    FixedPoint0::FromRaw(shifted_sum_minus_one));
-
-            // Compute result
-            constexpr int32_t q_min = std::numeric_limits<T>::min();
-            constexpr int32_t q_max = std::numeric_limits<T>::max();
-            T* pOut = outputBeg;
-            for (const T* p = inputBeg; p < inputEnd; p += innerSize, pOut += innerSize) {
-                int32_t input_diff = static_cast<int32_t>(*p) - maxValue;
-                if (input_diff >= diffMin) {
-                    const int32_t input_diff_rescaled =
-                            tflite::MultiplyByQuantizedMultiplierGreaterThanOne(
-                                    input_diff, inputMultiplier, inputLeftShift);
-                    const auto scaled_diff_f8 = FixedPointScaledDiff::FromRaw(input_diff_rescaled);
-
-                    FixedPoint0 exp_in_0 = exp_on_negative_values(scaled_diff_f8);
-                    int32_t unsat_output = gemmlowp::RoundingDivideByPOT(
-                            (shifted_scale * exp_in_0).raw(), num_bits_over_unit + 31 - 8);
-                    if (std::is_same_v<T, int8_t>) {
-                        unsat_output -= 128;
-                    }
-
-                    *pOut = static_cast<T>(std::max(std::min(unsat_output, q_max), q_min));
-
-                } else {
-                    *pOut = std::is_same_v<T, int8_t> ? -128 : 0;
+    // Compute result
+    for (uint32_t a = 0; a < axisSize; ++a) {
+        const T* row = input + a * innerSize;
+        T* outputRow = output + a * innerSize;
+        for (uint32_t j = 0; j < numLanes; ++j) {
+            int32_t input_diff = static_cast<int32_t>(row[j]) - maxValues[j];
+            if (input_diff >= diffMin) {
+                const int32_t input_diff_rescaled =
+                        tflite::MultiplyByQuantizedMultiplierGreaterThanOne(
+                                input_diff, inputMultiplier, inputLeftShift);
+                const auto scaled_diff_f8 = FixedPointScaledDiff::FromRaw(input_diff_rescaled);
+
+                FixedPoint0 exp_in_0 = exp_on_negative_values(scaled_diff_f8);
+                int32_t unsat_output = gemmlowp::RoundingDivideByPOT(
+                        (shiftedScales[j] * exp_in_0).raw(), numBitsOverUnit[j] + 31 - 8);
+                if (std::is_same_v<T, int8_t>) {
+                    unsat_output -= 128;
                 }
+
+                outputRow[j] = static_cast<T>(std::max(std::min(unsat_output, q_max), q_min));
+
+            } else {
+                outputRow[j] = std::is_same_v<T, int8_t> ? -128 : 0;
             }
         }
     }
+}
+
+template <typename T>
+bool softmaxQuant8Impl(const T* inputData, const Shape& inputShape, const float /*beta*/,
+                       int32_t axis, int32_t inputMultiplier, int32_t inputLeftShift, float diffMin,
+                       T* outputData, const Shape& /*outputShape*/, ruy::Context* ruyContext) {
+    NNTRACE_TRANS("softmaxQuant8");
+    const uint32_t outerSize = getNumberOfElements(inputShape, 0, axis);
+    const uint32_t axisSize = getSizeOfDimension(inputShape, axis);
+    const uint32_t innerSize =
+            getNumberOfElements(inputShape, axis + 1, getNumberOfDimensions(inputShape));
+    parallelForAxisBlocks(ruyContext, outerSize, axisSize, innerSize, kAxisBlockSize,
+                          [&](uint32_t outer, uint32_t innerBegin, uint32_t innerEnd) {
+                              const uint32_t offset = outer * axisSize * innerSize + innerBegin;
+                              softmaxQuant8Block(inputData + offset, axisSize, innerSize,
+                                                 innerEnd - innerBegin, inputMultiplier,
+                                                 inputLeftShift, diffMin, outputData + offset);
+                          });
     return true;
 }
 
 template <typename T>
 bool softmaxQuant8(const T* inputData, const Shape& inputShape, const float beta, int32_t axis,
-                   T* outputData, const Shape& outputShape) {
+                   T* outputData, const Shape& outputShape, ruy::Context* ruyContext) {
     [[maybe_unused]] int32_t ndim = getNumberOfDimensions(inputShape);
     NN_CHECK(handleNegativeAxis(inputShape, &axis));
 
@@ -223,7 +279,7 @@ bool softmaxQuant8(const T* inputData, const Shape& inputShape, const float beta
     int32_t diffMin = -CalculateInputRadius(kScaledDiffIntegerBits, inputLeftShift);
 
     return softmaxQuant8Impl(inputData, inputShape, beta, axis, inputMultiplier, inputLeftShift,
-                             diffMin, outputData, outputShape);
+                             diffMin, outputData, outputShape, ruyContext);
 }
 
 }  // namespace
@@ -252,25 +308,29 @@ bool execute(IOperationExecutionContext* context) {
                                   context->getInputShape(kInputTensor),
                                   context->getInputValue<_Float16>(kBetaScalar), axis,
                                   context->getOutputBuffer<_Float16>(kOutputTensor),
-                                  context->getOutputShape(kOutputTensor));
+                                  context->getOutputShape(kOutputTensor),
+                                  context->getRuyContext());
         case OperandType::TENSOR_FLOAT32:
             return softmaxFloat32(context->getInputBuffer<float>(kInputTensor),
                                   context->getInputShape(kInputTensor),
                                   context->getInputValue<float>(kBetaScalar), axis,
                                   context->getOutputBuffer<float>(kOutputTensor),
-                                  context->getOutputShape(kOutputTensor));
+                                  context->getOutputShape(kOutputTensor),
+                                  context->getRuyContext());
         case OperandType::TENSOR_QUANT8_ASYMM:
             return softmaxQuant8(context->getInputBuffer<uint8_t>(kInputTensor),
                                  context->getInputShape(kInputTensor),
                                  context->getInputValue<float>(kBetaScalar), axis,
                                  context->getOutputBuffer<uint8_t>(kOutputTensor),
-                                 context->getOutputShape(kOutputTensor));
+                                 context->getOutputShape(kOutputTensor),
+                                 context->getRuyContext());
         case OperandType::TENSOR_QUANT8_ASYMM_SIGNED:
             return softmaxQuant8(context->getInputBuffer<int8_t>(kInputTensor),
                                  context->getInputShape(kInputTensor),
                                  context->getInputValue<float>(kBetaScalar), axis,
                                  context->getOutputBuffer<int8_t>(kOutputTensor),
-                                 context->getOutputShape(kOutputTensor));
+                                 context->getOutputShape(kOutputTensor),
+                                 context->getRuyContext());
         default:
             NN_RET_CHECK_FAIL() << "Unsupported tensor type for operation " << kOperationName;
     }
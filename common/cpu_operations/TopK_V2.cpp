@@ -19,39 +19,113 @@
 #include "TopK_V2.h"
 
 #include <algorithm>
+#include <functional>
+#include <numeric>
 #include <utility>
 #include <vector>
 
 #include "OperationResolver.h"
 #include "OperationsExecutionUtils.h"
 
+#ifdef NN_INCLUDE_CPU_IMPLEMENTATION
+#include "CpuOperationUtils.h"
+#endif  // NN_INCLUDE_CPU_IMPLEMENTATION
+
 namespace android {
 namespace nn {
 namespace topk_v2 {
 namespace {
 
+// Rows at least this many times longer than k use the bounded heap.
+constexpr int kMinRowSizePerKForHeap = 8;
+
+// Number of values compared against the heap threshold at once.
+constexpr int kFilterBlockSize = 16;
+
+// Both strategies return the k largest values in descending order, with equal values ordered by
+// descending index, i.e. in descending (value, index) order.
+
+// Keeps the k best (value, index) pairs seen so far in a min-heap. As indices only increase along
+// the row, a value equal to the worst one kept also replaces it. Blocks of values that are all
+// below the worst kept value are skipped with a single vectorizable comparison pass.
 template <typename T>
-bool evalGeneric(const T* inputData, const Shape& inputShape, const int32_t k, T* valuesData,
-                 int32_t* indicesData) {
-    const int rowSize = inputShape.dimensions.back();
-    const int totalSize = getNumberOfElements(inputShape);
-    std::vector<std::pair<T, int32_t>> values(rowSize);
-    T* curOutputValue = valuesData;
-    int32_t* curOutputIndex = indicesData;
-    for (int rowBegin = 0; rowBegin < totalSize; rowBegin += rowSize) {
-        for (int i = 0; i < rowSize; ++i) {
-            values[i] = std::make_pair(inputData[rowBegin + i], i);
+void topKWithHeap(const T* row, int rowSize, int k, std::vector<std::pair<T, int32_t>>* heap,
+                  T* outputValues, int32_t* outputIndices) {
+    heap->clear();
+    for (int i = 0; i < k; ++i) {
+        heap->emplace_back(row[i], i);
+    }
+    std::make_heap(heap->begin(), heap->end(), std::greater<>());
+    int i = k;
+    while (i < rowSize) {
+        const T threshold = heap->front().first;
+        if (i + kFilterBlockSize <= rowSize) {
+            bool anyCandidate = false;
+            for (int j = 0; j < kFilterBlockSize; ++j) {
+                anyCandidate |= !(row[i + j] < threshold);
+            }
+            if (!anyCandidate) {
+                i += kFilterBlockSize;
+                continue;
+            }
         }
-        std::nth_element(values.begin(), values.begin() + (rowSize - k), values.end());
-        std::sort(values.begin() + (rowSize - k), values.end());
-        std::reverse(values.begin(), values.end());
-        for (int i = 0; i < k; ++i) {
-            *curOutputValue = values[i].first;
-            *curOutputIndex = values[i].second;
-            curOutputValue++;
-            curOutputIndex++;
+        for (const int blockEnd = std::min(i + kFilterBlockSize, rowSize); i < blockEnd; ++i) {
+            if (!(row[i] < heap->front().first)) {
+                std::pop_heap(heap->begin(), heap->end(), std::greater<>());
+                heap->back() = std::make_pair(row[i], i);
+                std::push_heap(heap->begin(), heap->end(), std::greater<>());
+            }
         }
     }
+    std::sort_heap(heap->begin(), heap->end(), std::greater<>());
+    for (int j = 0; j < k; ++j) {
+        outputValues[j] = (*heap)[j].first;
+        outputIndices[j] = (*heap)[j].second;
+    }
+}
+
+// Partially sorts the indices of the row by value, for k close to the row size.
+template <typename T>
+void topKWithSelection(const T* row, int rowSize, int k, std::vector<int32_t>* indices,
+                       T* outputValues, int32_t* outputIndices) {
+    indices->resize(rowSize);
+    std::iota(indices->begin(), indices->end(), 0);
+    const auto ranksBefore = [row](int32_t a, int32_t b) {
+        return row[a] > row[b] || (row[a] == row[b] && a > b);
+    };
+    std::nth_element(indices->begin(), indices->begin() + (k - 1), indices->end(), ranksBefore);
+    std::sort(indices->begin(), indices->begin() + k, ranksBefore);
+    for (int j = 0; j < k; ++j) {
+        outputValues[j] = row[(*indices)[j]];
+        outputIndices[j] = (*indices)[j];
+    }
+}
+
+template <typename T>
+bool evalGeneric(const T* inputData, const Shape& inputShape, const int32_t k, T* valuesData,
+                 int32_t* indicesData, [[maybe_unused]] IOperationExecutionContext* context) {
+    const int rowSize = inputShape.dimensions.back();
+    const uint32_t numRows = getNumberOfElements(inputShape) / rowSize;
+    const bool useHeap = rowSize / kMinRowSizePerKForHeap >= k;
+    const auto computeRows = [&](uint32_t begin, uint32_t end) {
+        std::vector<std::pair<T, int32_t>> heap;
+        std::vector<int32_t> indices;
+        for (uint32_t r = begin; r < end; ++r) {
+            if (useHeap) {
+                topKWithHeap(inputData + r * rowSize, rowSize, k, &heap, valuesData + r * k,
+                             indicesData + r * k);
+            } else {
+                topKWithSelection(inputData + r * rowSize, rowSize, k, &indices,
+                                  valuesData + r * k, indicesData + r * k);
+            }
+        }
+    };
+#ifdef NN_INCLUDE_CPU_IMPLEMENTATION
+    parallelFor(context->getRuyContext(), numRows,
+                std::max(kMinElementsPerTask / rowSize, 1u), computeRows);
+#else   // NN_INCLUDE_CPU_IMPLEMENTATION
+    computeRows(0, numRows);
+#endif  // NN_INCLUDE_CPU_IMPLEMENTATION
     return true;
 }
 
@@ -61,7 +135,7 @@ bool executeTyped(IOperationExecutionContext* context) {
                        context->getInputShape(kInputTensor),
                        context->getInputValue<int32_t>(kTopKScalar),
                        context->getOutputBuffer<T>(kOutputValuesTensor),
-                       context->getOutputBuffer<int32_t>(kOutputIndicesTensor));
+                       context->getOutputBuffer<int32_t>(kOutputIndicesTensor), context);
 }
 
 }  // namespace
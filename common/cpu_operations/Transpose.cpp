@@ -18,20 +18,13 @@
 
 #include "Transpose.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "OperationResolver.h"
 #include "Tracing.h"
 
 #ifdef NN_INCLUDE_CPU_IMPLEMENTATION
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wunused-parameter"
-#pragma clang diagnostic ignored "-Wsign-compare"
-#pragma clang diagnostic ignored "-Winvalid-partial-specialization"
-#include <tensorflow/lite/kernels/internal/optimized/legacy_optimized_ops.h>
-#include <tensorflow/lite/kernels/internal/reference/reference_ops.h>
-#pragma clang diagnostic pop
-
 #include "CpuOperationUtils.h"
 #endif  // NN_INCLUDE_CPU_IMPLEMENTATION
 
@@ -42,30 +35,173 @@ namespace transpose {
 #ifdef NN_INCLUDE_CPU_IMPLEMENTATION
 namespace {
 
+// Side of the square tiles of 2-D transposes.
+constexpr uint32_t kTileSize = 8;
+
+// A transpose as a walk over the output axes, each reading the input at a given stride.
+struct TransposeAxes {
+    std::vector<uint32_t> sizes;
+    std::vector<uint32_t> inputStrides;
+    std::vector<uint32_t> outputStrides;
+};
+
+// Drops the axes of size 1 and merges the output axes that read adjacent input axes in order, so
+// that e.g. NCHW to NHWC becomes the 2-D transpose of [C, H * W] matrices, batched over N.
+TransposeAxes collapseTransposeAxes(const Shape& inputShape, const int32_t* perm, uint32_t rank) {
+    std::vector<int32_t> compactAxis(rank, -1);
+    std::vector<uint32_t> compactSizes;
+    for (uint32_t i = 0; i < rank; ++i) {
+        if (getSizeOfDimension(inputShape, i) > 1) {
+            compactAxis[i] = static_cast<int32_t>(compactSizes.size());
+            compactSizes.push_back(getSizeOfDimension(inputShape, i));
+        }
+    }
+    std::vector<uint32_t> compactStrides(compactSizes.size());
+    uint32_t stride = 1;
+    for (size_t i = compactSizes.size(); i-- > 0;) {
+        compactStrides[i] = stride;
+        stride *= compactSizes[i];
+    }
+
+    TransposeAxes axes;
+    int32_t previousAxis = -2;
+    for (uint32_t k = 0; k < rank; ++k) {
+        const int32_t axis = compactAxis[perm[k]];
+        if (axis < 0) continue;
+        if (axis == previousAxis + 1) {
+            axes.sizes.back() *= compactSizes[axis];
+            axes.inputStrides.back() = compactStrides[axis];
+        } else {
+            axes.sizes.push_back(compactSizes[axis]);
+            axes.inputStrides.push_back(compactStrides[axis]);
+        }
+        previousAxis = axis;
+    }
+    if (axes.sizes.empty()) {
+        axes.sizes.push_back(1);
+        axes.inputStrides.push_back(1);
+    }
+    axes.outputStrides.resize(axes.sizes.size());
+    stride = 1;
+    for (size_t k = axes.sizes.size(); k-- > 0;) {
+        axes.outputStrides[k] = stride;
+        stride *= axes.sizes[k];
+    }
+    return axes;
+}
+
+// Computes the input and output offsets of the index-th combination of the axes not in
+// [skipA, skipB], enumerated in output order.
+void getOuterOffsets(const TransposeAxes& axes, uint32_t index, size_t skipA, size_t skipB,
+                     uint32_t* inputOffset, uint32_t* outputOffset) {
+    *inputOffset = 0;
+    *outputOffset = 0;
+    for (size_t k = axes.sizes.size(); k-- > 0;) {
+        if (k == skipA || k == skipB) continue;
+        const uint32_t i = index % axes.sizes[k];
+        index /= axes.sizes[k];
+        *inputOffset += i * axes.inputStrides[k];
+        *outputOffset += i * axes.outputStrides[k];
+    }
+}
+
+// Copies src[r * srcStride + c] to dst[c * dstStride + r]. The tile is staged in a local array
+// so that full tiles, whose sizes are compile-time constants, load and store whole vectors.
+template <typename T, uint32_t kRows, uint32_t kCols>
+inline void transposeFullTile(const T* src, uint32_t srcStride, T* dst, uint32_t dstStride) {
+    T tile[kRows][kCols];
+    for (uint32_t r = 0; r < kRows; ++r) {
+        for (uint32_t c = 0; c < kCols; ++c) {
+            tile[r][c] = src[r * srcStride + c];
+        }
+    }
+    for (uint32_t c = 0; c < kCols; ++c) {
+        for (uint32_t r = 0; r < kRows; ++r) {
+            dst[c * dstStride + r] = tile[r][c];
+        }
+    }
+}
+
+template <typename T>
+inline void transposePartialTile(const T* src, uint32_t srcStride, T* dst, uint32_t dstStride,
+                                 uint32_t rows, uint32_t cols) {
+    for (uint32_t c = 0; c < cols; ++c) {
+        for (uint32_t r = 0; r < rows; ++r) {
+            dst[c * dstStride + r] = src[r * srcStride + c];
+        }
+    }
+}
+
 template <typename T>
 bool transposeGeneric(const T* inputData, const Shape& inputShape, const int32_t* perm,
-                      const Shape& permShape, T* outputData, const Shape& outputShape) {
+                      const Shape& permShape, T* outputData, const Shape& outputShape,
+                      IOperationExecutionContext* context) {
     NNTRACE_TRANS("transposeGeneric");
-    // Reverse the permuted axes and convert to 4D due to the way Dims are
-    // constructed.
-    const int32_t kOutputDimensionNum = 4;
-
     // permData can be NO_VALUE representing a regular 2D matrix transpose
-    int32_t permSize = perm == nullptr ? 2 : static_cast<int32_t>(getSizeOfDimension(permShape, 0));
-    int32_t perm_tmp[2] = {1, 0};
-    if (perm == nullptr) {
-        perm = perm_tmp;
-    }
-    int32_t reversed_perm[kOutputDimensionNum];
-    for (int32_t output_k = 0, input_k = permSize - 1; output_k < permSize; ++output_k, --input_k) {
-        reversed_perm[output_k] = permSize - perm[input_k] - 1;
-    }
-    for (int32_t k = permSize; k < kOutputDimensionNum; ++k) {
-        reversed_perm[k] = k;
+    const uint32_t permSize = perm == nullptr ? 2 : getSizeOfDimension(permShape, 0);
+    const int32_t defaultPerm[2] = {1, 0};
+    const TransposeAxes axes =
+            collapseTransposeAxes(inputShape, perm == nullptr ? defaultPerm : perm, permSize);
+    const size_t numAxes = axes.sizes.size();
+    const uint32_t numElements = getNumberOfElements(outputShape);
+    const size_t innerAxis = numAxes - 1;
+
+    if (axes.inputStrides[innerAxis] == 1) {
+        // The innermost output axis is also the innermost input one, so whole rows are copied.
+        NNTRACE_COMP_SWITCH("transposeRows");
+        const uint32_t rowSize = axes.sizes[innerAxis];
+        parallelFor(context->getRuyContext(), numElements / rowSize,
+                    std::max(kMinElementsPerTask / rowSize, 1u), [&](uint32_t begin, uint32_t end) {
+                        for (uint32_t row = begin; row < end; ++row) {
+                            uint32_t inputOffset, outputOffset;
+                            getOuterOffsets(axes, row, innerAxis, innerAxis, &inputOffset,
+                                            &outputOffset);
+                            std::copy(inputData + inputOffset, inputData + inputOffset + rowSize,
+                                      outputData + outputOffset);
+                        }
+                    });
+        return true;
     }
-    NNTRACE_COMP_SWITCH("reference_ops::Transpose");
-    tflite::reference_ops::Transpose(inputData, convertShapeToDims(inputShape), outputData,
-                                     convertShapeToDims(outputShape), reversed_perm);
+
+    // Otherwise, the innermost output axis and the output axis that reads the innermost input
+    // axis form a 2-D transpose, which is tiled so that both its reads and writes use whole
+    // cache lines. The work is split over the other axes and the strips of tiles.
+    NNTRACE_COMP_SWITCH("transposeTiled");
+    const size_t stripAxis = static_cast<size_t>(
+            std::find(axes.inputStrides.begin(), axes.inputStrides.end(), 1u) -
+            axes.inputStrides.begin());
+    const uint32_t innerSize = axes.sizes[innerAxis];
+    const uint32_t innerInputStride = axes.inputStrides[innerAxis];
+    const uint32_t stripSize = axes.sizes[stripAxis];
+    const uint32_t stripOutputStride = axes.outputStrides[stripAxis];
+    const uint32_t numStrips = (stripSize + kTileSize - 1) / kTileSize;
+    const uint32_t elementsPerStrip = kTileSize * innerSize;
+    parallelFor(
+            context->getRuyContext(), numElements / (stripSize * innerSize) * numStrips,
+            std::max(kMinElementsPerTask / elementsPerStrip, 1u),
+            [&](uint32_t begin, uint32_t end) {
+                for (uint32_t task = begin; task < end; ++task) {
+                    uint32_t inputOffset, outputOffset;
+                    getOuterOffsets(axes, task / numStrips, innerAxis, stripAxis, &inputOffset,
+                                    &outputOffset);
+                    const uint32_t stripBegin = task % numStrips * kTileSize;
+                    const uint32_t stripCount = std::min(kTileSize, stripSize - stripBegin);
+                    const T* src = inputData + inputOffset + stripBegin;
+                    T* dst = outputData + outputOffset + stripBegin * stripOutputStride;
+                    for (uint32_t i = 0; i < innerSize; i += kTileSize) {
+                        const uint32_t innerCount = std::min(kTileSize, innerSize - i);
+                        if (innerCount == kTileSize && stripCount == kTileSize) {
+                            transposeFullTile<T, kTileSize, kTileSize>(
+                                    src + i * innerInputStride, innerInputStride, dst + i,
+                                    stripOutputStride);
+                        } else {
+                            transposePartialTile(src + i * innerInputStride, innerInputStride,
+                                                 dst + i, stripOutputStride, innerCount,
+                                                 stripCount);
+                        }
+                    }
+                }
+            });
     return true;
 }
 
@@ -120,28 +256,28 @@ bool execute(IOperationExecutionContext* context) {
                                     context->getInputBuffer<int32_t>(kPermTensor),
                                     context->getInputShape(kPermTensor),
                                     context->getOutputBuffer<float>(kOutputTensor),
-                                    context->getOutputShape(kOutputTensor));
+                                    context->getOutputShape(kOutputTensor), context);
         case OperandType::TENSOR_FLOAT16:
             return transposeGeneric(context->getInputBuffer<_Float16>(kInputTensor),
                                     context->getInputShape(kInputTensor),
                                     context->getInputBuffer<int32_t>(kPermTensor),
                                     context->getInputShape(kPermTensor),
                                     context->getOutputBuffer<_Float16>(kOutputTensor),
-                                    context->getOutputShape(kOutputTensor));
+                                    context->getOutputShape(kOutputTensor), context);
         case OperandType::TENSOR_QUANT8_ASYMM:
             return transposeGeneric(context->getInputBuffer<uint8_t>(kInputTensor),
                                     context->getInputShape(kInputTensor),
                                     context->getInputBuffer<int32_t>(kPermTensor),
                                     context->getInputShape(kPermTensor),
                                     context->getOutputBuffer<uint8_t>(kOutputTensor),
-                                    context->getOutputShape(kOutputTensor));
+                                    context->getOutputShape(kOutputTensor), context);
         case OperandType::TENSOR_QUANT8_ASYMM_SIGNED:
             return transposeGeneric(context->getInputBuffer<int8_t>(kInputTensor),
                                     context->getInputShape(kInputTensor),
                                     context->getInputBuffer<int32_t>(kPermTensor),
                                     context->getInputShape(kPermTensor),
                                     context->getOutputBuffer<int8_t>(kOutputTensor),
-                                    context->getOutputShape(kOutputTensor));
+                                    context->getOutputShape(kOutputTensor), context);
         default:
             NN_RET_CHECK_FAIL() << "Unsupported tensor type for operation " << kOperationName;
     }
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures a model with a single TRANSPOSE operation. To compare two versions
+// of the kernel, run the benchmark built from each of them. On a device, set
+// debug.nn.partition to 0 so that the model runs on the CPU.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "NeuralNetworksWrapper.h"
+
+namespace android {
+namespace nn {
+namespace wrapper {
+namespace {
+
+// The arguments are the four dimensions of the input.
+void transpose(benchmark::State& state, Type type, std::vector<int32_t> perm) {
+    const std::vector<uint32_t> inputDimensions = {
+            static_cast<uint32_t>(state.range(0)), static_cast<uint32_t>(state.range(1)),
+            static_cast<uint32_t>(state.range(2)), static_cast<uint32_t>(state.range(3))};
+    std::vector<uint32_t> outputDimensions(perm.size());
+    size_t count = 1;
+    for (size_t i = 0; i < perm.size(); ++i) {
+        outputDimensions[i] = inputDimensions[perm[i]];
+        count *= inputDimensions[i];
+    }
+    const bool isQuantized = type == Type::TENSOR_QUANT8_ASYMM;
+    const float scale = isQuantized ? 0.5f : 0.0f;
+
+    const OperandType inputType(type, inputDimensions, scale);
+    const OperandType permType(Type::TENSOR_INT32, {static_cast<uint32_t>(perm.size())});
+    const OperandType outputType(type, outputDimensions, scale);
+
+    Model model;
+    const uint32_t input = model.addOperand(&inputType);
+    const uint32_t permOperand = model.addOperand(&permType);
+    const uint32_t output = model.addOperand(&outputType);
+    model.setOperandValue(permOperand, perm.data(), perm.size() * sizeof(int32_t));
+    model.addOperation(ANEURALNETWORKS_TRANSPOSE, {input, permOperand}, {output});
+    model.identifyInputsAndOutputs({input}, {output});
+    if (model.finish() != Result::NO_ERROR) {
+        state.SkipWithError("Failed to create the model");
+        return;
+    }
+
+    Compilation compilation(&model);
+    if (compilation.finish() != Result::NO_ERROR) {
+        state.SkipWithError("Failed to compile the model");
+        return;
+    }
+
+    // The values do not matter to TRANSPOSE.
+    const size_t size = (isQuantized ? 1 : sizeof(float)) * count;
+    const std::vector<uint8_t> inputData(size, 1);
+    std::vector<uint8_t> outputData(size);
+    Execution execution(&compilation);
+    if (execution.setReusable(true) != Result::NO_ERROR ||
+        execution.setInput(0, inputData.data(), inputData.size()) != Result::NO_ERROR ||
+        execution.setOutput(0, outputData.data(), outputData.size()) != Result::NO_ERROR) {
+        state.SkipWithError("Failed to create the execution");
+        return;
+    }
+    for (auto _ : state) {
+        if (execution.compute() != Result::NO_ERROR) {
+            state.SkipWithError("Failed to compute");
+            return;
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * size);
+}
+
+void transposeArguments(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({"d0", "d1", "d2", "d3"});
+    benchmark->Args({1, 56, 56, 64});
+    benchmark->Args({1, 112, 112, 32});
+    benchmark->Args({4, 32, 32, 3});
+    benchmark->Args({1, 7, 7, 1024});
+}
+
+// NHWC to NCHW, which transposes [H * W, C] matrices.
+BENCHMARK_CAPTURE(transpose, float32_0312, Type::TENSOR_FLOAT32, {0, 3, 1, 2})
+        ->Apply(transposeArguments)
+        ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(transpose, quant8_asymm_0312, Type::TENSOR_QUANT8_ASYMM, {0, 3, 1, 2})
+        ->Apply(transposeArguments)
+        ->Unit(benchmark::kMicrosecond);
+// Swaps H and W, which copies whole rows of C elements.
+BENCHMARK_CAPTURE(transpose, float32_0213, Type::TENSOR_FLOAT32, {0, 2, 1, 3})
+        ->Apply(transposeArguments)
+        ->Unit(benchmark::kMicrosecond);
+// Reverses the axes, so that no axes can be merged.
+BENCHMARK_CAPTURE(transpose, float32_3210, Type::TENSOR_FLOAT32, {3, 2, 1, 0})
+        ->Apply(transposeArguments)
+        ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+}  // namespace wrapper
+}  // namespace nn
+}  // namespace android
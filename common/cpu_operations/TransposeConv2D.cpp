@@ -21,7 +21,10 @@
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <limits>
 #include <memory>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 #include "OperationResolver.h"
@@ -30,6 +33,9 @@
 #ifdef NN_INCLUDE_CPU_IMPLEMENTATION
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wunused-parameter"
+#pragma clang diagnostic ignored "-Wsign-compare"
+#include <public/gemmlowp.h>
+#include <ruy/ruy.h>
 #include <tensorflow/lite/kernels/internal/common.h>
 #pragma clang diagnostic pop
 
@@ -43,14 +49,6 @@ namespace transpose_conv_2d {
 #ifdef NN_INCLUDE_CPU_IMPLEMENTATION
 namespace {
 
-// If possible we will use this static buffer for the tensor.
-constexpr size_t kStaticBufferSize = 1605632;
-[[maybe_unused]] char static_scratch_buffer[kStaticBufferSize];
-
-// executionMutex is used to protect concurrent access of the static_scratch_buffer.
-// std::mutex is safe for pthreads on Android.
-std::mutex executionMutex;
-
 struct TransposeConv2dParam {
     int32_t paddingLeft, paddingRight;
     int32_t paddingTop, paddingBottom;
@@ -102,66 +100,139 @@ struct TransposeConv2dParam {
     }
 };
 
-#define ANDROID_NN_TRANSPOSE_CONV_PARAMETERS                                    \
-    uint32_t numBatches = getSizeOfDimension(inputShape, 0);                    \
-    uint32_t inputHeight = getSizeOfDimension(inputShape, 1);                   \
-    uint32_t inputWidth = getSizeOfDimension(inputShape, 2);                    \
-    uint32_t inputDepth = getSizeOfDimension(inputShape, 3);                    \
-    uint32_t filterHeight = getSizeOfDimension(filterShape, 1);                 \
-    uint32_t filterWidth = getSizeOfDimension(filterShape, 2);                  \
-    uint32_t outputHeight = getSizeOfDimension(outputShape, 1);                 \
-    uint32_t outputWidth = getSizeOfDimension(outputShape, 2);                  \
-    uint32_t outputDepth = getSizeOfDimension(outputShape, 3);                  \
-    int32_t paddingLeft = param.paddingLeft;                                    \
-    [[maybe_unused]] int32_t paddingRight = param.paddingRight;                 \
-    int32_t paddingTop = param.paddingTop;                                      \
-    [[maybe_unused]] int32_t paddingBottom = param.paddingBottom;               \
-    int32_t strideWidth = param.strideWidth, strideHeight = param.strideHeight; \
-    int32_t activation = param.activation;
-
-bool transposeConvNhwc(const float* inputData, const Shape& inputShape, const float* filterData,
-                       const Shape& filterShape, const float* biasData, const Shape& /*biasShape*/,
-                       const TransposeConv2dParam& param, float* outputData,
-                       const Shape& outputShape) {
-    NNTRACE_TRANS("transposeConvFloat32");
-    ANDROID_NN_TRANSPOSE_CONV_PARAMETERS
-
-    float outputActivationMin = 0.0f, outputActivationMax = 0.0f;
-    CalculateActivationRangeFloat(activation, &outputActivationMin, &outputActivationMax);
+// Upper bound on the elements of the GEMM result held at once. Larger inputs are processed a few
+// input rows at a time.
+constexpr uint32_t kMaxColumnElements = 1 << 18;
+
+// Adds the transpose convolution of numBatches input batches to accumData, which holds the
+// zero-initialized NHWC output accumulators. For every chunk of input rows, one GEMM computes
+// the contributions of each input pixel to its filterHeight * filterWidth output pixels, and
+// col2im adds them to the outputs that are not cropped by the padding. The GEMM runs on gemmlowp
+// for uint8, which multiplies uint8 values without the int16 overflow of the ruy int8 kernels,
+// and on ruy otherwise. Both parallelize every GEMM over the threads of their context.
+template <typename T, typename AccumT>
+bool transposeConvGemm(const T* inputData, const Shape& inputShape, const T* filterData,
+                       const Shape& filterShape, const TransposeConv2dParam& param,
+                       AccumT* accumData, const Shape& outputShape,
+                       IOperationExecutionContext* context) {
+    const uint32_t numBatches = getSizeOfDimension(inputShape, 0);
+    const uint32_t inputHeight = getSizeOfDimension(inputShape, 1);
+    const uint32_t inputWidth = getSizeOfDimension(inputShape, 2);
+    const uint32_t inputDepth = getSizeOfDimension(inputShape, 3);
+    const uint32_t filterHeight = getSizeOfDimension(filterShape, 1);
+    const uint32_t filterWidth = getSizeOfDimension(filterShape, 2);
+    const uint32_t outputHeight = getSizeOfDimension(outputShape, 1);
+    const uint32_t outputWidth = getSizeOfDimension(outputShape, 2);
+    const uint32_t outputDepth = getSizeOfDimension(outputShape, 3);
+    const uint32_t filterArea = filterHeight * filterWidth;
+    const uint32_t gemmRows = filterArea * outputDepth;
+
+    // Reorders the [outputDepth, filterHeight, filterWidth, inputDepth] filter to
+    // [filterHeight, filterWidth, outputDepth, inputDepth], so that the GEMM result of every
+    // filter tap is a contiguous run of output channels.
+    std::vector<T> gemmFilter(static_cast<size_t>(gemmRows) * inputDepth);
+    for (uint32_t k = 0; k < outputDepth; k++) {
+        for (uint32_t f = 0; f < filterArea; f++) {
+            const T* filterPtr = filterData + (k * filterArea + f) * inputDepth;
+            std::copy(filterPtr, filterPtr + inputDepth,
+                      gemmFilter.begin() + (f * outputDepth + k) * inputDepth);
+        }
+    }
 
-    memset(outputData, 0, getNumberOfElements(outputShape) * sizeof(float));
+    const uint64_t rowElements = static_cast<uint64_t>(inputWidth) * gemmRows;
+    NN_RET_CHECK_LT(rowElements, 0x7fffffffu) << "ConvTranspose size is too large";
+    const uint32_t chunkRows = std::clamp<uint32_t>(
+            static_cast<uint32_t>(kMaxColumnElements / rowElements), 1u, inputHeight);
+    std::vector<AccumT> columnData(chunkRows * rowElements);
+
+    ruy::Matrix<T> lhs;
+    ruy::MakeSimpleLayout(gemmRows, inputDepth, ruy::Order::kRowMajor, lhs.mutable_layout());
+    lhs.set_data(gemmFilter.data());
+    lhs.set_zero_point(static_cast<T>(filterShape.offset));
+    ruy::Matrix<T> rhs;
+    rhs.set_zero_point(static_cast<T>(inputShape.offset));
+    ruy::Matrix<AccumT> dst;
+    dst.set_data(columnData.data());
+    // Without a multiplier, the quantized GEMM returns the raw int32 accumulators.
+    ruy::MulParams<AccumT, AccumT> mulParams;
 
-    const float* inputBase = inputData;
-    float* outputBase = outputData;
     for (uint32_t b = 0; b < numBatches; b++) {
-        for (uint32_t h = 0; h < inputHeight; h++) {
-            for (uint32_t w = 0; w < inputWidth; w++) {
-                int32_t wOutputOrigin = static_cast<int32_t>(w) * strideWidth - paddingLeft;
-                int32_t hOutputOrigin = static_cast<int32_t>(h) * strideHeight - paddingTop;
+        AccumT* accumBase = accumData + b * outputHeight * outputWidth * outputDepth;
+        for (uint32_t hBegin = 0; hBegin < inputHeight; hBegin += chunkRows) {
+            const uint32_t hEnd = std::min(hBegin + chunkRows, inputHeight);
+            const uint32_t numPixels = (hEnd - hBegin) * inputWidth;
+            const T* rhsData = inputData + (b * inputHeight + hBegin) * inputWidth * inputDepth;
+            if constexpr (std::is_same_v<T, uint8_t>) {
+                gemmlowp::MatrixMap<const uint8_t, gemmlowp::MapOrder::RowMajor> lhsMap(
+                        gemmFilter.data(), gemmRows, inputDepth);
+                gemmlowp::MatrixMap<const uint8_t, gemmlowp::MapOrder::ColMajor> rhsMap(
+                        rhsData, inputDepth, numPixels);
+                gemmlowp::MatrixMap<int32_t, gemmlowp::MapOrder::ColMajor> dstMap(
+                        columnData.data(), gemmRows, numPixels);
+                // An empty output pipeline returns the raw int32 accumulators.
+                gemmlowp::GemmWithOutputPipeline<uint8_t, int32_t,
+                                                 gemmlowp::DefaultL8R8BitDepthParams>(
+                        context->getGemmContext(), lhsMap, rhsMap, &dstMap, -filterShape.offset,
+                        -inputShape.offset, std::make_tuple());
+            } else {
+                ruy::MakeSimpleLayout(inputDepth, numPixels, ruy::Order::kColMajor,
+                                      rhs.mutable_layout());
+                rhs.set_data(rhsData);
+                ruy::MakeSimpleLayout(gemmRows, numPixels, ruy::Order::kColMajor,
+                                      dst.mutable_layout());
+                ruy::Mul(lhs, rhs, mulParams, context->getRuyContext(), &dst);
+            }
 
-                const float* filterBase = filterData;
-                for (uint32_t k = 0; k < outputDepth; k++) {
+            const AccumT* columnPtr = columnData.data();
+            for (uint32_t h = hBegin; h < hEnd; h++) {
+                const int32_t hOutputOrigin =
+                        static_cast<int32_t>(h) * param.strideHeight - param.paddingTop;
+                for (uint32_t w = 0; w < inputWidth; w++, columnPtr += gemmRows) {
+                    const int32_t wOutputOrigin =
+                            static_cast<int32_t>(w) * param.strideWidth - param.paddingLeft;
                     for (uint32_t i = 0; i < filterHeight; i++) {
-                        for (uint32_t j = 0; j < filterWidth; j++, filterBase += inputDepth) {
-                            int32_t hOutput = hOutputOrigin + static_cast<int32_t>(i);
-                            int32_t wOutput = wOutputOrigin + static_cast<int32_t>(j);
-                            if (hOutput >= 0 && hOutput < static_cast<int32_t>(outputHeight) &&
-                                wOutput >= 0 && wOutput < static_cast<int32_t>(outputWidth)) {
-                                for (uint32_t d = 0; d < inputDepth; d++) {
-                                    uint32_t outputIndex = hOutput * outputWidth * outputDepth +
-                                                           wOutput * outputDepth + k;
-                                    outputBase[outputIndex] += inputBase[d] * filterBase[d];
-                                }
+                        const int32_t hOutput = hOutputOrigin + static_cast<int32_t>(i);
+                        if (hOutput < 0 || hOutput >= static_cast<int32_t>(outputHeight)) {
+                            continue;
+                        }
+                        for (uint32_t j = 0; j < filterWidth; j++) {
+                            const int32_t wOutput = wOutputOrigin + static_cast<int32_t>(j);
+                            if (wOutput < 0 || wOutput >= static_cast<int32_t>(outputWidth)) {
+                                continue;
+                            }
+                            const AccumT* tapPtr = columnPtr + (i * filterWidth + j) * outputDepth;
+                            AccumT* accumPtr =
+                                    accumBase + (hOutput * outputWidth + wOutput) * outputDepth;
+                            for (uint32_t k = 0; k < outputDepth; k++) {
+                                accumPtr[k] += tapPtr[k];
                             }
                         }
                     }
                 }
-
-                inputBase += inputDepth;
             }
         }
-        outputBase += outputHeight * outputWidth * outputDepth;
     }
+    return true;
+}
+
+bool transposeConvNhwc(const float* inputData, const Shape& inputShape, const float* filterData,
+                       const Shape& filterShape, const float* biasData, const Shape& /*biasShape*/,
+                       const TransposeConv2dParam& param, float* outputData,
+                       const Shape& outputShape, IOperationExecutionContext* context) {
+    NNTRACE_TRANS("transposeConvFloat32");
+    const uint32_t numBatches = getSizeOfDimension(inputShape, 0);
+    const uint32_t outputHeight = getSizeOfDimension(outputShape, 1);
+    const uint32_t outputWidth = getSizeOfDimension(outputShape, 2);
+    const uint32_t outputDepth = getSizeOfDimension(outputShape, 3);
+
+    float outputActivationMin = 0.0f, outputActivationMax = 0.0f;
+    CalculateActivationRangeFloat(param.activation, &outputActivationMin, &outputActivationMax);
+
+    memset(outputData, 0, getNumberOfElements(outputShape) * sizeof(float));
+
+    NNTRACE_COMP_SWITCH("ruy::Mul");
+    NN_RET_CHECK(transposeConvGemm(inputData, inputShape, filterData, filterShape, param,
+                                   outputData, outputShape, context));
 
     const uint32_t outerSize = numBatches * outputHeight * outputWidth;
     float* outPtr = outputData;
@@ -175,19 +246,25 @@ bool transposeConvNhwc(const float* inputData, const Shape& inputShape, const fl
     return true;
 }
 
+// Computes a quantized transpose convolution whose output channel d is requantized with
+// outputMultiplier[d] and outputShift[d], with positive shifts meaning right shifts.
 template <typename T>
-bool transposeConvNhwc(const T* inputData, const Shape& inputShape, const T* filterData,
-                       const Shape& filterShape, const int32_t* biasData, const Shape& biasShape,
-                       const TransposeConv2dParam& param, T* outputData, const Shape& outputShape) {
-    NNTRACE_TRANS("transposeConvQuant8");
-    ANDROID_NN_TRANSPOSE_CONV_PARAMETERS
+bool transposeConvQuant8Nhwc(const T* inputData, const Shape& inputShape, const T* filterData,
+                             const Shape& filterShape, const int32_t* biasData,
+                             const TransposeConv2dParam& param,
+                             const std::vector<int32_t>& outputMultiplier,
+                             const std::vector<int32_t>& outputShift, T* outputData,
+                             const Shape& outputShape, IOperationExecutionContext* context) {
+    const uint32_t numBatches = getSizeOfDimension(inputShape, 0);
+    const uint32_t outputHeight = getSizeOfDimension(outputShape, 1);
+    const uint32_t outputWidth = getSizeOfDimension(outputShape, 2);
+    const uint32_t outputDepth = getSizeOfDimension(outputShape, 3);
 
     int32_t* tempBuffer = nullptr;
     std::unique_ptr<int32_t[]> bufferGuard;
     uint32_t tempBufferByteSize = getNumberOfElements(outputShape) * sizeof(int32_t);
-    if (tempBufferByteSize <= kStaticBufferSize) {
-        tempBuffer = reinterpret_cast<int32_t*>(static_scratch_buffer);
-    } else {
+    tempBuffer = static_cast<int32_t*>(context->getScratchBuffer(tempBufferByteSize));
+    if (tempBuffer == nullptr) {
         tempBuffer = new (std::nothrow) int32_t[tempBufferByteSize / sizeof(int32_t)];
         if (tempBuffer == nullptr) {
             LOG(ERROR) << "ConvTranspose size is too large, not enough memory";
@@ -196,62 +273,43 @@ bool transposeConvNhwc(const T* inputData, const Shape& inputShape, const T* fil
         bufferGuard.reset(tempBuffer);
     }
 
-    int32_t inputOffset = -inputShape.offset;
-    int32_t filterOffset = -filterShape.offset;
     int32_t outputOffset = outputShape.offset;
 
-    double realMultiplier = 0.0;
-    int32_t outputMultiplier = 0;
-    int32_t outputShift = 0;
-    NN_RET_CHECK(GetQuantizedConvolutionMultiplier(inputShape, filterShape, biasShape, outputShape,
-                                                   &realMultiplier));
-    int exponent;
-    NN_RET_CHECK(QuantizeMultiplier(realMultiplier, &outputMultiplier, &exponent));
-    outputShift = -exponent;
-
     int32_t outputActivationMin = 0, outputActivationMax = 0;
-    CalculateActivationRange<T>(activation, outputShape, &outputActivationMin,
+    CalculateActivationRange<T>(param.activation, outputShape, &outputActivationMin,
                                 &outputActivationMax);
 
-    // Prevent concurrent executions that may access the scratch buffer
-    std::unique_lock<std::mutex> lock(executionMutex);
     memset(tempBuffer, 0, tempBufferByteSize);
 
-    const T* inputPtr = inputData;
-    int32_t* outputBase = tempBuffer;
-    for (uint32_t b = 0; b < numBatches; b++) {
-        for (uint32_t h = 0; h < inputHeight; h++) {
-            for (uint32_t w = 0; w < inputWidth; w++) {
-                for (uint32_t d = 0; d < inputDepth; d++) {
-                    int32_t wOutputOrigin = static_cast<int32_t>(w) * strideWidth - paddingLeft;
-                    int32_t hOutputOrigin = static_cast<int32_t>(h) * strideHeight - paddingTop;
-
-                    for (uint32_t i = 0; i < filterHeight; i++) {
-                        for (uint32_t j = 0; j < filterWidth; j++) {
-                            for (uint32_t k = 0; k < outputDepth; k++) {
-                                int32_t hOutput = hOutputOrigin + static_cast<int32_t>(i);
-                                int32_t wOutput = wOutputOrigin + static_cast<int32_t>(j);
-                                if (hOutput >= 0 && hOutput < static_cast<int32_t>(outputHeight) &&
-                                    wOutput >= 0 && wOutput < static_cast<int32_t>(outputWidth)) {
-                                    uint32_t filterIndex =
-                                            k * filterHeight * filterWidth * inputDepth +
-                                            i * filterWidth * inputDepth + j * inputDepth + d;
-                                    uint32_t outputIndex = hOutput * outputWidth * outputDepth +
-                                                           wOutput * outputDepth + k;
-                                    outputBase[outputIndex] +=
-                                            (static_cast<int32_t>(*inputPtr) + inputOffset) *
-                                            (static_cast<int32_t>(filterData[filterIndex]) +
-                                             filterOffset);
-                                }
-                            }
-                        }
-                    }
-
-                    inputPtr++;
-                }
-            }
+    if constexpr (std::is_same_v<T, uint8_t>) {
+        NNTRACE_COMP_SWITCH("gemmlowp::GemmWithOutputPipeline");
+        NN_RET_CHECK(transposeConvGemm(inputData, inputShape, filterData, filterShape, param,
+                                       tempBuffer, outputShape, context));
+    } else {
+        // The pre-dotprod ruy kernels accumulate pairs of int8 products in int16, which
+        // overflows for -128 * -128 + -128 * -128. TFLite-style filters in [-127, 127] never hit
+        // this, and other filters are shifted to uint8 for gemmlowp, which yields the same
+        // accumulators.
+        const int8_t* filterEnd = filterData + getNumberOfElements(filterShape);
+        if (filterShape.offset != std::numeric_limits<int8_t>::min() &&
+            std::find(filterData, filterEnd, std::numeric_limits<int8_t>::min()) == filterEnd) {
+            NNTRACE_COMP_SWITCH("ruy::Mul");
+            NN_RET_CHECK(transposeConvGemm(inputData, inputShape, filterData, filterShape, param,
+                                           tempBuffer, outputShape, context));
+        } else {
+            std::vector<uint8_t> unsignedInput(getNumberOfElements(inputShape));
+            convertInt8ToUInt8(inputData, &unsignedInput);
+            Shape unsignedInputShape = inputShape;
+            unsignedInputShape.offset += 128;
+            std::vector<uint8_t> unsignedFilter(getNumberOfElements(filterShape));
+            convertInt8ToUInt8(filterData, &unsignedFilter);
+            Shape unsignedFilterShape = filterShape;
+            unsignedFilterShape.offset += 128;
+            NNTRACE_COMP_SWITCH("gemmlowp::GemmWithOutputPipeline");
+            NN_RET_CHECK(transposeConvGemm(unsignedInput.data(), unsignedInputShape,
+                                           unsignedFilter.data(), unsignedFilterShape, param,
+                                           tempBuffer, outputShape, context));
         }
-        outputBase += outputHeight * outputWidth * outputDepth;
     }
 
     const uint32_t outerSize = numBatches * outputHeight * outputWidth;
@@ -260,7 +318,8 @@ bool transposeConvNhwc(const T* inputData, const Shape& inputShape, const T* fil
     for (uint32_t i = 0; i < outerSize; i++) {
         for (uint32_t d = 0; d < outputDepth; d++, bufferPtr++, outPtr++) {
             int32_t outVal = *bufferPtr + biasData[d];
-            outVal = tflite::MultiplyByQuantizedMultiplier(outVal, outputMultiplier, -outputShift);
+            outVal = tflite::MultiplyByQuantizedMultiplier(outVal, outputMultiplier[d],
+                                                           -outputShift[d]);
             outVal += outputOffset;
             outVal = std::max(std::min(outVal, outputActivationMax), outputActivationMin);
             *outPtr = static_cast<T>(outVal);
@@ -270,41 +329,54 @@ bool transposeConvNhwc(const T* inputData, const Shape& inputShape, const T* fil
     return true;
 }
 
-bool transposeConvNhwc(const _Float16* inputData, const Shape& inputShape,
-                       const _Float16* filterData, const Shape& filterShape,
-                       const _Float16* biasData, const Shape& biasShape,
-                       const TransposeConv2dParam& param, _Float16* outputData,
-                       const Shape& outputShape) {
-    NNTRACE_TRANS("transposeConvFloat16");
-    std::vector<float> inputData_float32(getNumberOfElements(inputShape));
-    std::vector<float> filterData_float32(getNumberOfElements(filterShape));
-    std::vector<float> biasData_float32(getNumberOfElements(biasShape));
-    std::vector<float> outputData_float32(getNumberOfElements(outputShape));
+template <typename T>
+bool transposeConvNhwc(const T* inputData, const Shape& inputShape, const T* filterData,
+                       const Shape& filterShape, const int32_t* biasData, const Shape& biasShape,
+                       const TransposeConv2dParam& param, T* outputData, const Shape& outputShape,
+                       IOperationExecutionContext* context) {
+    NNTRACE_TRANS("transposeConvQuant8");
+    const uint32_t outputDepth = getSizeOfDimension(outputShape, 3);
 
-    convertFloat16ToFloat32(inputData, &inputData_float32);
-    convertFloat16ToFloat32(filterData, &filterData_float32);
-    convertFloat16ToFloat32(biasData, &biasData_float32);
+    double realMultiplier = 0.0;
+    int32_t outputMultiplier = 0;
+    NN_RET_CHECK(GetQuantizedConvolutionMultiplier(inputShape, filterShape, biasShape, outputShape,
+                                                   &realMultiplier));
+    int exponent;
+    NN_RET_CHECK(QuantizeMultiplier(realMultiplier, &outputMultiplier, &exponent));
 
-    transposeConvNhwc(inputData_float32.data(), inputShape, filterData_float32.data(), filterShape,
-                      biasData_float32.data(), biasShape, param, outputData_float32.data(),
-                      outputShape);
-    convertFloat32ToFloat16(outputData_float32, outputData);
+    return transposeConvQuant8Nhwc(inputData, inputShape, filterData, filterShape, biasData, param,
+                                   std::vector<int32_t>(outputDepth, outputMultiplier),
+                                   std::vector<int32_t>(outputDepth, -exponent), outputData,
+                                   outputShape, context);
+}
 
-    return true;
+bool transposeConvNhwc(const _Float16* inputData, const Shape& inputShape, const float* filterData,
+                       const Shape& filterShape, const float* biasData, const Shape& biasShape,
+                       const TransposeConv2dParam& param, _Float16* outputData,
+                       const Shape& outputShape, IOperationExecutionContext* context) {
+    NNTRACE_TRANS("transposeConvFloat16");
+    return computeFloat16PerBatch(
+            context, inputData, inputShape, outputData, outputShape,
+            [&](const float* inputBatch, const Shape& inputBatchShape, float* outputBatch,
+                const Shape& outputBatchShape) {
+                return transposeConvNhwc(inputBatch, inputBatchShape, filterData, filterShape,
+                                         biasData, biasShape, param, outputBatch,
+                                         outputBatchShape, context);
+            });
 }
 
 template <typename T_Input, typename T_Filter, typename T_Bias>
 bool transposeConv(const T_Input* inputData, const Shape& inputShape, const T_Filter* filterData,
                    const Shape& filterShape, const T_Bias* biasData, const Shape& biasShape,
                    const TransposeConv2dParam& param, T_Input* outputData,
-                   const Shape& outputShape) {
+                   const Shape& outputShape, IOperationExecutionContext* context) {
     InputWithLayout<T_Input> input(param.useNchw);
     OutputWithLayout<T_Input> output(param.useNchw);
     NN_RET_CHECK(input.initialize(inputData, inputShape));
     NN_RET_CHECK(output.initialize(outputData, outputShape));
     NN_RET_CHECK(transposeConvNhwc(input.getNhwcBuffer(), input.getNhwcShape(), filterData,
                                    filterShape, biasData, biasShape, param, output.getNhwcBuffer(),
-                                   output.getNhwcShape()));
+                                   output.getNhwcShape(), context));
     NN_RET_CHECK(output.commit());
     return true;
 }
@@ -314,26 +386,10 @@ bool transposeConvQuant8PerChannelNhwc(const T* inputData, const Shape& inputSha
                                        const int8_t* filterData, const Shape& filterShape,
                                        const float* filterScales, const int32_t* biasData,
                                        const Shape& biasShape, const TransposeConv2dParam& param,
-                                       T* outputData, const Shape& outputShape) {
+                                       T* outputData, const Shape& outputShape,
+                                       IOperationExecutionContext* context) {
     NNTRACE_TRANS("transposeConvQuant8PerChannel");
-    ANDROID_NN_TRANSPOSE_CONV_PARAMETERS
-
-    int32_t* tempBuffer = nullptr;
-    std::unique_ptr<int32_t[]> bufferGuard;
-    uint32_t tempBufferByteSize = getNumberOfElements(outputShape) * sizeof(int32_t);
-    if (tempBufferByteSize <= kStaticBufferSize) {
-        tempBuffer = reinterpret_cast<int32_t*>(static_scratch_buffer);
-    } else {
-        tempBuffer = new (std::nothrow) int32_t[tempBufferByteSize / sizeof(int32_t)];
-        if (tempBuffer == nullptr) {
-            LOG(ERROR) << "ConvTranspose size is too large, not enough memory";
-            return false;
-        }
-        bufferGuard.reset(tempBuffer);
-    }
-
-    int32_t inputOffset = -inputShape.offset;
-    int32_t outputOffset = outputShape.offset;
+    const uint32_t outputDepth = getSizeOfDimension(outputShape, 3);
 
     std::vector<double> realMultiplier(outputDepth, 0.0);
     std::vector<int32_t> outputMultiplier(outputDepth, 0);
@@ -351,65 +407,21 @@ bool transposeConvQuant8PerChannelNhwc(const T* inputData, const Shape& inputSha
         outputShift[i] = -exponent;
     }
 
-    int32_t outputActivationMin = 0, outputActivationMax = 0;
-    CalculateActivationRange<T>(activation, outputShape, &outputActivationMin,
-                                &outputActivationMax);
-
-    // Prevent concurrent executions that may access the scratch buffer
-    std::unique_lock<std::mutex> lock(executionMutex);
-    memset(tempBuffer, 0, tempBufferByteSize);
-
-    const T* inputPtr = inputData;
-    int32_t* outputBase = tempBuffer;
-    for (uint32_t b = 0; b < numBatches; b++) {
-        for (uint32_t h = 0; h < inputHeight; h++) {
-            for (uint32_t w = 0; w < inputWidth; w++) {
-                for (uint32_t d = 0; d < inputDepth; d++) {
-                    int32_t wOutputOrigin = static_cast<int32_t>(w) * strideWidth - paddingLeft;
-                    int32_t hOutputOrigin = static_cast<int32_t>(h) * strideHeight - paddingTop;
-
-                    for (uint32_t i = 0; i < filterHeight; i++) {
-                        for (uint32_t j = 0; j < filterWidth; j++) {
-                            for (uint32_t k = 0; k < outputDepth; k++) {
-                                int32_t hOutput = hOutputOrigin + static_cast<int32_t>(i);
-                                int32_t wOutput = wOutputOrigin + static_cast<int32_t>(j);
-                                if (hOutput >= 0 && hOutput < static_cast<int32_t>(outputHeight) &&
-                                    wOutput >= 0 && wOutput < static_cast<int32_t>(outputWidth)) {
-                                    uint32_t filterIndex =
-                                            k * filterHeight * filterWidth * inputDepth +
-                                            i * filterWidth * inputDepth + j * inputDepth + d;
-                                    uint32_t outputIndex = hOutput * outputWidth * outputDepth +
-                                                           wOutput * outputDepth + k;
-                                    outputBase[outputIndex] +=
-                                            (static_cast<int32_t>(*inputPtr) + inputOffset) *
-                                            static_cast<int32_t>(filterData[filterIndex]);
-                                }
-                            }
-                        }
-                    }
-
-                    inputPtr++;
-                }
-            }
-        }
-        outputBase += outputHeight * outputWidth * outputDepth;
-    }
-
-    const uint32_t outerSize = numBatches * outputHeight * outputWidth;
-    int32_t* bufferPtr = tempBuffer;
-    T* outPtr = outputData;
-    for (uint32_t i = 0; i < outerSize; i++) {
-        for (uint32_t d = 0; d < outputDepth; d++, bufferPtr++, outPtr++) {
-            int32_t outVal = *bufferPtr + biasData[d];
-            outVal = tflite::MultiplyByQuantizedMultiplier(outVal, outputMultiplier[d],
-                                                           -outputShift[d]);
-            outVal += outputOffset;
-            outVal = std::max(std::min(outVal, outputActivationMax), outputActivationMin);
-            *outPtr = static_cast<T>(outVal);
-        }
+    if constexpr (std::is_same_v<T, uint8_t>) {
+        // The GEMM needs the filter in the type of the input, and a symmetric int8 filter is
+        // the uint8 one with a zero point of 128.
+        std::vector<uint8_t> filterData_uint8(getNumberOfElements(filterShape));
+        convertInt8ToUInt8(filterData, &filterData_uint8);
+        Shape filterShape_uint8 = filterShape;
+        filterShape_uint8.offset = 128;
+        return transposeConvQuant8Nhwc(inputData, inputShape, filterData_uint8.data(),
+                                       filterShape_uint8, biasData, param, outputMultiplier,
+                                       outputShift, outputData, outputShape, context);
+    } else {
+        return transposeConvQuant8Nhwc(inputData, inputShape, filterData, filterShape, biasData,
+                                       param, outputMultiplier, outputShift, outputData,
+                                       outputShape, context);
     }
-
-    return true;
 }
 
 template <typename T>
@@ -417,20 +429,19 @@ bool transposeConvQuant8PerChannel(const T* inputData, const Shape& inputShape,
                                    const int8_t* filterData, const Shape& filterShape,
                                    const float* filterScales, const int32_t* biasData,
                                    const Shape& biasShape, const TransposeConv2dParam& param,
-                                   T* outputData, const Shape& outputShape) {
+                                   T* outputData, const Shape& outputShape,
+                                   IOperationExecutionContext* context) {
     InputWithLayout<T> input(param.useNchw);
     OutputWithLayout<T> output(param.useNchw);
     NN_RET_CHECK(input.initialize(inputData, inputShape));
     NN_RET_CHECK(output.initialize(outputData, outputShape));
     NN_RET_CHECK(transposeConvQuant8PerChannelNhwc(
             input.getNhwcBuffer(), input.getNhwcShape(), filterData, filterShape, filterScales,
-            biasData, biasShape, param, output.getNhwcBuffer(), output.getNhwcShape()));
+            biasData, biasShape, param, output.getNhwcBuffer(), output.getNhwcShape(), context));
     NN_RET_CHECK(output.commit());
     return true;
 }
 
-#undef ANDROID_NN_TRANSPOSE_CONV_PARAMETERS
-
 }  // namespace
 
 bool prepare(IOperationExecutionContext* context) {
@@ -505,16 +516,17 @@ bool execute(IOperationExecutionContext* context) {
                                  context->getInputBuffer<float>(kBiasTensor),
                                  context->getInputShape(kBiasTensor), param,
                                  context->getOutputBuffer<float>(kOutputTensor),
-                                 context->getOutputShape(kOutputTensor));
-        case OperandType::TENSOR_FLOAT16:
+                                 context->getOutputShape(kOutputTensor), context);
+        case OperandType::TENSOR_FLOAT16: {
+            const Float32Input filter(context, kFilterTensor);
+            const Float32Input bias(context, kBiasTensor);
             return transposeConv(context->getInputBuffer<_Float16>(kInputTensor),
-                                 context->getInputShape(kInputTensor),
-                                 context->getInputBuffer<_Float16>(kFilterTensor),
-                                 context->getInputShape(kFilterTensor),
-                                 context->getInputBuffer<_Float16>(kBiasTensor),
+                                 context->getInputShape(kInputTensor), filter.get(),
+                                 context->getInputShape(kFilterTensor), bias.get(),
                                  context->getInputShape(kBiasTensor), param,
                                  context->getOutputBuffer<_Float16>(kOutputTensor),
-                                 context->getOutputShape(kOutputTensor));
+                                 context->getOutputShape(kOutputTensor), context);
+        }
         case OperandType::TENSOR_QUANT8_ASYMM:
             if (context->getInputType(kFilterTensor) ==
                 OperandType::TENSOR_QUANT8_SYMM_PER_CHANNEL) {
@@ -529,7 +541,7 @@ bool execute(IOperationExecutionContext* context) {
                         context->getInputBuffer<int32_t>(kBiasTensor),
                         context->getInputShape(kBiasTensor), param,
                         context->getOutputBuffer<uint8_t>(kOutputTensor),
-                        context->getOutputShape(kOutputTensor));
+                        context->getOutputShape(kOutputTensor), context);
             } else if (context->getInputType(kFilterTensor) == OperandType::TENSOR_QUANT8_ASYMM) {
                 return transposeConv(context->getInputBuffer<uint8_t>(kInputTensor),
                                      context->getInputShape(kInputTensor),
@@ -538,7 +550,7 @@ bool execute(IOperationExecutionContext* context) {
                                      context->getInputBuffer<int32_t>(kBiasTensor),
                                      context->getInputShape(kBiasTensor), param,
                                      context->getOutputBuffer<uint8_t>(kOutputTensor),
-                                     context->getOutputShape(kOutputTensor));
+                                     context->getOutputShape(kOutputTensor), context);
             } else {
                 NN_RET_CHECK_FAIL() << "Unsupported filter type for operation " << kOperationName;
             }
@@ -556,7 +568,7 @@ bool execute(IOperationExecutionContext* context) {
                         context->getInputBuffer<int32_t>(kBiasTensor),
                         context->getInputShape(kBiasTensor), param,
                         context->getOutputBuffer<int8_t>(kOutputTensor),
-                        context->getOutputShape(kOutputTensor));
+                        context->getOutputShape(kOutputTensor), context);
             } else if (context->getInputType(kFilterTensor) ==
                        OperandType::TENSOR_QUANT8_ASYMM_SIGNED) {
                 return transposeConv(context->getInputBuffer<int8_t>(kInputTensor),
@@ -566,7 +578,7 @@ bool execute(IOperationExecutionContext* context) {
                                      context->getInputBuffer<int32_t>(kBiasTensor),
                                      context->getInputShape(kBiasTensor), param,
                                      context->getOutputBuffer<int8_t>(kOutputTensor),
-                                     context->getOutputShape(kOutputTensor));
+                                     context->getOutputShape(kOutputTensor), context);
             } else {
                 NN_RET_CHECK_FAIL() << "Unsupported filter type for operation " << kOperationName;
             }
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures a model with a single TRANSPOSE_CONV_2D operation. To compare two
+// versions of the kernel, run the benchmark built from each of them. On a
+// device, set debug.nn.partition to 0 so that the model runs on the CPU.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "NeuralNetworksWrapper.h"
+
+namespace android {
+namespace nn {
+namespace wrapper {
+namespace {
+
+// Returns the bytes of count elements of the given type with nonzero values.
+std::vector<uint8_t> makeData(Type type, size_t count) {
+    if (type == Type::TENSOR_FLOAT32) {
+        std::vector<float> values(count);
+        for (size_t i = 0; i < count; ++i) {
+            values[i] = static_cast<float>(i % 7) * 0.25f - 0.75f;
+        }
+        std::vector<uint8_t> data(count * sizeof(float));
+        std::memcpy(data.data(), values.data(), data.size());
+        return data;
+    }
+    std::vector<uint8_t> data(count);
+    for (size_t i = 0; i < count; ++i) {
+        data[i] = static_cast<uint8_t>(i * 7);
+    }
+    return data;
+}
+
+// The arguments are the height and width of the input, the input depth, the
+// output depth, the height and width of the filter, and the stride.
+void transposeConv2D(benchmark::State& state, Type type) {
+    const uint32_t inputSize = state.range(0);
+    const uint32_t inputDepth = state.range(1);
+    const uint32_t outputDepth = state.range(2);
+    const uint32_t filterSize = state.range(3);
+    const int32_t stride = state.range(4);
+    const uint32_t outputSize = inputSize * stride;
+    const bool isQuantized = type == Type::TENSOR_QUANT8_ASYMM;
+    const float scale = isQuantized ? 0.5f : 0.0f;
+    const int32_t zeroPoint = isQuantized ? 128 : 0;
+
+    const OperandType inputType(type, {1, inputSize, inputSize, inputDepth}, scale, zeroPoint);
+    const OperandType filterType(type, {outputDepth, filterSize, filterSize, inputDepth}, scale,
+                                 zeroPoint);
+    const OperandType biasType(isQuantized ? Type::TENSOR_INT32 : Type::TENSOR_FLOAT32,
+                               {outputDepth}, scale * scale);
+    const OperandType outputShapeType(Type::TENSOR_INT32, {4});
+    const OperandType scalarType(Type::INT32, {});
+    const OperandType layoutType(Type::BOOL, {});
+    const OperandType outputType(type, {1, outputSize, outputSize, outputDepth},
+                                 isQuantized ? 16.0f : 0.0f, zeroPoint);
+
+    // Values larger than 128 bytes are not copied into the model, so they
+    // must outlive it.
+    const std::vector<uint8_t> filterData =
+            makeData(type, outputDepth * filterSize * filterSize * inputDepth);
+    const std::vector<uint8_t> biasData(outputDepth * 4, 0);
+    const int32_t outputShape[] = {1, static_cast<int32_t>(outputSize),
+                                   static_cast<int32_t>(outputSize),
+                                   static_cast<int32_t>(outputDepth)};
+    const int32_t paddingScheme = ANEURALNETWORKS_PADDING_SAME;
+    const int32_t activation = ANEURALNETWORKS_FUSED_NONE;
+    const bool layout = false;
+
+    Model model;
+    const uint32_t input = model.addOperand(&inputType);
+    const uint32_t filter = model.addOperand(&filterType);
+    const uint32_t bias = model.addOperand(&biasType);
+    const uint32_t outputShapeOperand = model.addOperand(&outputShapeType);
+    const uint32_t paddingOperand = model.addOperand(&scalarType);
+    const uint32_t strideWidth = model.addOperand(&scalarType);
+    const uint32_t strideHeight = model.addOperand(&scalarType);
+    const uint32_t activationOperand = model.addOperand(&scalarType);
+    const uint32_t layoutOperand = model.addOperand(&layoutType);
+    const uint32_t output = model.addOperand(&outputType);
+    model.setOperandValue(filter, filterData.data(), filterData.size());
+    model.setOperandValue(bias, biasData.data(), biasData.size());
+    model.setOperandValue(outputShapeOperand, outputShape, sizeof(outputShape));
+    model.setOperandValue(paddingOperand, &paddingScheme, sizeof(paddingScheme));
+    model.setOperandValue(strideWidth, &stride, sizeof(stride));
+    model.setOperandValue(strideHeight, &stride, sizeof(stride));
+    model.setOperandValue(activationOperand, &activation, sizeof(activation));
+    model.setOperandValue(layoutOperand, &layout, sizeof(layout));
+    model.addOperation(ANEURALNETWORKS_TRANSPOSE_CONV_2D,
+                       {input, filter, bias, outputShapeOperand, paddingOperand, strideWidth,
+                        strideHeight, activationOperand, layoutOperand},
+                       {output});
+    model.identifyInputsAndOutputs({input}, {output});
+    if (model.finish() != Result::NO_ERROR) {
+        state.SkipWithError("Failed to create the model");
+        return;
+    }
+
+    Compilation compilation(&model);
+    if (compilation.finish() != Result::NO_ERROR) {
+        state.SkipWithError("Failed to compile the model");
+        return;
+    }
+
+    const std::vector<uint8_t> inputData = makeData(type, inputSize * inputSize * inputDepth);
+    std::vector<uint8_t> outputData((isQuantized ? 1 : sizeof(float)) * outputSize * outputSize *
+                                    outputDepth);
+    Execution execution(&compilation);
+    if (execution.setReusable(true) != Result::NO_ERROR ||
+        execution.setInput(0, inputData.data(), inputData.size()) != Result::NO_ERROR ||
+        execution.setOutput(0, outputData.data(), outputData.size()) != Result::NO_ERROR) {
+        state.SkipWithError("Failed to create the execution");
+        return;
+    }
+    for (auto _ : state) {
+        if (execution.compute() != Result::NO_ERROR) {
+            state.SkipWithError("Failed to compute");
+            return;
+        }
+    }
+}
+
+void transposeConv2DArguments(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({"size", "inDepth", "outDepth", "filter", "stride"});
+    benchmark->Args({16, 64, 64, 3, 1});
+    benchmark->Args({16, 128, 64, 4, 2});
+    benchmark->Args({32, 64, 32, 3, 2});
+    benchmark->Args({64, 16, 16, 5, 2});
+}
+
+BENCHMARK_CAPTURE(transposeConv2D, float32, Type::TENSOR_FLOAT32)
+        ->Apply(transposeConv2DArguments)
+        ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(transposeConv2D, quant8_asymm, Type::TENSOR_QUANT8_ASYMM)
+        ->Apply(transposeConv2DArguments)
+        ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+}  // namespace wrapper
+}  // namespace nn
+}  // namespace android
@@ -21,18 +21,45 @@
 #include <nnapi/Types.h>
 
 #include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <optional>
+#include <unordered_map>
 #include <vector>
 
 #include "ControlFlow.h"
 #include "LegacyUtils.h"
 #include "OperationResolver.h"
 #include "OperationsExecutionUtils.h"
+#include "ThreadPool.h"
 
 namespace android {
 namespace nn {
 
+// Storage that backs an operand across the iterations of a WHILE loop. It is
+// only reallocated when an iteration needs more than its capacity, and then at
+// least doubles, so that a tensor growing by a constant amount per iteration is
+// reallocated a logarithmic number of times.
+class GrowableBuffer {
+   public:
+    // Returns storage for at least length bytes. The previous contents are not
+    // preserved when the storage is reallocated.
+    uint8_t* reserve(uint32_t length) {
+        if (length > mCapacity) {
+            const uint64_t doubled = 2 * static_cast<uint64_t>(mCapacity);
+            mCapacity = static_cast<uint32_t>(std::min<uint64_t>(
+                    std::max<uint64_t>(length, doubled), std::numeric_limits<uint32_t>::max()));
+            mData.reset(new uint8_t[mCapacity]);
+        }
+        return mData.get();
+    }
+
+   private:
+    std::unique_ptr<uint8_t[]> mData;
+    uint32_t mCapacity = 0;
+};
+
 // Information we maintain about each operand during execution that
 // may change during execution.
 struct RunTimeOperandInfo {
@@ -70,6 +97,15 @@ struct RunTimeOperandInfo {
     // we free the buffer.  For non-temporary variables, this count is
     // always 0.
     uint32_t numberOfUsesLeft;
+    // Whether the buffer is a slice of the arena laid out by CpuMemoryPlan, or
+    // the storage of a GrowableBuffer. Such buffers are owned by the arena or
+    // the loop and must not be freed individually when numberOfUsesLeft drops
+    // to 0.
+    bool isPlanned = false;
+    // If not null, setInfoAndAllocateIfNeeded takes the buffer from this
+    // storage instead of allocating one. Used for the body outputs of WHILE
+    // loops.
+    GrowableBuffer* growableBuffer = nullptr;
 
     Operand::ExtraParams extraParams;
 
@@ -126,6 +162,159 @@ bool setRunTimePoolInfosFromCanonicalMemories(std::vector<RunTimePoolInfo>* pool
 bool setRunTimePoolInfosFromMemoryPools(std::vector<RunTimePoolInfo>* poolInfos,
                                         const std::vector<Request::MemoryPool>& pools);
 
+// Chains of elementwise operations of a subgraph that CpuExecutor runs as one
+// fused kernel, making a single pass over memory instead of writing and reading
+// back a full tensor between each pair of operations.
+//
+// A group is a chain of operations, each of which is the only reader of the
+// output of the previous one. It may start with a DEQUANTIZE and end with a
+// QUANTIZE of 8 bit asymmetric tensors, and the other operations are float32
+// ADD, SUB, MUL, DIV, RELU, RELU1, RELU6, LOGISTIC and TANH. A group runs in
+// the position of its last operation, once all of its inputs are available.
+// If at execution time the other inputs of the binary operations neither have
+// the shape of the group input nor are scalars, the group runs unfused.
+//
+// A plan is computed once at preparation time and may be shared by any number
+// of concurrent executions.
+class CpuFusionPlan {
+   public:
+    // A float32 operation of a group, applied to the value computed so far.
+    struct Step {
+        OperationType type;
+        // Whether this is ADD, SUB, MUL or DIV, rather than an activation.
+        bool isBinary = false;
+        // The other input of a binary operation, and whether it is the first
+        // input of the operation.
+        uint32_t sideOperand = 0;
+        bool sideIsFirst = false;
+        // The fused activation function of a binary operation.
+        uint32_t activationOperand = 0;
+    };
+
+    struct Group {
+        // The indexes of the operations, in execution order.
+        std::vector<uint32_t> operations;
+        uint32_t inputOperand = 0;
+        uint32_t outputOperand = 0;
+        // Whether the group starts with a DEQUANTIZE and ends with a QUANTIZE.
+        bool dequantizesInput = false;
+        bool quantizesOutput = false;
+        std::vector<Step> steps;
+    };
+
+    // Returns an empty plan, under which every operation runs unfused.
+    CpuFusionPlan() = default;
+
+    static CpuFusionPlan create(const Model::Subgraph& subgraph);
+
+    // Returns the group of the operation, or nullptr if it is not fused.
+    const Group* getGroup(uint32_t operationIndex) const;
+
+    // Returns the index of the operation in whose position the operation runs,
+    // which is the last operation of its group if it is fused.
+    uint32_t getExecutionPosition(uint32_t operationIndex) const;
+
+    size_t getGroupCount() const { return mGroups.size(); }
+
+   private:
+    static constexpr uint32_t kNoGroup = std::numeric_limits<uint32_t>::max();
+
+    std::vector<Group> mGroups;
+    // The index in mGroups of the group of each operation, or kNoGroup.
+    std::vector<uint32_t> mGroupIndexes;
+};
+
+// Static memory layout for the temporaries of a subgraph.
+//
+// The live range of each TEMPORARY_VARIABLE operand is computed from the
+// serialized execution order of the operations: the operand is live from the
+// operation that writes it up to the last operation that reads it. All
+// temporaries whose size is fully specified in the model are packed into a
+// single aligned arena, and operands with disjoint live ranges share storage.
+// Temporaries whose size is unknown before execution are not planned and are
+// allocated dynamically by CpuExecutor instead.
+//
+// A plan is computed once at preparation time and may be shared by any number
+// of concurrent executions, each of which allocates its own arena.
+class CpuMemoryPlan {
+   public:
+    static constexpr size_t kAlignment = kTfliteKernelAlignment;
+
+    // Returns an empty plan, under which every temporary is allocated dynamically.
+    CpuMemoryPlan() = default;
+
+    // If the operations of the subgraph are to be run with a fusion plan, the
+    // memory plan must be created with it, since fused operations read their
+    // inputs later than in the serialized execution order.
+    static CpuMemoryPlan create(const Model::Subgraph& subgraph,
+                                const CpuFusionPlan* fusionPlan = nullptr);
+
+    // The number of bytes of the arena, excluding any padding needed to align
+    // its start address to kAlignment.
+    size_t getArenaSize() const { return mArenaSize; }
+
+    // Points the planned temporaries at their slices of the arena. The arena
+    // must be aligned to kAlignment, be at least getArenaSize() bytes long, and
+    // outlive any use of the operands. The operands must have been created from
+    // the subgraph used to create this plan.
+    void setBuffers(uint8_t* arena, std::vector<RunTimeOperandInfo>* operands) const;
+
+   private:
+    struct PlannedOperand {
+        uint32_t operandIndex;
+        size_t offset;
+        uint32_t length;
+    };
+
+    std::vector<PlannedOperand> mPlannedOperands;
+    size_t mArenaSize = 0;
+};
+
+// Float32 copies of the constant TENSOR_FLOAT16 weights and biases of the
+// operations that compute FP16 tensors in float32: CONV_2D, DEPTHWISE_CONV_2D,
+// TRANSPOSE_CONV_2D, GROUPED_CONV_2D and FULLY_CONNECTED. They are converted
+// once at preparation time instead of on every execution.
+//
+// The copies are looked up by the address of the FP16 value, so the cache
+// must be created from the model and pools that executions read the constants
+// from, and those must outlive it. A cache may be shared by any number of
+// concurrent executions.
+class CpuFloat16ConstantCache {
+   public:
+    // Returns an empty cache, under which operations convert their weights themselves.
+    CpuFloat16ConstantCache() = default;
+
+    static CpuFloat16ConstantCache create(const Model& model,
+                                          const std::vector<RunTimePoolInfo>& modelPoolInfos);
+
+    // Returns the float32 copy of the FP16 constant whose value is at the
+    // address, or nullptr if it has not been converted.
+    const float* getFloat32Value(const void* float16Value) const;
+
+   private:
+    std::unordered_map<const void*, std::vector<float>> mValues;
+};
+
+// The runtime operand table of the main subgraph of a model bound to the
+// arguments of one request, or of the condition or body of a WHILE loop. It is
+// built once by CpuExecutor::prepareOperandTable for executions that are
+// computed repeatedly, such as reusable executions, and once per loop for the
+// iterations of a WHILE operation, so that each run only needs to reset the
+// operands that execution modifies.
+//
+// A table must not be used by more than one run at a time.
+struct RunTimeOperandTable {
+    // The state of every operand before execution.
+    std::vector<RunTimeOperandInfo> initialOperands;
+    // The operands modified by execution, i.e. the temporaries and the
+    // subgraph outputs. They are reset from initialOperands before every run.
+    std::vector<uint32_t> mutableOperandIndexes;
+    // The state of every operand during a run.
+    std::vector<RunTimeOperandInfo> operands;
+    // The storage of the temporaries planned by a CpuMemoryPlan, if any.
+    std::unique_ptr<uint8_t[]> arenaStorage;
+};
+
 // This class is used to execute a model on the CPU.
 class CpuExecutor {
    public:
@@ -150,6 +339,20 @@ class CpuExecutor {
             const std::vector<RunTimePoolInfo>& modelPoolInfos,
             const std::vector<RunTimePoolInfo>& requestPoolInfos);
 
+    // Builds the runtime operand table of the main subgraph of the model bound
+    // to the arguments of the request, for use by the overload of run() below.
+    // The model and pools must outlive the table. The executor running the
+    // table must use the same memory plan and parallelism as this one.
+    RunTimeOperandTable prepareOperandTable(const Model& model, const Request& request,
+                                            const std::vector<RunTimePoolInfo>& modelPoolInfos,
+                                            const std::vector<RunTimePoolInfo>& requestPoolInfos);
+
+    // Executes the model using an operand table created by
+    // prepareOperandTable() for the same model and pools.
+    int run(const Model& model, RunTimeOperandTable* table,
+            const std::vector<RunTimePoolInfo>& modelPoolInfos,
+            const std::vector<RunTimePoolInfo>& requestPoolInfos);
+
     const std::vector<OutputShape>& getOutputShapes() const {
         CHECK(mFinished) << "getOutputShapes() called by an unfinished CpuExecutor.";
         return mOutputShapes;
@@ -158,17 +361,76 @@ class CpuExecutor {
     void setDeadline(const TimePoint& deadline) { mDeadline = deadline; }
     void setLoopTimeout(uint64_t duration) { mLoopTimeoutDuration = duration; }
 
+    // Uses the given memory plan for the temporaries of the main subgraph. The
+    // plan must have been created from the main subgraph of the model passed to
+    // run() and must outlive the executor.
+    void setMemoryPlan(const CpuMemoryPlan* memoryPlan) { mMemoryPlan = memoryPlan; }
+
+    // Uses the given memory plans for the temporaries of the conditions and
+    // bodies of WHILE operations, instead of planning them on every execution
+    // of the loop. The plans must have been created from the referenced
+    // subgraphs of the model passed to run(), in the same order, and must
+    // outlive the executor.
+    void setReferencedMemoryPlans(const std::vector<CpuMemoryPlan>* referencedMemoryPlans) {
+        mReferencedMemoryPlans = referencedMemoryPlans;
+    }
+
+    // Runs the fused groups of the given plan for the main subgraph when it is
+    // executed serially. The plan must have been created from the main subgraph
+    // of the model passed to run() and must outlive the executor. The memory
+    // plan, if any, must have been created with the same fusion plan.
+    void setFusionPlan(const CpuFusionPlan* fusionPlan) { mFusionPlan = fusionPlan; }
+
+    // Lets the operations read the float32 copies of their FP16 constants from
+    // the cache. The cache must have been created from the model and pools
+    // passed to run() and must outlive the executor.
+    void setFloat16ConstantCache(const CpuFloat16ConstantCache* float16ConstantCache) {
+        mFloat16ConstantCache = float16ConstantCache;
+    }
+
+    // Runs independent operations of the main subgraph concurrently on the
+    // given thread pool, with at most maxConcurrency operations in flight. The
+    // results are identical to those of serial execution. A maxConcurrency of
+    // 1 (the default) selects serial execution. The thread pool must outlive
+    // the executor, and run() must not be called from one of its threads.
+    void setInterOperationParallelism(ThreadPool* threadPool, uint32_t maxConcurrency) {
+        mThreadPool = threadPool;
+        mMaxConcurrency = maxConcurrency;
+    }
+
    private:
+    bool runsInParallel() const { return mThreadPool != nullptr && mMaxConcurrency > 1; }
+    // Sets the compile-time operand value information of the model.
+    void setModel(const Model& model, const std::vector<RunTimePoolInfo>& modelPoolInfos);
+    // Points the planned temporaries at a newly allocated arena, if the memory
+    // plan is in use. Returns the storage of the arena.
+    std::unique_ptr<uint8_t[]> allocatePlannedTemporaries(
+            std::vector<RunTimeOperandInfo>* operands) const;
     // Creates runtime info from what's in the model.
     std::vector<RunTimeOperandInfo> initializeRunTimeInfo(const Model::Subgraph& subgraph);
+    // Builds the operand table of the condition or body of a WHILE operation,
+    // with the temporaries laid out by a CpuMemoryPlan of the subgraph.
+    RunTimeOperandTable prepareLoopOperandTable(const Model::Subgraph& subgraph);
     // Adjusts the runtime info for the arguments passed to the model,
     // modifying the buffer location, and possibly the dimensions.
     void updateForArguments(const std::vector<uint32_t>& indexes,
                             const std::vector<Request::Argument>& arguments,
                             const std::vector<RunTimePoolInfo>& requestPoolInfos,
                             RunTimeOperandInfo* operands);
-    // Runs one subgraph.
-    int executeSubgraph(const Model::Subgraph& subgraph, RunTimeOperandInfo* operands);
+    // Runs the main subgraph and collects the output shapes.
+    int executeMainSubgraph(const Model::Subgraph& subgraph,
+                            std::vector<RunTimeOperandInfo>* operands,
+                            const std::vector<RunTimePoolInfo>& requestPoolInfos);
+    // Runs one subgraph, with the fused groups of fusionPlan if not null.
+    int executeSubgraph(const Model::Subgraph& subgraph, RunTimeOperandInfo* operands,
+                        const CpuFusionPlan* fusionPlan = nullptr);
+    // Runs the operations of a fused group, unfused if the shapes of their
+    // operands do not allow fusing them.
+    int executeFusedGroup(const std::vector<Operation>& operations,
+                          const CpuFusionPlan::Group& group, RunTimeOperandInfo* operands);
+    // Runs one subgraph, dispatching each operation to mThreadPool as soon as
+    // all the operations producing its inputs have finished.
+    int executeSubgraphInParallel(const Model::Subgraph& subgraph, RunTimeOperandInfo* operands);
     // Runs one operation of the graph.
     int executeOperation(const Operation& operation, RunTimeOperandInfo* operands);
     int executeIfOperation(const Operation& operation, RunTimeOperandInfo* operands);
@@ -198,6 +460,24 @@ class CpuExecutor {
     // WHILE loop.
     uint64_t mLoopTimeoutDuration = operation_while::kTimeoutNsDefault;
 
+    // The static memory layout of the temporaries of the main subgraph, if any.
+    const CpuMemoryPlan* mMemoryPlan = nullptr;
+
+    // The static memory layouts of the temporaries of the referenced
+    // subgraphs, if any, indexed like Model::referenced.
+    const std::vector<CpuMemoryPlan>* mReferencedMemoryPlans = nullptr;
+
+    // The fused operation groups of the main subgraph, if any.
+    const CpuFusionPlan* mFusionPlan = nullptr;
+
+    // The float32 copies of the FP16 constants of all subgraphs, if any.
+    const CpuFloat16ConstantCache* mFloat16ConstantCache = nullptr;
+
+    // The worker threads and the maximum number of operations of the main
+    // subgraph to run concurrently.
+    ThreadPool* mThreadPool = nullptr;
+    uint32_t mMaxConcurrency = 1;
+
     [[maybe_unused]] const IOperationResolver* mOperationResolver;
 };
 
@@ -18,6 +18,12 @@
 #define ANDROID_PACKAGES_MODULES_NEURALNETWORKS_COMMON_CPU_OPERATION_UTILS_H
 
 #include <android-base/logging.h>
+#include <android-base/macros.h>
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#include <ruy/context.h>
+#include <ruy/thread_pool.h>
+#pragma clang diagnostic pop
 #include <tensorflow/lite/kernels/internal/types.h>
 
 #include <algorithm>
@@ -73,6 +79,95 @@ inline void convertFloat32ToFloat16(const std::vector<float>& input, _Float16* o
     }
 }
 
+// Runs a float32 implementation on FP16 tensors whose batches are computed independently,
+// converting one batch of the input and output at a time instead of the whole tensors.
+// computeBatch(const float* input, const Shape& inputBatchShape, float* output,
+//              const Shape& outputBatchShape)
+// is called once per batch and returns false on failure.
+//
+// The unit is a whole batch rather than a fixed-size tile, as the callers are convolutions whose
+// windows may span the whole image of a batch. The float32 copies are kept in
+// context->getFloat16ConversionBuffer(), so only batches too large for it are allocated.
+template <typename ComputeBatchFn>
+bool computeFloat16PerBatch(IOperationExecutionContext* context, const _Float16* inputData,
+                            const Shape& inputShape, _Float16* outputData,
+                            const Shape& outputShape, ComputeBatchFn computeBatch) {
+    const uint32_t numBatches = getSizeOfDimension(inputShape, 0);
+    NN_RET_CHECK_EQ(numBatches, getSizeOfDimension(outputShape, 0));
+    Shape inputBatchShape = inputShape;
+    inputBatchShape.dimensions[0] = 1;
+    Shape outputBatchShape = outputShape;
+    outputBatchShape.dimensions[0] = 1;
+    const uint32_t inputBatchSize = getNumberOfElements(inputBatchShape);
+    const uint32_t outputBatchSize = getNumberOfElements(outputBatchShape);
+
+    const size_t bufferSize = size_t{inputBatchSize} + outputBatchSize;
+    std::vector<float> ownBuffer;
+    float* inputBatch =
+            static_cast<float*>(context->getFloat16ConversionBuffer(bufferSize * sizeof(float)));
+    if (inputBatch == nullptr) {
+        ownBuffer.resize(bufferSize);
+        inputBatch = ownBuffer.data();
+    }
+    float* outputBatch = inputBatch + inputBatchSize;
+    for (uint32_t b = 0; b < numBatches; ++b) {
+        const _Float16* inputBegin = inputData + b * inputBatchSize;
+        std::copy(inputBegin, inputBegin + inputBatchSize, inputBatch);
+        NN_RET_CHECK(computeBatch(inputBatch, inputBatchShape, outputBatch, outputBatchShape));
+        std::copy(outputBatch, outputBatch + outputBatchSize, outputData + b * outputBatchSize);
+    }
+    return true;
+}
+
+// Number of elements below which splitting the work of an operation over threads costs more than
+// it saves. Callers of parallelFor() whose indices cover several elements divide it accordingly.
+constexpr uint32_t kMinElementsPerTask = 16384;
+
+// Splits [0, size) into contiguous ranges of at least minRangeSize indices, at most one per
+// thread of ruyContext, and calls fn(begin, end) for every range on the ruy thread pool. Returns
+// once all ranges are done. Small problems and a null ruyContext run on the calling thread.
+template <typename RangeFn>
+void parallelFor(ruy::Context* ruyContext, uint32_t size, uint32_t minRangeSize, RangeFn fn) {
+    const uint32_t maxNumTasks = ruyContext != nullptr ? ruyContext->max_num_threads() : 1;
+    const uint32_t numTasks = std::min(maxNumTasks, size / std::max(minRangeSize, 1u));
+    if (numTasks <= 1) {
+        fn(0u, size);
+        return;
+    }
+    struct RangeTask : ruy::Task {
+        void Run() override { (*fn)(begin, end); }
+        RangeFn* fn;
+        uint32_t begin;
+        uint32_t end;
+    };
+    std::vector<RangeTask> tasks(numTasks);
+    for (uint32_t i = 0; i < numTasks; ++i) {
+        tasks[i].fn = &fn;
+        tasks[i].begin = static_cast<uint64_t>(size) * i / numTasks;
+        tasks[i].end = static_cast<uint64_t>(size) * (i + 1) / numTasks;
+    }
+    ruyContext->mutable_thread_pool()->Execute(numTasks, tasks.data());
+}
+
+// Views a tensor as [outerSize, axisSize, innerSize] and calls fn(outer, innerBegin, innerEnd) for
+// every block of at most blockSize consecutive inner positions, spread over the threads of
+// ruyContext. A block walks the axis as rows of contiguous values, which the compiler processes as
+// SIMD lanes, rather than as columns with stride innerSize.
+template <typename BlockFn>
+void parallelForAxisBlocks(ruy::Context* ruyContext, uint32_t outerSize, uint32_t axisSize,
+                           uint32_t innerSize, uint32_t blockSize, BlockFn fn) {
+    const uint32_t numBlocks = (innerSize + blockSize - 1) / blockSize;
+    const uint32_t elementsPerBlock = std::max(axisSize * std::min(innerSize, blockSize), 1u);
+    parallelFor(ruyContext, outerSize * numBlocks,
+                std::max(kMinElementsPerTask / elementsPerBlock, 1u),
+                [&](uint32_t begin, uint32_t end) {
+                    for (uint32_t i = begin; i < end; ++i) {
+                        const uint32_t innerBegin = i % numBlocks * blockSize;
+                        fn(i / numBlocks, innerBegin, std::min(innerBegin + blockSize, innerSize));
+                    }
+                });
+}
+
 // Convert int8 quantized values to uint8 assuming that the scale is the same
 // and the distance between offsets is 128.
 inline void convertInt8ToUInt8(const int8_t* input, std::vector<uint8_t>* output) {
@@ -211,6 +306,28 @@ class OutputWithLayout {
     bool mUseNchw;
 };
 
+// The float32 value of a TENSOR_FLOAT16 input of an operation that computes in float32. Constant
+// weights use the copy converted when the model was prepared, other inputs are converted here.
+class Float32Input {
+    DISALLOW_COPY_AND_ASSIGN(Float32Input);
+
+   public:
+    Float32Input(const IOperationExecutionContext* context, uint32_t index)
+        : mData(context->getFloat32ConstantInput(index)) {
+        if (mData == nullptr) {
+            mConverted.resize(getNumberOfElements(context->getInputShape(index)));
+            convertFloat16ToFloat32(context->getInputBuffer<_Float16>(index), &mConverted);
+            mData = mConverted.data();
+        }
+    }
+
+    const float* get() const { return mData; }
+
+   private:
+    const float* mData;
+    std::vector<float> mConverted;
+};
+
 template <typename T>
 inline void CalculateActivationRange(int32_t activation, const Shape& outputShape,
                                      int32_t* outputActivationMin, int32_t* outputActivationMax);
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_PACKAGES_MODULES_NEURALNETWORKS_COMMON_ELEMENTWISE_MATH_H
+#define ANDROID_PACKAGES_MODULES_NEURALNETWORKS_COMMON_ELEMENTWISE_MATH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+// Elementwise float kernels written so that the compiler can inline them into a loop and
+// vectorize it: the approximations are branch-free, work on a clamped input, and leave the inputs
+// they do not cover to the libm function in a separate scalar pass.
+//
+// A kernel is a struct with:
+//   static float approximate(float x): branch-free and defined for every input, including NaN.
+//   static constexpr bool kHasFallback: whether some inputs need the reference function.
+//   static bool isCovered(float x): whether approximate(x) is within the documented error.
+//   static float reference(float x): the libm function, used for the uncovered inputs.
+//
+// The errors below are measured against the exact result. They are well within the
+// tolerance that the CTS and VTS tests allow for float32.
+
+namespace android {
+namespace nn {
+namespace elementwise_math {
+
+inline uint32_t floatToBits(float x) {
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+inline float bitsToFloat(uint32_t bits) {
+    float x;
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+// Clamps x to [low, high]. Unlike std::clamp, NaN is mapped to low, so the result is always safe
+// to convert to an integer.
+inline float clampToRange(float x, float low, float high) {
+    x = x > low ? x : low;
+    return x < high ? x : high;
+}
+
+// exp(x) = 2^n * exp(r), with n = round(x / ln(2)) and |r| <= ln(2) / 2. ln(2) is split in two so
+// that r is computed without cancellation, and exp(r) is the Cephes minimax polynomial.
+// Max error: 1 ulp on [-87, 88]. Outside of that range the result may be infinite, zero or
+// denormal, which the reference function handles.
+struct ExpKernel {
+    static constexpr float kLow = -87.0f;
+    static constexpr float kHigh = 88.0f;
+    static constexpr bool kHasFallback = true;
+
+    static float approximate(float x) {
+        x = clampToRange(x, kLow, kHigh);
+        const float n = std::floor(x * 1.44269504088896341f + 0.5f);
+        float r = x - n * 0.693359375f;
+        r = r - n * -2.12194440e-4f;
+        float p = 1.9875691500e-4f;
+        p = p * r + 1.3981999507e-3f;
+        p = p * r + 8.3334519073e-3f;
+        p = p * r + 4.1665795894e-2f;
+        p = p * r + 1.6666665459e-1f;
+        p = p * r + 5.0000001201e-1f;
+        p = p * r * r + r + 1.0f;
+        // n is in [-126, 127], so 2^n is a normal float.
+        const float scale = bitsToFloat(static_cast<uint32_t>(static_cast<int32_t>(n) + 127) << 23);
+        return p * scale;
+    }
+    static bool isCovered(float x) { return x >= kLow && x <= kHigh; }
+    static float reference(float x) { return std::exp(x); }
+};
+
+// log(x) = e * ln(2) + log(m), with m in [sqrt(0.5), sqrt(2)) read from the bits of x, and log(m)
+// computed with the Cephes minimax polynomial in m - 1.
+// Max error: 1 ulp on the positive normal floats. Zero, negative, denormal and non-finite inputs
+// use the reference function.
+struct LogKernel {
+    static constexpr bool kHasFallback = true;
+
+    static float approximate(float x) {
+        x = clampToRange(x, std::numeric_limits<float>::min(), std::numeric_limits<float>::max());
+        const uint32_t bits = floatToBits(x);
+        // The mantissa with the exponent of 0.5, in [0.5, 1).
+        float m = bitsToFloat((bits & 0x007fffffu) | 0x3f000000u);
+        float e = static_cast<float>(static_cast<int32_t>(bits >> 23) - 126);
+        const bool belowSqrtHalf = m < 0.707106781186547524f;
+        e = belowSqrtHalf ? e - 1.0f : e;
+        m = belowSqrtHalf ? m + m - 1.0f : m - 1.0f;
+        const float z = m * m;
+        float p = 7.0376836292e-2f;
+        p = p * m + -1.1514610310e-1f;
+        p = p * m + 1.1676998740e-1f;
+        p = p * m + -1.2420140846e-1f;
+        p = p * m + 1.4249322787e-1f;
+        p = p * m + -1.6668057665e-1f;
+        p = p * m + 2.0000714765e-1f;
+        p = p * m + -2.4999993993e-1f;
+        p = p * m + 3.3333331174e-1f;
+        float y = p * m * z;
+        y = y + e * -2.12194440e-4f;
+        y = y - 0.5f * z;
+        return m + y + e * 0.693359375f;
+    }
+    static bool isCovered(float x) {
+        return x >= std::numeric_limits<float>::min() && x <= std::numeric_limits<float>::max();
+    }
+    static float reference(float x) { return std::log(x); }
+};
+
+// sin(x) with x reduced to |r| <= pi / 4 around the nearest multiple j of pi / 2, using a three
+// part Cody-Waite split of pi / 2, and the Cephes minimax polynomials for sin(r) or cos(r)
+// depending on the quadrant.
+// Max error: 1.5 ulp, and 1e-10 absolute near the zeros of sin, for |x| <= 8192. Larger inputs
+// lose too many bits in the reduction and use the reference function.
+struct SinKernel {
+    static constexpr float kMaxInput = 8192.0f;
+    static constexpr bool kHasFallback = true;
+
+    static float approximate(float x) {
+        x = clampToRange(x, -kMaxInput, kMaxInput);
+        const bool negative = x < 0.0f;
+        float y = negative ? -x : x;
+        // The index of the octant of y, rounded up to an even number, i.e. 2 * j.
+        int32_t octant = static_cast<int32_t>(y * 1.27323954473516f);
+        octant = (octant + 1) & ~1;
+        const float j = static_cast<float>(octant);
+        y = ((y - j * 0.78515625f) - j * 2.4187564849853515625e-4f) -
+            j * 3.77489497744594108e-8f;
+        const float z = y * y;
+        float sinR = -1.9515295891e-4f;
+        sinR = sinR * z + 8.3321608736e-3f;
+        sinR = sinR * z + -1.6666654611e-1f;
+        sinR = sinR * z * y + y;
+        float cosR = 2.443315711809948e-5f;
+        cosR = cosR * z + -1.388731625493765e-3f;
+        cosR = cosR * z + 4.166664568298827e-2f;
+        cosR = cosR * z * z - 0.5f * z + 1.0f;
+        const float result = (octant & 2) ? cosR : sinR;
+        // sin is odd, and changes sign every two quadrants.
+        return negative != static_cast<bool>(octant & 4) ? -result : result;
+    }
+    static bool isCovered(float x) { return x >= -kMaxInput && x <= kMaxInput; }
+    static float reference(float x) { return std::sin(x); }
+};
+
+// 1 / sqrt(x) with the IEEE square root and division, which are vector instructions on the
+// targets we care about. This is more accurate than an estimate refined with Newton-Raphson steps
+// at about the same cost.
+// Max error: 1.5 ulp.
+struct RsqrtKernel {
+    static constexpr bool kHasFallback = false;
+    static float approximate(float x) { return 1.0f / std::sqrt(x); }
+};
+
+struct SqrtKernel {
+    static constexpr bool kHasFallback = false;
+    static float approximate(float x) { return std::sqrt(x); }
+};
+
+struct AbsKernel {
+    static constexpr bool kHasFallback = false;
+    static float approximate(float x) { return std::fabs(x); }
+};
+
+struct FloorKernel {
+    static constexpr bool kHasFallback = false;
+    static float approximate(float x) { return std::floor(x); }
+};
+
+// Applies Kernel to size floats. The first loop has no calls and no branches, so the compiler
+// vectorizes it; the second one only patches the inputs that the approximation does not cover.
+// input and output must not overlap.
+template <typename Kernel>
+void apply(const float* input, float* output, uint32_t size) {
+    for (uint32_t i = 0; i < size; ++i) {
+        output[i] = Kernel::approximate(input[i]);
+    }
+    if constexpr (Kernel::kHasFallback) {
+        for (uint32_t i = 0; i < size; ++i) {
+            if (!Kernel::isCovered(input[i])) {
+                output[i] = Kernel::reference(input[i]);
+            }
+        }
+    }
+}
+
+// Applies Kernel to size values of another floating point type, such as _Float16. The values are
+// widened and narrowed a block at a time, with loops that compile to vector conversions.
+template <typename Kernel, typename T>
+void apply(const T* input, T* output, uint32_t size) {
+    constexpr uint32_t kBlockSize = 256;
+    float block[kBlockSize];
+    float result[kBlockSize];
+    for (uint32_t begin = 0; begin < size; begin += kBlockSize) {
+        const uint32_t blockSize = std::min(kBlockSize, size - begin);
+        for (uint32_t i = 0; i < blockSize; ++i) {
+            block[i] = static_cast<float>(input[begin + i]);
+        }
+        apply<Kernel>(block, result, blockSize);
+        for (uint32_t i = 0; i < blockSize; ++i) {
+            output[begin + i] = static_cast<T>(result[i]);
+        }
+    }
+}
+
+}  // namespace elementwise_math
+}  // namespace nn
+}  // namespace android
+
+#endif  // ANDROID_PACKAGES_MODULES_NEURALNETWORKS_COMMON_ELEMENTWISE_MATH_H
@@ -17,6 +17,7 @@
 #ifndef ANDROID_PACKAGES_MODULES_NEURALNETWORKS_COMMON_INDEXED_SHAPE_WRAPPER_H
 #define ANDROID_PACKAGES_MODULES_NEURALNETWORKS_COMMON_INDEXED_SHAPE_WRAPPER_H
 
+#include <cstdint>
 #include <vector>
 
 #include "OperationsExecutionUtils.h"
@@ -61,6 +62,89 @@ class IndexedShapeWrapper {
     bool isValid(const std::vector<uint32_t>& index) const;
 };
 
+// The broadcast of two tensors a and b to an output shape, collapsed to as few dimensions as
+// possible. Output dimensions of size 1 are dropped, and adjacent dimensions are merged when
+// each input either spans both of them or is broadcast along both of them. The output elements
+// of the innermost dimension are contiguous, and each input either is contiguous along it or
+// repeats a single element.
+struct BinaryBroadcast {
+    // Sizes of the outer dimensions, outermost first, and the strides of a and b along them,
+    // which are zero for the dimensions that an input is broadcast along.
+    std::vector<uint32_t> outerSizes;
+    std::vector<uint32_t> aOuterStrides;
+    std::vector<uint32_t> bOuterStrides;
+    uint32_t innerSize = 1;
+    // Either 1 or 0.
+    uint32_t aInnerStride = 1;
+    uint32_t bInnerStride = 1;
+};
+
+// Fails if a or b cannot be broadcast to outputShape.
+bool collapseBinaryBroadcast(const Shape& aShape, const Shape& bShape, const Shape& outputShape,
+                             BinaryBroadcast* broadcast);
+
+// Calls fn(aOffset, bOffset, outputOffset) for every run of broadcast.innerSize output elements,
+// in output order.
+template <typename RunFn>
+void forEachBroadcastRun(const BinaryBroadcast& broadcast, RunFn fn) {
+    const size_t numOuter = broadcast.outerSizes.size();
+    uint32_t numRuns = 1;
+    for (uint32_t size : broadcast.outerSizes) numRuns *= size;
+    std::vector<uint32_t> index(numOuter, 0);
+    uint32_t aOffset = 0, bOffset = 0;
+    for (uint32_t run = 0; run < numRuns; ++run) {
+        fn(aOffset, bOffset, run * broadcast.innerSize);
+        for (size_t i = numOuter; i-- > 0;) {
+            aOffset += broadcast.aOuterStrides[i];
+            bOffset += broadcast.bOuterStrides[i];
+            if (++index[i] < broadcast.outerSizes[i]) break;
+            aOffset -= broadcast.aOuterStrides[i] * broadcast.outerSizes[i];
+            bOffset -= broadcast.bOuterStrides[i] * broadcast.outerSizes[i];
+            index[i] = 0;
+        }
+    }
+}
+
+// Computes outputData = op(aData, bData) elementwise, broadcasting a and b to outputShape. Every
+// run of output elements is computed by one of three loops, over two contiguous inputs or over
+// one contiguous input and a repeated element, which the compiler vectorizes when op is inlined.
+template <typename A, typename B, typename Out, typename Op>
+bool broadcastBinaryOp(const A* aData, const Shape& aShape, const B* bData, const Shape& bShape,
+                       Out* outputData, const Shape& outputShape, Op op) {
+    BinaryBroadcast broadcast;
+    NN_RET_CHECK(collapseBinaryBroadcast(aShape, bShape, outputShape, &broadcast));
+    const uint32_t size = broadcast.innerSize;
+    if (broadcast.aInnerStride == 0) {
+        forEachBroadcastRun(broadcast, [&](uint32_t aOffset, uint32_t bOffset, uint32_t offset) {
+            const A a = aData[aOffset];
+            const B* b = bData + bOffset;
+            Out* output = outputData + offset;
+            for (uint32_t i = 0; i < size; ++i) {
+                output[i] = op(a, b[i]);
+            }
+        });
+    } else if (broadcast.bInnerStride == 0) {
+        forEachBroadcastRun(broadcast, [&](uint32_t aOffset, uint32_t bOffset, uint32_t offset) {
+            const A* a = aData + aOffset;
+            const B b = bData[bOffset];
+            Out* output = outputData + offset;
+            for (uint32_t i = 0; i < size; ++i) {
+                output[i] = op(a[i], b);
+            }
+        });
+    } else {
+        forEachBroadcastRun(broadcast, [&](uint32_t aOffset, uint32_t bOffset, uint32_t offset) {
+            const A* a = aData + aOffset;
+            const B* b = bData + bOffset;
+            Out* output = outputData + offset;
+            for (uint32_t i = 0; i < size; ++i) {
+                output[i] = op(a[i], b[i]);
+            }
+        });
+    }
+    return true;
+}
+
 }  // namespace nn
 }  // namespace android
 
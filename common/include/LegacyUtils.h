@@ -60,6 +60,9 @@ const int kNumberOfOperationTypesOEM = 1;
 // The lowest number assigned to any OEM Code in NeuralNetworksOEM.h.
 const int kOEMCodeBase = 10000;
 
+// TFLite kernels prefer 64 bytes for the alignment and padding of the buffers they access.
+const uint32_t kTfliteKernelAlignment = 64;
+
 #ifdef NN_DEBUGGABLE
 #define SHOW_IF_DEBUG(msg) msg
 #else
@@ -24,9 +24,18 @@
 
 #include "ActivationFunctor.h"
 
+namespace gemmlowp {
+class GemmContext;
+}  // namespace gemmlowp
+
+namespace ruy {
+class Context;
+}  // namespace ruy
+
 namespace android {
 namespace nn {
 
+class IOperationExecutionContext;
 struct Shape;
 
 bool floorFloat16(const _Float16* inputData, _Float16* outputData, const Shape& shape);
@@ -95,10 +104,10 @@ bool spaceToBatchGeneric(const T* inputData, const Shape& inputShape, const int3
 
 bool meanFloat16(_Float16* inputData, const Shape& inputShape, const int32_t* axis,
                  const Shape& axisShape, bool keepDims, _Float16* outputData,
-                 const Shape& outputShape);
+                 const Shape& outputShape, ruy::Context* ruyContext);
 template <typename T, typename U>
 bool meanGeneric(T* inputData, const Shape& inputShape, const int32_t* axis, const Shape& axisShape,
-                 bool keepDims, T* outputData, const Shape& outputShape);
+                 bool keepDims, T* outputData, const Shape& outputShape, ruy::Context* ruyContext);
 
 bool stridedSliceGeneric(const uint8_t* inputData, const Shape& inputShape,
                          const int32_t* beginData, const int32_t* endData,
@@ -128,27 +137,28 @@ bool splitQuant8Signed(const int8_t* inputData, const Shape& inputShape, const i
                        const std::vector<int8_t*>* outputDataPtrs,
                        const std::vector<Shape>& outputShapes);
 
-bool groupedConvFloat16(const _Float16* inputData, const Shape& inputShape,
-                        const _Float16* filterData, const Shape& filterShape,
-                        const _Float16* biasData, const Shape& biasShape, int32_t numGroups,
+bool groupedConvFloat16(const _Float16* inputData, const Shape& inputShape, const float* filterData,
+                        const Shape& filterShape, const float* biasData, const Shape& biasShape,
                         int32_t padding_left, int32_t padding_right, int32_t padding_top,
                         int32_t padding_bottom, int32_t stride_width, int32_t stride_height,
-                        int32_t activation, _Float16* outputData, const Shape& outputShape);
+                        int32_t numGroups, int32_t activation, _Float16* outputData,
+                        const Shape& outputShape, IOperationExecutionContext* context);
 
 bool groupedConvFloat32(const float* inputData, const Shape& inputShape, const float* filterData,
                         const Shape& filterShape, const float* biasData, const Shape& biasShape,
-                        int32_t numGroups, int32_t padding_left, int32_t padding_right,
-                        int32_t padding_top, int32_t padding_bottom, int32_t stride_width,
-                        int32_t stride_height, int32_t activation, float* outputData,
-                        const Shape& outputShape);
+                        int32_t padding_left, int32_t padding_right, int32_t padding_top,
+                        int32_t padding_bottom, int32_t stride_width, int32_t stride_height,
+                        int32_t numGroups, int32_t activation, float* outputData,
+                        const Shape& outputShape, ruy::Context* ruyContext);
 
 template <typename T>
 bool groupedConvQuant8(const T* inputData, const Shape& inputShape, const T* filterData,
                        const Shape& filterShape, const int32_t* biasData, const Shape& biasShape,
-                       int32_t numGroups, int32_t padding_left, int32_t padding_right,
-                       int32_t padding_top, int32_t padding_bottom, int32_t stride_width,
-                       int32_t stride_height, int32_t activation, T* outputData,
-                       const Shape& outputShape);
+                       int32_t padding_left, int32_t padding_right, int32_t padding_top,
+                       int32_t padding_bottom, int32_t stride_width, int32_t stride_height,
+                       int32_t numGroups, int32_t activation, T* outputData,
+                       const Shape& outputShape, ruy::Context* ruyContext,
+                       gemmlowp::GemmContext* gemmContext);
 
 template <typename T>
 bool groupedConvQuant8PerChannel(const T* inputData, const Shape& inputShape,
@@ -157,7 +167,8 @@ bool groupedConvQuant8PerChannel(const T* inputData, const Shape& inputShape,
                                  const Shape& biasShape, int32_t padding_left,
                                  int32_t padding_right, int32_t padding_top, int32_t padding_bottom,
                                  int32_t stride_width, int32_t stride_height, int32_t numGroups,
-                                 int32_t activation, T* outputData, const Shape& outputShape);
+                                 int32_t activation, T* outputData, const Shape& outputShape,
+                                 ruy::Context* ruyContext, gemmlowp::GemmContext* gemmContext);
 
 bool channelShuffleGeneric(const uint8_t* inputData, const Shape& inputShape, int32_t numGroups,
                            int32_t axis, uint8_t* outputData, const Shape& outputShape);
@@ -18,7 +18,9 @@
 #define ANDROID_PACKAGES_MODULES_NEURALNETWORKS_COMMON_OPERATIONS_EXECUTION_UTILS_H
 
 #include <algorithm>
+#include <array>
 #include <cstdint>
+#include <limits>
 #include <string>
 #include <vector>
 
@@ -26,6 +28,14 @@
 #include "nnapi/TypeUtils.h"
 #include "nnapi/Types.h"
 
+namespace gemmlowp {
+class GemmContext;
+}  // namespace gemmlowp
+
+namespace ruy {
+class Context;
+}  // namespace ruy
+
 namespace android {
 namespace nn {
 
@@ -57,6 +67,25 @@ class IOperationExecutionContext {
     virtual bool isOmittedInput(uint32_t index) const = 0;
     virtual bool isOmittedOutput(uint32_t index) const = 0;
 
+    // Returns a buffer of at least |size| bytes for intermediate results, or nullptr if the
+    // request is too large, in which case the operation should allocate its own. The buffer is
+    // not shared with concurrently running operations and stays valid until execute() returns.
+    virtual void* getScratchBuffer(size_t size) = 0;
+
+    // Returns a buffer like getScratchBuffer(), but distinct from it, for the float32 copies of
+    // FP16 tensors computed by a float32 implementation that may itself use getScratchBuffer().
+    virtual void* getFloat16ConversionBuffer(size_t size) = 0;
+
+    // Returns a gemmlowp context that is not shared with concurrently running operations.
+    virtual gemmlowp::GemmContext* getGemmContext() = 0;
+
+    // Returns a ruy context that is not shared with concurrently running operations.
+    virtual ruy::Context* getRuyContext() = 0;
+
+    // Returns the value of a constant TENSOR_FLOAT16 input converted to float32 when the model
+    // was prepared, or nullptr if it was not converted.
+    virtual const float* getFloat32ConstantInput(uint32_t index) const = 0;
+
     template <typename T>
     const T* getInputBuffer(uint32_t index) const {
         return reinterpret_cast<const T*>(getInputBuffer(index));
@@ -218,6 +247,19 @@ bool calculateBroadcastedShape(const Shape& in1, const Shape& in2, Shape* out);
 template <typename T>
 T requantize(T value, const Shape& oldShape, const Shape& newShape);
 
+// Returns requantize() of every value of an 8-bit type T, indexed by the value minus the lowest
+// value of T, so that a tensor can be requantized with one lookup per element.
+template <typename T>
+std::array<T, 256> makeRequantizeTable(const Shape& oldShape, const Shape& newShape) {
+    static_assert(sizeof(T) == 1);
+    std::array<T, 256> table;
+    for (int32_t i = 0; i < 256; ++i) {
+        table[i] = requantize<T>(static_cast<T>(i + std::numeric_limits<T>::min()), oldShape,
+                                 newShape);
+    }
+    return table;
+}
+
 // Preparation functions for the corresponding ops
 bool floorPrepare(const Shape& input, Shape* output);
 
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_PACKAGES_MODULES_NEURALNETWORKS_COMMON_REDUCTION_UTILS_H
+#define ANDROID_PACKAGES_MODULES_NEURALNETWORKS_COMMON_REDUCTION_UTILS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "CpuOperationUtils.h"
+#include "OperationsExecutionUtils.h"
+
+namespace android {
+namespace nn {
+
+// The axes of a tensor collapsed into alternating runs of kept and reduced axes. Axes of size 1
+// are dropped, since they do not change the memory layout.
+struct ReductionSegments {
+    std::vector<uint32_t> sizes;
+    std::vector<bool> reduced;
+    std::vector<uint32_t> inputStrides;
+    // Zero for reduced segments.
+    std::vector<uint32_t> outputStrides;
+};
+
+// Marks the axes listed in axes, which may be negative, in shouldReduce.
+inline bool getReducedAxes(const int32_t* axes, uint32_t numAxes, uint32_t rank,
+                           std::vector<bool>* shouldReduce) {
+    shouldReduce->assign(rank, false);
+    for (uint32_t i = 0; i < numAxes; ++i) {
+        int32_t axis = axes[i];
+        NN_RET_CHECK(handleNegativeAxis(rank, &axis));
+        (*shouldReduce)[axis] = true;
+    }
+    return true;
+}
+
+inline ReductionSegments collapseReductionSegments(const Shape& inputShape,
+                                                   const std::vector<bool>& shouldReduce) {
+    ReductionSegments segments;
+    for (uint32_t axis = 0; axis < getNumberOfDimensions(inputShape); ++axis) {
+        const uint32_t size = getSizeOfDimension(inputShape, axis);
+        if (size == 1) continue;
+        if (!segments.sizes.empty() && segments.reduced.back() == shouldReduce[axis]) {
+            segments.sizes.back() *= size;
+        } else {
+            segments.sizes.push_back(size);
+            segments.reduced.push_back(shouldReduce[axis]);
+        }
+    }
+    if (segments.sizes.empty()) {
+        segments.sizes.push_back(1);
+        segments.reduced.push_back(false);
+    }
+    const size_t numSegments = segments.sizes.size();
+    segments.inputStrides.resize(numSegments);
+    segments.outputStrides.resize(numSegments);
+    uint32_t inputStride = 1, outputStride = 1;
+    for (size_t i = numSegments; i-- > 0;) {
+        segments.inputStrides[i] = inputStride;
+        inputStride *= segments.sizes[i];
+        segments.outputStrides[i] = segments.reduced[i] ? 0 : outputStride;
+        outputStride *= segments.reduced[i] ? 1 : segments.sizes[i];
+    }
+    return segments;
+}
+
+// Folds size contiguous values into acc. When the accumulator has the type of the input, the
+// values are folded into independent lanes that the compiler keeps in SIMD registers, which
+// changes the order of floating point operations but not the result of exact reductions.
+template <typename T, typename Acc, typename ReduceFn>
+Acc reduceContiguous(const T* input, uint32_t size, Acc acc, Acc identity, ReduceFn reduce) {
+    uint32_t i = 0;
+    if constexpr (std::is_same_v<T, Acc>) {
+        constexpr uint32_t kNumLanes = 16;
+        if (size >= 2 * kNumLanes) {
+            Acc lanes[kNumLanes];
+            std::fill(lanes, lanes + kNumLanes, identity);
+            lanes[0] = acc;
+            for (; i + kNumLanes <= size; i += kNumLanes) {
+                for (uint32_t j = 0; j < kNumLanes; ++j) {
+                    lanes[j] = reduce(lanes[j], input[i + j]);
+                }
+            }
+            acc = lanes[0];
+            for (uint32_t j = 1; j < kNumLanes; ++j) {
+                acc = reduce(acc, lanes[j]);
+            }
+        }
+    }
+    for (; i < size; ++i) {
+        acc = reduce(acc, input[i]);
+    }
+    return acc;
+}
+
+template <typename T, typename Acc, typename ReduceFn>
+void reduceSegments(const ReductionSegments& segments, size_t segment, const T* input, Acc* output,
+                    Acc identity, ReduceFn reduce) {
+    const uint32_t size = segments.sizes[segment];
+    if (segment + 1 == segments.sizes.size()) {
+        if (segments.reduced[segment]) {
+            *output = reduceContiguous(input, size, *output, identity, reduce);
+        } else {
+            for (uint32_t i = 0; i < size; ++i) {
+                output[i] = reduce(output[i], input[i]);
+            }
+        }
+        return;
+    }
+    for (uint32_t i = 0; i < size; ++i) {
+        reduceSegments(segments, segment + 1, input + i * segments.inputStrides[segment],
+                       output + i * segments.outputStrides[segment], identity, reduce);
+    }
+}
+
+// Reduces inputData over the axes marked in shouldReduce into one accumulator per output
+// element, in the order of the kept axes. reduce(Acc, T) -> Acc must be associative and
+// commutative, with identity as its neutral element. The work is split over the outermost kept
+// axes on the threads of ruyContext, so that every thread writes its own outputs.
+template <typename T, typename Acc, typename ReduceFn>
+void reduceAxes(const T* inputData, const Shape& inputShape, const std::vector<bool>& shouldReduce,
+                Acc identity, ReduceFn reduce, Acc* outputData, ruy::Context* ruyContext) {
+    const ReductionSegments segments = collapseReductionSegments(inputShape, shouldReduce);
+    uint32_t numOutputs = 1;
+    for (size_t i = 0; i < segments.sizes.size(); ++i) {
+        if (!segments.reduced[i]) numOutputs *= segments.sizes[i];
+    }
+    std::fill(outputData, outputData + numOutputs, identity);
+
+    if (segments.sizes.size() == 1 && segments.reduced[0]) {
+        *outputData = reduceContiguous(inputData, segments.sizes[0], identity, identity, reduce);
+        return;
+    }
+
+    // Segments alternate, so the outermost kept segment is the first or the second one.
+    const size_t parallelSegment = segments.reduced[0] ? 1 : 0;
+    const uint32_t numOuterReduced = parallelSegment == 1 ? segments.sizes[0] : 1;
+    const uint32_t inputsPerIndex = segments.inputStrides[parallelSegment] * numOuterReduced;
+    const uint32_t minRangeSize = std::max(kMinElementsPerTask / std::max(inputsPerIndex, 1u), 1u);
+    parallelFor(ruyContext, segments.sizes[parallelSegment], minRangeSize,
+                [&](uint32_t begin, uint32_t end) {
+                    for (uint32_t r = 0; r < numOuterReduced; ++r) {
+                        const T* input = inputData + r * segments.inputStrides[0] * parallelSegment;
+                        if (parallelSegment + 1 == segments.sizes.size()) {
+                            // The innermost kept values are contiguous in input and output.
+                            for (uint32_t i = begin; i < end; ++i) {
+                                outputData[i] = reduce(outputData[i], input[i]);
+                            }
+                            continue;
+                        }
+                        for (uint32_t i = begin; i < end; ++i) {
+                            reduceSegments(
+                                    segments, parallelSegment + 1,
+                                    input + i * segments.inputStrides[parallelSegment],
+                                    outputData + i * segments.outputStrides[parallelSegment],
+                                    identity, reduce);
+                        }
+                    }
+                });
+}
+
+}  // namespace nn
+}  // namespace android
+
+#endif  // ANDROID_PACKAGES_MODULES_NEURALNETWORKS_COMMON_REDUCTION_UTILS_H
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_PACKAGES_MODULES_NEURALNETWORKS_COMMON_THREAD_POOL_H
+#define ANDROID_PACKAGES_MODULES_NEURALNETWORKS_COMMON_THREAD_POOL_H
+
+#include <android-base/macros.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace nn {
+
+// A fixed set of persistent worker threads that run tasks in FIFO order.
+//
+// Tasks must not block waiting for other tasks scheduled on the same pool, as
+// all workers may be busy with tasks doing the same. runAndWait() avoids this
+// by running the task inline when called from a worker thread of the pool.
+class ThreadPool {
+    DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+
+   public:
+    // Starts numThreads worker threads. numThreads must be greater than 0.
+    //
+    // cpuAffinityMask is a hint restricting the worker threads to the CPUs
+    // whose bits are set, e.g. to keep them on the big cores. A mask of 0 (the
+    // default) or a mask that cannot be applied leaves the affinity unchanged.
+    explicit ThreadPool(uint32_t numThreads, uint64_t cpuAffinityMask = 0);
+
+    // Waits for all scheduled tasks to finish and joins the worker threads.
+    ~ThreadPool();
+
+    // Queues a task to be run on one of the worker threads.
+    void schedule(std::function<void()> task);
+
+    // Runs a task on one of the worker threads and waits for it to finish.
+    void runAndWait(const std::function<void()>& task);
+
+    // Returns whether the calling thread is a worker thread of this pool.
+    bool isWorkerThread() const;
+
+    // Returns whether the calling thread is a worker thread of any pool.
+    static bool isAnyWorkerThread();
+
+    uint32_t getNumThreads() const { return mWorkers.size(); }
+
+   private:
+    void workerLoop();
+
+    const uint64_t kCpuAffinityMask;
+
+    // Guards mTasks and mShuttingDown.
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::queue<std::function<void()>> mTasks;
+    bool mShuttingDown = false;
+    std::vector<std::thread> mWorkers;
+};
+
+}  // namespace nn
+}  // namespace android
+
+#endif  // ANDROID_PACKAGES_MODULES_NEURALNETWORKS_COMMON_THREAD_POOL_H
@@ -28,6 +28,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <variant>
 #include <vector>
 
 #include "BurstBuilder.h"
@@ -35,6 +36,8 @@
 #include "ExecutionPlan.h"
 #include "Manager.h"
 #include "ModelBuilder.h"
+#include "PartitioningProfile.h"
+#include "StreamingExecution.h"
 #include "TypeManager.h"
 
 namespace android {
@@ -46,11 +49,27 @@ CompilationBuilder::CompilationBuilder(const ModelBuilder* model,
     : mModel(model),
       mPartitioning(explicitDeviceList ? DeviceManager::kPartitioningWithoutFallback
                                        : DeviceManager::get()->getPartitioning()),
+      mPartitioningStrategy(DeviceManager::get()->getPartitioningStrategy()),
       mDevices(devices),
       mExplicitDeviceList(explicitDeviceList) {
     VLOG(COMPILATION) << "CompilationBuilder::CompilationBuilder";
 }
 
+CompilationBuilder::~CompilationBuilder() {
+    // Executions of this compilation may have measured operations since it
+    // was finished, so this is the last chance to save their times.
+    if (const CacheDir* dir = getPartitioningProfileDir(); mFinished && dir != nullptr) {
+        PartitioningProfile::get()->save(*mModel, *dir);
+    }
+}
+
+const CacheDir* CompilationBuilder::getPartitioningProfileDir() const {
+    if (!mIsCacheInfoProvided || !DeviceManager::get()->isPartitioningProfileEnabled()) {
+        return nullptr;
+    }
+    return std::get_if<CacheDir>(&mCacheInfo.variant);
+}
+
 int CompilationBuilder::finish() {
     if (mFinished) {
         LOG(ERROR) << "ANeuralNetworksCompilation_finish called more than once";
@@ -68,6 +87,10 @@ int CompilationBuilder::finish() {
     if (mIsCacheInfoProvided) {
         mPlan.setCaching(&mCacheInfo, mToken);
     }
+    mPlan.setPartitioningStrategy(mPartitioningStrategy);
+    if (const CacheDir* dir = getPartitioningProfileDir(); dir != nullptr) {
+        PartitioningProfile::get()->load(*mModel, *dir);
+    }
     if (mPartitioning) {
         int n = mModel->partitionTheWork(mDevices, mPreference, mPriority, deadline, &mPlan,
                                          mMetadata, mFailPartitioning);
@@ -264,6 +287,17 @@ int CompilationBuilder::forTest_setPartitioning(uint32_t partitioning) {
     return ANEURALNETWORKS_NO_ERROR;
 }
 
+int CompilationBuilder::forTest_setPartitioningStrategy(uint32_t strategy) {
+    if (mFinished) {
+        LOG(ERROR) << "CompilationBuilder::forTest_setPartitioningStrategy can't modify after "
+                      "compilation finished";
+        return ANEURALNETWORKS_BAD_STATE;
+    }
+
+    mPartitioningStrategy = strategy;
+    return ANEURALNETWORKS_NO_ERROR;
+}
+
 int CompilationBuilder::forTest_failPartitioning(int fail) {
     if (mFinished) {
         LOG(ERROR) << "CompilationBuilder::forTest_failPartitioning can't modify after compilation "
@@ -401,6 +435,25 @@ int CompilationBuilder::createBurst(BurstBuilder** burst) {
     return (*burst ? ANEURALNETWORKS_NO_ERROR : ANEURALNETWORKS_OUT_OF_MEMORY);
 }
 
+int CompilationBuilder::createStreamingExecution(uint32_t maxInFlight,
+                                                 StreamingExecution** stream) {
+    *stream = nullptr;
+    if (!mFinished) {
+        LOG(ERROR) << "createStreamingExecution passed an unfinished compilation";
+        return ANEURALNETWORKS_BAD_STATE;
+    }
+    if (!mPlan.isValid()) {
+        LOG(ERROR) << "createStreamingExecution passed an invalid compilation";
+        return ANEURALNETWORKS_BAD_STATE;
+    }
+    if (maxInFlight == 0) {
+        LOG(ERROR) << "createStreamingExecution passed maxInFlight == 0";
+        return ANEURALNETWORKS_BAD_DATA;
+    }
+    *stream = new (std::nothrow) StreamingExecution(this, &mPlan, maxInFlight);
+    return (*stream ? ANEURALNETWORKS_NO_ERROR : ANEURALNETWORKS_OUT_OF_MEMORY);
+}
+
 int CompilationBuilder::forEachStepRoleOfInput(uint32_t index,
                                                const StepRoleCallback& callback) const {
     if (!mFinished) {
@@ -39,6 +39,7 @@ class BurstBuilder;
 class Device;
 class ExecutionBuilder;
 class ModelBuilder;
+class StreamingExecution;
 
 class CompilationBuilder {
    public:
@@ -50,6 +51,7 @@ class CompilationBuilder {
     CompilationBuilder(const ModelBuilder* model,
                        const std::vector<std::shared_ptr<Device>>& devices,
                        bool explicitDeviceList = false);
+    ~CompilationBuilder();
 
     int setPreference(int32_t preference);
 
@@ -77,6 +79,14 @@ class CompilationBuilder {
 
     int createBurst(BurstBuilder** burst);
 
+    // See StreamingExecution for the meaning of maxInFlight.
+    //
+    // There is no NDK or support library entry point for streams: one would
+    // need a new feature level, with its own version of the NnApiSLDriverImpl
+    // struct. Until then, streams are only used from within the runtime and
+    // its tests.
+    int createStreamingExecution(uint32_t maxInFlight, StreamingExecution** stream);
+
     const ModelBuilder* getModel() const { return mModel; }
     const std::vector<std::shared_ptr<Device>>& getDevices() const { return mDevices; }
 
@@ -93,6 +103,7 @@ class CompilationBuilder {
     // partitioning algorithm.
     const ExecutionPlan& forTest_getExecutionPlan() const { return mPlan; }
     int forTest_setPartitioning(uint32_t partitioning);
+    int forTest_setPartitioningStrategy(uint32_t strategy);
     int forTest_failPartitioning(
             int resultCode);  // If not ANEURALNETWORKS_NO_ERROR, then simulate partitioning failure
 
@@ -103,6 +114,10 @@ class CompilationBuilder {
     const std::optional<TelemetryInfo>& getTelemetryInfo() const { return mTelemetryInfo; }
 
    private:
+    // Returns the directory where the partitioning profile of the model is
+    // kept, or nullptr if there is none.
+    const CacheDir* getPartitioningProfileDir() const;
+
     const ModelBuilder* mModel;
 
     ExecutionPlan mPlan;
@@ -115,6 +130,10 @@ class CompilationBuilder {
     // we can override this later.
     uint32_t mPartitioning;
 
+    // One of DeviceManager::kPartitioningStrategy*, captured from
+    // DeviceManager like mPartitioning.
+    uint32_t mPartitioningStrategy;
+
     // For testing purposes, simulate partitioning failure.
     int mFailPartitioning = ANEURALNETWORKS_NO_ERROR;
 
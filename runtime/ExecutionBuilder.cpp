@@ -32,9 +32,9 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <numeric>
 #include <optional>
 #include <string>
-#include <thread>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -44,6 +44,8 @@
 #include "Manager.h"
 #include "ModelArgumentInfo.h"
 #include "ModelBuilder.h"
+#include "PartitioningProfile.h"
+#include "StreamingExecution.h"
 #include "Telemetry.h"
 #include "TypeManager.h"
 
@@ -569,13 +571,11 @@ int ExecutionBuilder::getOutputOperandRank(uint32_t index, uint32_t* rank) {
 bool ExecutionBuilder::checkAndSetComputationState(const char* name) {
     std::lock_guard<std::mutex> lock(mStateMutex);
     if (!mReusable && mState == State::COMPLETED) {
-        LOG(ERROR) << "ANeuralNetworksExecution_" << name
-                   << " called on a non-reusable execution that has already completed";
+        LOG(ERROR) << name << " called on a non-reusable execution that has already completed";
         return false;
     }
     if (mState == State::COMPUTATION) {
-        LOG(ERROR) << "ANeuralNetworksExecution_" << name
-                   << " called on an execution that has already started";
+        LOG(ERROR) << name << " called on an execution that has already started";
         return false;
     }
     mState = State::COMPUTATION;
@@ -715,12 +715,27 @@ std::tuple<int, std::vector<OutputShape>, Timing> SimpleExecutionBuilder::comput
     return cpuFallbackFull(this);
 }
 
+std::shared_ptr<ExecutionPlan::Controller> CompoundExecutionBuilder::getController(
+        const BurstBuilder* burstBuilder) {
+    if (!mReusable) {
+        return mPlan->makeController(this, burstBuilder, /*reusable=*/false);
+    }
+    if (mController == nullptr) {
+        mController = mPlan->makeController(this, burstBuilder, /*reusable=*/true);
+    } else {
+        mPlan->resetController(mController, this, burstBuilder);
+    }
+    return mController;
+}
+
 std::tuple<int, std::vector<OutputShape>, Timing> CompoundExecutionBuilder::computeInternal(
         const OptionalTimePoint& deadline, BurstBuilder* burstBuilder) {
     NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "CompoundExecutionBuilder::computeInternal");
     VLOG(EXECUTION) << "CompoundExecutionBuilder::computeInternal (from plan, iteratively)";
 
-    auto controller = mPlan->makeController(this, burstBuilder);
+    auto controller = getController(burstBuilder);
+    mSizeOfTemporaries = controller->getSizeOfTemporaries();
+    mSummedSizeOfTemporaries = controller->getSummedSizeOfTemporaries();
     std::vector<OutputShape> outputShapes = getInitialOutputShapes();
 
     // On this iteration, do I need to repeat the previous step because it
@@ -948,7 +963,9 @@ std::tuple<int, int, ExecuteFencedInfoCallback> CompoundExecutionBuilder::comput
     base::unique_fd syncFence;
     ExecuteFencedInfoCallback executeFencedInfoCallback;
 
-    std::shared_ptr<ExecutionPlan::Controller> controller = mPlan->makeController(this, nullptr);
+    std::shared_ptr<ExecutionPlan::Controller> controller = getController(nullptr);
+    mSizeOfTemporaries = controller->getSizeOfTemporaries();
+    mSummedSizeOfTemporaries = controller->getSummedSizeOfTemporaries();
     while (true) {
         VLOG(EXECUTION) << "looking for next StepExecutor";
 
@@ -1011,8 +1028,8 @@ std::tuple<int, int, ExecuteFencedInfoCallback> CompoundExecutionBuilder::comput
 int ExecutionBuilder::computeFenced(const std::vector<int>& waitFor,
                                     uint64_t timeoutDurationAfterFence, int* syncFence) {
     CHECK(syncFence != nullptr);
-    NN_RETURN_IF_ERROR(
-            prepareForCompute("startComputeWithDependencies", ExecutionMode::ASYNC_WITH_DEPS));
+    NN_RETURN_IF_ERROR(prepareForCompute("ANeuralNetworksExecution_startComputeWithDependencies",
+                                         ExecutionMode::ASYNC_WITH_DEPS));
     if (timeoutDurationAfterFence > 0) {
         if (!mCompilation->mExplicitDeviceList || (mCompilation->mDevices.size() != 1)) {
             LOG(ERROR)
@@ -1048,17 +1065,36 @@ int ExecutionBuilder::computeFenced(const std::vector<int>& waitFor,
     return result;
 }
 
+int ExecutionBuilder::streamCompute(StreamingExecution* stream,
+                                    std::shared_ptr<ExecutionCallback>* synchronizationCallback) {
+    CHECK(stream != nullptr);
+    CHECK(synchronizationCallback != nullptr);
+    if (stream->getCompilation() != mCompilation) {
+        LOG(ERROR) << "ExecutionBuilder::streamCompute passed a stream and an execution of "
+                      "different compilations";
+        *synchronizationCallback = nullptr;
+        return ANEURALNETWORKS_BAD_DATA;
+    }
+    return compute(synchronizationCallback, nullptr, stream);
+}
+
 int ExecutionBuilder::compute(std::shared_ptr<ExecutionCallback>* synchronizationCallback,
-                              BurstBuilder* burstBuilder) {
+                              BurstBuilder* burstBuilder, StreamingExecution* stream) {
     CHECK(synchronizationCallback == nullptr || burstBuilder == nullptr)
             << "synchronizationCallback and burstBuilder cannot simultaneously be used";
+    CHECK(stream == nullptr || synchronizationCallback != nullptr)
+            << "stream requires synchronizationCallback";
 
     const bool synchronous = (synchronizationCallback == nullptr);
     if (!synchronous) {
         *synchronizationCallback = nullptr;
     }
 
-    const char* name = burstBuilder ? "burstCompute" : synchronous ? "compute" : "startCompute";
+    // Streams have no NDK entry point, see StreamingExecution.
+    const char* name = burstBuilder  ? "ANeuralNetworksExecution_burstCompute"
+                       : stream      ? "ExecutionBuilder::streamCompute"
+                       : synchronous ? "ANeuralNetworksExecution_compute"
+                                     : "ANeuralNetworksExecution_startCompute";
     const ExecutionMode mode = burstBuilder
                                        ? ExecutionMode::BURST
                                        : synchronous ? ExecutionMode::SYNC : ExecutionMode::ASYNC;
@@ -1100,10 +1136,6 @@ int ExecutionBuilder::compute(std::shared_ptr<ExecutionCallback>* synchronizatio
         // asynchronous thread -- take the asynchronous thread logic out of
         // CpuExecution::compute() and use it to wrap the plan-based-path.
 
-        // TODO: use a thread pool
-        // TODO(mikie): this could have NNTRACE so we could measure the overhead
-        //              of spinning up a new thread.
-
         // Prepare the callback for asynchronous execution.
         // std::shared_ptr<ExecutionCallback> object is returned when the
         // execution has been successfully launched, otherwise a
@@ -1119,13 +1151,19 @@ int ExecutionBuilder::compute(std::shared_ptr<ExecutionCallback>* synchronizatio
             const auto status = convertResultCodeToErrorStatus(n);
             executionCallback->notify(status, outputShapes, timing);
         };
-        if (DeviceManager::get()->syncExecRuntime()) {
+        if (stream != nullptr) {
+            VLOG(EXECUTION) << "ExecutionBuilder::compute (asynchronous API, stream)";
+            stream->enqueue(this, deadline, executionCallback);
+        } else if (DeviceManager::get()->syncExecRuntime()) {
             VLOG(EXECUTION) << "ExecutionBuilder::compute (asynchronous API, non-threaded)";
             asyncStartCompute();
         } else {
             VLOG(EXECUTION) << "ExecutionBuilder::compute (asynchronous API)";
-            std::thread asyncExecution(asyncStartCompute);
-            executionCallback->bindThread(std::move(asyncExecution));
+            // The callback is notified from the worker thread once the
+            // computation has finished, so no thread needs to be bound to it.
+            // If every worker is busy, the computation waits for one; see
+            // DeviceManager::getAsyncExecutionThreadPool().
+            DeviceManager::get()->getAsyncExecutionThreadPool()->schedule(asyncStartCompute);
         }
         *synchronizationCallback = executionCallback;
         return ANEURALNETWORKS_NO_ERROR;
@@ -1372,7 +1410,7 @@ StepExecutor::StepExecutor(ExecutionBuilder* executionBuilder, const ModelBuilde
       mReusable(reusable) {
     CHECK(mDevice != nullptr);
     CHECK_EQ(step == nullptr, dynamicTemporaries == nullptr);
-    CHECK(!(reusable && dynamicTemporaries != nullptr));
+    CHECK(!(reusable && dynamicTemporaries != nullptr && !dynamicTemporaries->empty()));
     VLOG(EXECUTION) << "StepExecutor::StepExecutor with " << mInputs.size() << " inputs and "
                     << mOutputs.size() << " outputs";
 }
@@ -1515,25 +1553,47 @@ std::tuple<int, std::vector<OutputShape>, Timing> StepExecutor::compute(
     int n;
     std::vector<OutputShape> outputShapes;
     Timing timing;
+    uint64_t nanos = 0;
     if (mReusable) {
         auto [nCreate, execution] = getReusableExecution();
         if (nCreate != ANEURALNETWORKS_NO_ERROR) {
             return {nCreate, {}, {}};
         }
+        const auto measurer = TimeNanoMeasurer(&nanos);
         std::tie(n, outputShapes, timing) = execution->compute(burstController, deadline);
     } else {
         CHECK(mPreparedModel != nullptr);
         const MeasureTiming measure = measureTiming(mExecutionBuilder);
         const OptionalDuration loopTimeoutDuration =
                 makeTimeoutDuration(mExecutionBuilder->getLoopTimeoutDuration());
+        const auto measurer = TimeNanoMeasurer(&nanos);
         std::tie(n, outputShapes, timing) = mPreparedModel->execute(
                 mInputs, mOutputs, mMemories.getObjects(), burstController, measure, deadline,
                 loopTimeoutDuration, mExecutionBuilder->getMetadata());
     }
     mExecutionBuilder->reportTimingWithoutFencedExecutionCallback(timing);
+    if (n == ANEURALNETWORKS_NO_ERROR && DeviceManager::get()->isPartitioningProfileEnabled()) {
+        recordPartitioningProfile(nanos);
+    }
     return {n, std::move(outputShapes), std::move(timing)};
 }
 
+void StepExecutor::recordPartitioningProfile(uint64_t nanos) const {
+    // The time includes the overhead of the driver call, which is part of the
+    // cost of running the operations on the device.
+    if (mExecutionStep != nullptr) {
+        PartitioningProfile::get()->recordExecution(*mExecutionStep->getSourceModel(),
+                                                    mDevice->getName(),
+                                                    mExecutionStep->getSourceOperationIndexes(),
+                                                    nanos);
+    } else {
+        std::vector<uint32_t> operationIndexes(mModel->operationCount());
+        std::iota(operationIndexes.begin(), operationIndexes.end(), 0u);
+        PartitioningProfile::get()->recordExecution(*mModel, mDevice->getName(), operationIndexes,
+                                                    nanos);
+    }
+}
+
 std::tuple<int, int, ExecuteFencedInfoCallback> StepExecutor::computeFenced(
         const std::vector<int>& waitFor, uint64_t timeoutDurationAfterFence,
         const OptionalTimePoint& deadline) {
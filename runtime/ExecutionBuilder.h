@@ -33,6 +33,7 @@
 #include <vector>
 
 #include "ExecutionCallback.h"
+#include "ExecutionPlan.h"
 #include "Memory.h"
 #include "ModelArgumentInfo.h"
 #include "ModelBuilder.h"
@@ -52,12 +53,14 @@ class RuntimeMemory;
 class RuntimePreparedModel;
 class RuntimeExecution;
 class StepExecutor;
+class StreamingExecution;
 
 // Execution modes
 enum class ExecutionMode { ASYNC, SYNC, BURST, ASYNC_WITH_DEPS };
 
 class ExecutionBuilder {
     friend class StepExecutor;
+    friend class StreamingExecution;
 
    public:
     explicit ExecutionBuilder(const CompilationBuilder* compilation);
@@ -100,6 +103,10 @@ class ExecutionBuilder {
     }
     int computeSynchronously() { return compute(nullptr); }
     int burstCompute(BurstBuilder* burst) { return compute(nullptr, burst); }
+    // Starts the computation on a stream of the same compilation, where it may
+    // overlap with the other computations of the stream. See StreamingExecution.
+    int streamCompute(StreamingExecution* stream,
+                      std::shared_ptr<ExecutionCallback>* synchronizationCallback);
 
     // Initialize output dimensional information from ModelArgumentInfo.
     std::vector<OutputShape> getInitialOutputShapes() const;
@@ -147,6 +154,12 @@ class ExecutionBuilder {
     // Retrieve a computation start point
     TimePoint getComputeStartTimePoint() const;
 
+    // The size of the memory that the last computation of a compound plan
+    // used for the temporaries passed between steps, and the size it would
+    // have used if no two temporaries shared storage. Both are 0 otherwise.
+    uint32_t getSizeOfTemporaries() const { return mSizeOfTemporaries; }
+    uint32_t getSummedSizeOfTemporaries() const { return mSummedSizeOfTemporaries; }
+
     const ModelArgumentInfo& getInputInfo(uint32_t index) const { return mInputs[index]; }
     const ModelArgumentInfo& getOutputInfo(uint32_t index) const { return mOutputs[index]; }
 
@@ -164,8 +177,11 @@ class ExecutionBuilder {
     // provided (i.e., is nullptr), then a synchronous execution will occur.
     //
     // Providing both synchronizationCallback and burstBuilder is an error.
+    //
+    // If stream is provided, then synchronizationCallback must be provided, and
+    // the computation is queued on the stream.
     int compute(std::shared_ptr<ExecutionCallback>* synchronizationCallback,
-                BurstBuilder* burstBuilder = nullptr);
+                BurstBuilder* burstBuilder = nullptr, StreamingExecution* stream = nullptr);
 
     virtual std::tuple<int, std::vector<OutputShape>, Timing> computeInternal(
             const OptionalTimePoint& deadline, BurstBuilder* burstBuilder) = 0;
@@ -175,7 +191,8 @@ class ExecutionBuilder {
             const OptionalTimePoint& deadline) = 0;
 
     // This method handles the common preparation and validation logic of compute and computeFenced.
-    // It will be called at the start of every computation.
+    // It will be called at the start of every computation. name is the entry point reported in
+    // error messages.
     int prepareForCompute(const char* name, ExecutionMode mode);
 
     const CompilationBuilder* mCompilation;
@@ -217,6 +234,10 @@ class ExecutionBuilder {
     // mFencedExecutionCallback is nullptr.
     Timing mTimingWithoutFencedExecutionCallback = {};
 
+    // See getSizeOfTemporaries() and getSummedSizeOfTemporaries().
+    uint32_t mSizeOfTemporaries = 0;
+    uint32_t mSummedSizeOfTemporaries = 0;
+
     // Amount of time to complete or abort the execution.
     std::optional<uint64_t> mTimeoutDuration;
 
@@ -309,6 +330,15 @@ class CompoundExecutionBuilder : public ExecutionBuilder {
     std::tuple<int, int, ExecuteFencedInfoCallback> computeFencedInternal(
             const std::vector<int>& waitFor, uint64_t timeoutDurationAfterFence,
             const OptionalTimePoint& deadline) override;
+
+   private:
+    // Returns the Controller for a new computation.  A reusable execution
+    // makes it on its first computation and resets it on the later ones, so
+    // that the temporaries and StepExecutors are only set up once.
+    std::shared_ptr<ExecutionPlan::Controller> getController(const BurstBuilder* burstBuilder);
+
+    // Only set if mReusable.
+    std::shared_ptr<ExecutionPlan::Controller> mController;
 };
 
 // class StepExecutor is used to execute a single "step" in a
@@ -330,7 +360,7 @@ class StepExecutor {
     // reusable
     //     If true, multiple StepExecutor::compute/computeFenced may be called on this
     //     object; otherwise, only one StepExecutor::compute/computeFenced may be called.
-    //     reusable must be false if mDynamicTemporaries != nullptr.
+    //     reusable must be false if dynamicTemporaries is neither nullptr nor empty.
     // step
     //     Contains the output index mapping from the excerpted "step" model to
     //     main model if the execution has multiple "steps". Must be nullptr
@@ -420,6 +450,10 @@ class StepExecutor {
     bool areDynamicTemporariesAllocated() const;
 
    private:
+    // Records the time the device took to run the operations of this executor
+    // for the partitioning of later compilations.
+    void recordPartitioningProfile(uint64_t nanos) const;
+
     // builderDimensions may be nullptr if executorInputOrOutput has fully
     // specified dimensions.
     void mapInputOrOutput(const ModelArgumentInfo& builderInputOrOutput,
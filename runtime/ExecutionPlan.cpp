@@ -34,9 +34,11 @@
 
 #include <algorithm>
 #include <functional>
+#include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <numeric>
 #include <queue>
 #include <set>
 #include <string>
@@ -51,6 +53,7 @@
 #include "ExecutionCallback.h"
 #include "Manager.h"
 #include "ModelBuilder.h"
+#include "PartitioningProfile.h"
 #include "TypeManager.h"
 
 namespace android {
@@ -174,8 +177,17 @@ class OperandTracker {
     // of the operation now being known, this may make new operations to be
     // able to run.  Call cb for each one of them.
     void markProcessed(uint32_t operationIndex, OperationReadyCallback cb);
+    // Returns the number of operations that would be processed by processing
+    // the operations in queue, then the operations that this makes ready and
+    // for which follow returns true, and so on. This does not change the state
+    // of the tracker.
+    size_t countProcessable(std::queue<uint32_t> queue,
+                            const std::function<bool(uint32_t)>& follow) const;
 
    private:
+    void markProcessed(uint32_t operationIndex, std::vector<uint32_t>* unknownInputCount,
+                       const OperationReadyCallback& cb) const;
+
     const ModelBuilder* mModel;
     std::multimap<uint32_t, uint32_t> mOperandToOperations;
     std::vector<uint32_t> mUnknownInputCount;  // For each operation
@@ -204,12 +216,18 @@ OperandTracker::OperandTracker(const ModelBuilder* model, OperationReadyCallback
 }
 
 void OperandTracker::markProcessed(uint32_t operationIndex, OperationReadyCallback cb) {
+    markProcessed(operationIndex, &mUnknownInputCount, cb);
+}
+
+void OperandTracker::markProcessed(uint32_t operationIndex,
+                                   std::vector<uint32_t>* unknownInputCount,
+                                   const OperationReadyCallback& cb) const {
     // Mark all its outputs as known.
     const Operation& operation = mModel->getOperations()[operationIndex];
     for (uint32_t operandIndex : operation.outputs) {
         auto range = mOperandToOperations.equal_range(operandIndex);
         for (auto i = range.first; i != range.second; i++) {
-            uint32_t& count = mUnknownInputCount[i->second];
+            uint32_t& count = (*unknownInputCount)[i->second];
             if (--count == 0) {
                 cb(i->second);
             }
@@ -217,6 +235,25 @@ void OperandTracker::markProcessed(uint32_t operationIndex, OperationReadyCallba
     }
 }
 
+size_t OperandTracker::countProcessable(std::queue<uint32_t> queue,
+                                        const std::function<bool(uint32_t)>& follow) const {
+    // Only the input counts change during the simulation, so there is no need
+    // to copy the rest of the tracker.
+    std::vector<uint32_t> unknownInputCount = mUnknownInputCount;
+    size_t count = 0;
+    while (!queue.empty()) {
+        const uint32_t operationIndex = queue.front();
+        queue.pop();
+        count++;
+        markProcessed(operationIndex, &unknownInputCount, [&](uint32_t readyOperationIndex) {
+            if (follow(readyOperationIndex)) {
+                queue.push(readyOperationIndex);
+            }
+        });
+    }
+    return count;
+}
+
 StaticTemporaryLocation addTemporary(uint32_t* totalSizeOfTemporaries, uint32_t size,
                                      uint32_t alignment, uint32_t padding) {
     // TODO: what about overflow?
@@ -227,6 +264,55 @@ StaticTemporaryLocation addTemporary(uint32_t* totalSizeOfTemporaries, uint32_t
     return {.offset = offset, .paddedLength = size};
 };
 
+// A static temporary of ExecutionPlan::Controller, with the first and last
+// indexes of the steps during which it must keep its value.
+struct TemporaryToLayOut {
+    uint32_t paddedLength;
+    uint32_t alignment;
+    uint32_t firstStep;
+    uint32_t lastStep;
+};
+
+// Assigns an offset to each temporary such that temporaries whose step ranges
+// overlap do not overlap in memory. The largest temporaries are placed first,
+// each one at the lowest offset where it fits. Returns the offsets and the
+// total size.
+std::pair<std::vector<uint32_t>, uint32_t> layOutTemporaries(
+        const std::vector<TemporaryToLayOut>& temporaries) {
+    std::vector<size_t> order(temporaries.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&temporaries](size_t a, size_t b) {
+        return temporaries[a].paddedLength > temporaries[b].paddedLength;
+    });
+    std::vector<uint32_t> offsets(temporaries.size());
+    std::vector<size_t> placed;
+    uint32_t totalSize = 0;
+    for (size_t i : order) {
+        const TemporaryToLayOut& temporary = temporaries[i];
+        // The memory of the placed temporaries that are alive at the same
+        // time as this one, by offset.
+        std::vector<std::pair<uint32_t, uint32_t>> conflicts;
+        for (size_t j : placed) {
+            const TemporaryToLayOut& other = temporaries[j];
+            if (other.firstStep <= temporary.lastStep && temporary.firstStep <= other.lastStep) {
+                conflicts.emplace_back(offsets[j], offsets[j] + other.paddedLength);
+            }
+        }
+        std::sort(conflicts.begin(), conflicts.end());
+        uint32_t offset = 0;
+        for (const auto& [begin, end] : conflicts) {
+            if (roundUp(offset, temporary.alignment) + temporary.paddedLength <= begin) {
+                break;
+            }
+            offset = std::max(offset, end);
+        }
+        offsets[i] = roundUp(offset, temporary.alignment);
+        totalSize = std::max(totalSize, offsets[i] + temporary.paddedLength);
+        placed.push_back(i);
+    }
+    return {std::move(offsets), totalSize};
+}
+
 std::string toString(SourceOperandIndex sourceOperandIndex) {
     return "(" + std::to_string(sourceOperandIndex.first) + ", " +
            std::to_string(sourceOperandIndex.second) + ")";
@@ -335,8 +421,9 @@ void DynamicTemporaries::declare(SourceOperandIndex sourceOperandIndex, uint32_t
     CHECK_GT(initialLength, 0u);
     const uint32_t paddedLength = roundUp(initialLength, padding);
     auto [_, isNew] = mSourceOperandToTemporary.emplace(
-            sourceOperandIndex, InternalLocationAndShape{stepIndex, 0, initialDimensions,
-                                                         paddedLength, alignment, padding});
+            sourceOperandIndex,
+            InternalLocationAndShape{stepIndex, 0, initialDimensions, paddedLength, alignment,
+                                     padding, initialDimensions});
     CHECK(isNew);
     mStepIndexToSourceOperandIndexes[stepIndex].emplace_back(sourceOperandIndex);
 }
@@ -414,6 +501,14 @@ int DynamicTemporaries::allocate(uint32_t stepIndex) {
     return ANEURALNETWORKS_NO_ERROR;
 }
 
+void DynamicTemporaries::resetDimensions() {
+    VLOG(EXECUTION) << "DynamicTemporaries::resetDimensions()";
+    CHECK(mDeclared);
+    for (auto& [_, temp] : mSourceOperandToTemporary) {
+        temp.dimensions = temp.initialDimensions;
+    }
+}
+
 bool DynamicTemporaries::allocated(uint32_t stepIndex) const {
     return (mStepIndexToSourceOperandIndexes.find(stepIndex) ==
             mStepIndexToSourceOperandIndexes.end()) ||
@@ -582,6 +677,7 @@ int ExecutionStep::addOperation(int operationIndex) {
     std::vector<uint32_t> outputs(outputCount);
     NN_RETURN_IF_ERROR(addOperands(operation.inputs, &inputs, INPUT));
     NN_RETURN_IF_ERROR(addOperands(operation.outputs, &outputs, OUTPUT));
+    mSourceOperationIndexes.push_back(operationIndex);
     return mStepModel.addOperation(static_cast<uint32_t>(operation.type), inputCount, inputs.data(),
                                    outputCount, outputs.data());
 }
@@ -1002,6 +1098,7 @@ int ExecutionPlan::CompoundBody::finish(const SourceModels* sourceModels,
     findControlFlowBoundaryConstants(sourceModels);
     findModelOutputsThatAreDownstreamInputs();
     findMemoryStepRoles();
+    findTemporaryStepRanges();
 
     mSuccessfulFinish = true;
     LOG(INFO) << "ExecutionPlan::CompoundBody::finish: compilation finished successfully";
@@ -1135,6 +1232,87 @@ void ExecutionPlan::CompoundBody::findMemoryStepRoles() {
     });
 }
 
+void ExecutionPlan::CompoundBody::findTemporaryStepRanges() {
+    auto& ranges = mSourceOperandToStepRange;
+    auto use = [&ranges](const SourceOperandIndex& sourceOperandIndex, uint32_t firstStep,
+                         uint32_t lastStep) {
+        auto [it, isNew] = ranges.emplace(sourceOperandIndex, std::make_pair(firstStep, lastStep));
+        if (!isNew) {
+            it->second.first = std::min(it->second.first, firstStep);
+            it->second.second = std::max(it->second.second, lastStep);
+        }
+    };
+    // The operands of an IfStep or a WhileStep are aliased by the operands of
+    // the steps of its referenced models (see Controller::setInput() and
+    // Controller::setOutput()), so they are used by every step of the
+    // construct.
+    std::vector<std::pair<uint32_t, uint32_t>> loops;
+    for (uint32_t stepIndex = 0; stepIndex < mSteps.size(); ++stepIndex) {
+        const auto& logicalStep = mSteps[stepIndex];
+        if (const ExecutionStep* step = logicalStep->tryExecutionStep()) {
+            for (const auto* operands :
+                 {&step->getStepModelInputs(), &step->getStepModelOutputs()}) {
+                for (const auto& operand : *operands) {
+                    use(SourceOperandIndex(step->getSourceModelIndex(), operand.first), stepIndex,
+                        stepIndex);
+                }
+            }
+        } else if (const IfStep* step = logicalStep->tryIfStep()) {
+            // The "then" branch ends with a GotoStep to the first step after
+            // the IF.
+            const GotoStep* afterThenBranch = mSteps[step->elseStepIndex - 1]->gotoStep();
+            const uint32_t lastStep = afterThenBranch->gotoStepIndex - 1;
+            use(step->conditionOperandIndex, stepIndex, lastStep);
+            for (const auto* operands :
+                 {&step->outerInputOperands, &step->outerOutputOperands,
+                  &step->thenBranchInputOperands, &step->thenBranchOutputOperands,
+                  &step->elseBranchInputOperands, &step->elseBranchOutputOperands}) {
+                for (const auto& sourceOperandIndex : *operands) {
+                    use(sourceOperandIndex, stepIndex, lastStep);
+                }
+            }
+        } else if (const WhileStep* step = logicalStep->tryWhileStep()) {
+            const uint32_t lastStep = step->exitStepIndex - 1;
+            use(step->condOutputOperand, stepIndex, lastStep);
+            for (const auto* operands :
+                 {&step->outerInputOperands, &step->outerOutputOperands, &step->condInputOperands,
+                  &step->bodyInputOperands, &step->bodyOutputOperands}) {
+                for (const auto& sourceOperandIndex : *operands) {
+                    use(sourceOperandIndex, stepIndex, lastStep);
+                }
+            }
+            loops.emplace_back(stepIndex, lastStep);
+        } else {
+            CHECK(logicalStep->isGoto());
+        }
+    }
+    // The steps of a loop run again after the later ones, so an operand that
+    // is used both inside and outside of a loop must live through all of it.
+    // Extending a range may make it cross an enclosing loop, hence the
+    // iteration.
+    bool extended = true;
+    while (extended) {
+        extended = false;
+        for (const auto& [firstLoopStep, lastLoopStep] : loops) {
+            for (auto& [sourceOperandIndex, range] : ranges) {
+                const bool overlaps = range.first <= lastLoopStep && firstLoopStep <= range.second;
+                const bool contained = firstLoopStep <= range.first && range.second <= lastLoopStep;
+                const bool covers = range.first <= firstLoopStep && lastLoopStep <= range.second;
+                if (overlaps && !contained && !covers) {
+                    range.first = std::min(range.first, firstLoopStep);
+                    range.second = std::max(range.second, lastLoopStep);
+                    extended = true;
+                }
+            }
+        }
+    }
+    // Boundary constants are copied into the temporaries when the Controller
+    // is created, so they must never be overwritten.
+    for (const auto& [sourceOperandIndex, location] : mSourceOperandToBoundaryConstantCopy) {
+        use(sourceOperandIndex, 0, mSteps.size() - 1);
+    }
+}
+
 int ExecutionPlan::SimpleBody::finish(const SourceModels*, int32_t executionPreference,
                                       int32_t priority, const OptionalTimePoint& deadline,
                                       const std::vector<TokenValuePair>& metadata,
@@ -1169,6 +1347,7 @@ int ExecutionPlan::finish(int32_t executionPreference, int32_t priority,
 ExecutionPlan::Controller::Controller(
         const ExecutionPlan* plan, ExecutionBuilder* executionBuilder,
         const BurstBuilder* burstBuilder, uint32_t totalSizeOfTemporaries,
+        uint32_t summedSizeOfTemporaries,
         std::map<SourceOperandIndex, StaticTemporaryLocation> sourceOperandToLocationOfTemporary,
         std::map<SourceOperandIndex, StaticTemporaryLocation> sourceOperandToLocationOfTemporary2,
         std::map<SourceOperandIndex, uint32_t> sourceOperandToInputIndex,
@@ -1184,6 +1363,8 @@ ExecutionPlan::Controller::Controller(
       mSourceOperandToInputIndex(std::move(sourceOperandToInputIndex)),
       mSourceOperandToOutputIndex(std::move(sourceOperandToOutputIndex)),
       mSourceOperandToConstantReference(std::move(sourceOperandToConstantReference)),
+      mSizeOfTemporaries(totalSizeOfTemporaries),
+      mSummedSizeOfTemporaries(summedSizeOfTemporaries),
       mDynamicTemporaries(std::move(dynamicTemporaries)),
       mNextStepIndex(0),
       mFallbackNextStepIndex(kBadStepIndex),
@@ -1257,32 +1438,57 @@ std::vector<SharedBurst> ExecutionPlan::makeBursts() const {
 }
 
 std::shared_ptr<ExecutionPlan::Controller> ExecutionPlan::makeController(
-        ExecutionBuilder* executionBuilder, const BurstBuilder* burstBuilder) const {
+        ExecutionBuilder* executionBuilder, const BurstBuilder* burstBuilder,
+        bool reusable) const {
     CHECK(isValid());
     CHECK(mState != SIMPLE);
+    CHECK(reusable || executionBuilder != nullptr);
     const auto* body = compound();
     // Create the layout for a RuntimeMemory object big enough to hold
     // - every partition boundary TEMPORARY operand that is not a dynamic temporary, and
     // - buffers required by the control flow implementation.
     //
-    // TODO: Rethink this approach for managing temporaries.  Some
-    // alternatives:
-    //
-    // 1) Adopt a memory layout scheme analogous to stack allocation,
-    // where objects of non-overlapping lifetime can occupy the same
-    // storage.  We would still have a single Memory object in this
-    // case.
+    // Temporaries whose lifetimes do not overlap, as given by
+    // CompoundBody::mSourceOperandToStepRange, share storage, so the size of
+    // the memory is the peak size of the temporaries alive at any step
+    // rather than their sum.
     //
-    // 2) Do something like what CpuExecutor does, and do allocations
-    // and deallocations on the fly (during execution) before first
-    // reference and after last reference, respectively.  This would
+    // TODO: An alternative is to do something like what CpuExecutor does, and
+    // do allocations and deallocations on the fly (during execution) before
+    // first reference and after last reference, respectively.  This would
     // mean having one Memory object per TEMPORARY; or, in a more
     // complicated implementation, one Memory object per set of
     // temporaries that have the same lifetime.  Note that the Android
     // system limits the number of shared memory objects, which are
     // what our Memory objects represent.
     //
-    uint32_t totalSizeOfTemporaries = 0;
+    // The temporaries are laid out once they are all known.
+    std::vector<TemporaryToLayOut> temporaries;
+    using LocationMap = std::map<SourceOperandIndex, StaticTemporaryLocation>;
+    std::vector<std::pair<SourceOperandIndex, LocationMap*>> temporaryOperands;
+    uint32_t summedSizeOfTemporaries = 0;
+    auto addTemporaryToLayOut = [body, &temporaries, &temporaryOperands, &summedSizeOfTemporaries](
+                                        const SourceOperandIndex& sourceOperandIndex,
+                                        LocationMap* sourceOperandToLocationOfTemporary,
+                                        uint32_t size) {
+        const auto memoryPreference = body->getMemoryPreferenceOfSourceOperand(sourceOperandIndex);
+        const uint32_t paddedLength =
+                addTemporary(&summedSizeOfTemporaries, size, memoryPreference.alignment,
+                             memoryPreference.padding)
+                        .paddedLength;
+        // Every operand allocated here has a range, but an operand without
+        // one stays valid for the whole plan.
+        std::pair<uint32_t, uint32_t> stepRange(0, body->mSteps.size() - 1);
+        if (const auto it = body->mSourceOperandToStepRange.find(sourceOperandIndex);
+            it != body->mSourceOperandToStepRange.end()) {
+            stepRange = it->second;
+        }
+        temporaries.push_back({.paddedLength = paddedLength,
+                               .alignment = memoryPreference.alignment,
+                               .firstStep = stepRange.first,
+                               .lastStep = stepRange.second});
+        temporaryOperands.emplace_back(sourceOperandIndex, sourceOperandToLocationOfTemporary);
+    };
     // This function has two modes of operation:
     // 1. When lifetime is TEMPORARY_VARIABLE, we allocate memory for
     //    TEMPORARY_VARIABLE source operands that are not dynamic temporaries,
@@ -1292,7 +1498,7 @@ std::shared_ptr<ExecutionPlan::Controller> ExecutionPlan::makeController(
     // 2. When lifetime is SUBGRAPH_OUTPUT, we allocate memory for
     //    SUBGRAPH_OUTPUT source operands and panic if we see a source operand
     //    of another lifetime.
-    auto mapTemporary = [body, executionBuilder, &totalSizeOfTemporaries](
+    auto mapTemporary = [this, &addTemporaryToLayOut](
                                 const SourceOperandIndex& sourceOperandIndex,
                                 std::map<SourceOperandIndex, StaticTemporaryLocation>*
                                         sourceOperandToLocationOfTemporary,
@@ -1300,7 +1506,7 @@ std::shared_ptr<ExecutionPlan::Controller> ExecutionPlan::makeController(
                                         Operand::LifeTime::TEMPORARY_VARIABLE) {
         CHECK(lifetime == Operand::LifeTime::TEMPORARY_VARIABLE ||
               lifetime == Operand::LifeTime::SUBGRAPH_OUTPUT);
-        const Operand& sourceOperand = executionBuilder->getSourceOperand(sourceOperandIndex);
+        const Operand& sourceOperand = getSourceOperand(sourceOperandIndex);
         if (lifetime == Operand::LifeTime::TEMPORARY_VARIABLE &&
             sourceOperand.lifetime == Operand::LifeTime::SUBGRAPH_OUTPUT) {
             // See the caller for explanation.
@@ -1309,14 +1515,7 @@ std::shared_ptr<ExecutionPlan::Controller> ExecutionPlan::makeController(
         CHECK_EQ(sourceOperand.lifetime, lifetime);
         const uint32_t size = TypeManager::get()->getSizeOfData(sourceOperand);
         if (size != 0u) {
-            const auto memoryPreference =
-                    body->getMemoryPreferenceOfSourceOperand(sourceOperandIndex);
-            const auto loc = addTemporary(&totalSizeOfTemporaries, size, memoryPreference.alignment,
-                                          memoryPreference.padding);
-            auto [_, isNew] = sourceOperandToLocationOfTemporary->emplace(sourceOperandIndex, loc);
-            CHECK(isNew);
-            VLOG(EXECUTION) << "temp: operand " << toString(sourceOperandIndex)
-                            << " offset = " << loc.offset << " paddedLength = " << loc.paddedLength;
+            addTemporaryToLayOut(sourceOperandIndex, sourceOperandToLocationOfTemporary, size);
         } else {
             // Unknown size, hence dynamic temporary.  The mapping will
             // be established elsewhere (DynamicTemporaries::allocate()).
@@ -1405,13 +1604,23 @@ std::shared_ptr<ExecutionPlan::Controller> ExecutionPlan::makeController(
     }
     // Allocate temporary memory for boundary CONSTANT_COPY operands.
     for (const auto& [sourceOperandIndex, location] : body->mSourceOperandToBoundaryConstantCopy) {
-        const auto memoryPreference = body->getMemoryPreferenceOfSourceOperand(sourceOperandIndex);
-        const auto loc = addTemporary(&totalSizeOfTemporaries, location.length,
-                                      memoryPreference.alignment, memoryPreference.padding);
-        sourceOperandToLocationOfTemporary.emplace(sourceOperandIndex, loc);
-        VLOG(EXECUTION) << "temp (boundary constant): operand " << toString(sourceOperandIndex)
-                        << " offset = " << loc.offset << " paddedLength = " << loc.paddedLength;
-    }
+        addTemporaryToLayOut(sourceOperandIndex, &sourceOperandToLocationOfTemporary,
+                             location.length);
+    }
+    const auto [offsets, totalSizeOfTemporaries] = layOutTemporaries(temporaries);
+    for (size_t i = 0; i < temporaries.size(); ++i) {
+        const auto& [sourceOperandIndex, sourceOperandToLocationOfTemporary] = temporaryOperands[i];
+        const StaticTemporaryLocation loc = {.offset = offsets[i],
+                                             .paddedLength = temporaries[i].paddedLength};
+        auto [_, isNew] = sourceOperandToLocationOfTemporary->emplace(sourceOperandIndex, loc);
+        CHECK(isNew);
+        VLOG(EXECUTION) << "temp: operand " << toString(sourceOperandIndex)
+                        << " offset = " << loc.offset << " paddedLength = " << loc.paddedLength
+                        << " steps = [" << temporaries[i].firstStep << ", "
+                        << temporaries[i].lastStep << "]";
+    }
+    VLOG(EXECUTION) << "ExecutionPlan::makeController: static temporaries take "
+                    << totalSizeOfTemporaries << " bytes instead of " << summedSizeOfTemporaries;
     // Collect dynamic temporaries.
     // TODO(b/157236079): Move some or all of this work to compilation time?
     DynamicTemporaries dynamicTemporaries;
@@ -1430,12 +1639,66 @@ std::shared_ptr<ExecutionPlan::Controller> ExecutionPlan::makeController(
     dynamicTemporaries.endDeclarations();
     dynamicTemporaries.vlogDump("finished declarations");
 
-    return std::shared_ptr<Controller>(new Controller(
-            this, executionBuilder, burstBuilder, totalSizeOfTemporaries,
+    std::shared_ptr<Controller> controller(new Controller(
+            this, executionBuilder, burstBuilder, totalSizeOfTemporaries, summedSizeOfTemporaries,
             std::move(sourceOperandToLocationOfTemporary),
             std::move(sourceOperandToLocationOfTemporary2), body->mSourceOperandToInputIndex,
             body->mSourceOperandToOutputIndex, body->mSourceOperandToBoundaryConstantCopy,
             body->mSourceOperandToBoundaryConstantReference, std::move(dynamicTemporaries)));
+    if (reusable) {
+        controller->mReusable = true;
+        controller->mHasControlFlowSteps =
+                std::any_of(body->mSteps.begin(), body->mSteps.end(),
+                            [](const auto& logicalStep) { return !logicalStep->isExecution(); });
+        if (controller->mHasControlFlowSteps) {
+            controller->mInitialSourceOperandToLocationOfTemporary =
+                    controller->mSourceOperandToLocationOfTemporary;
+            controller->mInitialSourceOperandToLocationOfTemporary2 =
+                    controller->mSourceOperandToLocationOfTemporary2;
+        } else if (controller->mDynamicTemporaries.empty() && executionBuilder != nullptr) {
+            // A Controller made without an execution may be used for a
+            // different execution in each computation, so it does not cache
+            // StepExecutors.
+            controller->mStepExecutors.resize(body->mSteps.size());
+        }
+    }
+    return controller;
+}
+
+void ExecutionPlan::resetController(std::shared_ptr<Controller> controller,
+                                    ExecutionBuilder* executionBuilder,
+                                    const BurstBuilder* burstBuilder) const {
+    CHECK(mState == COMPOUND);
+    CHECK(controller->mReusable);
+    CHECK(executionBuilder != nullptr);
+    VLOG(EXECUTION) << "ExecutionPlan::resetController(" << SHOW_IF_DEBUG(controller) << ")";
+    const auto* body = compound();
+    // Only a Controller without cached StepExecutors may change executions.
+    CHECK(controller->mStepExecutors.empty() || controller->mExecutionBuilder == executionBuilder);
+    controller->mExecutionBuilder = executionBuilder;
+    controller->mBurstBuilder = burstBuilder;
+    if (controller->mHasControlFlowSteps) {
+        // Undo the changes made by IfStep and WhileStep.
+        controller->mSourceOperandToLocationOfTemporary =
+                controller->mInitialSourceOperandToLocationOfTemporary;
+        controller->mSourceOperandToLocationOfTemporary2 =
+                controller->mInitialSourceOperandToLocationOfTemporary2;
+        controller->mSourceOperandToInputIndex = body->mSourceOperandToInputIndex;
+        controller->mSourceOperandToOutputIndex = body->mSourceOperandToOutputIndex;
+        controller->mSourceOperandToConstantReference =
+                body->mSourceOperandToBoundaryConstantReference;
+    }
+    if (!controller->mDynamicTemporaries.empty()) {
+        controller->mDynamicTemporaries.resetDimensions();
+    }
+    // The boundary constants copied into mTemporaries by the constructor are
+    // never overwritten, since they are live during the whole plan.
+    const bool temporariesAllocated =
+            controller->mSizeOfTemporaries == 0 || controller->mTemporaries != nullptr;
+    controller->mNextStepIndex = temporariesAllocated ? 0 : Controller::kBadStepIndex;
+    controller->mFallbackNextStepIndex = Controller::kBadStepIndex;
+    controller->mWhileState.clear();
+    controller->mLastStepSyncFd = -1;
 }
 
 // TODO: Find a better way to provide this functionality.
@@ -1616,16 +1879,31 @@ int ExecutionPlan::nextCompound(const ExecutionStep* step, std::shared_ptr<Contr
     NN_RETURN_IF_ERROR(controller->mDynamicTemporaries.allocate(step->getIndex()));
     controller->mDynamicTemporaries.vlogDump("finished allocating for a step");
 
-    *executor = std::make_shared<StepExecutor>(controller->mExecutionBuilder, step->getStepModel(),
-                                               step->getDevice(), step->getPreparedStepModel(),
-                                               /*reusable=*/false, step,
-                                               &controller->mDynamicTemporaries);
-
-    step->mapInputsAndOutputs(
-            *executor, mainModelOutputShapes, controller->mTemporaries.get(),
-            controller->mSourceOperandToLocationOfTemporary, controller->mDynamicTemporaries,
-            controller->mSourceOperandToInputIndex, controller->mSourceOperandToOutputIndex,
-            controller->mSourceOperandToConstantReference);
+    // The StepExecutor can be reused by later computations if its inputs and
+    // outputs cannot change.  This is not the case if it reads a main model
+    // output, whose dimensions are only known once the step defining it has
+    // been executed.
+    std::shared_ptr<StepExecutor>* reusableExecutor =
+            !controller->mStepExecutors.empty() && step->getOutputsAsStepModelInputs().empty()
+                    ? &controller->mStepExecutors[controller->mNextStepIndex]
+                    : nullptr;
+    if (reusableExecutor != nullptr && *reusableExecutor != nullptr) {
+        *executor = *reusableExecutor;
+    } else {
+        *executor = std::make_shared<StepExecutor>(
+                controller->mExecutionBuilder, step->getStepModel(), step->getDevice(),
+                step->getPreparedStepModel(), /*reusable=*/reusableExecutor != nullptr, step,
+                &controller->mDynamicTemporaries);
+
+        step->mapInputsAndOutputs(
+                *executor, mainModelOutputShapes, controller->mTemporaries.get(),
+                controller->mSourceOperandToLocationOfTemporary, controller->mDynamicTemporaries,
+                controller->mSourceOperandToInputIndex, controller->mSourceOperandToOutputIndex,
+                controller->mSourceOperandToConstantReference);
+        if (reusableExecutor != nullptr) {
+            *reusableExecutor = *executor;
+        }
+    }
     if (burstController != nullptr && controller->mBurstBuilder != nullptr) {
         *burstController = controller->mBurstBuilder->getControllerAt(controller->mNextStepIndex);
     }
@@ -2013,6 +2291,17 @@ bool ExecutionPlan::hasDynamicTemporaries() const {
     return mBody == nullptr ? false : mBody->hasDynamicTemporaries();
 }
 
+size_t ExecutionPlan::getStraightLineStepCount() const {
+    if (mState != COMPOUND || hasDynamicTemporaries()) {
+        return 0;
+    }
+    const auto& steps = compound()->mSteps;
+    const bool straightLine =
+            std::all_of(steps.begin(), steps.end(),
+                        [](const auto& logicalStep) { return logicalStep->isExecution(); });
+    return straightLine ? steps.size() : 0;
+}
+
 bool ExecutionPlan::forTest_hasStepModelWithNoInputsOrNoOutputs() const {
     return mBody == nullptr ? false : mBody->hasStepModelWithNoInputsOrNoOutputs();
 }
@@ -2169,8 +2458,10 @@ int ModelBuilder::partitionTheWorkInternal(uint32_t sourceModelIndex,
     // Figure out where each operation will best execute.
     // The value of the vector is the index in the devices vector.
     std::vector<int> bestDeviceForOperation(operationCount);
-    NN_RETURN_IF_ERROR(
-            findBestDeviceForEachOperation(preference, devices, &bestDeviceForOperation));
+    const bool minimizeBoundaries = plan->getPartitioningStrategy() ==
+                                    DeviceManager::kPartitioningStrategyMinimizeBoundaries;
+    NN_RETURN_IF_ERROR(findBestDeviceForEachOperation(preference, devices, minimizeBoundaries,
+                                                      &bestDeviceForOperation));
 
     // A special value produced by findBestDeviceForEachOperation meaning that
     // this is a control flow operation scheduled for interpreted execution
@@ -2221,13 +2512,42 @@ int ModelBuilder::partitionTheWorkInternal(uint32_t sourceModelIndex,
                           << deviceIndex << " (" << deviceName(deviceIndex) << ")";
     };
 
+    OperandTracker tracker(this, enqueueOnAppropriateDevice);
+
+    // This helper function returns the number of operations that a step for
+    // the device would run if it were created now: the operations in its
+    // queue, and those that they make ready on the same device.
+    auto countOperationsForNextStep = [&](int deviceIndex) -> size_t {
+        return tracker.countProcessable(
+                perDeviceQueue[deviceIndex], [&](uint32_t readyOperationIndex) {
+                    return bestDeviceForOperation[readyOperationIndex] == deviceIndex;
+                });
+    };
+
     // This helper function finds a device that has operations ready to process.
     // We start by looking at the control flow queue, and then look at the
     // devices in reverse order (i.e., starting at the end of the devices
     // vector). Earlier devices have a chance to prepare more of the inputs
-    // required by other devices. This function returns -1 if all queues are
-    // empty.
+    // required by other devices. When minimizing boundaries, we instead pick
+    // the device whose step would run the most operations, so that fewer
+    // steps are needed overall; ties still go to the later device. This
+    // function returns -1 if all queues are empty.
     auto findNextDeviceToProcess = [&]() -> int {
+        if (minimizeBoundaries && perDeviceQueue[kControlFlowInterpreter].empty()) {
+            int bestDeviceIndex = -1;
+            size_t bestCount = 0;
+            for (int i = deviceCount - 1; i >= 0; i--) {
+                if (perDeviceQueue[i].empty()) {
+                    continue;
+                }
+                const size_t count = countOperationsForNextStep(i);
+                if (count > bestCount) {
+                    bestDeviceIndex = i;
+                    bestCount = count;
+                }
+            }
+            return bestDeviceIndex;
+        }
         for (int i = perDeviceQueue.size() - 1; i >= 0; i--) {
             if (!perDeviceQueue[i].empty()) {
                 return i;
@@ -2236,7 +2556,6 @@ int ModelBuilder::partitionTheWorkInternal(uint32_t sourceModelIndex,
         return -1;
     };
 
-    OperandTracker tracker(this, enqueueOnAppropriateDevice);
     // For each iteration of this loop, we'll create either an execution step or
     // an interpreted control flow construct (including nested execution steps
     // and interpreted control flow constructs).
@@ -2537,7 +2856,7 @@ class CanDo {
 
 int ModelBuilder::findBestDeviceForEachOperation(
         uint32_t preference, const std::vector<std::shared_ptr<Device>>& devices,
-        std::vector<int>* bestDeviceForOperation) const {
+        bool minimizeBoundaries, std::vector<int>* bestDeviceForOperation) const {
     const MetaModel metaModel(makeModel(), DeviceManager::get()->strictSlicing());
 
     const size_t deviceCount = devices.size();
@@ -2607,8 +2926,284 @@ int ModelBuilder::findBestDeviceForEachOperation(
                               << devices[bestChoice]->getName() << ")";
         }
     }
+
+    // Measured times are not a measure of power usage.
+    if (preference != ANEURALNETWORKS_PREFER_LOW_POWER &&
+        PartitioningProfile::get()->hasMeasurements(*this)) {
+        applyPartitioningProfile(
+                preference, devices,
+                [&canDo](size_t deviceIndex, uint32_t operationIndex) {
+                    return canDo[deviceIndex].check(operationIndex);
+                },
+                bestDeviceForOperation);
+    }
+    if (minimizeBoundaries) {
+        minimizePartitionBoundaries(
+                deviceCount,
+                [&canDo](size_t deviceIndex, uint32_t operationIndex) {
+                    return canDo[deviceIndex].check(operationIndex);
+                },
+                bestDeviceForOperation);
+    }
     return ANEURALNETWORKS_NO_ERROR;
 }
 
+void ModelBuilder::applyPartitioningProfile(
+        uint32_t preference, const std::vector<std::shared_ptr<Device>>& devices,
+        const std::function<bool(size_t deviceIndex, uint32_t operationIndex)>& canDo,
+        std::vector<int>* bestDeviceForOperation) const {
+    // The cost of passing a temporary from one step to another: the overhead
+    // of an extra driver call, plus copying the data through shared memory.
+    constexpr float kBoundaryNanos = 20000.0f;
+    constexpr float kBoundaryNanosPerByte = 0.5f;
+    // Each pass moves operations one at a time, so a few passes are enough
+    // to merge the steps of a chain of small operations.
+    constexpr int kMaxPasses = 4;
+    constexpr float kCannotDo = std::numeric_limits<float>::infinity();
+    constexpr uint32_t kNoWriter = std::numeric_limits<uint32_t>::max();
+
+    const PartitioningProfile* profile = PartitioningProfile::get();
+    const size_t deviceCount = devices.size();
+    const int kControlFlowInterpreter = deviceCount;
+    const uint32_t operationCount = mOperations.size();
+    std::vector<int>& bestDevice = *bestDeviceForOperation;
+
+    // The time of each operation on each device that can run it. A device
+    // that has not run the operation yet is assumed to be as much faster or
+    // slower than the measured devices as their static performance says. The
+    // operations that are not measured at all keep their device.
+    std::vector<std::vector<float>> nanos(operationCount);
+    for (uint32_t operationIndex = 0; operationIndex < operationCount; operationIndex++) {
+        const OperationType type = getOperation(operationIndex).type;
+        if (bestDevice[operationIndex] == kControlFlowInterpreter || type == OperationType::IF ||
+            type == OperationType::WHILE) {
+            continue;
+        }
+        std::vector<float> operationNanos(deviceCount, kCannotDo);
+        std::vector<size_t> measuredDevices;
+        for (size_t deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++) {
+            if (!canDo(deviceIndex, operationIndex)) {
+                continue;
+            }
+            if (const std::optional<float> measured = profile->getOperationNanos(
+                        *this, devices[deviceIndex]->getName(), operationIndex)) {
+                operationNanos[deviceIndex] = *measured;
+                measuredDevices.push_back(deviceIndex);
+            }
+        }
+        if (measuredDevices.empty()) {
+            continue;
+        }
+        for (size_t deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++) {
+            if (!canDo(deviceIndex, operationIndex) || operationNanos[deviceIndex] != kCannotDo) {
+                continue;
+            }
+            const float perf = getPerformance(preference, devices[deviceIndex], operationIndex);
+            float sum = 0.0f;
+            for (size_t measuredIndex : measuredDevices) {
+                const float measuredPerf =
+                        getPerformance(preference, devices[measuredIndex], operationIndex);
+                sum += operationNanos[measuredIndex] * (perf / std::max(measuredPerf, 1e-6f));
+            }
+            operationNanos[deviceIndex] = sum / measuredDevices.size();
+        }
+        nanos[operationIndex] = std::move(operationNanos);
+    }
+
+    // The operations that write and read each temporary.
+    std::vector<uint32_t> writer(mOperands.size(), kNoWriter);
+    std::vector<std::vector<uint32_t>> readers(mOperands.size());
+    for (uint32_t operationIndex = 0; operationIndex < operationCount; operationIndex++) {
+        const Operation& operation = getOperation(operationIndex);
+        for (uint32_t operandIndex : operation.inputs) {
+            if (mOperands[operandIndex].lifetime == Operand::LifeTime::TEMPORARY_VARIABLE) {
+                readers[operandIndex].push_back(operationIndex);
+            }
+        }
+        for (uint32_t operandIndex : operation.outputs) {
+            if (mOperands[operandIndex].lifetime == Operand::LifeTime::TEMPORARY_VARIABLE) {
+                writer[operandIndex] = operationIndex;
+            }
+        }
+    }
+    const auto getBoundaryNanos = [this, &writer, &readers, &bestDevice](uint32_t operationIndex,
+                                                                         int deviceIndex) {
+        const auto getTransferNanos = [this](uint32_t operandIndex) {
+            return kBoundaryNanos +
+                   kBoundaryNanosPerByte *
+                           TypeManager::get()->getSizeOfData(mOperands[operandIndex]);
+        };
+        const Operation& operation = getOperation(operationIndex);
+        float boundaryNanos = 0.0f;
+        for (uint32_t operandIndex : operation.inputs) {
+            const uint32_t writerIndex = writer[operandIndex];
+            if (writerIndex != kNoWriter && bestDevice[writerIndex] != deviceIndex) {
+                boundaryNanos += getTransferNanos(operandIndex);
+            }
+        }
+        for (uint32_t operandIndex : operation.outputs) {
+            for (uint32_t readerIndex : readers[operandIndex]) {
+                if (bestDevice[readerIndex] != deviceIndex) {
+                    boundaryNanos += getTransferNanos(operandIndex);
+                }
+            }
+        }
+        return boundaryNanos;
+    };
+
+    // Start from the fastest device for each operation, then move operations
+    // to other devices as long as this lowers the total of the computation
+    // and boundary times. Every move strictly lowers the total, so this
+    // cannot cycle.
+    for (uint32_t operationIndex = 0; operationIndex < operationCount; operationIndex++) {
+        const std::vector<float>& operationNanos = nanos[operationIndex];
+        if (!operationNanos.empty()) {
+            bestDevice[operationIndex] =
+                    std::min_element(operationNanos.begin(), operationNanos.end()) -
+                    operationNanos.begin();
+        }
+    }
+    bool moved = true;
+    for (int pass = 0; pass < kMaxPasses && moved; pass++) {
+        moved = false;
+        for (uint32_t operationIndex = 0; operationIndex < operationCount; operationIndex++) {
+            const std::vector<float>& operationNanos = nanos[operationIndex];
+            if (operationNanos.empty()) {
+                continue;
+            }
+            int& current = bestDevice[operationIndex];
+            float currentNanos =
+                    operationNanos[current] + getBoundaryNanos(operationIndex, current);
+            for (size_t deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++) {
+                if (operationNanos[deviceIndex] == kCannotDo) {
+                    continue;
+                }
+                const float deviceNanos =
+                        operationNanos[deviceIndex] + getBoundaryNanos(operationIndex, deviceIndex);
+                if (deviceNanos < currentNanos) {
+                    current = deviceIndex;
+                    currentNanos = deviceNanos;
+                    moved = true;
+                }
+            }
+        }
+    }
+
+    for (uint32_t operationIndex = 0; operationIndex < operationCount; operationIndex++) {
+        if (!nanos[operationIndex].empty()) {
+            VLOG(COMPILATION) << "ModelBuilder::applyPartitioningProfile("
+                              << getOperation(operationIndex).type << ":" << operationIndex
+                              << ") = " << bestDevice[operationIndex] << " ("
+                              << devices[bestDevice[operationIndex]]->getName() << ")";
+        }
+    }
+}
+
+void ModelBuilder::minimizePartitionBoundaries(
+        size_t deviceCount,
+        const std::function<bool(size_t deviceIndex, uint32_t operationIndex)>& canDo,
+        std::vector<int>* bestDeviceForOperation) const {
+    // The cost of a temporary crossing a boundary, on top of its size, so
+    // that temporaries of small or unknown size still count: each one is an
+    // extra output of a step, and often an extra step.
+    constexpr uint64_t kBoundaryOverheadBytes = 1024;
+    // Moving an operation can make it worthwhile to move its neighbours, so
+    // we make several passes, but a few are enough for the chains of
+    // operations that a single move cannot merge.
+    constexpr int kMaxPasses = 8;
+    constexpr uint32_t kNoWriter = std::numeric_limits<uint32_t>::max();
+
+    const int kControlFlowInterpreter = deviceCount;
+    const uint32_t operationCount = mOperations.size();
+    std::vector<int>& bestDevice = *bestDeviceForOperation;
+
+    // The operation that writes and the operations that read each temporary.
+    std::vector<uint32_t> writer(mOperands.size(), kNoWriter);
+    std::vector<std::vector<uint32_t>> readers(mOperands.size());
+    for (uint32_t operationIndex = 0; operationIndex < operationCount; operationIndex++) {
+        const Operation& operation = getOperation(operationIndex);
+        for (uint32_t operandIndex : operation.inputs) {
+            if (mOperands[operandIndex].lifetime == Operand::LifeTime::TEMPORARY_VARIABLE) {
+                readers[operandIndex].push_back(operationIndex);
+            }
+        }
+        for (uint32_t operandIndex : operation.outputs) {
+            if (mOperands[operandIndex].lifetime == Operand::LifeTime::TEMPORARY_VARIABLE) {
+                writer[operandIndex] = operationIndex;
+            }
+        }
+    }
+
+    // A temporary is passed once to each device other than its writer's that
+    // reads it.
+    const auto getTemporaryCost = [this, &writer, &readers, &bestDevice](uint32_t operandIndex) {
+        const int writerDevice = bestDevice[writer[operandIndex]];
+        std::set<int> readerDevices;
+        for (uint32_t readerIndex : readers[operandIndex]) {
+            if (bestDevice[readerIndex] != writerDevice) {
+                readerDevices.insert(bestDevice[readerIndex]);
+            }
+        }
+        const uint64_t bytes = TypeManager::get()->getSizeOfData(mOperands[operandIndex]);
+        return readerDevices.size() * (kBoundaryOverheadBytes + bytes);
+    };
+    const auto getOperationCost = [this, &writer, &getTemporaryCost](uint32_t operationIndex) {
+        const Operation& operation = getOperation(operationIndex);
+        uint64_t cost = 0;
+        for (uint32_t operandIndex : operation.inputs) {
+            if (writer[operandIndex] != kNoWriter) {
+                cost += getTemporaryCost(operandIndex);
+            }
+        }
+        for (uint32_t operandIndex : operation.outputs) {
+            if (writer[operandIndex] != kNoWriter) {
+                cost += getTemporaryCost(operandIndex);
+            }
+        }
+        return cost;
+    };
+
+    // Move each operation to the device that its temporaries are passed from
+    // or to, if that device can run it. Every move strictly lowers the total
+    // cost of the temporaries, so this cannot cycle. Control flow operations
+    // stay where findBestDeviceForEachOperation put them, since they may be
+    // restricted to the CPU or to the interpreter.
+    bool moved = true;
+    for (int pass = 0; pass < kMaxPasses && moved; pass++) {
+        moved = false;
+        for (uint32_t operationIndex = 0; operationIndex < operationCount; operationIndex++) {
+            const OperationType type = getOperation(operationIndex).type;
+            int& current = bestDevice[operationIndex];
+            if (current == kControlFlowInterpreter || type == OperationType::IF ||
+                type == OperationType::WHILE) {
+                continue;
+            }
+            const int original = current;
+            int best = original;
+            uint64_t bestCost = getOperationCost(operationIndex);
+            if (bestCost == 0) {
+                continue;
+            }
+            for (size_t deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++) {
+                if (int(deviceIndex) == original || !canDo(deviceIndex, operationIndex)) {
+                    continue;
+                }
+                current = deviceIndex;
+                const uint64_t cost = getOperationCost(operationIndex);
+                if (cost < bestCost) {
+                    best = deviceIndex;
+                    bestCost = cost;
+                }
+            }
+            current = best;
+            if (best != original) {
+                moved = true;
+                VLOG(COMPILATION) << "ModelBuilder::minimizePartitionBoundaries(" << type << ":"
+                                  << operationIndex << ") = " << best;
+            }
+        }
+    }
+}
+
 }  // namespace nn
 }  // namespace android
@@ -172,6 +172,12 @@ class DynamicTemporaries {
     // (Will be true if there are no dynamic temporaries defined by this step.)
     bool allocated(uint32_t stepIndex) const;
 
+    // Forget the dimensions learned during an execution, so that the
+    // temporaries can be used by another execution of the same plan.  Lengths
+    // and allocations are kept, as they are a good guess of what the other
+    // execution needs.
+    void resetDimensions();
+
     // Dump information to VLOG(EXECUTION).
     void vlogDump(const char* context = nullptr) const;
 
@@ -204,6 +210,8 @@ class DynamicTemporaries {
         uint32_t paddedLength;
         uint32_t alignment;
         uint32_t padding;
+        // The dimensions passed to declare().
+        Dimensions initialDimensions;
     };
     std::map<SourceOperandIndex, InternalLocationAndShape> mSourceOperandToTemporary;
 
@@ -267,6 +275,12 @@ class ExecutionStep {
 
     uint32_t getIndex() const { return mIndex; }
     uint32_t getSourceModelIndex() const { return mSourceModelIndex; }
+    const ModelBuilder* getSourceModel() const;
+
+    // The indexes of the operations of the source model run by this step.
+    const std::vector<uint32_t>& getSourceOperationIndexes() const {
+        return mSourceOperationIndexes;
+    }
 
     void declareModelOutputIsDownstreamInput(uint32_t mainModelOutputIndex);
     void recordTempAsStepModelOutput(uint32_t stepOperandIndex);
@@ -315,7 +329,6 @@ class ExecutionStep {
 
    private:
     void logStepModel() const;
-    const ModelBuilder* getSourceModel() const;
 
     // TODO: Some of the data is working state information that
     // shouldn't be needed after we've constructed but not executed
@@ -325,6 +338,7 @@ class ExecutionStep {
     uint32_t mIndex;  // index of step within plan
     uint32_t mSourceModelIndex;
     ModelBuilder mStepModel;  // An excerpt of a source model to be run by one device.
+    std::vector<uint32_t> mSourceOperationIndexes;
     std::shared_ptr<Device> mDevice;
     std::shared_ptr<RuntimePreparedModel> mPreparedStepModel;
 
@@ -587,9 +601,17 @@ class ExecutionPlan {
     //   signifying there are no more steps.
     // - If ExecutionPlan::next() returns anything other than ANEURALNETWORKS_NO_ERROR,
     //   a problem has occurred.
+    // - A Controller made for a reusable execution may be used for another
+    //   main execution after a call to ExecutionPlan::resetController().
     class Controller {
         friend class ExecutionPlan;
 
+       public:
+        // The size of the memory holding the static temporaries, and the size
+        // it would have if no two temporaries shared storage.
+        uint32_t getSizeOfTemporaries() const { return mSizeOfTemporaries; }
+        uint32_t getSummedSizeOfTemporaries() const { return mSummedSizeOfTemporaries; }
+
        private:
         Controller(const Controller&) = delete;
         Controller& operator=(const Controller&) = delete;
@@ -601,7 +623,7 @@ class ExecutionPlan {
                    const BurstBuilder* burstBuilder,
 
                    // static temporaries
-                   uint32_t totalSizeOfTemporaries,
+                   uint32_t totalSizeOfTemporaries, uint32_t summedSizeOfTemporaries,
                    std::map<SourceOperandIndex, StaticTemporaryLocation>
                            sourceOperandToLocationOfTemporary,
                    std::map<SourceOperandIndex, StaticTemporaryLocation>
@@ -659,6 +681,8 @@ class ExecutionPlan {
 
         // static temporaries
         std::unique_ptr<MemoryAshmem> mTemporaries;
+        uint32_t mSizeOfTemporaries;
+        uint32_t mSummedSizeOfTemporaries;
 
         DynamicTemporaries mDynamicTemporaries;
 
@@ -670,13 +694,48 @@ class ExecutionPlan {
         std::unordered_map<size_t, WhileState> mWhileState;
         // The sync fence fd of the last step.
         int mLastStepSyncFd;
+
+        // Is the Controller kept across the computations of a reusable
+        // execution?  See ExecutionPlan::resetController().
+        bool mReusable = false;
+        // Does the plan have an IfStep or a WhileStep, which modify the
+        // location maps above?
+        bool mHasControlFlowSteps = false;
+        // The initial contents of mSourceOperandToLocationOfTemporary and
+        // mSourceOperandToLocationOfTemporary2.  Only set if mReusable and
+        // mHasControlFlowSteps.
+        std::map<SourceOperandIndex, StaticTemporaryLocation>
+                mInitialSourceOperandToLocationOfTemporary;
+        std::map<SourceOperandIndex, StaticTemporaryLocation>
+                mInitialSourceOperandToLocationOfTemporary2;
+        // Map from step index to a reusable StepExecutor, made the first time
+        // the step is executed.  Only used if mReusable and the inputs and
+        // outputs of the steps cannot change between computations, i.e. if
+        // the plan has neither control flow steps nor dynamic temporaries,
+        // and if the Controller was made for a particular execution; empty
+        // otherwise.  See ExecutionPlan::nextCompound(const ExecutionStep*, ...).
+        std::vector<std::shared_ptr<StepExecutor>> mStepExecutors;
     };
 
     std::vector<SharedBurst> makeBursts() const;
 
     // Only legal to call when mState == COMPOUND.
+    // If reusable is true, the Controller may be reset with resetController()
+    // and used for another computation. executionBuilder may then be nullptr,
+    // in which case resetController() must be called before next(), and the
+    // Controller may be used for a different execution in each computation.
     std::shared_ptr<Controller> makeController(ExecutionBuilder* executionBuilder,
-                                               const BurstBuilder* burstBuilder) const;
+                                               const BurstBuilder* burstBuilder,
+                                               bool reusable) const;
+
+    // Prepares a Controller made by makeController() with reusable == true for
+    // another computation of executionBuilder, keeping its temporaries and
+    // StepExecutors. executionBuilder must be the one passed to
+    // makeController(), unless that was nullptr.
+    // Only legal to call when mState == COMPOUND.
+    void resetController(std::shared_ptr<Controller> controller,
+                         ExecutionBuilder* executionBuilder,
+                         const BurstBuilder* burstBuilder) const;
 
     // Sets up a new StepExecutor and burstController (if applicable) if there
     // is a step to execute. See ExecutionPlan::Controller.
@@ -734,6 +793,10 @@ class ExecutionPlan {
     const CacheInfo* getCacheInfo() const { return mCacheInfo; }
     const uint8_t* getCacheToken() const { return mToken; }
 
+    // One of DeviceManager::kPartitioningStrategy*.
+    void setPartitioningStrategy(uint32_t strategy) { mPartitioningStrategy = strategy; }
+    uint32_t getPartitioningStrategy() const { return mPartitioningStrategy; }
+
     // The caller is responsible for making sure the index is within range.
     void forEachStepRoleOfInput(uint32_t index, const StepRoleCallback& callback) const {
         CHECK(mBody != nullptr);
@@ -758,6 +821,11 @@ class ExecutionPlan {
 
     bool hasDynamicTemporaries() const;
 
+    // Returns the number of steps of a compound plan that runs the same
+    // ExecutionSteps in the same order in every execution, i.e. that has
+    // neither control flow steps nor dynamic temporaries; 0 otherwise.
+    size_t getStraightLineStepCount() const;
+
     // These functions are solely intended for use by unit tests of
     // the partitioning algorithm.
     enum class Kind {
@@ -938,6 +1006,14 @@ class ExecutionPlan {
         // does not have any ExecutionStep role (this may happen with interpreted control flow).
         std::map<SourceOperandIndex, std::set<StepRole>> mSourceOperandToStepRoles;
 
+        // Map from source operand index to the first and last indexes of the
+        // steps during which its memory must stay valid, for the operands
+        // that ExecutionPlan::makeController() allocates static temporary
+        // memory for. Steps of a WHILE loop run repeatedly, so operands used
+        // across its iterations live for the whole loop; boundary constants
+        // are copied once and live for the whole plan.
+        std::map<SourceOperandIndex, std::pair<uint32_t, uint32_t>> mSourceOperandToStepRange;
+
         bool mHasDynamicTemporaries = false;
 
        private:
@@ -966,6 +1042,9 @@ class ExecutionPlan {
         // This method will set mSourceOperandToStepRoles.
         void findMemoryStepRoles();
 
+        // This method will set mSourceOperandToStepRange.
+        void findTemporaryStepRanges();
+
         const ExecutionPlan* mPlan;
     };
 
@@ -999,6 +1078,9 @@ class ExecutionPlan {
     const CacheInfo* mCacheInfo = nullptr;
     const uint8_t* mToken = nullptr;
 
+    // Captured from CompilationBuilder. 0 is DeviceManager::kPartitioningStrategyGreedy.
+    uint32_t mPartitioningStrategy = 0;
+
     SourceModels mSourceModels;
 };
 
@@ -37,9 +37,11 @@
 #include <iterator>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <regex>
 #include <set>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -957,29 +959,51 @@ class CpuPreparedModel : public RuntimePreparedModel {
     }
 
     // Prefer to use CpuPreparedModel::create.
-    CpuPreparedModel(Model model, std::vector<RunTimePoolInfo> poolInfos)
-        : mModel(std::move(model)), mModelPoolInfos(std::move(poolInfos)) {}
+    CpuPreparedModel(Model model, std::vector<RunTimePoolInfo> poolInfos,
+                     CpuFusionPlan fusionPlan, CpuMemoryPlan memoryPlan,
+                     std::vector<CpuMemoryPlan> referencedMemoryPlans)
+        : mModel(std::move(model)),
+          mModelPoolInfos(std::move(poolInfos)),
+          mFusionPlan(std::move(fusionPlan)),
+          mMemoryPlan(std::move(memoryPlan)),
+          mReferencedMemoryPlans(std::move(referencedMemoryPlans)),
+          mFloat16ConstantCache(CpuFloat16ConstantCache::create(mModel, mModelPoolInfos)) {}
 
     const Model& getModel() const { return mModel; }
     const std::vector<RunTimePoolInfo>& getModelPoolInfos() const { return mModelPoolInfos; }
+    const CpuFusionPlan& getFusionPlan() const { return mFusionPlan; }
+    const CpuMemoryPlan& getMemoryPlan() const { return mMemoryPlan; }
+    const std::vector<CpuMemoryPlan>& getReferencedMemoryPlans() const {
+        return mReferencedMemoryPlans;
+    }
+    const CpuFloat16ConstantCache& getFloat16ConstantCache() const {
+        return mFloat16ConstantCache;
+    }
 
    private:
-    // TFLite kernels prefers 64 bytes for padding and alignment.
-    static constexpr uint32_t kPreferredAlignment = 64;
-    static constexpr uint32_t kPreferredPadding = 64;
+    static constexpr uint32_t kPreferredAlignment = kTfliteKernelAlignment;
+    static constexpr uint32_t kPreferredPadding = kTfliteKernelAlignment;
 
     const Model mModel;
     const std::vector<RunTimePoolInfo> mModelPoolInfos;
+    const CpuFusionPlan mFusionPlan;
+    const CpuMemoryPlan mMemoryPlan;
+    // The memory plans of the subgraphs in mModel.referenced, in the same order.
+    const std::vector<CpuMemoryPlan> mReferencedMemoryPlans;
+    // Created from mModel and mModelPoolInfos, which must be initialized first.
+    const CpuFloat16ConstantCache mFloat16ConstantCache;
 };
 
 class CpuExecution : public RuntimeExecution {
    public:
-    CpuExecution(const CpuPreparedModel& preparedModel, Request request,
-                 std::vector<RunTimePoolInfo> requestPoolInfos,
+    // The operand table must have been prepared for the model of
+    // preparedModel and the given request pools.
+    CpuExecution(const CpuPreparedModel& preparedModel,
+                 std::vector<RunTimePoolInfo> requestPoolInfos, RunTimeOperandTable operandTable,
                  OptionalDuration loopTimeoutDuration)
         : kPreparedModel(preparedModel),
-          kRequest(std::move(request)),
           kRequestPoolInfos(std::move(requestPoolInfos)),
+          mOperandTable(std::move(operandTable)),
           kLoopTimeoutDuration(std::move(loopTimeoutDuration)) {}
 
     std::tuple<int, std::vector<OutputShape>, Timing> compute(
@@ -991,8 +1015,11 @@ class CpuExecution : public RuntimeExecution {
 
    private:
     const CpuPreparedModel& kPreparedModel;
-    Request kRequest;
-    std::vector<RunTimePoolInfo> kRequestPoolInfos;
+    const std::vector<RunTimePoolInfo> kRequestPoolInfos;
+    // The operands of the model bound to the request, built once at creation
+    // and reset by every computation. Guarded by mMutex.
+    mutable RunTimeOperandTable mOperandTable;
+    mutable std::mutex mMutex;
     const OptionalDuration kLoopTimeoutDuration;
 };
 
@@ -1066,29 +1093,103 @@ std::pair<int, std::shared_ptr<RuntimePreparedModel>> CpuPreparedModel::create(M
         return {ANEURALNETWORKS_UNMAPPABLE, nullptr};
     }
 
-    std::shared_ptr<RuntimePreparedModel> preparedModel =
-            std::make_shared<CpuPreparedModel>(std::move(model), std::move(poolInfos));
+    // The fusion plan is left empty when fusion is disabled, so that the
+    // results can be compared with those of the unfused operations.
+    CpuFusionPlan fusionPlan = DeviceManager::get()->isCpuFusionEnabled()
+                                       ? CpuFusionPlan::create(model.main)
+                                       : CpuFusionPlan();
+    CpuMemoryPlan memoryPlan = CpuMemoryPlan::create(model.main, &fusionPlan);
+    // The referenced subgraphs are only planned for the serial execution of
+    // WHILE loops, which never uses a fusion plan.
+    std::vector<CpuMemoryPlan> referencedMemoryPlans;
+    referencedMemoryPlans.reserve(model.referenced.size());
+    for (const Model::Subgraph& subgraph : model.referenced) {
+        referencedMemoryPlans.push_back(CpuMemoryPlan::create(subgraph));
+    }
+    std::shared_ptr<RuntimePreparedModel> preparedModel = std::make_shared<CpuPreparedModel>(
+            std::move(model), std::move(poolInfos), std::move(fusionPlan), std::move(memoryPlan),
+            std::move(referencedMemoryPlans));
     return {ANEURALNETWORKS_NO_ERROR, std::move(preparedModel)};
 }
 
-static std::tuple<int, std::vector<OutputShape>, Timing> computeOnCpu(
-        const Model& model, const Request& request,
-        const std::vector<RunTimePoolInfo>& modelPoolInfos,
-        const std::vector<RunTimePoolInfo>& requestPoolInfos, const OptionalTimePoint& deadline,
-        const OptionalDuration& loopTimeoutDuration) {
-    NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "computeOnCpu");
+// Returns the worker threads shared by all CPU executions that run independent
+// operations concurrently. The pool is intentionally never destroyed, so that
+// it remains usable by executions still running during process exit.
+static ThreadPool* getCpuOperationThreadPool() {
+    const DeviceManager* manager = DeviceManager::get();
+    static ThreadPool* const pool = new ThreadPool(manager->getCpuMaxConcurrency(),
+                                                   manager->getThreadPoolCpuAffinityMask());
+    return pool;
+}
+
+// Creates an executor configured for the CPU device.
+static CpuExecutor createCpuExecutor(const CpuFusionPlan& fusionPlan,
+                                     const CpuMemoryPlan& memoryPlan,
+                                     const std::vector<CpuMemoryPlan>& referencedMemoryPlans,
+                                     const CpuFloat16ConstantCache& float16ConstantCache,
+                                     const OptionalTimePoint& deadline,
+                                     const OptionalDuration& loopTimeoutDuration) {
     CpuExecutor executor;
+    executor.setFusionPlan(&fusionPlan);
+    executor.setMemoryPlan(&memoryPlan);
+    executor.setReferencedMemoryPlans(&referencedMemoryPlans);
+    executor.setFloat16ConstantCache(&float16ConstantCache);
+    if (const uint32_t maxConcurrency = DeviceManager::get()->getCpuMaxConcurrency();
+        maxConcurrency > 1) {
+        executor.setInterOperationParallelism(getCpuOperationThreadPool(), maxConcurrency);
+    }
     if (loopTimeoutDuration.has_value()) {
         executor.setLoopTimeout(loopTimeoutDuration->count());
     }
     if (deadline.has_value()) {
         executor.setDeadline(*deadline);
     }
+    return executor;
+}
+
+// Runs a CPU computation on the execution pool, unless the calling thread is
+// already a persistent worker thread, e.g. one running an asynchronous
+// execution, in which case the computation runs inline rather than occupying a
+// second thread.
+static void runOnCpuExecutionThread(const std::function<void()>& computation) {
+    if (ThreadPool::isAnyWorkerThread()) {
+        computation();
+        return;
+    }
+    DeviceManager::get()->getExecutionThreadPool()->runAndWait(computation);
+}
+
+static std::tuple<int, std::vector<OutputShape>, Timing> computeOnCpu(
+        const Model& model, const Request& request,
+        const std::vector<RunTimePoolInfo>& modelPoolInfos, const CpuFusionPlan& fusionPlan,
+        const CpuMemoryPlan& memoryPlan, const std::vector<CpuMemoryPlan>& referencedMemoryPlans,
+        const CpuFloat16ConstantCache& float16ConstantCache,
+        const std::vector<RunTimePoolInfo>& requestPoolInfos, const OptionalTimePoint& deadline,
+        const OptionalDuration& loopTimeoutDuration) {
+    NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "computeOnCpu");
+    CpuExecutor executor = createCpuExecutor(fusionPlan, memoryPlan, referencedMemoryPlans,
+                                             float16ConstantCache, deadline, loopTimeoutDuration);
     int err = executor.run(model, request, modelPoolInfos, requestPoolInfos);
     const auto& outputShapes = executor.getOutputShapes();
     return {err, outputShapes, {}};
 }
 
+// Same as above, but reuses an operand table prepared for the model and request.
+static std::tuple<int, std::vector<OutputShape>, Timing> computeOnCpu(
+        const Model& model, RunTimeOperandTable* operandTable,
+        const std::vector<RunTimePoolInfo>& modelPoolInfos, const CpuFusionPlan& fusionPlan,
+        const CpuMemoryPlan& memoryPlan, const std::vector<CpuMemoryPlan>& referencedMemoryPlans,
+        const CpuFloat16ConstantCache& float16ConstantCache,
+        const std::vector<RunTimePoolInfo>& requestPoolInfos, const OptionalTimePoint& deadline,
+        const OptionalDuration& loopTimeoutDuration) {
+    NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "computeOnCpu");
+    CpuExecutor executor = createCpuExecutor(fusionPlan, memoryPlan, referencedMemoryPlans,
+                                             float16ConstantCache, deadline, loopTimeoutDuration);
+    int err = executor.run(model, operandTable, modelPoolInfos, requestPoolInfos);
+    const auto& outputShapes = executor.getOutputShapes();
+    return {err, outputShapes, {}};
+}
+
 std::tuple<int, int, ExecuteFencedInfoCallback, Timing> CpuPreparedModel::executeFenced(
         const std::vector<ModelArgumentInfo>& inputs, const std::vector<ModelArgumentInfo>& outputs,
         const std::vector<const RuntimeMemory*>& memories, const std::vector<int>& waitFor,
@@ -1186,18 +1287,19 @@ std::tuple<int, std::vector<OutputShape>, Timing> CpuPreparedModel::execute(
     }
 
     if (!DeviceManager::get()->syncExecCpu()) {
-        // TODO: use a thread pool
-        // TODO(mikie): this could have NNTRACE so we could measure the overhead
-        //              of spinning up a new thread.
         std::tuple<int, std::vector<OutputShape>, Timing> result = {};
-        std::thread([this, &request, &requestPoolInfos, &deadline, &loopTimeoutDuration, &result] {
-            result = computeOnCpu(mModel, request, mModelPoolInfos, requestPoolInfos, deadline,
-                                  loopTimeoutDuration);
-        }).join();
+        runOnCpuExecutionThread(
+                [this, &request, &requestPoolInfos, &deadline, &loopTimeoutDuration, &result] {
+                    result = computeOnCpu(mModel, request, mModelPoolInfos, mFusionPlan,
+                                          mMemoryPlan, mReferencedMemoryPlans,
+                                          mFloat16ConstantCache, requestPoolInfos, deadline,
+                                          loopTimeoutDuration);
+                });
         return result;
     }
 
-    return computeOnCpu(mModel, request, mModelPoolInfos, requestPoolInfos, deadline,
+    return computeOnCpu(mModel, request, mModelPoolInfos, mFusionPlan, mMemoryPlan,
+                        mReferencedMemoryPlans, mFloat16ConstantCache, requestPoolInfos, deadline,
                         loopTimeoutDuration);
 }
 
@@ -1210,8 +1312,13 @@ std::pair<int, std::shared_ptr<RuntimeExecution>> CpuPreparedModel::createReusab
     if (nCreateRequest != ANEURALNETWORKS_NO_ERROR) {
         return {nCreateRequest, nullptr};
     }
-    auto execution = std::make_shared<CpuExecution>(
-            *this, std::move(request), std::move(requestPoolInfos), loopTimeoutDuration);
+    // Bind the operands to the request once, so that each computation only resets them.
+    RunTimeOperandTable operandTable =
+            createCpuExecutor(mFusionPlan, mMemoryPlan, mReferencedMemoryPlans,
+                              mFloat16ConstantCache, {}, loopTimeoutDuration)
+                    .prepareOperandTable(mModel, request, mModelPoolInfos, requestPoolInfos);
+    auto execution = std::make_shared<CpuExecution>(*this, std::move(requestPoolInfos),
+                                                    std::move(operandTable), loopTimeoutDuration);
     return {ANEURALNETWORKS_NO_ERROR, std::move(execution)};
 }
 
@@ -1221,21 +1328,25 @@ std::tuple<int, std::vector<OutputShape>, Timing> CpuExecution::compute(
         return {ANEURALNETWORKS_MISSED_DEADLINE_PERSISTENT, {}, {}};
     }
 
+    std::lock_guard<std::mutex> guard(mMutex);
     if (!DeviceManager::get()->syncExecCpu()) {
-        // TODO: use a thread pool
-        // TODO(mikie): this could have NNTRACE so we could measure the overhead
-        //              of spinning up a new thread.
         std::tuple<int, std::vector<OutputShape>, Timing> result = {};
-        std::thread([this, &deadline, &result] {
-            result = computeOnCpu(kPreparedModel.getModel(), kRequest,
-                                  kPreparedModel.getModelPoolInfos(), kRequestPoolInfos, deadline,
-                                  kLoopTimeoutDuration);
-        }).join();
+        runOnCpuExecutionThread([this, &deadline, &result] {
+            result = computeOnCpu(kPreparedModel.getModel(), &mOperandTable,
+                                  kPreparedModel.getModelPoolInfos(),
+                                  kPreparedModel.getFusionPlan(), kPreparedModel.getMemoryPlan(),
+                                  kPreparedModel.getReferencedMemoryPlans(),
+                                  kPreparedModel.getFloat16ConstantCache(), kRequestPoolInfos,
+                                  deadline, kLoopTimeoutDuration);
+        });
         return result;
     }
 
-    return computeOnCpu(kPreparedModel.getModel(), kRequest, kPreparedModel.getModelPoolInfos(),
-                        kRequestPoolInfos, deadline, kLoopTimeoutDuration);
+    return computeOnCpu(kPreparedModel.getModel(), &mOperandTable,
+                        kPreparedModel.getModelPoolInfos(), kPreparedModel.getFusionPlan(),
+                        kPreparedModel.getMemoryPlan(), kPreparedModel.getReferencedMemoryPlans(),
+                        kPreparedModel.getFloat16ConstantCache(), kRequestPoolInfos, deadline,
+                        kLoopTimeoutDuration);
 }
 
 std::tuple<int, int, ExecuteFencedInfoCallback, Timing> CpuExecution::computeFenced(
@@ -1279,6 +1390,31 @@ std::shared_ptr<Device> DeviceManager::getCpuDevice() {
     return CpuDevice::get();
 }
 
+ThreadPool* DeviceManager::makeThreadPool(const char* name, uint32_t size) const {
+    VLOG(MANAGER) << "Creating " << name << " thread pool with " << size << " threads";
+    return new ThreadPool(size, mThreadPoolCpuAffinityMask);
+}
+
+ThreadPool* DeviceManager::getExecutionThreadPool() const {
+    // The pool is created on first use and intentionally never destroyed, so
+    // that it remains usable by executions still running during process exit.
+    static ThreadPool* const pool = makeThreadPool(
+            "execution", mExecutionThreadPoolSize != 0
+                                 ? mExecutionThreadPoolSize
+                                 : std::max(std::thread::hardware_concurrency(), 1u));
+    return pool;
+}
+
+ThreadPool* DeviceManager::getAsyncExecutionThreadPool() const {
+    // Same lifetime as the execution thread pool above.
+    static ThreadPool* const pool = makeThreadPool(
+            "asynchronous execution",
+            mAsyncExecutionThreadPoolSize != 0
+                    ? mAsyncExecutionThreadPoolSize
+                    : std::max(2 * std::thread::hardware_concurrency(), 1u));
+    return pool;
+}
+
 std::shared_ptr<Device> DeviceManager::forTest_makeDriverDevice(const SharedDevice& device) {
     VLOG(MANAGER) << "forTest_makeDriverDevice(" << device->getName() << ")";
     const auto driverDevice = DriverDevice::create(device);
@@ -1364,9 +1500,16 @@ DeviceManager::DeviceManager() {
 #ifdef NN_DEBUGGABLE
     mStrictSlicing = (getProp("debug.nn.strict-slicing") != 0);
     mPartitioning = getProp("debug.nn.partition", kPartitioningDefault);
+    mPartitioningStrategy = getProp("debug.nn.partitioning-strategy", kPartitioningStrategyGreedy);
     mDebugNNCpuOnly = (getProp("debug.nn.cpuonly") != 0);
     mSyncExecCpu = (getProp("debug.nn.syncexec-cpu", 1) != 0);
     mSyncExecRuntime = (getProp("debug.nn.syncexec-runtime") != 0);
+    mCpuMaxConcurrency = std::max(getProp("debug.nn.cpu-max-concurrency", 1), 1u);
+    mCpuFusion = (getProp("debug.nn.cpu-fusion", 1) != 0);
+    mPartitioningProfile = (getProp("debug.nn.partitioning-profile") != 0);
+    mExecutionThreadPoolSize = getProp("debug.nn.thread-pool-size");
+    mAsyncExecutionThreadPoolSize = getProp("debug.nn.async-thread-pool-size");
+    mThreadPoolCpuAffinityMask = getProp("debug.nn.thread-pool-cpu-mask");
 #endif  // NN_DEBUGGABLE
 }
 
@@ -18,6 +18,7 @@
 #define ANDROID_PACKAGES_MODULES_NEURALNETWORKS_RUNTIME_MANAGER_H
 
 #include <LegacyUtils.h>
+#include <ThreadPool.h>
 #include <android-base/macros.h>
 #include <nnapi/IBurst.h>
 #include <nnapi/IDevice.h>
@@ -192,6 +193,39 @@ class DeviceManager {
     bool syncExecCpu() const { return mSyncExecCpu; }
     bool syncExecRuntime() const { return mSyncExecRuntime; }
 
+    // The maximum number of independent operations the CPU device may run
+    // concurrently within one execution. 1 means serial execution.
+    uint32_t getCpuMaxConcurrency() const { return mCpuMaxConcurrency; }
+
+    // Whether the CPU device runs chains of elementwise operations as fused
+    // kernels. Disabling it allows comparing against the unfused operations.
+    bool isCpuFusionEnabled() const { return mCpuFusion; }
+
+    // Whether executions record the time each device takes to run their
+    // operations, so that later compilations of models with the same
+    // architecture are partitioned using the measured times.
+    bool isPartitioningProfileEnabled() const { return mPartitioningProfile; }
+
+    // Returns the process-wide pool of worker threads that runs CPU executions
+    // when syncExecCpu() is false.
+    ThreadPool* getExecutionThreadPool() const;
+
+    // Returns the process-wide pool of worker threads that runs asynchronous
+    // executions. It is separate from getExecutionThreadPool(), so that long
+    // asynchronous executions do not queue synchronous CPU executions behind
+    // them. CPU executions started from its workers run inline.
+    //
+    // startCompute() never blocks: once every worker is busy, further
+    // asynchronous executions wait in FIFO order until a worker is free, e.g.
+    // behind a slow driver. Since such executions mostly wait on drivers
+    // rather than use a core, the pool has twice as many threads as there are
+    // cores by default, or as set by debug.nn.async-thread-pool-size.
+    ThreadPool* getAsyncExecutionThreadPool() const;
+
+    // The CPU affinity hint for the worker threads of the runtime, as a
+    // bitmask of CPUs. 0 means no hint.
+    uint64_t getThreadPoolCpuAffinityMask() const { return mThreadPoolCpuAffinityMask; }
+
     // How to handle graph partitioning?
     // 0 - Don't do graph partitioning.
     // 1 - Do graph partitioning; but fall back to non-partitioned
@@ -203,6 +237,17 @@ class DeviceManager {
         return partitioning == kPartitioningWithFallback;
     }
 
+    // How to split the work among the devices?
+    // 0 - Run each operation on its best device, and make a step of as many
+    //     ready operations of the same device as possible.
+    // 1 - Move operations to the device of their neighbours when this lowers
+    //     the number of bytes passed between devices, and choose the order of
+    //     the steps so that each one runs as many operations as possible.
+    //     This trades some of the performance of the individual operations
+    //     for fewer steps and less data copied between them.
+    enum { kPartitioningStrategyGreedy = 0, kPartitioningStrategyMinimizeBoundaries = 1 };
+    uint32_t getPartitioningStrategy() const { return mPartitioningStrategy; }
+
     bool strictSlicing() const { return mStrictSlicing; }
 
     // Returns the singleton manager.
@@ -247,6 +292,10 @@ class DeviceManager {
 
     void findAvailableDevices();
 
+    // Makes a pool of size worker threads with the CPU affinity hint. name is
+    // only logged.
+    ThreadPool* makeThreadPool(const char* name, uint32_t size) const;
+
     // Runtime version corresponding to getServerFeatureLevelFlag (in ServerFlag.h).
     Version mRuntimeVersion;
 
@@ -269,9 +318,28 @@ class DeviceManager {
     bool mSyncExecCpu = true;
     bool mSyncExecRuntime = false;
 
+    // derived from system property debug.nn.cpu-max-concurrency
+    uint32_t mCpuMaxConcurrency = 1;
+
+    // derived from system property debug.nn.cpu-fusion
+    bool mCpuFusion = true;
+
+    // derived from system property debug.nn.partitioning-profile
+    bool mPartitioningProfile = false;
+
+    // worker thread pool configuration, derived from system properties
+    // debug.nn.thread-pool-size, debug.nn.async-thread-pool-size and
+    // debug.nn.thread-pool-cpu-mask; a size of 0 means the default
+    uint32_t mExecutionThreadPoolSize = 0;
+    uint32_t mAsyncExecutionThreadPoolSize = 0;
+    uint64_t mThreadPoolCpuAffinityMask = 0;
+
     static const uint32_t kPartitioningDefault = kPartitioningWithFallback;
     uint32_t mPartitioning = kPartitioningDefault;
 
+    // derived from system property debug.nn.partitioning-strategy
+    uint32_t mPartitioningStrategy = kPartitioningStrategyGreedy;
+
     bool mStrictSlicing = false;
 };
 
@@ -30,7 +30,8 @@ bool update(SHA256_CTX* hasher, const void* bytes, size_t length) {
     return SHA256_Update(hasher, bytes, length) != 0;
 }
 
-bool updateSubgraph(SHA256_CTX* hasher, const Model::Subgraph& subgraph) {
+bool updateSubgraph(SHA256_CTX* hasher, const Model::Subgraph& subgraph,
+                    const Model::OperandValues* operandValues) {
     bool success = true;
     for (auto& operand : subgraph.operands) {
         success &= update(hasher, static_cast<const void*>(&operand.type), sizeof(operand.type));
@@ -44,6 +45,11 @@ bool updateSubgraph(SHA256_CTX* hasher, const Model::Subgraph& subgraph) {
                           sizeof(operand.lifetime));
         success &= update(hasher, static_cast<const void*>(&operand.extraParams),
                           sizeof(operand.extraParams));
+        if (operandValues != nullptr && operand.lifetime == Operand::LifeTime::CONSTANT_COPY &&
+            operand.dimensions.empty()) {
+            success &= update(hasher, operandValues->data() + operand.location.offset,
+                              operand.location.length);
+        }
     }
 
     for (auto& operation : subgraph.operations) {
@@ -65,18 +71,17 @@ bool updateSubgraph(SHA256_CTX* hasher, const Model::Subgraph& subgraph) {
     return success;
 }
 
-}  // namespace
-
-bool calcModelArchHash(const Model& model, uint8_t* data) {
+// If operandValues is not null, the values of the constant scalar operands are hashed as well.
+bool calcHash(const Model& model, const Model::OperandValues* operandValues, uint8_t* data) {
     SHA256_CTX mHasher;
     if (SHA256_Init(&mHasher) == 0) {
         return false;
     }
 
     bool success = true;
-    success &= updateSubgraph(&mHasher, model.main);
+    success &= updateSubgraph(&mHasher, model.main, operandValues);
     for (auto& subgraph : model.referenced) {
-        success &= updateSubgraph(&mHasher, subgraph);
+        success &= updateSubgraph(&mHasher, subgraph, operandValues);
     }
     if (!success) {
         return false;
@@ -88,4 +93,14 @@ bool calcModelArchHash(const Model& model, uint8_t* data) {
     return true;
 }
 
+}  // namespace
+
+bool calcModelArchHash(const Model& model, uint8_t* data) {
+    return calcHash(model, /*operandValues=*/nullptr, data);
+}
+
+bool calcModelPartitioningHash(const Model& model, uint8_t* data) {
+    return calcHash(model, &model.operandValues, data);
+}
+
 }  // namespace android::nn
@@ -25,6 +25,11 @@ namespace android::nn {
 // Weights do not affect this hash.
 bool calcModelArchHash(const Model& model, uint8_t* data);
 
+// Generated hash from canonical model operations and operands, and from the values of the
+// constant scalar operands, such as the activation or the strides of an operation. Tensor weights
+// do not affect this hash. Used to key the times measured by PartitioningProfile.
+bool calcModelPartitioningHash(const Model& model, uint8_t* data);
+
 static const int BYTE_SIZE_OF_MODEL_ARCH_HASH = 32;
 
 }  // namespace android::nn
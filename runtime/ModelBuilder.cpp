@@ -557,12 +557,17 @@ int ModelBuilder::finish() {
         graphDump("ModelBuilder::finish", modelForValidation, nullptr);
     }
 
+    inlineIfOperationsWithConstantConditions();
     removeTrailingArgumentsWithDefaultValues();
     simplifyModel();
 
     mCompletedModel = true;
     CHECK(calcModelArchHash(modelForValidation, mModelArchHash))
             << "Failed to calculate model arch hash";
+    // The operation indexes of the partitioning profile are those of the finished model, whose
+    // operations differ from modelForValidation once IF operations are inlined.
+    CHECK(calcModelPartitioningHash(makeModel(), mModelPartitioningHash))
+            << "Failed to calculate model partitioning hash";
     return ANEURALNETWORKS_NO_ERROR;
 }
 
@@ -915,6 +920,130 @@ class ModelBuilder::ModelMaker {
     std::set<uint16_t> mPrefixSet;
 };
 
+const ModelBuilder* ModelBuilder::getStaticallyTakenBranch(const Operation& operation) const {
+    namespace op = operation_if;
+    if (operation.type != OperationType::IF) {
+        return nullptr;
+    }
+    const Operand& condition = mOperands[operation.inputs[op::kCondBoolOperand]];
+    const void* valuePtr = nullptr;
+    if (condition.lifetime == Operand::LifeTime::CONSTANT_COPY) {
+        valuePtr = static_cast<const void*>(&mSmallOperandValues[condition.location.offset]);
+    } else if (condition.lifetime == Operand::LifeTime::POINTER) {
+        valuePtr = std::get<const void*>(condition.location.pointer);
+    } else {
+        // CONSTANT_REFERENCE operands are not supported to avoid mapping memory
+        // during compilation.
+        return nullptr;
+    }
+    const bool8 value = *static_cast<const bool8*>(valuePtr);
+    const ModelBuilder* branch = getReferencedModel(
+            mOperands[operation.inputs[value ? op::kThenModelOperand : op::kElseModelOperand]]);
+
+    // The outputs of the IF operation are written by the operations of the branch, so every
+    // branch output has to be written by exactly one of them, and to only one IF output.
+    if (branch->operationCount() == 0) {
+        return nullptr;
+    }
+    std::set<uint32_t> branchOutputs;
+    for (uint32_t index : branch->mOutputIndexes) {
+        if (branch->mOperands[index].lifetime != Operand::LifeTime::SUBGRAPH_OUTPUT ||
+            !branchOutputs.insert(index).second) {
+            return nullptr;
+        }
+    }
+    return branch;
+}
+
+void ModelBuilder::inlineBranch(const Operation& operation, const ModelBuilder& branch,
+                                std::vector<Operation>* operations) {
+    namespace op = operation_if;
+    // Maps the operands of the branch to operands of this model. The inputs and outputs of the
+    // branch become the inputs and outputs of the IF operation, and the other operands are
+    // copied along with their values.
+    std::vector<uint32_t> operandMap(branch.operandCount());
+    for (uint32_t i = 0; i < branch.inputCount(); ++i) {
+        operandMap[branch.mInputIndexes[i]] = operation.inputs[op::kFirstInput + i];
+    }
+    for (uint32_t i = 0; i < branch.outputCount(); ++i) {
+        operandMap[branch.mOutputIndexes[i]] = operation.outputs[i];
+    }
+    for (uint32_t i = 0; i < branch.operandCount(); ++i) {
+        Operand operand = branch.mOperands[i];
+        switch (operand.lifetime) {
+            case Operand::LifeTime::SUBGRAPH_INPUT:
+            case Operand::LifeTime::SUBGRAPH_OUTPUT:
+                continue;
+            case Operand::LifeTime::CONSTANT_COPY: {
+                const uint32_t existingSize = static_cast<uint32_t>(mSmallOperandValues.size());
+                const uint32_t extraBytes = alignBytesNeeded(existingSize, operand.location.length);
+                mSmallOperandValues.resize(existingSize + extraBytes + operand.location.length);
+                memcpy(&mSmallOperandValues[existingSize + extraBytes],
+                       branch.getPointerToOperandValue(operand.location.offset),
+                       operand.location.length);
+                operand.location.offset = existingSize + extraBytes;
+                break;
+            }
+            case Operand::LifeTime::CONSTANT_REFERENCE:
+                operand.location.poolIndex =
+                        mMemories.add(branch.mMemories[operand.location.poolIndex]);
+                break;
+            case Operand::LifeTime::SUBGRAPH:
+                operand.location.offset = static_cast<uint32_t>(mReferencedModels.size());
+                mReferencedModels.push_back(branch.getReferencedModel(branch.mOperands[i]));
+                mReferencedSubgraphsForValidation.push_back(
+                        mReferencedModels.back()->makeModel().main);
+                break;
+            case Operand::LifeTime::TEMPORARY_VARIABLE:
+            case Operand::LifeTime::NO_VALUE:
+            case Operand::LifeTime::POINTER:
+                break;
+        }
+        operandMap[i] = operandCount();
+        mOperands.push_back(std::move(operand));
+    }
+
+    for (const Operation& branchOperation : branch.mOperations) {
+        Operation inlined = branchOperation;
+        for (uint32_t& index : inlined.inputs) {
+            index = operandMap[index];
+        }
+        for (uint32_t& index : inlined.outputs) {
+            index = operandMap[index];
+        }
+        operations->push_back(std::move(inlined));
+    }
+    mHasOEMOperand |= branch.mHasOEMOperand;
+    mHasOEMOperation |= branch.mHasOEMOperation;
+    mHasExtensionOperation |= branch.mHasExtensionOperation;
+}
+
+void ModelBuilder::inlineIfOperationsWithConstantConditions() {
+    if (!mHasControlFlow) {
+        return;
+    }
+    std::vector<Operation> operations;
+    std::vector<uint32_t> sortedOperationIndexMap;
+    operations.reserve(mOperations.size());
+    sortedOperationIndexMap.reserve(mOperations.size());
+    for (uint32_t i = 0; i < mOperations.size(); ++i) {
+        const ModelBuilder* branch = getStaticallyTakenBranch(mOperations[i]);
+        if (branch == nullptr) {
+            operations.push_back(std::move(mOperations[i]));
+            sortedOperationIndexMap.push_back(mSortedOperationIndexMap[i]);
+            continue;
+        }
+        VLOG(MODEL) << "Inlining the taken branch of operation " << mSortedOperationIndexMap[i]
+                    << " (IF) with " << branch->operationCount() << " operations";
+        // The operations of the branch only depend on the inputs of the IF operation and on each
+        // other, so the run order is preserved. They all map to the original IF operation.
+        inlineBranch(mOperations[i], *branch, &operations);
+        sortedOperationIndexMap.resize(operations.size(), mSortedOperationIndexMap[i]);
+    }
+    mOperations = std::move(operations);
+    mSortedOperationIndexMap = std::move(sortedOperationIndexMap);
+}
+
 void ModelBuilder::simplifyModel() {
     mSimplifyModel = true;
 }
@@ -1020,6 +1149,11 @@ const uint8_t* ModelBuilder::getModelArchHash() const {
     return mModelArchHash;
 }
 
+const uint8_t* ModelBuilder::getModelPartitioningHash() const {
+    CHECK(mCompletedModel) << "Calling getModelPartitioningHash on non completed model";
+    return mModelPartitioningHash;
+}
+
 #undef NN_VALIDATE_NULL_OR_SIZED
 
 }  // namespace nn
@@ -22,6 +22,7 @@
 
 #include <LegacyUtils.h>
 
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -135,6 +136,7 @@ class ModelBuilder {
                          int simulateFailureResultCode = ANEURALNETWORKS_NO_ERROR) const;
 
     const uint8_t* getModelArchHash() const;
+    const uint8_t* getModelPartitioningHash() const;
 
    private:
     // TODO(b/132322449): move partitionTheWork, findBestDeviceForEachOperation,
@@ -151,9 +153,32 @@ class ModelBuilder {
     // (*bestDeviceForOperation)[i] == devices.size() is a special value meaning
     // that this is a control flow operation scheduled for interpreted execution
     // (see LogicalStep).
+    //
+    // If minimizeBoundaries is true, the result is then revised by
+    // minimizePartitionBoundaries.
     int findBestDeviceForEachOperation(uint32_t preference,
                                        const std::vector<std::shared_ptr<Device>>& devices,
+                                       bool minimizeBoundaries,
                                        std::vector<int>* bestDeviceForOperation) const;
+    // Revises the devices chosen by findBestDeviceForEachOperation using the
+    // times measured in earlier executions of models with the same
+    // operations and operands (see PartitioningProfile). This weighs the time of each
+    // operation on each device against the cost of passing temporaries between
+    // devices, so that small operations are not split off into their own steps
+    // when the boundaries cost more than they save.
+    void applyPartitioningProfile(
+            uint32_t preference, const std::vector<std::shared_ptr<Device>>& devices,
+            const std::function<bool(size_t deviceIndex, uint32_t operationIndex)>& canDo,
+            std::vector<int>* bestDeviceForOperation) const;
+    // Moves operations to other devices that can run them when this lowers
+    // the number and size of the temporaries passed between devices, for
+    // DeviceManager::kPartitioningStrategyMinimizeBoundaries. This ignores
+    // the performance of the devices: an operation may end up on a slower
+    // device than the one it was given if its neighbours run there.
+    void minimizePartitionBoundaries(
+            size_t deviceCount,
+            const std::function<bool(size_t deviceIndex, uint32_t operationIndex)>& canDo,
+            std::vector<int>* bestDeviceForOperation) const;
     float getPerformance(uint32_t preference, const std::shared_ptr<Device> device) const;
     float getPerformance(uint32_t preference, const std::shared_ptr<Device> device,
                          uint32_t operationIndex) const;
@@ -179,6 +204,19 @@ class ModelBuilder {
     void removeTrailingArgumentsWithDefaultValues();
     uint32_t getNumTrailingArgumentsToRemove(const Operation& operation) const;
 
+    // Replaces each IF operation whose condition is a constant with the operations of the branch
+    // that it takes, so that the condition is not evaluated at execution time and the model may
+    // run on a single device without the control flow interpreter. The untaken branch becomes a
+    // dead subgraph, which is removed when the model is simplified.
+    void inlineIfOperationsWithConstantConditions();
+    // Returns the branch taken by operation if it is an IF operation with a constant condition
+    // whose branch can be inlined, or nullptr otherwise.
+    const ModelBuilder* getStaticallyTakenBranch(const Operation& operation) const;
+    // Appends the operations of branch, taken by the IF operation, to operations, copying the
+    // operands of branch that are not its inputs or outputs into this model.
+    void inlineBranch(const Operation& operation, const ModelBuilder& branch,
+                      std::vector<Operation>* operations);
+
     // Sorts the operations to be in the correct order for single threaded
     // node-at-a-time execution.
     bool sortIntoRunOrder();
@@ -194,7 +232,8 @@ class ModelBuilder {
     // The operations of the graph.
     std::vector<Operation> mOperations;
     // The mapping from sorted index to the original index of operations in mOperations.
-    // mSortedOperationIndexMap is empty before sortIntoRunOrder() is called.
+    // mSortedOperationIndexMap is empty before sortIntoRunOrder() is called. The operations of an
+    // inlined IF branch all map to the original index of the IF operation.
     std::vector<uint32_t> mSortedOperationIndexMap;
     // Is at least one of those operations an OEM_OPERATION?
     bool mHasOEMOperation = false;
@@ -255,6 +294,10 @@ class ModelBuilder {
     // Model architecture hash, used for telemetry.
     uint8_t mModelArchHash[BYTE_SIZE_OF_MODEL_ARCH_HASH];
 
+    // Hash of the finished model including its constant scalar values, used
+    // by PartitioningProfile.
+    uint8_t mModelPartitioningHash[BYTE_SIZE_OF_MODEL_ARCH_HASH];
+
     class ModelMaker;
 };
 
@@ -762,8 +762,12 @@ int ANeuralNetworksModel_getSupportedOperationsForDevices(
 
     const Model canonicalModel = m->makeModel();
     const std::vector<uint32_t>& opMap = m->getSortedOperationMapping();
+    // Several operations map to the same original operation when ModelBuilder::finish inlined the
+    // taken branch of an IF operation, and each original operation has at least one of them.
+    const uint32_t originalOperationCount =
+            opMap.empty() ? 0 : *std::max_element(opMap.begin(), opMap.end()) + 1;
     // init the output array to false for all the operations.
-    std::fill(supportedOps, supportedOps + opMap.size(), false);
+    std::fill(supportedOps, supportedOps + originalOperationCount, false);
     for (uint32_t i = 0; i < numDevices; i++) {
         if (devices[i] == nullptr) {
             LOG(ERROR) << "ANeuralNetworksModel_getSupportedOperationsForDevices passed a nullptr "
@@ -781,9 +785,17 @@ int ANeuralNetworksModel_getSupportedOperationsForDevices(
         Device* d = reinterpret_cast<Device*>(const_cast<ANeuralNetworksDevice*>(devices[i]));
         const MetaModel metaModel(canonicalModel, DeviceManager::get()->strictSlicing());
         const std::vector<bool> supportsByDevice = d->getSupportedOperations(metaModel);
+        // The device supports an original operation only if it supports all the operations
+        // that replaced it.
+        std::vector<bool> supportsOriginalByDevice(originalOperationCount, true);
         for (uint32_t j = 0; j < supportsByDevice.size(); j++) {
             uint32_t originalIdx = opMap[j];
-            supportedOps[originalIdx] |= supportsByDevice[j];
+            if (!supportsByDevice[j]) {
+                supportsOriginalByDevice[originalIdx] = false;
+            }
+        }
+        for (uint32_t j = 0; j < originalOperationCount; j++) {
+            supportedOps[j] |= supportsOriginalByDevice[j];
         }
     }
     return ANEURALNETWORKS_NO_ERROR;
@@ -0,0 +1,309 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PartitioningProfile"
+
+#include "PartitioningProfile.h"
+
+#include <LegacyUtils.h>
+#include <android-base/logging.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ModelBuilder.h"
+#include "TypeManager.h"
+
+namespace android {
+namespace nn {
+
+namespace {
+
+// The weight of a new measurement in the running average of the time of an
+// operation, so that the profile follows changes of the device load or clock
+// frequency without being thrown off by a single slow execution.
+constexpr float kMeasurementWeight = 0.25f;
+
+constexpr char kFileHeader[] = "nnapi-partitioning-profile 2";
+constexpr char kFileSuffix[] = ".partitioning_profile";
+
+std::string getModelKey(const ModelBuilder& model) {
+    const uint8_t* hash = model.getModelPartitioningHash();
+    return std::string(reinterpret_cast<const char*>(hash), BYTE_SIZE_OF_MODEL_ARCH_HASH);
+}
+
+std::string toHex(const std::string& bytes) {
+    static constexpr char kDigits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(2 * bytes.size());
+    for (const char c : bytes) {
+        const uint8_t byte = static_cast<uint8_t>(c);
+        hex.push_back(kDigits[byte >> 4]);
+        hex.push_back(kDigits[byte & 0xf]);
+    }
+    return hex;
+}
+
+std::optional<std::string> fromHex(const std::string& hex) {
+    if (hex.size() != 2 * BYTE_SIZE_OF_MODEL_ARCH_HASH) {
+        return std::nullopt;
+    }
+    const auto digit = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    };
+    std::string bytes;
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        const int high = digit(hex[i]), low = digit(hex[i + 1]);
+        if (high < 0 || low < 0) {
+            return std::nullopt;
+        }
+        bytes.push_back(static_cast<char>(high << 4 | low));
+    }
+    return bytes;
+}
+
+std::string getFilePath(const ModelBuilder& model, const std::string& cacheDir) {
+    return cacheDir + toHex(getModelKey(model)) + kFileSuffix;
+}
+
+// Returns the model and the models it references, by key.
+std::map<std::string, const ModelBuilder*> getModelsByKey(const ModelBuilder& model) {
+    std::map<std::string, const ModelBuilder*> models = {{getModelKey(model), &model}};
+    for (uint32_t i = 0; i < model.referencedModelCount(); ++i) {
+        const ModelBuilder* referencedModel = model.getReferencedModel(i);
+        models.emplace(getModelKey(*referencedModel), referencedModel);
+    }
+    return models;
+}
+
+// Returns whether the time was measured for this operation of the model.
+bool matchesOperation(const ModelBuilder& model, uint32_t operationCount, uint32_t operationIndex,
+                      OperationType type) {
+    return operationCount == model.operationCount() && operationIndex < operationCount &&
+           model.getOperation(operationIndex).type == type;
+}
+
+// The number of bytes the operation reads and writes, plus one so that
+// operations on operands of unknown size still get a share of the time.
+float getOperationWeight(const ModelBuilder& model, uint32_t operationIndex) {
+    const Operation& operation = model.getOperation(operationIndex);
+    float weight = 1.0f;
+    for (const auto* indexes : {&operation.inputs, &operation.outputs}) {
+        for (uint32_t operandIndex : *indexes) {
+            weight += TypeManager::get()->getSizeOfData(model.getOperand(operandIndex));
+        }
+    }
+    return weight;
+}
+
+}  // namespace
+
+PartitioningProfile* PartitioningProfile::get() {
+    static PartitioningProfile profile;
+    return &profile;
+}
+
+void PartitioningProfile::recordExecution(const ModelBuilder& model, const std::string& deviceName,
+                                          const std::vector<uint32_t>& operationIndexes,
+                                          uint64_t nanos) {
+    if (operationIndexes.empty()) {
+        return;
+    }
+    std::vector<float> weights;
+    weights.reserve(operationIndexes.size());
+    float totalWeight = 0.0f;
+    for (uint32_t operationIndex : operationIndexes) {
+        weights.push_back(getOperationWeight(model, operationIndex));
+        totalWeight += weights.back();
+    }
+
+    std::lock_guard<std::mutex> guard(mMutex);
+    ModelProfile& profile = addModelProfile(getModelKey(model));
+    if (profile.operationCount != model.operationCount()) {
+        profile.operationNanos.clear();
+        profile.operationCount = model.operationCount();
+    }
+    for (size_t i = 0; i < operationIndexes.size(); ++i) {
+        const OperationType type = model.getOperation(operationIndexes[i]).type;
+        const float measurement = nanos * (weights[i] / totalWeight);
+        const auto [it, inserted] = profile.operationNanos.emplace(
+                std::make_pair(deviceName, operationIndexes[i]), OperationNanos{type, measurement});
+        if (inserted) {
+            continue;
+        }
+        if (it->second.type != type) {
+            it->second = {type, measurement};
+        } else {
+            it->second.nanos += kMeasurementWeight * (measurement - it->second.nanos);
+        }
+    }
+    profile.modified = true;
+}
+
+std::optional<float> PartitioningProfile::getOperationNanos(const ModelBuilder& model,
+                                                            const std::string& deviceName,
+                                                            uint32_t operationIndex) const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    const auto profile = mModelProfiles.find(getModelKey(model));
+    if (profile == mModelProfiles.end()) {
+        return std::nullopt;
+    }
+    const auto it = profile->second.operationNanos.find(std::make_pair(deviceName, operationIndex));
+    if (it == profile->second.operationNanos.end() ||
+        !matchesOperation(model, profile->second.operationCount, operationIndex, it->second.type)) {
+        return std::nullopt;
+    }
+    return it->second.nanos;
+}
+
+bool PartitioningProfile::hasMeasurements(const ModelBuilder& model) const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    const auto profile = mModelProfiles.find(getModelKey(model));
+    return profile != mModelProfiles.end() && !profile->second.operationNanos.empty();
+}
+
+bool PartitioningProfile::load(const ModelBuilder& model, const std::string& cacheDir) {
+    const std::string path = getFilePath(model, cacheDir);
+    std::ifstream file(path);
+    if (!file) {
+        // Nothing has been saved yet.
+        return true;
+    }
+    std::string line;
+    if (!std::getline(file, line) || line != kFileHeader) {
+        LOG(ERROR) << "PartitioningProfile::load: unexpected header in " << path;
+        return false;
+    }
+
+    // Each line is "<model partitioning hash> <operation count> <operation index>
+    // <operation type> <nanos> <device name>".
+    const std::map<std::string, const ModelBuilder*> models = getModelsByKey(model);
+    std::map<std::string, ModelProfile> loaded;
+    uint32_t droppedCount = 0;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string hex, deviceName;
+        uint32_t operationCount, operationIndex;
+        int32_t type;
+        float nanos;
+        const std::optional<std::string> key =
+                (fields >> hex >> operationCount >> operationIndex >> type >> nanos)
+                        ? fromHex(hex)
+                        : std::nullopt;
+        if (!key.has_value() || fields.get() != ' ' || !std::getline(fields, deviceName) ||
+            deviceName.empty()) {
+            LOG(ERROR) << "PartitioningProfile::load: malformed line in " << path << ": " << line;
+            return false;
+        }
+        const auto it = models.find(*key);
+        const OperationType operationType = static_cast<OperationType>(type);
+        if (it == models.end() ||
+            !matchesOperation(*it->second, operationCount, operationIndex, operationType)) {
+            ++droppedCount;
+            continue;
+        }
+        ModelProfile& profile = loaded[*key];
+        profile.operationCount = operationCount;
+        profile.operationNanos[std::make_pair(deviceName, operationIndex)] = {operationType, nanos};
+    }
+    if (droppedCount > 0) {
+        VLOG(COMPILATION) << "PartitioningProfile::load: dropped " << droppedCount
+                          << " times that do not match the operations of the model in " << path;
+    }
+
+    std::lock_guard<std::mutex> guard(mMutex);
+    for (auto& [key, profile] : loaded) {
+        // Measurements of this process are more recent than the saved ones.
+        addModelProfile(key, std::move(profile));
+    }
+    return true;
+}
+
+bool PartitioningProfile::save(const ModelBuilder& model, const std::string& cacheDir) {
+    const std::map<std::string, const ModelBuilder*> models = getModelsByKey(model);
+    std::ostringstream contents;
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        bool modified = false;
+        for (const auto& [key, _] : models) {
+            const auto profile = mModelProfiles.find(key);
+            modified |= profile != mModelProfiles.end() && profile->second.modified;
+        }
+        if (!modified) {
+            return true;
+        }
+        contents << kFileHeader << "\n";
+        for (const auto& [key, _] : models) {
+            const auto profile = mModelProfiles.find(key);
+            if (profile == mModelProfiles.end()) {
+                continue;
+            }
+            for (const auto& [deviceAndOperation, operationNanos] :
+                 profile->second.operationNanos) {
+                contents << toHex(key) << " " << profile->second.operationCount << " "
+                         << deviceAndOperation.second << " "
+                         << static_cast<int32_t>(operationNanos.type) << " "
+                         << operationNanos.nanos << " " << deviceAndOperation.first << "\n";
+            }
+        }
+    }
+
+    const std::string path = getFilePath(model, cacheDir);
+    std::ofstream file(path, std::ios::trunc);
+    if (!file || !(file << contents.str()) || !file.flush()) {
+        LOG(ERROR) << "PartitioningProfile::save: failed to write " << path;
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(mMutex);
+    for (const auto& [key, _] : models) {
+        if (const auto profile = mModelProfiles.find(key); profile != mModelProfiles.end()) {
+            profile->second.modified = false;
+        }
+    }
+    return true;
+}
+
+PartitioningProfile::ModelProfile& PartitioningProfile::addModelProfile(const std::string& key,
+                                                                       ModelProfile profile) {
+    const auto [it, inserted] = mModelProfiles.try_emplace(key, std::move(profile));
+    it->second.lastUse = ++mUseCount;
+    if (inserted && mModelProfiles.size() > kMaxModelProfiles) {
+        // The added profile is the most recently used, so it is not the one dropped.
+        const auto leastRecentlyUsed = std::min_element(
+                mModelProfiles.begin(), mModelProfiles.end(), [](const auto& a, const auto& b) {
+                    return a.second.lastUse < b.second.lastUse;
+                });
+        VLOG(COMPILATION) << "PartitioningProfile: dropping the times of model "
+                          << toHex(leastRecentlyUsed->first);
+        mModelProfiles.erase(leastRecentlyUsed);
+    }
+    return it->second;
+}
+
+void PartitioningProfile::clear() {
+    std::lock_guard<std::mutex> guard(mMutex);
+    mModelProfiles.clear();
+}
+
+}  // namespace nn
+}  // namespace android
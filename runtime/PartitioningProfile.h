@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_PACKAGES_MODULES_NEURALNETWORKS_RUNTIME_PARTITIONING_PROFILE_H
+#define ANDROID_PACKAGES_MODULES_NEURALNETWORKS_RUNTIME_PARTITIONING_PROFILE_H
+
+#include <nnapi/Types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace android {
+namespace nn {
+
+class ModelBuilder;
+
+// Execution times of operations measured during earlier executions, used by
+// the partitioner in place of the static performance of the devices.
+//
+// Times are recorded per finished model, as identified by
+// ModelBuilder::getModelPartitioningHash(), so that they carry over to every
+// compilation of a model with the same operations, operands and scalar
+// parameters, whatever its tensor weights. Each time is stored with the type
+// of its operation, and times that do not match the operations of the model
+// are ignored. Drivers only report the time of a whole execution, so the time
+// of a step is split among its operations in proportion to the number of
+// bytes each of them reads and writes.
+//
+// The profile is process-wide and thread-safe. It can be saved to and loaded
+// from the compilation cache directory of the application. It keeps the times
+// of at most kMaxModelProfiles models, dropping those of the model that was
+// least recently executed or loaded.
+class PartitioningProfile {
+   public:
+    static constexpr size_t kMaxModelProfiles = 64;
+
+    static PartitioningProfile* get();
+
+    // Records that the device ran the given operations of the model in the
+    // given time. The measurement is averaged with the earlier ones.
+    void recordExecution(const ModelBuilder& model, const std::string& deviceName,
+                         const std::vector<uint32_t>& operationIndexes, uint64_t nanos);
+
+    // Returns the average time of the operation on the device, or nullopt if
+    // it has never been measured.
+    std::optional<float> getOperationNanos(const ModelBuilder& model,
+                                           const std::string& deviceName,
+                                           uint32_t operationIndex) const;
+
+    // Returns whether any operation of the model has been measured.
+    bool hasMeasurements(const ModelBuilder& model) const;
+
+    // Loads the times of the model and of the models it references from a file
+    // in cacheDir named after the hash of the model, unless they are already
+    // known. Times that do not match the operations of the models are dropped.
+    // Returns false if the file exists but cannot be parsed.
+    bool load(const ModelBuilder& model, const std::string& cacheDir);
+
+    // Saves the times of the model and of the models it references to the file
+    // read by load(), if any of them changed since it was loaded or saved.
+    bool save(const ModelBuilder& model, const std::string& cacheDir);
+
+    // Forgets every measurement.
+    void clear();
+
+   private:
+    struct OperationNanos {
+        OperationType type;
+        float nanos;
+    };
+    struct ModelProfile {
+        // The number of operations of the model.
+        uint32_t operationCount = 0;
+        // Average time, by device name and operation index.
+        std::map<std::pair<std::string, uint32_t>, OperationNanos> operationNanos;
+        bool modified = false;
+        // The value of mUseCount when the model was last executed or loaded.
+        uint64_t lastUse = 0;
+    };
+
+    PartitioningProfile() = default;
+
+    // Returns the profile of the model, adding the given one if there is none,
+    // and marks it as the most recently used. mMutex must be held.
+    ModelProfile& addModelProfile(const std::string& key, ModelProfile profile = {});
+
+    mutable std::mutex mMutex;
+    // By model partitioning hash.
+    std::map<std::string, ModelProfile> mModelProfiles;
+    uint64_t mUseCount = 0;
+};
+
+}  // namespace nn
+}  // namespace android
+
+#endif  // ANDROID_PACKAGES_MODULES_NEURALNETWORKS_RUNTIME_PARTITIONING_PROFILE_H
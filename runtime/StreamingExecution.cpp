@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "StreamingExecution"
+
+#include "StreamingExecution.h"
+
+#include <LegacyUtils.h>
+#include <Tracing.h>
+#include <android-base/logging.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "CompilationBuilder.h"
+#include "ExecutionBuilder.h"
+#include "ExecutionCallback.h"
+#include "ExecutionPlan.h"
+
+namespace android {
+namespace nn {
+
+struct StreamingExecution::Computation {
+    ExecutionBuilder* execution;
+    OptionalTimePoint deadline;
+    std::shared_ptr<ExecutionCallback> callback;
+    // Only used if mPipelined. Taken from mFreeControllers by enqueue() and
+    // returned by finish().
+    std::shared_ptr<ExecutionPlan::Controller> controller;
+    std::vector<OutputShape> outputShapes;
+};
+
+StreamingExecution::StreamingExecution(const CompilationBuilder* compilation,
+                                       const ExecutionPlan* plan, uint32_t maxInFlight)
+    : mCompilation(compilation),
+      mPlan(plan),
+      kMaxInFlight(maxInFlight),
+      mPipelined(plan->getStraightLineStepCount() > 1) {
+    CHECK(mCompilation != nullptr);
+    CHECK_GT(kMaxInFlight, 0u);
+    const size_t stageCount = mPipelined ? mPlan->getStraightLineStepCount() : 1;
+    VLOG(EXECUTION) << "StreamingExecution: " << stageCount << " stages, at most " << kMaxInFlight
+                    << " computations in flight";
+    if (mPipelined) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFreeControllers.reserve(kMaxInFlight);
+        for (uint32_t i = 0; i < kMaxInFlight; ++i) {
+            mFreeControllers.push_back(mPlan->makeController(nullptr, nullptr, /*reusable=*/true));
+        }
+    }
+    mStages.reserve(stageCount);
+    for (size_t i = 0; i < stageCount; ++i) {
+        mStages.push_back(std::make_unique<ThreadPool>(1));
+    }
+    if (mPipelined) {
+        mFallback = std::make_unique<ThreadPool>(1);
+    }
+}
+
+StreamingExecution::~StreamingExecution() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [this] { return mInFlight == 0; });
+}
+
+void StreamingExecution::enqueue(ExecutionBuilder* execution, const OptionalTimePoint& deadline,
+                                 std::shared_ptr<ExecutionCallback> callback) {
+    auto computation = std::make_shared<Computation>();
+    computation->execution = execution;
+    computation->deadline = deadline;
+    computation->callback = std::move(callback);
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this] { return mInFlight < kMaxInFlight; });
+        ++mInFlight;
+        if (mPipelined) {
+            // Each computation in flight holds one Controller, so one is free.
+            CHECK(!mFreeControllers.empty());
+            computation->controller = std::move(mFreeControllers.back());
+            mFreeControllers.pop_back();
+        }
+    }
+    if (mPipelined) {
+        mStages[0]->schedule([this, computation] { runStage(0, computation); });
+    } else {
+        mStages[0]->schedule([this, computation] { runAll(computation); });
+    }
+}
+
+void StreamingExecution::runStage(size_t stageIndex,
+                                  const std::shared_ptr<Computation>& computation) {
+    NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "StreamingExecution::runStage");
+    ExecutionBuilder* execution = computation->execution;
+    const ExecutionPlan* plan = mPlan;
+    if (stageIndex == 0) {
+        plan->resetController(computation->controller, execution, nullptr);
+        computation->outputShapes = execution->getInitialOutputShapes();
+        execution->mSizeOfTemporaries = computation->controller->getSizeOfTemporaries();
+        execution->mSummedSizeOfTemporaries =
+                computation->controller->getSummedSizeOfTemporaries();
+    }
+    VLOG(EXECUTION) << "StreamingExecution::runStage(" << stageIndex << ")";
+
+    std::shared_ptr<StepExecutor> executor;
+    int n = plan->next(computation->controller, &executor, nullptr, &computation->outputShapes);
+    if (n == ANEURALNETWORKS_NO_ERROR) {
+        // The plan has one step per stage.
+        CHECK(executor != nullptr);
+        auto [stepN, stepOutputShapes, _] = executor->compute(computation->deadline);
+        StepExecutor::UpdateOutputShapes updateOutputShapes = {};
+        if (!executor->updateOutputShapes(stepN, stepOutputShapes, &computation->outputShapes,
+                                          &updateOutputShapes) ||
+            (stepN == ANEURALNETWORKS_NO_ERROR && updateOutputShapes.zeroSizedInput)) {
+            stepN = ANEURALNETWORKS_OP_FAILED;
+        }
+        n = stepN;
+    }
+
+    if (n == ANEURALNETWORKS_OUTPUT_INSUFFICIENT_SIZE) {
+        // The plan has no dynamic temporaries, so a main model output is not
+        // of sufficient size, which is not recoverable.
+        finish(computation, n, computation->outputShapes, {});
+        return;
+    }
+    if (n != ANEURALNETWORKS_NO_ERROR) {
+        if (!execution->mAllowCpuFallback) {
+            finish(computation, n, {}, {});
+            return;
+        }
+        VLOG(EXECUTION) << "StreamingExecution::runStage(" << stageIndex
+                        << ") failed, computing again without pipelining";
+        mFallback->schedule([this, computation] { runAll(computation); });
+        return;
+    }
+
+    if (stageIndex + 1 < mStages.size()) {
+        mStages[stageIndex + 1]->schedule(
+                [this, stageIndex, computation] { runStage(stageIndex + 1, computation); });
+        return;
+    }
+    executor = nullptr;
+    n = plan->next(computation->controller, &executor, nullptr, &computation->outputShapes);
+    CHECK(n != ANEURALNETWORKS_NO_ERROR || executor == nullptr);
+    if (n != ANEURALNETWORKS_NO_ERROR) {
+        finish(computation, n, {}, {});
+        return;
+    }
+    finish(computation, n, computation->outputShapes, {});
+}
+
+void StreamingExecution::runAll(const std::shared_ptr<Computation>& computation) {
+    NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "StreamingExecution::runAll");
+    const auto [n, outputShapes, timing] =
+            computation->execution->computeInternal(computation->deadline, nullptr);
+    finish(computation, n, outputShapes, timing);
+}
+
+void StreamingExecution::finish(const std::shared_ptr<Computation>& computation, int n,
+                                const std::vector<OutputShape>& outputShapes,
+                                const Timing& timing) {
+    computation->callback->notify(convertResultCodeToErrorStatus(n), outputShapes, timing);
+    // The stream may be destroyed as soon as mInFlight drops to 0, so signal
+    // mCondition while holding the lock, and do not touch any member afterwards.
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (computation->controller != nullptr) {
+        // Keep the temporaries for the next computation.
+        mFreeControllers.push_back(std::move(computation->controller));
+    }
+    --mInFlight;
+    mCondition.notify_all();
+}
+
+}  // namespace nn
+}  // namespace android
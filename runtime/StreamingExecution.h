@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_PACKAGES_MODULES_NEURALNETWORKS_RUNTIME_STREAMING_EXECUTION_H
+#define ANDROID_PACKAGES_MODULES_NEURALNETWORKS_RUNTIME_STREAMING_EXECUTION_H
+
+#include <ThreadPool.h>
+#include <android-base/macros.h>
+#include <android-base/thread_annotations.h>
+#include <nnapi/Types.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ExecutionPlan.h"
+
+namespace android {
+namespace nn {
+
+class CompilationBuilder;
+class ExecutionBuilder;
+class ExecutionCallback;
+
+// A stream of computations of executions of the same compilation, started
+// with ExecutionBuilder::streamCompute().
+//
+// If the execution plan runs the same steps in the same order in every
+// execution (see ExecutionPlan::getStraightLineStepCount()), each step is a
+// stage of a pipeline with its own worker thread, so that step k of a
+// computation runs while step k+1 of the previous computation runs on another
+// device. The stream makes maxInFlight reusable ExecutionPlan::Controllers up
+// front and each computation in flight takes one of them, so the temporaries
+// are allocated once per stream rather than once per computation.
+// streamCompute() blocks while maxInFlight computations are in flight, which
+// bounds the memory of the stream and the latency of a computation. With the
+// default of 2, the boundary temporaries are double buffered.
+//
+// Other plans run each computation in its entirety on a single worker thread,
+// in the order in which they were started.
+//
+// A computation that fails on a device is computed again from the start the
+// way ExecutionBuilder::compute() does it, including the fallback to the CPU.
+// This runs on a separate worker thread, so that the computations behind it
+// keep going through the stages.
+//
+// Like the computation of any plan with more than one step, a pipelined
+// computation passes no timing to its callback. Each step still reports its
+// own timing to the execution, as in StepExecutor::compute().
+class StreamingExecution {
+    DISALLOW_COPY_AND_ASSIGN(StreamingExecution);
+
+   public:
+    static constexpr uint32_t kDefaultMaxInFlight = 2;
+
+    // Use CompilationBuilder::createStreamingExecution().
+    // plan is the valid execution plan of the compilation. maxInFlight must be
+    // greater than 0.
+    StreamingExecution(const CompilationBuilder* compilation, const ExecutionPlan* plan,
+                       uint32_t maxInFlight);
+
+    // Waits for the computations in flight to finish.
+    ~StreamingExecution();
+
+    const CompilationBuilder* getCompilation() const { return mCompilation; }
+
+    // Only to be called by ExecutionBuilder::compute(), once the computation
+    // is prepared. Blocks while maxInFlight computations are in flight, then
+    // queues the computation, whose result is passed to callback.
+    void enqueue(ExecutionBuilder* execution, const OptionalTimePoint& deadline,
+                 std::shared_ptr<ExecutionCallback> callback);
+
+   private:
+    struct Computation;
+
+    // Runs the step of the pipeline stage on the worker thread of the stage,
+    // then passes the computation to the next stage, or to mFallback if the
+    // step failed.
+    void runStage(size_t stageIndex, const std::shared_ptr<Computation>& computation);
+
+    // Runs the whole computation without pipelining.
+    void runAll(const std::shared_ptr<Computation>& computation);
+
+    void finish(const std::shared_ptr<Computation>& computation, int n,
+                const std::vector<OutputShape>& outputShapes, const Timing& timing);
+
+    const CompilationBuilder* mCompilation;
+    const ExecutionPlan* mPlan;
+    const uint32_t kMaxInFlight;
+    // Is every step of the plan a stage of the pipeline?
+    const bool mPipelined;
+
+    // Guards mInFlight and mFreeControllers.
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    uint32_t mInFlight GUARDED_BY(mMutex) = 0;
+    // The Controllers not taken by a computation in flight. Only used if
+    // mPipelined, in which case there are kMaxInFlight Controllers in all.
+    std::vector<std::shared_ptr<ExecutionPlan::Controller>> mFreeControllers GUARDED_BY(mMutex);
+
+    // One single-threaded pool per stage, so that the computations go through
+    // each stage one at a time and in order.
+    std::vector<std::unique_ptr<ThreadPool>> mStages;
+    // Computes again the pipelined computations that failed. Only used if
+    // mPipelined.
+    std::unique_ptr<ThreadPool> mFallback;
+};
+
+}  // namespace nn
+}  // namespace android
+
+#endif  // ANDROID_PACKAGES_MODULES_NEURALNETWORKS_RUNTIME_STREAMING_EXECUTION_H
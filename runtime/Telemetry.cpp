@@ -229,6 +229,8 @@ void onExecutionFinish(ExecutionBuilder* e, ExecutionMode executionMode, int res
             .cacheEnabled = compilation->isCacheInfoProvided(),
             .hasControlFlow = compilation->getModel()->hasControlFlow(),
             .hasDynamicTemporaries = compilation->hasDynamicTemporaries(),
+            .sizeOfTemporaries = e->getSizeOfTemporaries(),
+            .summedSizeOfTemporaries = e->getSummedSizeOfTemporaries(),
     };
 
 #if defined(__ANDROID__) && !defined(NN_COMPATIBILITY_LIBRARY_BUILD)
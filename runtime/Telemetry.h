@@ -102,6 +102,13 @@ struct DiagnosticExecutionInfo {
     bool hasControlFlow;
     // Are dynamic tensors used?
     bool hasDynamicTemporaries;
+    // Size of the memory holding the temporaries passed between the steps of
+    // a partitioned model, and the size it would take if no two temporaries
+    // shared storage. 0 if the model is not partitioned. Only reported to the
+    // callbacks of registerTelemetryCallbacks(), as no NnApiSLDriverImpl
+    // struct has an accessor for them yet.
+    uint32_t sizeOfTemporaries = 0;
+    uint32_t summedSizeOfTemporaries = 0;
 };
 
 void registerTelemetryCallbacks(std::function<void(const DiagnosticCompilationInfo*)> compilation,
@@ -102,6 +102,254 @@ TEST_F(ControlFlowTest, InfiniteLoop) {
             << "result = " << static_cast<int>(result);
 }
 
+TEST_F(ControlFlowTest, LoopWithStateAndInputOnlyOperands) {
+    // Expected result: sum = 1 + 2 + ... + n.
+    // Model: sum is the only output of the loop, i is input-output state, and
+    // n is input-only.
+    //
+    // sum = 0.0
+    // i = 0.0
+    // while i < n:
+    //     i = i + 1.0
+    //     sum = sum + i
+
+    OperandType boolType(Type::TENSOR_BOOL8, {1});
+    OperandType activationType(Type::INT32, {});
+    OperandType valueType(Type::TENSOR_FLOAT32, {1});
+
+    Model conditionModel;
+    {
+        uint32_t sum = conditionModel.addOperand(&valueType);
+        uint32_t i = conditionModel.addOperand(&valueType);
+        uint32_t n = conditionModel.addOperand(&valueType);
+        uint32_t out = conditionModel.addOperand(&boolType);
+        conditionModel.addOperation(ANEURALNETWORKS_LESS, {i, n}, {out});
+        conditionModel.identifyInputsAndOutputs({sum, i, n}, {out});
+        ASSERT_EQ(conditionModel.finish(), Result::NO_ERROR);
+        ASSERT_TRUE(conditionModel.isValid());
+    }
+
+    Model bodyModel;
+    {
+        uint32_t sum = bodyModel.addOperand(&valueType);
+        uint32_t i = bodyModel.addOperand(&valueType);
+        uint32_t n = bodyModel.addOperand(&valueType);
+        uint32_t one = bodyModel.addConstantOperand(&valueType, 1.0f);
+        uint32_t noActivation = bodyModel.addConstantOperand(&activationType, kNoActivation);
+        uint32_t iOut = bodyModel.addOperand(&valueType);
+        uint32_t sumOut = bodyModel.addOperand(&valueType);
+        bodyModel.addOperation(ANEURALNETWORKS_ADD, {i, one, noActivation}, {iOut});
+        bodyModel.addOperation(ANEURALNETWORKS_ADD, {sum, iOut, noActivation}, {sumOut});
+        bodyModel.identifyInputsAndOutputs({sum, i, n}, {sumOut, iOut});
+        ASSERT_EQ(bodyModel.finish(), Result::NO_ERROR);
+        ASSERT_TRUE(bodyModel.isValid());
+    }
+
+    Model model;
+    {
+        uint32_t sumInit = model.addConstantOperand(&valueType, 0.0f);
+        uint32_t iInit = model.addConstantOperand(&valueType, 0.0f);
+        uint32_t n = model.addOperand(&valueType);
+        uint32_t conditionOperand = model.addModelOperand(&conditionModel);
+        uint32_t bodyOperand = model.addModelOperand(&bodyModel);
+        uint32_t sumOut = model.addOperand(&valueType);
+        model.addOperation(ANEURALNETWORKS_WHILE,
+                           {conditionOperand, bodyOperand, sumInit, iInit, n}, {sumOut});
+        model.identifyInputsAndOutputs({n}, {sumOut});
+        ASSERT_EQ(model.finish(), Result::NO_ERROR);
+        ASSERT_TRUE(model.isValid());
+    }
+
+    Compilation compilation(&model);
+    ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
+
+    for (float input : {0.0f, 1.0f, 2.0f, 5.0f}) {
+        SCOPED_TRACE(input);
+        float output = -1.0f;
+        Execution execution(&compilation);
+        ASSERT_EQ(execution.setInput(0, &input), Result::NO_ERROR);
+        ASSERT_EQ(execution.setOutput(0, &output), Result::NO_ERROR);
+        ASSERT_EQ(execution.compute(), Result::NO_ERROR);
+        EXPECT_EQ(output, input * (input + 1.0f) / 2.0f);
+    }
+}
+
+// Creates a branch model computing y = x + addend.
+void createAddBranchModel(Model* model, float addend) {
+    OperandType activationType(Type::INT32, {});
+    OperandType valueType(Type::TENSOR_FLOAT32, {1});
+    uint32_t x = model->addOperand(&valueType);
+    uint32_t constant = model->addConstantOperand(&valueType, addend);
+    uint32_t noActivation = model->addConstantOperand(&activationType, kNoActivation);
+    uint32_t y = model->addOperand(&valueType);
+    model->addOperation(ANEURALNETWORKS_ADD, {x, constant, noActivation}, {y});
+    model->identifyInputsAndOutputs({x}, {y});
+    ASSERT_EQ(model->finish(), Result::NO_ERROR);
+    ASSERT_TRUE(model->isValid());
+}
+
+// Creates a branch model computing y = x * multiplier.
+void createMulBranchModel(Model* model, float multiplier) {
+    OperandType activationType(Type::INT32, {});
+    OperandType valueType(Type::TENSOR_FLOAT32, {1});
+    uint32_t x = model->addOperand(&valueType);
+    uint32_t constant = model->addConstantOperand(&valueType, multiplier);
+    uint32_t noActivation = model->addConstantOperand(&activationType, kNoActivation);
+    uint32_t y = model->addOperand(&valueType);
+    model->addOperation(ANEURALNETWORKS_MUL, {x, constant, noActivation}, {y});
+    model->identifyInputsAndOutputs({x}, {y});
+    ASSERT_EQ(model->finish(), Result::NO_ERROR);
+    ASSERT_TRUE(model->isValid());
+}
+
+// Creates a model computing y = condition ? thenModel(x) : elseModel(x) with a constant condition.
+void createConstantIfModel(Model* model, bool condition, const Model* thenModel,
+                           const Model* elseModel) {
+    OperandType boolType(Type::TENSOR_BOOL8, {1});
+    OperandType valueType(Type::TENSOR_FLOAT32, {1});
+    uint32_t x = model->addOperand(&valueType);
+    uint32_t conditionOperand = model->addConstantOperand(&boolType, condition);
+    uint32_t thenOperand = model->addModelOperand(thenModel);
+    uint32_t elseOperand = model->addModelOperand(elseModel);
+    uint32_t y = model->addOperand(&valueType);
+    model->addOperation(ANEURALNETWORKS_IF, {conditionOperand, thenOperand, elseOperand, x}, {y});
+    model->identifyInputsAndOutputs({x}, {y});
+    ASSERT_EQ(model->finish(), Result::NO_ERROR);
+    ASSERT_TRUE(model->isValid());
+}
+
+// Compiles and runs a model with one input and one output.
+void computeUnary(const Model* model, float input, float* output) {
+    Compilation compilation(model);
+    ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
+    Execution execution(&compilation);
+    ASSERT_EQ(execution.setInput(0, &input), Result::NO_ERROR);
+    ASSERT_EQ(execution.setOutput(0, output), Result::NO_ERROR);
+    ASSERT_EQ(execution.compute(), Result::NO_ERROR);
+}
+
+TEST_F(ControlFlowTest, IfWithConstantTrueCondition) {
+    // Expected result: the then branch is taken, y = x + 1.0.
+    Model thenModel, elseModel, model;
+    createAddBranchModel(&thenModel, 1.0f);
+    createMulBranchModel(&elseModel, 10.0f);
+    createConstantIfModel(&model, true, &thenModel, &elseModel);
+
+    float output = -1.0f;
+    computeUnary(&model, 2.0f, &output);
+    EXPECT_EQ(output, 3.0f);
+}
+
+TEST_F(ControlFlowTest, IfWithConstantFalseCondition) {
+    // Expected result: the else branch is taken, y = x * 10.0.
+    Model thenModel, elseModel, model;
+    createAddBranchModel(&thenModel, 1.0f);
+    createMulBranchModel(&elseModel, 10.0f);
+    createConstantIfModel(&model, false, &thenModel, &elseModel);
+
+    float output = -1.0f;
+    computeUnary(&model, 2.0f, &output);
+    EXPECT_EQ(output, 20.0f);
+}
+
+TEST_F(ControlFlowTest, NestedIfWithConstantConditions) {
+    // Expected result: y = x * 10.0 + 1.0.
+    // Model:
+    //
+    // if true:
+    //     if false:
+    //         t = x + 1.0
+    //     else:
+    //         t = x * 10.0
+    //     y = t + 1.0
+    // else:
+    //     y = x * 10.0
+
+    OperandType boolType(Type::TENSOR_BOOL8, {1});
+    OperandType activationType(Type::INT32, {});
+    OperandType valueType(Type::TENSOR_FLOAT32, {1});
+
+    Model addModel, mulModel;
+    createAddBranchModel(&addModel, 1.0f);
+    createMulBranchModel(&mulModel, 10.0f);
+
+    Model outerThenModel;
+    {
+        uint32_t x = outerThenModel.addOperand(&valueType);
+        uint32_t conditionOperand = outerThenModel.addConstantOperand(&boolType, false);
+        uint32_t thenOperand = outerThenModel.addModelOperand(&addModel);
+        uint32_t elseOperand = outerThenModel.addModelOperand(&mulModel);
+        uint32_t one = outerThenModel.addConstantOperand(&valueType, 1.0f);
+        uint32_t noActivation = outerThenModel.addConstantOperand(&activationType, kNoActivation);
+        uint32_t t = outerThenModel.addOperand(&valueType);
+        uint32_t y = outerThenModel.addOperand(&valueType);
+        outerThenModel.addOperation(ANEURALNETWORKS_IF,
+                                    {conditionOperand, thenOperand, elseOperand, x}, {t});
+        outerThenModel.addOperation(ANEURALNETWORKS_ADD, {t, one, noActivation}, {y});
+        outerThenModel.identifyInputsAndOutputs({x}, {y});
+        ASSERT_EQ(outerThenModel.finish(), Result::NO_ERROR);
+        ASSERT_TRUE(outerThenModel.isValid());
+    }
+
+    Model model;
+    createConstantIfModel(&model, true, &outerThenModel, &mulModel);
+
+    float output = -1.0f;
+    computeUnary(&model, 2.0f, &output);
+    EXPECT_EQ(output, 21.0f);
+}
+
+TEST_F(ControlFlowTest, IfWithModelOutputAsBranchInput) {
+    // Expected result: x = a + 1.0 and y = x + 1.0.
+    // Model: x is both a model output and the input of the taken branch.
+    //
+    // x = a + 1.0
+    // if true:
+    //     y = x + 1.0
+    // else:
+    //     y = x * 10.0
+
+    OperandType boolType(Type::TENSOR_BOOL8, {1});
+    OperandType activationType(Type::INT32, {});
+    OperandType valueType(Type::TENSOR_FLOAT32, {1});
+
+    Model thenModel, elseModel;
+    createAddBranchModel(&thenModel, 1.0f);
+    createMulBranchModel(&elseModel, 10.0f);
+
+    Model model;
+    {
+        uint32_t a = model.addOperand(&valueType);
+        uint32_t one = model.addConstantOperand(&valueType, 1.0f);
+        uint32_t noActivation = model.addConstantOperand(&activationType, kNoActivation);
+        uint32_t conditionOperand = model.addConstantOperand(&boolType, true);
+        uint32_t thenOperand = model.addModelOperand(&thenModel);
+        uint32_t elseOperand = model.addModelOperand(&elseModel);
+        uint32_t x = model.addOperand(&valueType);
+        uint32_t y = model.addOperand(&valueType);
+        model.addOperation(ANEURALNETWORKS_ADD, {a, one, noActivation}, {x});
+        model.addOperation(ANEURALNETWORKS_IF, {conditionOperand, thenOperand, elseOperand, x},
+                           {y});
+        model.identifyInputsAndOutputs({a}, {x, y});
+        ASSERT_EQ(model.finish(), Result::NO_ERROR);
+        ASSERT_TRUE(model.isValid());
+    }
+
+    Compilation compilation(&model);
+    ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
+
+    float input = 2.0f;
+    float outputX = -1.0f;
+    float outputY = -1.0f;
+    Execution execution(&compilation);
+    ASSERT_EQ(execution.setInput(0, &input), Result::NO_ERROR);
+    ASSERT_EQ(execution.setOutput(0, &outputX), Result::NO_ERROR);
+    ASSERT_EQ(execution.setOutput(1, &outputY), Result::NO_ERROR);
+    ASSERT_EQ(execution.compute(), Result::NO_ERROR);
+    EXPECT_EQ(outputX, 3.0f);
+    EXPECT_EQ(outputY, 4.0f);
+}
+
 TEST_F(ControlFlowTest, GetLoopTimeouts) {
     uint64_t defaultTimeout = ANeuralNetworks_getDefaultLoopTimeout();
     uint64_t maximumTimeout = ANeuralNetworks_getMaximumLoopTimeout();
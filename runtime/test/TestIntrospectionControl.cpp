@@ -1370,6 +1370,88 @@ TEST_F(IntrospectionControlTest, ControlFlowSupported) {
     mModel = WrapperModel{};
 }
 
+// Creates a branch model computing y = x + x, followed by y = y * y if addMul is true.
+void createAddMaybeMulBranchModel(WrapperModel* model, bool addMul) {
+    WrapperOperandType type0(WrapperType::TENSOR_FLOAT32, {2});
+    WrapperOperandType type1(WrapperType::INT32, {});
+    // Phase 1, operands
+    auto op1 = model->addOperand(&type0);
+    auto act = model->addConstantOperand(&type1, 0);
+    auto op2 = model->addOperand(&type0);
+    // Phase 2, operations
+    model->addOperation(ANEURALNETWORKS_ADD, {op1, op1, act}, {op2});
+    auto output = op2;
+    if (addMul) {
+        output = model->addOperand(&type0);
+        model->addOperation(ANEURALNETWORKS_MUL, {op2, op2, act}, {output});
+    }
+    // Phase 3, inputs and outputs
+    model->identifyInputsAndOutputs({op1}, {output});
+    model->finish();
+    ASSERT_TRUE(model->isValid());
+}
+
+// Creates a model whose operations are, in the order they are added, an IF with a constant
+// condition and the ADD computing its input. The then branch is ADD->MUL and the else branch is
+// ADD, so ModelBuilder::finish replaces the IF with the operations of the taken branch.
+void createAddConstantIfModel(std::vector<WrapperModel>* extraModels, WrapperModel* mainModel,
+                              bool condition) {
+    WrapperOperandType type0(WrapperType::TENSOR_FLOAT32, {2});
+    WrapperOperandType type1(WrapperType::INT32, {});
+    WrapperOperandType boolType(WrapperType::TENSOR_BOOL8, {1});
+
+    extraModels->emplace_back();
+    extraModels->emplace_back();
+    WrapperModel* thenModel = &extraModels->at(extraModels->size() - 2);
+    WrapperModel* elseModel = &extraModels->at(extraModels->size() - 1);
+    createAddMaybeMulBranchModel(thenModel, /*addMul=*/true);
+    createAddMaybeMulBranchModel(elseModel, /*addMul=*/false);
+
+    // Phase 1, operands
+    auto op1 = mainModel->addOperand(&type0);
+    auto op2 = mainModel->addOperand(&type0);
+    auto act = mainModel->addConstantOperand(&type1, 0);
+    auto cond = mainModel->addConstantOperand(&boolType, condition);
+    auto thenOperand = mainModel->addModelOperand(thenModel);
+    auto elseOperand = mainModel->addModelOperand(elseModel);
+    auto op3 = mainModel->addOperand(&type0);
+    auto op4 = mainModel->addOperand(&type0);
+    // Phase 2, operations
+    mainModel->addOperation(ANEURALNETWORKS_IF, {cond, thenOperand, elseOperand, op3}, {op4});
+    mainModel->addOperation(ANEURALNETWORKS_ADD, {op1, op2, act}, {op3});
+    // Phase 3, inputs and outputs
+    mainModel->identifyInputsAndOutputs({op1, op2}, {op4});
+    mainModel->finish();
+    ASSERT_TRUE(mainModel->isValid());
+}
+
+// This test verifies that the operations replacing an IF with a constant condition are reported
+// as the original IF operation, which is supported only if all of them are supported.
+TEST_F(IntrospectionControlTest, ControlFlowInlinedIfSupportedOperations) {
+    // This is needed before we have the CPU fallback path being treated as a Device.
+    if (DeviceManager::get()->getUseCpuOnly()) {
+        GTEST_SKIP();
+    }
+
+    std::string addOnlyDriver = "test-onlyAdd";
+    std::vector<bool> addOnlyOp(android::nn::kNumberOfOperationTypes, false);
+    addOnlyOp[ANEURALNETWORKS_ADD] = true;
+
+    registerDevices({{addOnlyDriver, 0.9, addOnlyOp}});
+    EXPECT_TRUE(selectDeviceByName(addOnlyDriver));
+
+    for (bool condition : {true, false}) {
+        SCOPED_TRACE(condition);
+        std::vector<WrapperModel> extraModels;
+        createAddConstantIfModel(&extraModels, &mModel, condition);
+        // The then branch contains a MUL, which the device does not support.
+        EXPECT_TRUE(isSupportedOpListExpected({!condition, true}));
+
+        // Clear mModel early because it may reference `extraModels`.
+        mModel = WrapperModel{};
+    }
+}
+
 void createStaticWhileDynamicWhileModel(std::vector<WrapperModel>* extraModels,
                                         WrapperModel* mainModel) {
     std::vector<uint32_t> modelInputIndexes, modelOutputIndexes;
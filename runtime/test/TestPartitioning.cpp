@@ -37,12 +37,17 @@
 #include <vector>
 
 #include "CompilationBuilder.h"
+#include "ExecutionBuilder.h"
+#include "ExecutionCallback.h"
 #include "ExecutionPlan.h"
 #include "HalUtils.h"
 #include "Manager.h"
 #include "ModelBuilder.h"
 #include "NeuralNetworks.h"
 #include "NeuralNetworksOEM.h"
+#include "PartitioningProfile.h"
+#include "StreamingExecution.h"
+#include "Telemetry.h"
 #include "TestNeuralNetworksWrapper.h"
 #include "TmpDirectoryUtils.h"
 
@@ -157,8 +162,11 @@ namespace V1_3 = ::android::hardware::neuralnetworks::V1_3;
 using CompilationBuilder = ::android::nn::CompilationBuilder;
 using Device = ::android::nn::Device;
 using DeviceManager = ::android::nn::DeviceManager;
+using ErrorStatus = ::android::nn::ErrorStatus;
 using ExecutePreference = ::android::nn::test_wrapper::ExecutePreference;
 using ExecutePriority = ::android::nn::test_wrapper::ExecutePriority;
+using ExecutionBuilder = ::android::nn::ExecutionBuilder;
+using ExecutionCallback = ::android::nn::ExecutionCallback;
 using ExecutionPlan = ::android::nn::ExecutionPlan;
 using ExecutionStep = ::android::nn::ExecutionStep;
 using HalCacheToken = ::android::nn::HalCacheToken;
@@ -175,6 +183,7 @@ using SampleDriver = ::android::nn::sample_driver::SampleDriver;
 using SharedDevice = ::android::nn::SharedDevice;
 using SourceOperandIndex = ::android::nn::SourceOperandIndex;
 using StepRole = ::android::nn::StepRole;
+using StreamingExecution = ::android::nn::StreamingExecution;
 using WrapperCompilation = ::android::nn::test_wrapper::Compilation;
 using WrapperExecution = ::android::nn::test_wrapper::Execution;
 using WrapperModel = ::android::nn::test_wrapper::Model;
@@ -2210,6 +2219,241 @@ TEST_F(PartitioningTest, Perf) {
     }
 }
 
+TEST_F(PartitioningTest, PartitioningProfile) {
+    PartitioningModel model;
+    uint32_t opnd0 = model.addFloatOperand();
+    uint32_t opnd1 = model.addFloatOperand();
+    uint32_t opnd2 = model.addOperation2To1V1_0(0, opnd0, opnd1);
+    uint32_t opnd3 = model.addOperation2To1V1_0(1, opnd2, opnd1);
+    uint32_t opnd4 = model.addOperation2To1V1_0(0, opnd3, opnd1);
+    model.identifyInputsAndOutputs({opnd0, opnd1}, {opnd4});
+    model.finish();
+    ASSERT_TRUE(model.isValid());
+    const ModelBuilder* modelBuilder = reinterpret_cast<const ModelBuilder*>(model.getHandle());
+
+    // "a" is the best device for operation 0 but cannot do operation 1, so
+    // the static performance alone splits the model into three steps.
+    const auto devices = makeDevices({{"a", 0.5, 1 << 0}, {"b", 0.9, ~0U}});
+    ExecutionPlan staticPlan;
+    ASSERT_EQ(model.partitionTheWork(devices, ExecutePreference::PREFER_FAST_SINGLE_ANSWER,
+                                     ExecutePriority::DEFAULT, {}, &staticPlan),
+              ANEURALNETWORKS_NO_ERROR);
+    ASSERT_EQ(staticPlan.forTest_getKind(), ExecutionPlan::Kind::COMPOUND);
+    ASSERT_EQ(staticPlan.forTest_compoundGetSteps().size(), size_t(3));
+
+    // Once measured, "a" is only slightly faster than "b" for operation 0,
+    // which does not make up for passing the temporaries back and forth.
+    auto* profile = ::android::nn::PartitioningProfile::get();
+    profile->recordExecution(*modelBuilder, "a", {0}, 10000);
+    profile->recordExecution(*modelBuilder, "a", {2}, 10000);
+    profile->recordExecution(*modelBuilder, "b", {0, 1, 2}, 30000);
+    EXPECT_TRUE(profile->hasMeasurements(*modelBuilder));
+    EXPECT_TRUE(profile->getOperationNanos(*modelBuilder, "a", 0).has_value());
+    EXPECT_FALSE(profile->getOperationNanos(*modelBuilder, "a", 1).has_value());
+
+    // The times are not used for a model whose operations only differ by the
+    // value of a scalar operand, here the fuse code of the last operation.
+    PartitioningModel otherModel;
+    {
+        uint32_t opnd0 = otherModel.addFloatOperand();
+        uint32_t opnd1 = otherModel.addFloatOperand();
+        uint32_t opnd2 = otherModel.addOperation2To1V1_0(0, opnd0, opnd1);
+        uint32_t opnd3 = otherModel.addOperation2To1V1_0(1, opnd2, opnd1);
+        uint32_t opnd4 = otherModel.addOperation2To1V1_0(2, opnd3, opnd1);
+        otherModel.identifyInputsAndOutputs({opnd0, opnd1}, {opnd4});
+        otherModel.finish();
+        ASSERT_TRUE(otherModel.isValid());
+    }
+    EXPECT_FALSE(profile->hasMeasurements(
+            *reinterpret_cast<const ModelBuilder*>(otherModel.getHandle())));
+
+    ExecutionPlan profiledPlan;
+    ASSERT_EQ(model.partitionTheWork(devices, ExecutePreference::PREFER_FAST_SINGLE_ANSWER,
+                                     ExecutePriority::DEFAULT, {}, &profiledPlan),
+              ANEURALNETWORKS_NO_ERROR);
+    EXPECT_EQ(profiledPlan.forTest_getKind(), ExecutionPlan::Kind::SIMPLE);
+    if (profiledPlan.forTest_getKind() == ExecutionPlan::Kind::SIMPLE) {
+        EXPECT_EQ(profiledPlan.forTest_simpleGetDevice()->getName(), "b");
+    }
+
+    // Measured times do not say anything about power usage.
+    ExecutionPlan lowPowerPlan;
+    ASSERT_EQ(model.partitionTheWork(devices, ExecutePreference::PREFER_LOW_POWER,
+                                     ExecutePriority::DEFAULT, {}, &lowPowerPlan),
+              ANEURALNETWORKS_NO_ERROR);
+    EXPECT_EQ(lowPowerPlan.forTest_getKind(), ExecutionPlan::Kind::COMPOUND);
+
+    profile->clear();
+}
+
+TEST_F(PartitioningTest, PartitioningProfileDropsLeastRecentlyUsedModel) {
+    // Models with different numbers of operations have different partitioning hashes.
+    constexpr size_t kModelCount = ::android::nn::PartitioningProfile::kMaxModelProfiles + 1;
+    std::vector<PartitioningModel> models(kModelCount);
+    for (size_t i = 0; i < kModelCount; ++i) {
+        PartitioningModel& model = models[i];
+        uint32_t opnd0 = model.addFloatOperand();
+        uint32_t opnd1 = model.addFloatOperand();
+        uint32_t opnd2 = model.addOperation2To1V1_0(0, opnd0, opnd1);
+        for (size_t j = 0; j < i; ++j) {
+            opnd2 = model.addOperation2To1V1_0(0, opnd2, opnd1);
+        }
+        model.identifyInputsAndOutputs({opnd0, opnd1}, {opnd2});
+        model.finish();
+        ASSERT_TRUE(model.isValid());
+    }
+    const auto getModelBuilder = [&models](size_t i) {
+        return reinterpret_cast<const ModelBuilder*>(models[i].getHandle());
+    };
+
+    auto* profile = ::android::nn::PartitioningProfile::get();
+    for (size_t i = 0; i + 1 < kModelCount; ++i) {
+        profile->recordExecution(*getModelBuilder(i), "a", {0}, 10000);
+    }
+    // Model 0 is used again, so model 1 becomes the least recently used.
+    profile->recordExecution(*getModelBuilder(0), "a", {0}, 10000);
+    profile->recordExecution(*getModelBuilder(kModelCount - 1), "a", {0}, 10000);
+
+    EXPECT_TRUE(profile->hasMeasurements(*getModelBuilder(0)));
+    EXPECT_FALSE(profile->hasMeasurements(*getModelBuilder(1)));
+    for (size_t i = 2; i < kModelCount; ++i) {
+        EXPECT_TRUE(profile->hasMeasurements(*getModelBuilder(i)));
+    }
+
+    profile->clear();
+}
+
+TEST_F(PartitioningTest, TemporariesShareMemory) {
+    PartitioningModel model;
+    uint32_t opnd0 = model.addFloatOperand();
+    uint32_t opnd1 = model.addFloatOperand();
+    uint32_t opnd2 = model.addOperation2To1V1_0(0, opnd0, opnd1);
+    uint32_t opnd3 = model.addOperation2To1V1_0(1, opnd2, opnd1);
+    uint32_t opnd4 = model.addOperation2To1V1_0(0, opnd3, opnd1);
+    uint32_t opnd5 = model.addOperation2To1V1_0(1, opnd4, opnd1);
+    model.identifyInputsAndOutputs({opnd0, opnd1}, {opnd5});
+    model.finish();
+    ASSERT_TRUE(model.isValid());
+
+    // "a" is the best device for operations 0 and 2 but cannot do operations
+    // 1 and 3, so the steps alternate between the devices. opnd2 is passed
+    // from step 0 to step 1 and opnd4 from step 2 to step 3, so they are
+    // never alive at the same time and share memory.
+    const auto devices = makeDevices({{"a", 0.5, 1 << 0}, {"b", 0.9, ~0U}});
+    PartitioningCompilation compilation(&model, devices);
+    ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
+    checkExecutionPlanSteps(compilation.getExecutionPlan(), {"a", "b", "a", "b"});
+
+    namespace telemetry = ::android::nn::telemetry;
+    uint32_t sizeOfTemporaries = 0;
+    uint32_t summedSizeOfTemporaries = 0;
+    telemetry::registerTelemetryCallbacks(
+            [](const telemetry::DiagnosticCompilationInfo*) {},
+            [&sizeOfTemporaries,
+             &summedSizeOfTemporaries](const telemetry::DiagnosticExecutionInfo* info) {
+                sizeOfTemporaries = info->sizeOfTemporaries;
+                summedSizeOfTemporaries = info->summedSizeOfTemporaries;
+            });
+    const float input0 = 1.0f;
+    const float input1 = 2.0f;
+    float output = 0.0f;
+    WrapperExecution e(&compilation);
+    ASSERT_EQ(e.setInput(0, &input0, sizeof(input0)), Result::NO_ERROR);
+    ASSERT_EQ(e.setInput(1, &input1, sizeof(input1)), Result::NO_ERROR);
+    ASSERT_EQ(e.setOutput(0, &output, sizeof(output)), Result::NO_ERROR);
+    const Result result = e.compute();
+    telemetry::clearTelemetryCallbacks();
+    ASSERT_EQ(result, Result::NO_ERROR);
+    EXPECT_EQ(output, 9.0f);
+    EXPECT_GT(sizeOfTemporaries, 0u);
+    EXPECT_LT(sizeOfTemporaries, summedSizeOfTemporaries);
+}
+
+TEST_F(PartitioningTest, ReusableExecution) {
+    PartitioningModel model;
+    uint32_t opnd0 = model.addFloatOperand();
+    uint32_t opnd1 = model.addFloatOperand();
+    uint32_t opnd2 = model.addOperation2To1V1_0(0, opnd0, opnd1);
+    uint32_t opnd3 = model.addOperation2To1V1_0(1, opnd2, opnd1);
+    uint32_t opnd4 = model.addOperation2To1V1_0(0, opnd3, opnd1);
+    model.identifyInputsAndOutputs({opnd0, opnd1}, {opnd4});
+    model.finish();
+    ASSERT_TRUE(model.isValid());
+
+    const auto devices = makeDevices({{"a", 0.5, 1 << 0}, {"b", 0.9, ~0U}});
+    PartitioningCompilation compilation(&model, devices);
+    ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
+    checkExecutionPlanSteps(compilation.getExecutionPlan(), {"a", "b", "a"});
+
+    // The temporaries and step executors of the first computation are reused
+    // by the later ones, which must still see the new input values.
+    float input0 = 0.0f;
+    float input1 = 0.0f;
+    float output = 0.0f;
+    WrapperExecution e(&compilation);
+    ASSERT_EQ(e.setReusable(true), Result::NO_ERROR);
+    ASSERT_EQ(e.setInput(0, &input0, sizeof(input0)), Result::NO_ERROR);
+    ASSERT_EQ(e.setInput(1, &input1, sizeof(input1)), Result::NO_ERROR);
+    ASSERT_EQ(e.setOutput(0, &output, sizeof(output)), Result::NO_ERROR);
+    for (int i = 0; i < 3; ++i) {
+        SCOPED_TRACE(i);
+        input0 = static_cast<float>(i);
+        input1 = 2.0f;
+        ASSERT_EQ(e.compute(), Result::NO_ERROR);
+        EXPECT_EQ(output, input0 + 3 * input1);
+    }
+}
+
+TEST_F(PartitioningTest, StreamingExecution) {
+    PartitioningModel model;
+    uint32_t opnd0 = model.addFloatOperand();
+    uint32_t opnd1 = model.addFloatOperand();
+    uint32_t opnd2 = model.addOperation2To1V1_0(0, opnd0, opnd1);
+    uint32_t opnd3 = model.addOperation2To1V1_0(1, opnd2, opnd1);
+    uint32_t opnd4 = model.addOperation2To1V1_0(0, opnd3, opnd1);
+    model.identifyInputsAndOutputs({opnd0, opnd1}, {opnd4});
+    model.finish();
+    ASSERT_TRUE(model.isValid());
+
+    const auto devices = makeDevices({{"a", 0.5, 1 << 0}, {"b", 0.9, ~0U}});
+    PartitioningCompilation compilation(&model, devices);
+    ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
+    checkExecutionPlanSteps(compilation.getExecutionPlan(), {"a", "b", "a"});
+    ASSERT_EQ(compilation.getExecutionPlan().getStraightLineStepCount(), 3u);
+
+    StreamingExecution* streamPtr = nullptr;
+    ASSERT_EQ(compilation.builder()->createStreamingExecution(
+                      StreamingExecution::kDefaultMaxInFlight, &streamPtr),
+              ANEURALNETWORKS_NO_ERROR);
+    std::unique_ptr<StreamingExecution> stream(streamPtr);
+
+    // More computations than the stream lets in flight, so that streamCompute
+    // has to wait for earlier ones to leave the pipeline.
+    constexpr uint32_t kCount = 8;
+    const float input1 = 2.0f;
+    std::vector<float> inputs(kCount);
+    std::vector<float> outputs(kCount, 0.0f);
+    std::vector<std::unique_ptr<WrapperExecution>> executions;
+    std::vector<std::shared_ptr<ExecutionCallback>> callbacks(kCount);
+    for (uint32_t i = 0; i < kCount; ++i) {
+        inputs[i] = static_cast<float>(i);
+        executions.push_back(std::make_unique<WrapperExecution>(&compilation));
+        WrapperExecution* e = executions.back().get();
+        ASSERT_EQ(e->setInput(0, &inputs[i], sizeof(float)), Result::NO_ERROR);
+        ASSERT_EQ(e->setInput(1, &input1, sizeof(float)), Result::NO_ERROR);
+        ASSERT_EQ(e->setOutput(0, &outputs[i], sizeof(float)), Result::NO_ERROR);
+        ASSERT_EQ(reinterpret_cast<ExecutionBuilder*>(e->getHandle())
+                          ->streamCompute(stream.get(), &callbacks[i]),
+                  ANEURALNETWORKS_NO_ERROR);
+    }
+    for (uint32_t i = 0; i < kCount; ++i) {
+        SCOPED_TRACE(i);
+        callbacks[i]->wait();
+        EXPECT_EQ(callbacks[i]->getStatus(), ErrorStatus::NONE);
+        EXPECT_EQ(outputs[i], inputs[i] + 3 * input1);
+    }
+}
+
 TEST_F(PartitioningTest, ZeroInputStepModel) {
     PartitioningModel model;
     const uint32_t opnd0 = model.addFloatZeroOperand();
@@ -2475,6 +2719,61 @@ void DynamicTemporariesTest::executeCompilationAndCompareOutput(bool opnd2ModelO
     }
 }
 
+TEST_F(DynamicTemporariesTest, ReusableExecution) {
+    // The purpose of this test is to confirm that a reusable execution
+    // forgets the dimensions of a dynamic temporary learned by a computation,
+    // as the paddings and therefore these dimensions change between
+    // computations.
+
+    ASSERT_NO_FATAL_FAILURE(declareOutputDimensions(/*opnd2ModelAndPartitionOutputSpecified=*/false,
+                                                    /*opnd3PartitionOutputSpecified=*/false,
+                                                    /*opnd4ModelOutputSpecified=*/false));
+    ASSERT_NO_FATAL_FAILURE(makeModelAndValidate());
+    ASSERT_NO_FATAL_FAILURE(compileModelAndComparePlan());
+
+    WrapperExecution e(&mCompilation.value());
+    ASSERT_EQ(e.setReusable(true), Result::NO_ERROR);
+
+    WrapperOperandType padTensorValueType(WrapperType::TENSOR_FLOAT32, {2});
+    const float padTensorValue[] = {3.0f, 5.0f};
+    ASSERT_EQ(e.setInput(0, &padTensorValue, &padTensorValueType.operandType), Result::NO_ERROR);
+
+    WrapperOperandType paddingsType(WrapperType::TENSOR_INT32, {1, 2});
+    int paddings[1][2] = {};
+    ASSERT_EQ(e.setInput(1, &paddings, &paddingsType.operandType), Result::NO_ERROR);
+
+    constexpr uint32_t kMaxPadding = 2;
+    constexpr uint32_t kMaxElements = 2 + 2 * kMaxPadding;
+    WrapperOperandType outputType(WrapperType::TENSOR_FLOAT32, {});
+    float opnd2ModelOutput[kMaxElements], opnd4ModelOutput[kMaxElements];
+    ASSERT_EQ(e.setOutput(0, opnd2ModelOutput, sizeof(opnd2ModelOutput), &outputType.operandType),
+              Result::NO_ERROR);
+    ASSERT_EQ(e.setOutput(1, opnd4ModelOutput, sizeof(opnd4ModelOutput), &outputType.operandType),
+              Result::NO_ERROR);
+
+    for (int padding : {1, 0, 2, 1}) {
+        SCOPED_TRACE(padding);
+        paddings[0][0] = paddings[0][1] = padding;
+        ASSERT_EQ(e.compute(), Result::NO_ERROR);
+
+        const uint32_t elements = 2 + 2 * padding;
+        std::vector<float> expected(elements, 0.0f);
+        expected[padding] = padTensorValue[0];
+        expected[padding + 1] = padTensorValue[1];
+        for (uint32_t outputIndex : {0u, 1u}) {
+            SCOPED_TRACE(outputIndex);
+            std::vector<uint32_t> dimensions;
+            ASSERT_EQ(e.getOutputOperandDimensions(outputIndex, &dimensions), Result::NO_ERROR);
+            EXPECT_EQ(dimensions, std::vector<uint32_t>{elements});
+        }
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(), opnd2ModelOutput));
+        for (auto& elt : expected) {
+            elt *= 2;
+        }
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(), opnd4ModelOutput));
+    }
+}
+
 TEST_F(DynamicTemporariesTest, ModelOutputsSufficientSize) {
     // The purpose of this test is to confirm that the partitioner and the
     // runtime can handle a model output of unspecified dimensions but
@@ -3242,6 +3541,95 @@ TEST_F(ControlFlowPartitioningTest, WHILE_Interpreted) {
     checkExecutionPlanSteps(plan, {kWhileStep, cpuDeviceName, kGotoStep, "V1_0", kGotoStep});
 }
 
+TEST_F(ControlFlowPartitioningTest, IF_ReusableExecution) {
+    // The else branch clamps the sum to zero, so the computations below tell
+    // which branch they took.
+    auto thenModel = createBranchOrBodyModel(Dimensioned::YES);
+    PartitioningModel elseModel;
+    {
+        const uint32_t opnd0 = elseModel.addFloatOperand();
+        const uint32_t opnd1 = elseModel.addFloatOperand();
+        // ADD with a fused RELU.
+        const uint32_t opnd2 = elseModel.addOperation2To1V1_0(1, opnd0, opnd1);
+        elseModel.identifyInputsAndOutputs({opnd0, opnd1}, {opnd2});
+        elseModel.finish();
+        ASSERT_TRUE(elseModel.isValid());
+    }
+    PartitioningModel model;
+    const uint32_t opnd0 = model.addBooleanOperand();
+    const uint32_t opnd1 = model.addFloatOperand();
+    const uint32_t opnd2 = model.addFloatOperand();
+    const uint32_t opnd3 = model.addFloatOperand();
+    model.addIfOperation(opnd0, *thenModel, elseModel, {opnd1, opnd2}, {opnd3});
+    model.identifyInputsAndOutputs({opnd0, opnd1, opnd2}, {opnd3});
+    model.finish();
+    ASSERT_TRUE(model.isValid());
+
+    // The device supports the referenced models but does not support IF.
+    const auto devices = makeDevices({{"V1_0", 0.9, HalVersion::V1_0, ~0U}});
+    PartitioningCompilation compilation(&model, devices);
+    ASSERT_EQ(compilation.setPartitioning(DeviceManager::kPartitioningWithoutFallback),
+              Result::NO_ERROR);
+    ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
+    checkExecutionPlanSteps(compilation.getExecutionPlan(), {kIfStep, "V1_0", kGotoStep, "V1_0"});
+
+    // Each computation takes a branch that may differ from the previous one,
+    // so the IF step has to start from the initial locations of the operands.
+    uint8_t condition = 0;
+    const float input0 = -1.0f;
+    const float input1 = -2.0f;
+    float output = 0.0f;
+    WrapperExecution e(&compilation);
+    ASSERT_EQ(e.setReusable(true), Result::NO_ERROR);
+    ASSERT_EQ(e.setInput(0, &condition, sizeof(condition)), Result::NO_ERROR);
+    ASSERT_EQ(e.setInput(1, &input0, sizeof(input0)), Result::NO_ERROR);
+    ASSERT_EQ(e.setInput(2, &input1, sizeof(input1)), Result::NO_ERROR);
+    ASSERT_EQ(e.setOutput(0, &output, sizeof(output)), Result::NO_ERROR);
+    for (bool takeThen : {true, false, false, true}) {
+        SCOPED_TRACE(takeThen);
+        condition = takeThen;
+        output = 1.0f;
+        ASSERT_EQ(e.compute(), Result::NO_ERROR);
+        EXPECT_EQ(output, takeThen ? input0 + input1 : 0.0f);
+    }
+}
+
+TEST_F(ControlFlowPartitioningTest, WHILE_ReusableExecution) {
+    // while (opnd0 == opnd1) opnd0 = opnd0 + opnd1
+    const auto models = createWhileModel();
+
+    // The device supports the body model but does not support WHILE or the
+    // condition model (because of EQUAL).
+    const auto devices = makeDevices({{"V1_0", 0.9, HalVersion::V1_0, ~0U}});
+    PartitioningCompilation compilation(models[0].get(), devices);
+    ASSERT_EQ(compilation.setPartitioning(DeviceManager::kPartitioningWithoutFallback),
+              Result::NO_ERROR);
+    ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
+    const auto& cpuDeviceName = DeviceManager::getCpuDevice()->getName();
+    checkExecutionPlanSteps(compilation.getExecutionPlan(),
+                            {kWhileStep, cpuDeviceName, kGotoStep, "V1_0", kGotoStep});
+
+    // The number of iterations differs between the computations, so the
+    // WHILE step has to start from its initial state every time.
+    float input0 = 0.0f;
+    float input1 = 0.0f;
+    float output = 0.0f;
+    WrapperExecution e(&compilation);
+    ASSERT_EQ(e.setReusable(true), Result::NO_ERROR);
+    ASSERT_EQ(e.setInput(0, &input0, sizeof(input0)), Result::NO_ERROR);
+    ASSERT_EQ(e.setInput(1, &input1, sizeof(input1)), Result::NO_ERROR);
+    ASSERT_EQ(e.setOutput(0, &output, sizeof(output)), Result::NO_ERROR);
+    const std::vector<std::tuple<float, float, float>> cases = {
+            {1.0f, 1.0f, 2.0f}, {2.0f, 1.0f, 2.0f}, {3.0f, 3.0f, 6.0f}, {5.0f, 4.0f, 5.0f}};
+    for (const auto& [value0, value1, expected] : cases) {
+        SCOPED_TRACE(value0);
+        input0 = value0;
+        input1 = value1;
+        ASSERT_EQ(e.compute(), Result::NO_ERROR);
+        EXPECT_EQ(output, expected);
+    }
+}
+
 TEST_F(ControlFlowPartitioningTest, IF_SimplePlan) {
     const auto models = createIfModel();
 
@@ -40,6 +40,7 @@
 #include "ModelBuilder.h"
 #include "NeuralNetworks.h"
 #include "TestNeuralNetworksWrapper.h"
+#include "TypeManager.h"
 
 // Uncomment the following line to generate some debugging output that
 // may be useful when analyzing failures:
@@ -236,6 +237,10 @@ class TestCompilation : public WrapperCompilation {
         return static_cast<Result>(builder()->forTest_setPartitioning(partitioning));
     }
 
+    Result setPartitioningStrategy(uint32_t strategy) {
+        return static_cast<Result>(builder()->forTest_setPartitioningStrategy(strategy));
+    }
+
     const ExecutionPlan& getExecutionPlan() const { return builder()->forTest_getExecutionPlan(); }
 
    private:
@@ -352,6 +357,14 @@ class RandomPartitioningTest : public ::testing::TestWithParam<unsigned> {
 
     static std::string to_string(HalVersion version);
 
+    // The number of steps of a plan and the number of bytes of the
+    // temporaries that its steps pass to each other.
+    struct BoundaryStats {
+        size_t stepCount = 0;
+        uint64_t temporaryBytes = 0;
+    };
+    static BoundaryStats getBoundaryStats(const ExecutionPlan& plan);
+
     bool randBool() { return randUInt(2) == 1; }
 
     double randFrac() {  // [0.0, 1.0)
@@ -636,6 +649,26 @@ SharedDevice RandomPartitioningTest::makeTestDriver(HalVersion version, const ch
     }
 }
 
+RandomPartitioningTest::BoundaryStats RandomPartitioningTest::getBoundaryStats(
+        const ExecutionPlan& plan) {
+    BoundaryStats stats;
+    if (plan.forTest_getKind() != ExecutionPlan::Kind::COMPOUND) {
+        stats.stepCount = 1;
+        return stats;
+    }
+    for (const auto& step : plan.forTest_compoundGetSteps()) {
+        if (const ExecutionStep* executionStep = step->tryExecutionStep()) {
+            stats.stepCount++;
+            for (const auto& [sourceOperandIndex, stepOperandIndex] :
+                 executionStep->getTempsAsStepModelOutputs()) {
+                stats.temporaryBytes += nn::TypeManager::get()->getSizeOfData(
+                        executionStep->getSourceModel()->getOperand(sourceOperandIndex));
+            }
+        }
+    }
+    return stats;
+}
+
 INSTANTIATE_TEST_SUITE_P(Seed, RandomPartitioningTest,
                          ::testing::Range(kFirstSeed, kFirstSeed + kNumTestCases));
 
@@ -1115,6 +1148,10 @@ TEST_P(RandomPartitioningTest, Test) {
     // without CPU fallback.
     TestCompilation cNoFallback(&model, devices);
     TestCompilation cWithFallback(&model, devices);
+    for (TestCompilation* compilation : {&cNoFallback, &cWithFallback}) {
+        ASSERT_EQ(compilation->setPartitioningStrategy(DeviceManager::kPartitioningStrategyGreedy),
+                  Result::NO_ERROR);
+    }
     ASSERT_EQ(cNoFallback.setPartitioning(DeviceManager::kPartitioningWithoutFallback),
               Result::NO_ERROR);
     auto compilationResult = cNoFallback.finish();
@@ -1389,14 +1426,10 @@ TEST_P(RandomPartitioningTest, Test) {
         }
     }
 
-    // Partitioned execution.
-    WrapperExecution e2(&c2);
-    ASSERT_NO_FATAL_FAILURE(prepareForExecution(&e2));
-    ASSERT_EQ(e2.compute(computeMode), Result::NO_ERROR);
-
-    // Compare the outputs of the partitioned execution to the save
+    // Function to compare the outputs of a partitioned execution to the save
     // area containing the outpus of the non-partitioned execution.
-    {
+    auto checkPartitionedOutputs = [&ioDescriptors, &ioMemories, &nonPartitionedOutputs,
+                                    problemSize] {
         uint32_t outputIndex = 0;
         for (const auto& desc : ioDescriptors) {
             if (desc.mKind != InputOutputDescriptor::OUTPUT) {
@@ -1422,7 +1455,41 @@ TEST_P(RandomPartitioningTest, Test) {
             }
             outputIndex++;
         }
+    };
+
+    // Partitioned execution.
+    WrapperExecution e2(&c2);
+    ASSERT_NO_FATAL_FAILURE(prepareForExecution(&e2));
+    ASSERT_EQ(e2.compute(computeMode), Result::NO_ERROR);
+    ASSERT_NO_FATAL_FAILURE(checkPartitionedOutputs());
+
+    // Partitioned execution with the strategy that minimizes the boundaries
+    // between steps. It may run operations on other devices than the greedy
+    // strategy, but must compute the same outputs. Fallback is allowed, as
+    // moving operations between devices may make it needed or not.
+    TestCompilation c3(&model, devices);
+    ASSERT_EQ(c3.setPartitioning(DeviceManager::kPartitioningWithFallback), Result::NO_ERROR);
+    ASSERT_EQ(c3.setPartitioningStrategy(DeviceManager::kPartitioningStrategyMinimizeBoundaries),
+              Result::NO_ERROR);
+    ASSERT_EQ(c3.finish(), Result::NO_ERROR);
+    {
+        const BoundaryStats greedy = getBoundaryStats(c2.getExecutionPlan());
+        const BoundaryStats minimized = getBoundaryStats(c3.getExecutionPlan());
+        LOG(INFO) << "RandomPartitioningTest: greedy: " << greedy.stepCount << " steps, "
+                  << greedy.temporaryBytes << " bytes between steps; minimize boundaries: "
+                  << minimized.stepCount << " steps, " << minimized.temporaryBytes
+                  << " bytes between steps";
+        // Moving an operation to another device only happens when it lowers
+        // the temporaries passed between devices.
+        if (c2.getExecutionPlan().forTest_getKind() == ExecutionPlan::Kind::COMPOUND &&
+            c3.getExecutionPlan().forTest_getKind() == ExecutionPlan::Kind::COMPOUND) {
+            EXPECT_LE(minimized.temporaryBytes, greedy.temporaryBytes);
+        }
     }
+    WrapperExecution e3(&c3);
+    ASSERT_NO_FATAL_FAILURE(prepareForExecution(&e3));
+    ASSERT_EQ(e3.compute(computeMode), Result::NO_ERROR);
+    ASSERT_NO_FATAL_FAILURE(checkPartitionedOutputs());
 }
 
 }  // namespace